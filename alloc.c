@@ -0,0 +1,295 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+
+/**
+ * Stored in front of every tracked allocation, sized to keep the memory after it aligned for any type.
+ */
+typedef union AllocHeader
+{
+    struct
+    {
+        size_t size;
+        size_t site;
+
+        // bytes from the start of the underlying block to the header, only aligned allocations have any
+        size_t offset;
+    } info;
+    max_align_t align;
+} AllocHeader;
+
+/**
+ * Counters for one call site.
+ */
+typedef struct SiteCounters
+{
+    const char *file;
+    int line;
+    atomic_uint_fast64_t allocations;
+    atomic_uint_fast64_t bytes;
+    atomic_bool reported;
+} SiteCounters;
+
+static atomic_uint_fast64_t allocations;
+static atomic_uint_fast64_t frees;
+static atomic_uint_fast64_t bytes_in_use;
+static atomic_uint_fast64_t peak_bytes;
+static atomic_uint_fast64_t frame_allocations;
+static atomic_uint_fast64_t frame_bytes;
+static atomic_uint_fast64_t guarded_allocations;
+static atomic_int guard_mode;
+
+// sites are only ever added, under the lock, readers only look at the first site_count
+static SiteCounters sites[ALLOC_MAX_SITES];
+static atomic_size_t site_count;
+static atomic_flag site_lock = ATOMIC_FLAG_INIT;
+
+/**
+ * Helper function to find or add the counters for a call site.
+ *
+ * @param file
+ *   Source file of the call site.
+ *
+ * @param line
+ *   Line of the call site.
+ *
+ * @returns
+ *   Index of the site.
+ */
+static size_t find_site(const char *file, int line)
+{
+    size_t count = atomic_load_explicit(&site_count, memory_order_acquire);
+    for (size_t i = 0u; i < count; ++i)
+    {
+        if ((sites[i].line == line) && (sites[i].file == file))
+        {
+            return i;
+        }
+    }
+
+    while (atomic_flag_test_and_set_explicit(&site_lock, memory_order_acquire))
+    {
+    }
+
+    // another thread may have added it while we waited
+    count = atomic_load_explicit(&site_count, memory_order_relaxed);
+    size_t index = count;
+    for (size_t i = 0u; i < count; ++i)
+    {
+        if ((sites[i].line == line) && (sites[i].file == file))
+        {
+            index = i;
+            break;
+        }
+    }
+
+    if (index == count)
+    {
+        if (count == ALLOC_MAX_SITES)
+        {
+            index = ALLOC_MAX_SITES - 1u;
+        }
+        else
+        {
+            sites[index].file = file;
+            sites[index].line = line;
+            atomic_store_explicit(&site_count, count + 1u, memory_order_release);
+        }
+    }
+
+    atomic_flag_clear_explicit(&site_lock, memory_order_release);
+    return index;
+}
+
+/**
+ * Helper function to count an allocation.
+ *
+ * @param size
+ *   Bytes allocated.
+ *
+ * @param site
+ *   Call site index.
+ */
+static void count_allocation(size_t size, size_t site)
+{
+    atomic_fetch_add_explicit(&allocations, 1u, memory_order_relaxed);
+    atomic_fetch_add_explicit(&frame_allocations, 1u, memory_order_relaxed);
+    atomic_fetch_add_explicit(&frame_bytes, size, memory_order_relaxed);
+    atomic_fetch_add_explicit(&sites[site].allocations, 1u, memory_order_relaxed);
+    atomic_fetch_add_explicit(&sites[site].bytes, size, memory_order_relaxed);
+
+    const uint_fast64_t in_use = atomic_fetch_add_explicit(&bytes_in_use, size, memory_order_relaxed) + size;
+    uint_fast64_t peak = atomic_load_explicit(&peak_bytes, memory_order_relaxed);
+    while ((in_use > peak) &&
+           !atomic_compare_exchange_weak_explicit(&peak_bytes, &peak, in_use, memory_order_relaxed, memory_order_relaxed))
+    {
+    }
+
+    const AllocGuard guard = (AllocGuard)atomic_load_explicit(&guard_mode, memory_order_relaxed);
+    if (guard != ALLOC_GUARD_OFF)
+    {
+        atomic_fetch_add_explicit(&guarded_allocations, 1u, memory_order_relaxed);
+
+        // report each site once, it is likely to allocate every frame
+        if (!atomic_exchange_explicit(&sites[site].reported, true, memory_order_relaxed))
+        {
+            fprintf(stderr, "allocation during play: %s:%d (%zu bytes)\n", sites[site].file, sites[site].line, size);
+        }
+
+        if (guard == ALLOC_GUARD_ABORT)
+        {
+            abort();
+        }
+    }
+}
+
+void *calloc_tracked(size_t count, size_t size, const char *file, int line)
+{
+    if ((size != 0u) && (count > ((SIZE_MAX - sizeof(AllocHeader)) / size)))
+    {
+        return NULL;
+    }
+
+    const size_t bytes = count * size;
+    AllocHeader *header = (AllocHeader *)calloc(1u, sizeof(AllocHeader) + bytes);
+    if (header == NULL)
+    {
+        return NULL;
+    }
+
+    header->info.size = bytes;
+    header->info.site = find_site(file, line);
+    count_allocation(bytes, header->info.site);
+
+    return header + 1;
+}
+
+void *realloc_tracked(void *ptr, size_t size, const char *file, int line)
+{
+    if (ptr == NULL)
+    {
+        return calloc_tracked(1u, size, file, line);
+    }
+
+    if (size > (SIZE_MAX - sizeof(AllocHeader)))
+    {
+        return NULL;
+    }
+
+    AllocHeader *header = (AllocHeader *)ptr - 1;
+    const size_t old_size = header->info.size;
+
+    // realloc can't keep an alignment it doesn't know about
+    assert(header->info.offset == 0u);
+
+    AllocHeader *n_header = (AllocHeader *)realloc(header, sizeof(AllocHeader) + size);
+    if (n_header == NULL)
+    {
+        return NULL;
+    }
+
+    atomic_fetch_add_explicit(&frees, 1u, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&bytes_in_use, old_size, memory_order_relaxed);
+
+    n_header->info.size = size;
+    n_header->info.site = find_site(file, line);
+    count_allocation(size, n_header->info.site);
+
+    return n_header + 1;
+}
+
+void *calloc_aligned_tracked(size_t alignment, size_t size, const char *file, int line)
+{
+    assert((alignment & (alignment - 1u)) == 0u);
+    assert(alignment >= _Alignof(AllocHeader));
+
+    // the header sits right in front of the memory handed out, at the end of a whole number of alignments
+    const size_t prefix = ((sizeof(AllocHeader) + alignment - 1u) / alignment) * alignment;
+    if (size > (SIZE_MAX - prefix - alignment))
+    {
+        return NULL;
+    }
+
+    const size_t total = ((prefix + size + alignment - 1u) / alignment) * alignment;
+    uint8_t *block = (uint8_t *)aligned_alloc(alignment, total);
+    if (block == NULL)
+    {
+        return NULL;
+    }
+
+    memset(block, 0, total);
+
+    AllocHeader *header = (AllocHeader *)(block + prefix) - 1;
+    header->info.size = size;
+    header->info.site = find_site(file, line);
+    header->info.offset = prefix - sizeof(AllocHeader);
+    count_allocation(size, header->info.site);
+
+    return block + prefix;
+}
+
+void free_tracked(void *ptr)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    AllocHeader *header = (AllocHeader *)ptr - 1;
+
+    atomic_fetch_add_explicit(&frees, 1u, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&bytes_in_use, header->info.size, memory_order_relaxed);
+
+    free((uint8_t *)header - header->info.offset);
+}
+
+void set_alloc_guard(AllocGuard guard)
+{
+    atomic_store_explicit(&guard_mode, (int)guard, memory_order_relaxed);
+}
+
+void begin_alloc_frame(void)
+{
+    atomic_store_explicit(&frame_allocations, 0u, memory_order_relaxed);
+    atomic_store_explicit(&frame_bytes, 0u, memory_order_relaxed);
+}
+
+void get_alloc_stats(AllocStats *stats)
+{
+    assert(stats != NULL);
+
+    *stats = (AllocStats){
+        .allocations = atomic_load_explicit(&allocations, memory_order_relaxed),
+        .frees = atomic_load_explicit(&frees, memory_order_relaxed),
+        .bytes_in_use = atomic_load_explicit(&bytes_in_use, memory_order_relaxed),
+        .peak_bytes = atomic_load_explicit(&peak_bytes, memory_order_relaxed),
+        .frame_allocations = atomic_load_explicit(&frame_allocations, memory_order_relaxed),
+        .frame_bytes = atomic_load_explicit(&frame_bytes, memory_order_relaxed),
+        .guarded_allocations = atomic_load_explicit(&guarded_allocations, memory_order_relaxed)};
+}
+
+size_t get_alloc_sites(AllocSite *out, size_t capacity)
+{
+    assert((out != NULL) || (capacity == 0u));
+
+    const size_t count = atomic_load_explicit(&site_count, memory_order_acquire);
+    size_t written = 0u;
+
+    for (size_t i = 0u; (i < count) && (written < capacity); ++i)
+    {
+        out[written++] = (AllocSite){
+            .file = sites[i].file,
+            .line = sites[i].line,
+            .allocations = atomic_load_explicit(&sites[i].allocations, memory_order_relaxed),
+            .bytes = atomic_load_explicit(&sites[i].bytes, memory_order_relaxed)};
+    }
+
+    return written;
+}
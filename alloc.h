@@ -0,0 +1,178 @@
+#ifndef _ALLOC_H_
+#define _ALLOC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Alloc counts heap allocations so the ones made while playing can be found.
+ *
+ * Tracked allocations carry a small header recording their size and call site. Counts are kept in total, per frame
+ * and per call site, along with the bytes in use and the peak. Once a level has loaded the game should not need to
+ * allocate, a guard can be armed to report or abort on any allocation after that point.
+ *
+ * Memory from the tracked functions must only be released with free_tracked and vice versa. Counters are atomic so
+ * SDL's own threads can allocate through here too.
+ *
+ * Everything the game allocates comes through here, the simulation, grid, particles, rewind, netplay, jobs and SDL
+ * alike, so the counts, the peak and the guard cover the whole heap. The only exceptions are the telemetry object,
+ * which breakout_stat shares without a tracker, and the block realtime allocates straight from malloc to prefault its
+ * arena.
+ */
+
+/**
+ * Allocate through the tracker, recording the call site.
+ */
+#define TRACKED_CALLOC(COUNT, SIZE) calloc_tracked((COUNT), (SIZE), __FILE__, __LINE__)
+#define TRACKED_REALLOC(PTR, SIZE) realloc_tracked((PTR), (SIZE), __FILE__, __LINE__)
+#define TRACKED_ALIGNED_CALLOC(ALIGNMENT, SIZE) calloc_aligned_tracked((ALIGNMENT), (SIZE), __FILE__, __LINE__)
+
+/**
+ * Maximum number of call sites counted separately, any more are counted together under the last one.
+ */
+#define ALLOC_MAX_SITES 64u
+
+/**
+ * What to do about an allocation while the guard is armed.
+ */
+typedef enum AllocGuard
+{
+    ALLOC_GUARD_OFF,
+    ALLOC_GUARD_REPORT,
+    ALLOC_GUARD_ABORT
+} AllocGuard;
+
+/**
+ * Allocation totals.
+ */
+typedef struct AllocStats
+{
+    uint64_t allocations;
+    uint64_t frees;
+    uint64_t bytes_in_use;
+    uint64_t peak_bytes;
+
+    // since the last begin_alloc_frame
+    uint64_t frame_allocations;
+    uint64_t frame_bytes;
+
+    // made while the guard was armed
+    uint64_t guarded_allocations;
+} AllocStats;
+
+/**
+ * Allocation totals for one call site.
+ */
+typedef struct AllocSite
+{
+    const char *file;
+    int line;
+    uint64_t allocations;
+    uint64_t bytes;
+} AllocSite;
+
+/**
+ * Allocate zeroed memory, like calloc.
+ *
+ * @param count
+ *   Number of elements.
+ *
+ * @param size
+ *   Size of each element.
+ *
+ * @param file
+ *   Source file of the call site.
+ *
+ * @param line
+ *   Line of the call site.
+ *
+ * @returns
+ *   Allocated memory or NULL on failure.
+ */
+void *calloc_tracked(size_t count, size_t size, const char *file, int line);
+
+/**
+ * Resize an allocation, like realloc. Growing an allocation counts as a new allocation of the new size.
+ *
+ * @param ptr
+ *   Memory from calloc_tracked or realloc_tracked, or NULL.
+ *
+ * @param size
+ *   New size.
+ *
+ * @param file
+ *   Source file of the call site.
+ *
+ * @param line
+ *   Line of the call site.
+ *
+ * @returns
+ *   Resized memory or NULL on failure, in which case ptr is untouched.
+ */
+void *realloc_tracked(void *ptr, size_t size, const char *file, int line);
+
+/**
+ * Allocate zeroed memory aligned beyond what calloc gives, for data kept on cache lines of its own or loaded a vector
+ * at a time. The memory can't be passed to realloc_tracked.
+ *
+ * @param alignment
+ *   Alignment, a power of two no smaller than any type's.
+ *
+ * @param size
+ *   Bytes to allocate.
+ *
+ * @param file
+ *   Source file of the call site.
+ *
+ * @param line
+ *   Line of the call site.
+ *
+ * @returns
+ *   Allocated memory or NULL on failure.
+ */
+void *calloc_aligned_tracked(size_t alignment, size_t size, const char *file, int line);
+
+/**
+ * Free memory from calloc_tracked, realloc_tracked or calloc_aligned_tracked.
+ *
+ * @param ptr
+ *   Memory to free, may be NULL.
+ */
+void free_tracked(void *ptr);
+
+/**
+ * Set what happens on an allocation from now on. Arm the guard once loading is done.
+ *
+ * @param guard
+ *   Guard mode.
+ */
+void set_alloc_guard(AllocGuard guard);
+
+/**
+ * Start counting a new frame.
+ */
+void begin_alloc_frame(void);
+
+/**
+ * Get allocation totals.
+ *
+ * @param stats
+ *   Out parameter for totals.
+ */
+void get_alloc_stats(AllocStats *stats);
+
+/**
+ * Get the call sites that have allocated.
+ *
+ * @param sites
+ *   Out parameter for call sites.
+ *
+ * @param capacity
+ *   Number of sites that fit in sites.
+ *
+ * @returns
+ *   Number of sites written.
+ */
+size_t get_alloc_sites(AllocSite *sites, size_t capacity);
+
+#endif
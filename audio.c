@@ -0,0 +1,339 @@
+#include <assert.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "alloc.h"
+#include "audio.h"
+
+#include <SDL2/SDL.h>
+
+/**
+ * Output sample rate in Hz.
+ */
+#define SAMPLE_RATE 44100
+
+/**
+ * Number of sounds that can play at once, when all are busy the oldest voice is stolen.
+ */
+#define VOICE_COUNT 16u
+
+/**
+ * Capacity of the command queue, must be a power of two.
+ */
+#define QUEUE_CAPACITY 64u
+
+/**
+ * Number of samples mixed at a time in the callback.
+ */
+#define MIX_CHUNK 256
+
+/**
+ * Pre-generated PCM data for a sound.
+ */
+typedef struct Sample
+{
+    int16_t *data;
+    uint32_t length;
+} Sample;
+
+/**
+ * A voice plays one sample, length 0 means the voice is free.
+ */
+typedef struct Voice
+{
+    const Sample *sample;
+    uint32_t position;
+} Voice;
+
+typedef struct Audio
+{
+    SDL_AudioDeviceID device;
+    Sample samples[SOUND_COUNT];
+
+    // only touched by the audio callback
+    Voice voices[VOICE_COUNT];
+
+    // single producer (game thread) single consumer (audio callback) ring buffer
+    uint8_t queue[QUEUE_CAPACITY];
+    _Atomic uint32_t queue_head;
+    _Atomic uint32_t queue_tail;
+
+    // written by the game thread, except mixed which the audio callback counts
+    uint64_t queued;
+    uint64_t dropped;
+    atomic_uint_fast64_t mixed;
+} Audio;
+
+/**
+ * Helper function to generate a decaying tone.
+ *
+ * @param sample
+ *   Sample to fill in.
+ *
+ * @param frequency
+ *   Tone frequency in Hz.
+ *
+ * @param duration
+ *   Tone duration in seconds.
+ *
+ * @param square
+ *   True for a square wave, false for a sine wave.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result create_tone(Sample *sample, float frequency, float duration, bool square)
+{
+    sample->length = (uint32_t)(duration * SAMPLE_RATE);
+    sample->data = (int16_t *)TRACKED_CALLOC(sample->length, sizeof(int16_t));
+    if (sample->data == NULL)
+    {
+        return FAILED;
+    }
+
+    const float two_pi = 6.28318530718f;
+    for (uint32_t i = 0u; i < sample->length; ++i)
+    {
+        const float t = (float)i / SAMPLE_RATE;
+        const float envelope = 1.0f - ((float)i / sample->length);
+        float wave = sinf(two_pi * frequency * t);
+        if (square)
+        {
+            wave = (wave >= 0.0f) ? 1.0f : -1.0f;
+        }
+
+        sample->data[i] = (int16_t)(wave * envelope * envelope * 6000.0f);
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * Helper function to start a voice, stealing the oldest one if they are all busy.
+ *
+ * @param audio
+ *   Audio to start voice on.
+ *
+ * @param sound
+ *   Sound to play.
+ */
+static void start_voice(Audio *audio, Sound sound)
+{
+    Voice *target = &audio->voices[0];
+
+    for (uint32_t i = 0u; i < VOICE_COUNT; ++i)
+    {
+        Voice *voice = &audio->voices[i];
+        if (voice->sample == NULL)
+        {
+            target = voice;
+            break;
+        }
+
+        // the voice that has played the most is the oldest
+        if (voice->position > target->position)
+        {
+            target = voice;
+        }
+    }
+
+    target->sample = &audio->samples[sound];
+    target->position = 0u;
+}
+
+/**
+ * SDL audio callback, runs on the audio thread. This must never lock or allocate.
+ */
+static void mix_audio(void *userdata, Uint8 *stream, int len)
+{
+    Audio *audio = (Audio *)userdata;
+
+    // drain all pending commands
+    uint32_t tail = atomic_load_explicit(&audio->queue_tail, memory_order_relaxed);
+    const uint32_t head = atomic_load_explicit(&audio->queue_head, memory_order_acquire);
+    const uint32_t first = tail;
+    while (tail != head)
+    {
+        start_voice(audio, (Sound)audio->queue[tail & (QUEUE_CAPACITY - 1u)]);
+        ++tail;
+    }
+    atomic_store_explicit(&audio->queue_tail, tail, memory_order_release);
+    atomic_fetch_add_explicit(&audio->mixed, tail - first, memory_order_relaxed);
+
+    int16_t *out = (int16_t *)stream;
+    int remaining = len / (int)sizeof(int16_t);
+
+    while (remaining > 0)
+    {
+        const int count = (remaining < MIX_CHUNK) ? remaining : MIX_CHUNK;
+        int32_t mix[MIX_CHUNK] = {0};
+
+        for (uint32_t v = 0u; v < VOICE_COUNT; ++v)
+        {
+            Voice *voice = &audio->voices[v];
+            if (voice->sample == NULL)
+            {
+                continue;
+            }
+
+            uint32_t available = voice->sample->length - voice->position;
+            uint32_t n = (available < (uint32_t)count) ? available : (uint32_t)count;
+            const int16_t *src = voice->sample->data + voice->position;
+            for (uint32_t i = 0u; i < n; ++i)
+            {
+                mix[i] += src[i];
+            }
+
+            voice->position += n;
+            if (voice->position >= voice->sample->length)
+            {
+                voice->sample = NULL;
+                voice->position = 0u;
+            }
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            int32_t value = mix[i];
+            value = (value > INT16_MAX) ? INT16_MAX : value;
+            value = (value < INT16_MIN) ? INT16_MIN : value;
+            out[i] = (int16_t)value;
+        }
+
+        out += count;
+        remaining -= count;
+    }
+}
+
+Result create_audio(Audio **audio)
+{
+    assert(audio != NULL);
+
+    Result res = SUCCESS;
+
+    Audio *n_audio = (Audio *)TRACKED_CALLOC(1u, sizeof(Audio));
+    if (n_audio == NULL)
+    {
+        res = FAILED;
+        return res;
+    }
+    atomic_init(&n_audio->mixed, 0u);
+
+    if ((create_tone(&n_audio->samples[BRICK_SOUND], 880.0f, 0.08f, true) != SUCCESS) ||
+        (create_tone(&n_audio->samples[PADDLE_SOUND], 440.0f, 0.1f, false) != SUCCESS) ||
+        (create_tone(&n_audio->samples[WALL_SOUND], 220.0f, 0.05f, false) != SUCCESS))
+    {
+        res = FAILED;
+        destroy_audio(n_audio);
+        return res;
+    }
+
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0)
+    {
+        res = FAILED;
+        destroy_audio(n_audio);
+        return res;
+    }
+
+    SDL_AudioSpec spec = {
+        .freq = SAMPLE_RATE,
+        .format = AUDIO_S16SYS,
+        .channels = 1u,
+        .samples = 512u,
+        .callback = &mix_audio,
+        .userdata = n_audio};
+
+    // no changes allowed, SDL converts for us if the device wants something else
+    n_audio->device = SDL_OpenAudioDevice(NULL, 0, &spec, NULL, 0);
+    if (n_audio->device == 0u)
+    {
+        res = FAILED;
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        destroy_audio(n_audio);
+        return res;
+    }
+
+    SDL_PauseAudioDevice(n_audio->device, 0);
+
+    // assign the audio to the user supplied pointer
+    *audio = n_audio;
+    return res;
+}
+
+void destroy_audio(Audio *audio)
+{
+    if (audio == NULL)
+    {
+        return;
+    }
+
+    if (audio->device != 0u)
+    {
+        SDL_CloseAudioDevice(audio->device);
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    }
+
+    for (int i = 0; i < SOUND_COUNT; ++i)
+    {
+        free_tracked(audio->samples[i].data);
+    }
+
+    free_tracked(audio);
+}
+
+Result play_sound_audio(Audio *audio, Sound sound)
+{
+    assert(audio != NULL);
+    assert(sound < SOUND_COUNT);
+
+    Result result = SUCCESS;
+
+    const uint32_t head = atomic_load_explicit(&audio->queue_head, memory_order_relaxed);
+    const uint32_t tail = atomic_load_explicit(&audio->queue_tail, memory_order_acquire);
+    if ((head - tail) >= QUEUE_CAPACITY)
+    {
+        // queue full, drop the sound rather than block the game
+        ++audio->dropped;
+        result = FAILED;
+        return result;
+    }
+
+    audio->queue[head & (QUEUE_CAPACITY - 1u)] = (uint8_t)sound;
+    atomic_store_explicit(&audio->queue_head, head + 1u, memory_order_release);
+    ++audio->queued;
+
+    return result;
+}
+
+Result flush_audio(Audio *audio, uint32_t timeout_ms)
+{
+    assert(audio != NULL);
+
+    const uint32_t head = atomic_load_explicit(&audio->queue_head, memory_order_relaxed);
+    for (uint32_t waited = 0u; atomic_load_explicit(&audio->queue_tail, memory_order_acquire) != head; ++waited)
+    {
+        if (waited >= timeout_ms)
+        {
+            return FAILED;
+        }
+
+        SDL_Delay(1u);
+    }
+
+    return SUCCESS;
+}
+
+void get_audio_stats(const Audio *audio, AudioStats *stats)
+{
+    assert(audio != NULL);
+    assert(stats != NULL);
+
+    *stats = (AudioStats){
+        .queued = audio->queued,
+        .mixed = (uint64_t)atomic_load_explicit(&audio->mixed, memory_order_relaxed),
+        .dropped = audio->dropped};
+}
@@ -0,0 +1,112 @@
+#ifndef _AUDIO_H_
+#define _AUDIO_H_
+
+#include <stdint.h>
+
+#include "result.h"
+
+/**
+ * Audio is responsible for opening the audio device and mixing sound effects.
+ *
+ * Sounds are requested from the game thread through a lock-free single producer single consumer queue and mixed in the
+ * SDL audio callback from a fixed pool of voices, so the callback never locks or allocates. All sounds are generated
+ * into memory when the audio object is created.
+ *
+ * This works with any SDL audio driver, set SDL_AUDIODRIVER=dummy (or disk) to run without an audio device.
+ */
+
+/**
+ * Sound effects that can be played.
+ */
+typedef enum Sound
+{
+    BRICK_SOUND,
+    PADDLE_SOUND,
+    WALL_SOUND,
+    SOUND_COUNT,
+} Sound;
+
+/**
+ * Counts of sound commands so far.
+ */
+typedef struct AudioStats
+{
+    // accepted by play_sound_audio
+    uint64_t queued;
+    // taken off the queue by the mixer
+    uint64_t mixed;
+    // turned away because the queue was full
+    uint64_t dropped;
+} AudioStats;
+
+/**
+ * Audio internal data.
+ */
+typedef struct Audio Audio;
+
+/**
+ * Create audio, open the default audio device and start playback.
+ *
+ * @param audio
+ *   Created audio object.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result create_audio(Audio **audio);
+
+/**
+ * Stop playback and destroy audio.
+ *
+ * @param audio
+ *   The audio to destroy.
+ */
+void destroy_audio(Audio *audio);
+
+/**
+ * Queue a sound to be played.
+ *
+ * This must only be called from one thread (the game thread) and never blocks.
+ *
+ * @param audio
+ *   Audio to play sound on.
+ *
+ * @param sound
+ *   Sound to play.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the command queue is full
+ */
+Result play_sound_audio(Audio *audio, Sound sound);
+
+/**
+ * Wait for the mixer to take every queued sound, for comparing counts once a game is over.
+ *
+ * This must only be called from the thread that queues sounds.
+ *
+ * @param audio
+ *   Audio to wait for.
+ *
+ * @param timeout_ms
+ *   Longest to wait.
+ *
+ * @returns
+ *   SUCCESS once the queue is empty
+ *   FAILED if the mixer didn't empty it in time
+ */
+Result flush_audio(Audio *audio, uint32_t timeout_ms);
+
+/**
+ * Get counts of sound commands.
+ *
+ * @param audio
+ *   Audio to get counts for.
+ *
+ * @param stats
+ *   Out parameter for the counts.
+ */
+void get_audio_stats(const Audio *audio, AudioStats *stats);
+
+#endif
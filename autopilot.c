@@ -0,0 +1,393 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "autopilot.h"
+
+/**
+ * Maximum number of bounces followed before giving up on a prediction.
+ */
+#define MAX_BOUNCES 64
+
+/**
+ * How close (in pixels) the paddle has to be to its target before it stops moving.
+ */
+#define DEADBAND SCALAR(1.0f)
+
+/**
+ * A ray in world space, direction is the ball velocity so t is measured in steps. Built on Scalar like the game, so a
+ * fixed point build predicts, and so steers, with the same integer arithmetic on every machine.
+ */
+typedef struct Ray
+{
+    Scalar x;
+    Scalar y;
+    Scalar dx;
+    Scalar dy;
+} Ray;
+
+/**
+ * Helper function to get the smaller of two scalars.
+ *
+ * @param a
+ *   First value.
+ *
+ * @param b
+ *   Second value.
+ *
+ * @returns
+ *   The smaller value.
+ */
+static Scalar min_scalar(Scalar a, Scalar b)
+{
+    return (a < b) ? a : b;
+}
+
+/**
+ * Helper function to get the larger of two scalars.
+ *
+ * @param a
+ *   First value.
+ *
+ * @param b
+ *   Second value.
+ *
+ * @returns
+ *   The larger value.
+ */
+static Scalar max_scalar(Scalar a, Scalar b)
+{
+    return (a > b) ? a : b;
+}
+
+/**
+ * Helper function to add a time to a time that may already be SCALAR_MAX, without wrapping round.
+ *
+ * @param t
+ *   Time to add to.
+ *
+ * @param delta
+ *   Non negative time to add.
+ *
+ * @returns
+ *   The sum, or SCALAR_MAX if it doesn't fit.
+ */
+static Scalar add_time(Scalar t, Scalar delta)
+{
+    return (t > (SCALAR_MAX - delta)) ? SCALAR_MAX : (t + delta);
+}
+
+/**
+ * Helper function to intersect a ray with a box using the slab method.
+ *
+ * @param ray
+ *   Ray to cast.
+ *
+ * @param min_x
+ *   Left edge of box.
+ *
+ * @param min_y
+ *   Top edge of box.
+ *
+ * @param max_x
+ *   Right edge of box.
+ *
+ * @param max_y
+ *   Bottom edge of box.
+ *
+ * @param t
+ *   Out parameter for the time the ray enters the box.
+ *
+ * @param flip_x
+ *   Out parameter, true if the ray enters through a left or right face.
+ *
+ * @returns
+ *   True if the ray enters the box at t >= 0, otherwise false.
+ */
+static bool intersect_box(
+    const Ray *ray, Scalar min_x, Scalar min_y, Scalar max_x, Scalar max_y, Scalar *t, bool *flip_x)
+{
+    Scalar enter_x = -SCALAR_MAX;
+    Scalar exit_x = SCALAR_MAX;
+    Scalar enter_y = -SCALAR_MAX;
+    Scalar exit_y = SCALAR_MAX;
+
+    if (ray->dx != SCALAR(0.0f))
+    {
+        const Scalar t0 = scalar_div_clamped(min_x - ray->x, ray->dx);
+        const Scalar t1 = scalar_div_clamped(max_x - ray->x, ray->dx);
+        enter_x = min_scalar(t0, t1);
+        exit_x = max_scalar(t0, t1);
+    }
+    else if ((ray->x < min_x) || (ray->x > max_x))
+    {
+        return false;
+    }
+
+    if (ray->dy != SCALAR(0.0f))
+    {
+        const Scalar t0 = scalar_div_clamped(min_y - ray->y, ray->dy);
+        const Scalar t1 = scalar_div_clamped(max_y - ray->y, ray->dy);
+        enter_y = min_scalar(t0, t1);
+        exit_y = max_scalar(t0, t1);
+    }
+    else if ((ray->y < min_y) || (ray->y > max_y))
+    {
+        return false;
+    }
+
+    const Scalar enter = max_scalar(enter_x, enter_y);
+    const Scalar exit = min_scalar(exit_x, exit_y);
+
+    // starting inside a box means the game is already resolving that collision
+    if ((enter > exit) || (enter < SCALAR(0.0f)))
+    {
+        return false;
+    }
+
+    *t = enter;
+    *flip_x = enter_x > enter_y;
+    return true;
+}
+
+/**
+ * Helper function to find the first live brick the ball hits along a ray, walking the grid cell by cell.
+ *
+ * @param game
+ *   Game with the bricks.
+ *
+ * @param ray
+ *   Path of the ball's upper left corner.
+ *
+ * @param t_max
+ *   Only look for hits before this time.
+ *
+ * @param skip
+ *   Brick to ignore (the one just bounced off, the game destroys it).
+ *
+ * @param t_hit
+ *   Out parameter for time of hit.
+ *
+ * @param flip_x
+ *   Out parameter, true if the ball bounces off a left or right face.
+ *
+ * @param hit
+ *   Out parameter for the index of the brick hit.
+ *
+ * @returns
+ *   True if a brick is hit before t_max, otherwise false.
+ */
+static bool cast_bricks(
+    const Game *game, const Ray *ray, Scalar t_max, uint32_t skip, Scalar *t_hit, bool *flip_x, uint32_t *hit)
+{
+    const Scalar cell = GAME_CELL_SIZE;
+    const Scalar ball_width = game->state.ball.block.width;
+    const Scalar ball_height = game->state.ball.block.height;
+
+    // rounded down, a corner just left of or above the world is in the cell before the first
+    int32_t column = scalar_to_int(scalar_div(ray->x, cell)) - ((ray->x < SCALAR(0.0f)) ? 1 : 0);
+    int32_t row = scalar_to_int(scalar_div(ray->y, cell)) - ((ray->y < SCALAR(0.0f)) ? 1 : 0);
+    const int32_t step_column = (ray->dx > SCALAR(0.0f)) ? 1 : -1;
+    const int32_t step_row = (ray->dy > SCALAR(0.0f)) ? 1 : -1;
+
+    Scalar next_x = SCALAR_MAX;
+    Scalar delta_x = SCALAR_MAX;
+    if (ray->dx != SCALAR(0.0f))
+    {
+        const Scalar edge_x = scalar_mul(scalar_from_int(column + ((ray->dx > SCALAR(0.0f)) ? 1 : 0)), cell);
+        next_x = scalar_div_clamped(edge_x - ray->x, ray->dx);
+        delta_x = scalar_div_clamped(cell, scalar_abs(ray->dx));
+    }
+
+    Scalar next_y = SCALAR_MAX;
+    Scalar delta_y = SCALAR_MAX;
+    if (ray->dy != SCALAR(0.0f))
+    {
+        const Scalar edge_y = scalar_mul(scalar_from_int(row + ((ray->dy > SCALAR(0.0f)) ? 1 : 0)), cell);
+        next_y = scalar_div_clamped(edge_y - ray->y, ray->dy);
+        delta_y = scalar_div_clamped(cell, scalar_abs(ray->dy));
+    }
+
+    bool found = false;
+    Scalar best = t_max;
+
+    for (;;)
+    {
+        // a brick touching the ball from this cell is homed in this cell or one of its neighbours
+        for (int32_t r = row - 1; r <= row + 1; ++r)
+        {
+            for (int32_t c = column - 1; c <= column + 1; ++c)
+            {
+                size_t count = 0u;
+                const uint32_t *indices = get_cell_bricks(game, c, r, &count);
+
+                for (size_t i = 0u; i < count; ++i)
+                {
+                    const uint32_t index = indices[i];
+                    if ((index == skip) || !is_brick_alive(game, index))
+                    {
+                        continue;
+                    }
+
+                    // grow the brick by the ball size so the ball can be treated as a point
+                    const Block *brick = &get_brick(game, index)->block;
+                    const Scalar min_x = brick->position.x - ball_width;
+                    const Scalar min_y = brick->position.y - ball_height;
+                    const Scalar max_x = brick->position.x + brick->width;
+                    const Scalar max_y = brick->position.y + brick->height;
+
+                    Scalar t = SCALAR(0.0f);
+                    bool vertical = false;
+                    if (intersect_box(ray, min_x, min_y, max_x, max_y, &t, &vertical) && (t < best))
+                    {
+                        best = t;
+                        *flip_x = vertical;
+                        *hit = index;
+                        found = true;
+                    }
+                }
+            }
+        }
+
+        // later cells can only give later hits, and a cell left at t_max can't give one before it
+        const Scalar cell_exit = min_scalar(next_x, next_y);
+        if ((found && (best <= cell_exit)) || (cell_exit >= t_max))
+        {
+            break;
+        }
+
+        if (next_x < next_y)
+        {
+            column += step_column;
+            next_x = add_time(next_x, delta_x);
+        }
+        else
+        {
+            row += step_row;
+            next_y = add_time(next_y, delta_y);
+        }
+    }
+
+    *t_hit = best;
+    return found;
+}
+
+bool predict_ball_x(const Game *game, uint32_t player, Scalar *x)
+{
+    assert(game != NULL);
+    assert(player < game->players);
+    assert(x != NULL);
+
+    const Entity *ball = &game->state.ball;
+    const Block *bottom_paddle = &game->state.paddles[0].block;
+    const Block *top_paddle = &game->state.paddles[1].block;
+    const Scalar width = game->width;
+
+    // the ball turns round at the lines where it meets each paddle, or the top wall with only one player
+    const Scalar bottom_line = bottom_paddle->position.y - ball->block.height;
+    const Scalar top_line = (game->players > 1u) ? (top_paddle->position.y + top_paddle->height) : SCALAR(0.0f);
+    const bool defend_bottom = player == 0u;
+
+    Ray ray = {
+        .x = ball->block.position.x,
+        .y = ball->block.position.y,
+        .dx = game->state.ball_velocity.x,
+        .dy = game->state.ball_velocity.y};
+
+    uint32_t skip = UINT32_MAX;
+
+    for (int bounce = 0; bounce < MAX_BOUNCES; ++bounce)
+    {
+        if (ray.dy == SCALAR(0.0f))
+        {
+            return false;
+        }
+
+        const bool moving_down = ray.dy > SCALAR(0.0f);
+        if ((moving_down && (ray.y >= bottom_line)) || (!moving_down && (ray.y <= top_line)))
+        {
+            if (moving_down == defend_bottom)
+            {
+                *x = ray.x;
+                return true;
+            }
+
+            // already past the other player's line, they will have to deal with it first
+            ray.dy = -ray.dy;
+            continue;
+        }
+
+        // time to the next wall on each axis, update_ball reflects at 0 and the world width
+        const Scalar t_y = scalar_div_clamped((moving_down ? bottom_line : top_line) - ray.y, ray.dy);
+        Scalar t_x = SCALAR_MAX;
+        if (ray.dx > SCALAR(0.0f))
+        {
+            t_x = scalar_div_clamped(width - ray.x, ray.dx);
+        }
+        else if (ray.dx < SCALAR(0.0f))
+        {
+            t_x = scalar_div_clamped(-ray.x, ray.dx);
+        }
+
+        const Scalar t_wall = max_scalar(min_scalar(t_x, t_y), SCALAR(0.0f));
+
+        Scalar t_brick = SCALAR(0.0f);
+        bool flip_x = false;
+        uint32_t hit = UINT32_MAX;
+        if (cast_bricks(game, &ray, t_wall, skip, &t_brick, &flip_x, &hit))
+        {
+            ray.x += scalar_mul(ray.dx, t_brick);
+            ray.y += scalar_mul(ray.dy, t_brick);
+            if (flip_x)
+            {
+                ray.dx = -ray.dx;
+            }
+            else
+            {
+                ray.dy = -ray.dy;
+            }
+            skip = hit;
+            continue;
+        }
+
+        ray.x += scalar_mul(ray.dx, t_wall);
+        ray.y += scalar_mul(ray.dy, t_wall);
+
+        if (t_x < t_y)
+        {
+            ray.dx = -ray.dx;
+        }
+        else if (moving_down == defend_bottom)
+        {
+            *x = ray.x;
+            return true;
+        }
+        else
+        {
+            // assume the other player returns it
+            ray.dy = -ray.dy;
+        }
+    }
+
+    return false;
+}
+
+void autopilot_input(const Game *game, uint32_t player, GameInput *input)
+{
+    assert(game != NULL);
+    assert(player < game->players);
+    assert(input != NULL);
+
+    const Entity *ball = &game->state.ball;
+    const Entity *paddle = &game->state.paddles[player];
+
+    // fall back to following the ball if the path can't be predicted
+    Scalar ball_x = ball->block.position.x;
+    predict_ball_x(game, player, &ball_x);
+
+    const Scalar target = ball_x + (ball->block.width / 2);
+    const Scalar centre = paddle->block.position.x + (paddle->block.width / 2);
+
+    input->left = target < (centre - DEADBAND);
+    input->right = target > (centre + DEADBAND);
+}
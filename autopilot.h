@@ -0,0 +1,50 @@
+#ifndef _AUTOPILOT_H_
+#define _AUTOPILOT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "game.h"
+
+/**
+ * Autopilot plays the paddle without simulating ahead frame by frame.
+ *
+ * The ball path is followed analytically from one bounce to the next: side and top walls, plus the first brick hit
+ * found by ray casting through the brick grid. The work is proportional to the number of bounces before the ball
+ * reaches the paddle, not the number of steps.
+ *
+ * In versus the other paddle is treated as a wall, on the assumption it returns the ball.
+ */
+
+/**
+ * Predict where the ball will cross a player's paddle line.
+ *
+ * @param game
+ *   Game to predict for.
+ *
+ * @param player
+ *   Player to predict for.
+ *
+ * @param x
+ *   Out parameter for the x coordinate of the ball (left edge) when it reaches the paddle.
+ *
+ * @returns
+ *   True if a prediction was made, false if the ball never reaches the paddle within the bounce limit.
+ */
+bool predict_ball_x(const Game *game, uint32_t player, Scalar *x);
+
+/**
+ * Choose the keys to hold this step to get a player's paddle in line with the ball.
+ *
+ * @param game
+ *   Game to play.
+ *
+ * @param player
+ *   Player to choose keys for.
+ *
+ * @param input
+ *   Out parameter for the keys to hold.
+ */
+void autopilot_input(const Game *game, uint32_t player, GameInput *input);
+
+#endif
@@ -4,12 +4,12 @@
 #include "block.h"
 #include "vector.h"
 
-Block create_block(const Vector2D *position, float width, float height)
+Block create_block(const Vector2D *position, Scalar width, Scalar height)
 {
     return create_block_xy(position->x, position->y, width, height);
 }
 
-Block create_block_xy(float x, float y, float width, float height)
+Block create_block_xy(Scalar x, Scalar y, Scalar width, Scalar height)
 {
     Block block = {.position = {.x = x, .y = y}, .width = width, .height = height};
     return block;
@@ -20,7 +20,7 @@ void move_block(Block *block, const Vector2D *move_amount)
     add_vec(&block->position, move_amount);
 }
 
-void move_block_xy(Block *block, float x, float y)
+void move_block_xy(Block *block, Scalar x, Scalar y)
 {
     add_vec_xy(&block->position, x, y);
 }
@@ -30,7 +30,7 @@ void set_block_pos(Block *block, const Vector2D *position)
     block->position = *position;
 }
 
-void set_block_pos_xy(Block *block, float x, float y)
+void set_block_pos_xy(Block *block, Scalar x, Scalar y)
 {
     block->position.x = x;
     block->position.y = y;
@@ -40,8 +40,8 @@ void print_block(const Block *block)
 {
     printf(
         "{ x: %f, y: %f, w: %f, h: %f }\n",
-        block->position.x,
-        block->position.y,
-        block->width,
-        block->height);
+        scalar_to_float(block->position.x),
+        scalar_to_float(block->position.y),
+        scalar_to_float(block->width),
+        scalar_to_float(block->height));
 }
@@ -9,8 +9,8 @@
 typedef struct Block
 {
     Vector2D position;
-    float width;
-    float height;
+    Scalar width;
+    Scalar height;
 } Block;
 
 /**
@@ -28,7 +28,7 @@ typedef struct Block
  * @returns
  *   Block constructed with supplied values.
  */
-Block create_block(const Vector2D *position, float width, float height);
+Block create_block(const Vector2D *position, Scalar width, Scalar height);
 
 /**
  * Create a new Block.
@@ -48,7 +48,7 @@ Block create_block(const Vector2D *position, float width, float height);
  * @returns
  *   Block constructed with supplied values.
  */
-Block create_block_xy(float x, float y, float width, float height);
+Block create_block_xy(Scalar x, Scalar y, Scalar width, Scalar height);
 
 /**
  * Move block.
@@ -73,7 +73,7 @@ void move_block(Block *block, const Vector2D *move_amount);
  * @param y
  *   Amount to move_amount along y axis.
  */
-void move_block_xy(Block *block, float x, float y);
+void move_block_xy(Block *block, Scalar x, Scalar y);
 
 /**
  * Set the position of a block.
@@ -98,7 +98,7 @@ void set_block_pos(Block *block, const Vector2D *position);
  * @param y
  *   Y coordinate of new position.
  */
-void set_block_pos_xy(Block *block, float x, float y);
+void set_block_pos_xy(Block *block, Scalar x, Scalar y);
 
 /**
  * Print block to stdout.
@@ -0,0 +1,626 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "game.h"
+
+/**
+ * Bake level descriptions into C source, run by the build to make the levels in level.h.
+ *
+ * usage: breakout_bake OUTPUT LEVEL...
+ *
+ * Each level becomes constant, cache line aligned arrays of its bricks and of its brick grid already sorted into
+ * cells, in the layout build_brick_grid produces, so the game only points at them. Levels are written with the
+ * SCALAR macro rather than as numbers, so the same source works for float and fixed point builds. See
+ * levels/default.level for the description format.
+ */
+
+/**
+ * Longest line of a level description.
+ */
+#define BAKE_MAX_LINE 256u
+
+/**
+ * Longest level name.
+ */
+#define BAKE_MAX_NAME 64u
+
+/**
+ * Alignment of the baked arrays, a cache line.
+ */
+#define BAKE_ALIGNMENT 64u
+
+/**
+ * A brick as described, in whole pixels.
+ */
+typedef struct BakeBrick
+{
+    long x;
+    long y;
+    long width;
+    long height;
+    uint32_t colour;
+
+    // how far it slides and the steps to get there and back, all 0 if it stays put
+    long move_x;
+    long move_y;
+    long period;
+
+    // grows back after being destroyed
+    bool regrow;
+} BakeBrick;
+
+/**
+ * A level being baked.
+ */
+typedef struct BakeLevel
+{
+    char name[BAKE_MAX_NAME];
+    long width;
+    long height;
+
+    BakeBrick *bricks;
+    size_t count;
+    size_t capacity;
+
+    // motion and regrow time given to the bricks described from here on
+    long move_x;
+    long move_y;
+    long period;
+    long regrow;
+
+    // steps before a brick grows back, the same for every brick of a level that does
+    long regrow_delay;
+} BakeLevel;
+
+/**
+ * Helper function to work out a level's name from the path of its description, the file name without its extension.
+ *
+ * @param path
+ *   Path of the description.
+ *
+ * @param name
+ *   Where to write the name, BAKE_MAX_NAME bytes.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the name is too long or can't be part of a C identifier
+ */
+static Result get_level_name(const char *path, char *name)
+{
+    const char *start = strrchr(path, '/');
+    start = (start == NULL) ? path : (start + 1);
+
+    const char *end = strchr(start, '.');
+    const size_t length = (end == NULL) ? strlen(start) : (size_t)(end - start);
+    if ((length == 0u) || (length >= BAKE_MAX_NAME))
+    {
+        return FAILED;
+    }
+
+    for (size_t i = 0u; i < length; ++i)
+    {
+        const char c = start[i];
+        if (!(((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || ((c >= '0') && (c <= '9')) || (c == '_')))
+        {
+            return FAILED;
+        }
+    }
+
+    memcpy(name, start, length);
+    name[length] = '\0';
+    return SUCCESS;
+}
+
+/**
+ * Helper function to add a brick to a level, with the motion and regrow time described before it, checking it fits the
+ * world wherever it moves and the grid.
+ *
+ * @param level
+ *   Level to add to, the world size must already be set.
+ *
+ * @param brick
+ *   Brick to add, its position, size and colour.
+ *
+ * @param cell_size
+ *   Size of a grid cell in pixels.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the brick doesn't fit or memory ran out
+ */
+static Result add_level_brick(BakeLevel *level, const BakeBrick *brick, long cell_size)
+{
+    const long left = brick->x + ((level->move_x < 0) ? level->move_x : 0);
+    const long top = brick->y + ((level->move_y < 0) ? level->move_y : 0);
+    const long right = brick->x + brick->width + ((level->move_x > 0) ? level->move_x : 0);
+    const long bottom = brick->y + brick->height + ((level->move_y > 0) ? level->move_y : 0);
+    if ((brick->width <= 0) || (brick->height <= 0) || (brick->width > cell_size) || (brick->height > cell_size) ||
+        (left < 0) || (top < 0) || (right > level->width) || (bottom > level->height) || (level->count >= UINT32_MAX))
+    {
+        return FAILED;
+    }
+
+    if (level->count == level->capacity)
+    {
+        const size_t capacity = (level->capacity == 0u) ? 64u : (level->capacity * 2u);
+        BakeBrick *bricks = (BakeBrick *)TRACKED_REALLOC(level->bricks, capacity * sizeof(BakeBrick));
+        if (bricks == NULL)
+        {
+            return FAILED;
+        }
+
+        level->bricks = bricks;
+        level->capacity = capacity;
+    }
+
+    BakeBrick *added = &level->bricks[level->count++];
+    *added = *brick;
+    added->move_x = level->move_x;
+    added->move_y = level->move_y;
+    added->period = level->period;
+    added->regrow = level->regrow != 0;
+    return SUCCESS;
+}
+
+/**
+ * Helper function to check if two bricks move together.
+ *
+ * @param a
+ *   First brick.
+ *
+ * @param b
+ *   Second brick.
+ *
+ * @returns
+ *   True if both slide the same way at the same speed, otherwise false.
+ */
+static bool is_same_motion(const BakeBrick *a, const BakeBrick *b)
+{
+    return (a->move_x == b->move_x) && (a->move_y == b->move_y) && (a->period == b->period);
+}
+
+/**
+ * Helper function to read a level description.
+ *
+ * @param level
+ *   Level to fill in, empty.
+ *
+ * @param path
+ *   Description to read.
+ *
+ * @param cell_size
+ *   Size of a grid cell in pixels.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the description can't be read or is wrong, after saying where
+ */
+static Result read_level(BakeLevel *level, const char *path, long cell_size)
+{
+    if (get_level_name(path, level->name) != SUCCESS)
+    {
+        printf("%s: the file name must be a C identifier\n", path);
+        return FAILED;
+    }
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        printf("failed to open %s\n", path);
+        return FAILED;
+    }
+
+    Result res = SUCCESS;
+    char line[BAKE_MAX_LINE];
+    unsigned int number = 0u;
+
+    while ((res == SUCCESS) && (fgets(line, sizeof(line), file) != NULL))
+    {
+        ++number;
+
+        char *comment = strchr(line, '#');
+        if (comment != NULL)
+        {
+            *comment = '\0';
+        }
+
+        char keyword[16] = {0};
+        int used = 0;
+        if (sscanf(line, " %15s%n", keyword, &used) != 1)
+        {
+            continue;
+        }
+
+        const char *args = &line[used];
+        char extra = '\0';
+        BakeBrick brick = {0};
+        long count = 0;
+        long pitch = 0;
+        long value = 0;
+
+        if (strcmp(keyword, "world") == 0)
+        {
+            res = ((sscanf(args, "%ld %ld %c", &level->width, &level->height, &extra) == 2) && (level->count == 0u) &&
+                   (level->width > 0) && (level->height > 0))
+                      ? SUCCESS
+                      : FAILED;
+        }
+        else if (strcmp(keyword, "row") == 0)
+        {
+            res = ((sscanf(
+                        args,
+                        "%ld %ld %ld %ld %ld %ld %6x %c",
+                        &brick.x,
+                        &brick.y,
+                        &count,
+                        &pitch,
+                        &brick.width,
+                        &brick.height,
+                        &brick.colour,
+                        &extra) == 7) &&
+                   (count > 0))
+                      ? SUCCESS
+                      : FAILED;
+
+            for (long i = 0; (res == SUCCESS) && (i < count); ++i, brick.x += pitch)
+            {
+                res = add_level_brick(level, &brick, cell_size);
+            }
+        }
+        else if (strcmp(keyword, "move") == 0)
+        {
+            res = ((sscanf(args, "%ld %ld %ld %c", &level->move_x, &level->move_y, &level->period, &extra) == 3) &&
+                   (level->period >= 0) && (level->period <= UINT32_MAX) &&
+                   ((level->period >= 2) || ((level->move_x == 0) && (level->move_y == 0))))
+                      ? SUCCESS
+                      : FAILED;
+
+            // bricks that don't go anywhere stay put whatever the period
+            if ((level->move_x == 0) && (level->move_y == 0))
+            {
+                level->period = 0;
+            }
+        }
+        else if (strcmp(keyword, "regrow") == 0)
+        {
+            res = ((sscanf(args, "%ld %c", &value, &extra) == 1) && (value >= 0) && (value <= UINT32_MAX) &&
+                   ((value == 0) || (level->regrow_delay == 0) || (value == level->regrow_delay)))
+                      ? SUCCESS
+                      : FAILED;
+
+            level->regrow = value;
+            level->regrow_delay = (value != 0) ? value : level->regrow_delay;
+        }
+        else if (strcmp(keyword, "brick") == 0)
+        {
+            res = (sscanf(
+                       args,
+                       "%ld %ld %ld %ld %6x %c",
+                       &brick.x,
+                       &brick.y,
+                       &brick.width,
+                       &brick.height,
+                       &brick.colour,
+                       &extra) == 5)
+                      ? add_level_brick(level, &brick, cell_size)
+                      : FAILED;
+        }
+        else
+        {
+            res = FAILED;
+        }
+
+        if (res != SUCCESS)
+        {
+            printf(
+                "%s:%u: bad line, a brick larger than a %ld pixel cell or going outside the world, or a second regrow "
+                "time\n",
+                path,
+                number,
+                cell_size);
+        }
+    }
+
+    if ((res == SUCCESS) && ferror(file))
+    {
+        printf("failed to read %s\n", path);
+        res = FAILED;
+    }
+    else if ((res == SUCCESS) && (level->width == 0))
+    {
+        printf("%s: no world size\n", path);
+        res = FAILED;
+    }
+
+    fclose(file);
+    return res;
+}
+
+/**
+ * Helper function to write a list of numbers as the body of an array, a few to a line.
+ *
+ * @param out
+ *   File to write to.
+ *
+ * @param values
+ *   Numbers to write.
+ *
+ * @param count
+ *   Number of numbers, a single 0 is written for none so the array isn't empty.
+ */
+static void write_numbers(FILE *out, const uint32_t *values, size_t count)
+{
+    if (count == 0u)
+    {
+        fprintf(out, "    0u,\n");
+        return;
+    }
+
+    for (size_t i = 0u; i < count; ++i)
+    {
+        const bool first = (i % 12u) == 0u;
+        const bool last = ((i % 12u) == 11u) || ((i + 1u) == count);
+        fprintf(out, "%s%uu,%s", first ? "    " : " ", values[i], last ? "\n" : "");
+    }
+}
+
+/**
+ * Helper function to write a level's arrays and its BakedLevel.
+ *
+ * @param out
+ *   File to write to.
+ *
+ * @param level
+ *   Level to write.
+ *
+ * @param cell_size
+ *   Size of a grid cell in pixels.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if memory ran out
+ */
+static Result write_level(FILE *out, const BakeLevel *level, long cell_size)
+{
+    // the same cells as a BrickGrid with GAME_CELL_SIZE cells over the world
+    const long columns = (level->width / cell_size) + 1;
+    const long rows = (level->height / cell_size) + 1;
+    const size_t cells = (size_t)columns * (size_t)rows;
+
+    uint32_t *cell_start = (uint32_t *)TRACKED_CALLOC(cells + 1u, sizeof(uint32_t));
+    uint32_t *cell_bricks = (uint32_t *)TRACKED_CALLOC(level->count + 1u, sizeof(uint32_t));
+    uint32_t *homes = (uint32_t *)TRACKED_CALLOC(level->count + 1u, sizeof(uint32_t));
+    if ((cell_start == NULL) || (cell_bricks == NULL) || (homes == NULL))
+    {
+        free_tracked(cell_start);
+        free_tracked(cell_bricks);
+        free_tracked(homes);
+        return FAILED;
+    }
+
+    // counting sort by home cell, bricks stay in the order they were described within a cell
+    for (size_t i = 0u; i < level->count; ++i)
+    {
+        const BakeBrick *brick = &level->bricks[i];
+        const long column = ((brick->x / cell_size) < columns) ? (brick->x / cell_size) : (columns - 1);
+        const long row = ((brick->y / cell_size) < rows) ? (brick->y / cell_size) : (rows - 1);
+        homes[i] = (uint32_t)((row * columns) + column);
+        ++cell_start[homes[i] + 1u];
+    }
+
+    for (size_t i = 0u; i < cells; ++i)
+    {
+        cell_start[i + 1u] += cell_start[i];
+    }
+
+    for (size_t i = 0u; i < level->count; ++i)
+    {
+        cell_bricks[cell_start[homes[i]]++] = (uint32_t)i;
+    }
+
+    for (size_t i = cells; i > 0u; --i)
+    {
+        cell_start[i] = cell_start[i - 1u];
+    }
+    cell_start[0] = 0u;
+
+    // arrays can't be empty, a level with no bricks still gets one that is never looked at
+    const char *name = level->name;
+    const size_t length = (level->count == 0u) ? 1u : level->count;
+    fprintf(out, "static _Alignas(%u) const Entity %s_bricks[%zu] = {\n", BAKE_ALIGNMENT, name, length);
+    for (size_t i = 0u; i < level->count; ++i)
+    {
+        const BakeBrick *brick = &level->bricks[i];
+        fprintf(
+            out,
+            "    {.block = {.position = {.x = SCALAR(%ld.0f), .y = SCALAR(%ld.0f)}, .width = SCALAR(%ld.0f), "
+            ".height = SCALAR(%ld.0f)}, .r = 0x%02x, .g = 0x%02x, .b = 0x%02x},\n",
+            brick->x,
+            brick->y,
+            brick->width,
+            brick->height,
+            (brick->colour >> 16u) & 0xffu,
+            (brick->colour >> 8u) & 0xffu,
+            brick->colour & 0xffu);
+    }
+    fprintf(out, "%s};\n\n", (level->count == 0u) ? "    {.r = 0x00},\n" : "");
+
+    fprintf(out, "static _Alignas(%u) const uint32_t %s_cell_start[%zu] = {\n", BAKE_ALIGNMENT, name, cells + 1u);
+    write_numbers(out, cell_start, cells + 1u);
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static _Alignas(%u) const uint32_t %s_cell_bricks[%zu] = {\n", BAKE_ALIGNMENT, name, length);
+    write_numbers(out, cell_bricks, level->count);
+    fprintf(out, "};\n\n");
+
+    // consecutive bricks moving the same way make one run, most levels have none and get no array
+    size_t motion_count = 0u;
+    for (size_t i = 0u; i < level->count; ++i)
+    {
+        const BakeBrick *brick = &level->bricks[i];
+        if ((brick->period != 0) && ((motion_count == 0u) || !is_same_motion(&level->bricks[i - 1u], brick)))
+        {
+            if (motion_count == 0u)
+            {
+                fprintf(out, "static const BrickMotion %s_motions[] = {\n", name);
+            }
+
+            size_t run = 1u;
+            while (((i + run) < level->count) && is_same_motion(brick, &level->bricks[i + run]))
+            {
+                ++run;
+            }
+
+            fprintf(
+                out,
+                "    {.first_brick = %zuu, .brick_count = %zuu, .reach = {.x = SCALAR(%ld.0f), .y = SCALAR(%ld.0f)}, "
+                ".period = %ldu},\n",
+                i,
+                run,
+                brick->move_x,
+                brick->move_y,
+                brick->period);
+            ++motion_count;
+        }
+    }
+    fprintf(out, "%s", (motion_count > 0u) ? "};\n\n" : "");
+
+    // one bit a brick like the alive bits, only written if any brick grows back
+    const size_t words = (level->count / 64u) + 1u;
+    bool regrow = false;
+    for (size_t word = 0u; word < words; ++word)
+    {
+        uint64_t bits = 0u;
+        for (size_t i = word * 64u; (i < level->count) && (i < ((word + 1u) * 64u)); ++i)
+        {
+            bits |= level->bricks[i].regrow ? ((uint64_t)1u << (i % 64u)) : 0u;
+        }
+
+        if (!regrow && (bits != 0u))
+        {
+            fprintf(out, "static _Alignas(%u) const uint64_t %s_regrow[%zu] = {\n", BAKE_ALIGNMENT, name, words);
+            for (size_t skipped = 0u; skipped < word; ++skipped)
+            {
+                fprintf(out, "    0x0u,\n");
+            }
+            regrow = true;
+        }
+
+        if (regrow)
+        {
+            fprintf(out, "    0x%llxu,\n", (unsigned long long)bits);
+        }
+    }
+    fprintf(out, "%s", regrow ? "};\n\n" : "");
+
+    fprintf(
+        out,
+        "static const BakedLevel %s_level = {\n"
+        "    .name = \"%s\",\n"
+        "    .width = SCALAR(%ld.0f),\n"
+        "    .height = SCALAR(%ld.0f),\n"
+        "    .bricks = %s_bricks,\n"
+        "    .brick_count = %zuu,\n"
+        "    .cell_start = %s_cell_start,\n"
+        "    .cell_count = %zuu,\n"
+        "    .cell_bricks = %s_cell_bricks,\n",
+        name,
+        name,
+        level->width,
+        level->height,
+        name,
+        level->count,
+        name,
+        cells,
+        name);
+
+    if (motion_count > 0u)
+    {
+        fprintf(out, "    .motions = %s_motions,\n    .motion_count = %zuu,\n", name, motion_count);
+    }
+
+    if (regrow)
+    {
+        fprintf(out, "    .brick_regrow = %s_regrow,\n    .regrow_delay = %ldu,\n", name, level->regrow_delay);
+    }
+    fprintf(out, "};\n\n");
+
+    free_tracked(cell_start);
+    free_tracked(cell_bricks);
+    free_tracked(homes);
+    return SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        printf("usage: %s OUTPUT LEVEL...\n", argv[0]);
+        return 1;
+    }
+
+    const char *path = argv[1];
+    const long cell_size = (long)((double)GAME_CELL_SIZE / (double)SCALAR_ONE);
+
+    FILE *out = fopen(path, "w");
+    if (out == NULL)
+    {
+        printf("failed to open %s\n", path);
+        return 1;
+    }
+
+    fprintf(out, "// generated by breakout_bake, edit the level descriptions instead\n\n");
+    fprintf(out, "#include <stddef.h>\n#include <stdint.h>\n\n#include \"level.h\"\n\n");
+
+    Result res = SUCCESS;
+    for (int i = 2; (res == SUCCESS) && (i < argc); ++i)
+    {
+        BakeLevel level = {0};
+        res = read_level(&level, argv[i], cell_size);
+        if (res == SUCCESS)
+        {
+            for (int j = 2; j < i; ++j)
+            {
+                char name[BAKE_MAX_NAME];
+                if ((get_level_name(argv[j], name) == SUCCESS) && (strcmp(name, level.name) == 0))
+                {
+                    printf("%s: there is already a level called %s\n", argv[i], name);
+                    res = FAILED;
+                }
+            }
+        }
+
+        if ((res == SUCCESS) && (write_level(out, &level, cell_size) != SUCCESS))
+        {
+            printf("failed to bake %s\n", argv[i]);
+            res = FAILED;
+        }
+
+        free_tracked(level.bricks);
+    }
+
+    if (res == SUCCESS)
+    {
+        fprintf(out, "const BakedLevel *const baked_levels[] = {\n");
+        for (int i = 2; i < argc; ++i)
+        {
+            char name[BAKE_MAX_NAME];
+            get_level_name(argv[i], name);
+            fprintf(out, "    &%s_level,\n", name);
+        }
+        fprintf(out, "};\n\nconst size_t baked_level_count = %du;\n", argc - 2);
+    }
+
+    // a half written file mustn't look up to date to the build
+    if ((fclose(out) != 0) || (res != SUCCESS))
+    {
+        remove(path);
+        return 1;
+    }
+
+    return 0;
+}
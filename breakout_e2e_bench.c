@@ -0,0 +1,884 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "alloc.h"
+#include "camera.h"
+#include "game.h"
+#include "jobs.h"
+#include "observe.h"
+#include "particle.h"
+#include "scene.h"
+#include "session.h"
+#include "timer.h"
+#include "window.h"
+
+/**
+ * End to end benchmark, plays recorded sessions through the whole game and compares the numbers with a baseline.
+ *
+ * usage: breakout_e2e_bench [--mode headless|offscreen|observe|both|all] [--repeat N] [--threads N]
+ *                           [--baseline PATH] [--tolerance PERCENT] [--write-baseline PATH] [SESSION...]
+ *
+ * Every session is played in each mode: headless steps as fast as possible, offscreen also draws a frame every
+ * BENCH_STEPS_PER_FRAME steps into an offscreen window, and observe draws an agent's observation of the view around
+ * the ball that often instead. both is headless and offscreen, all adds observe. Each run is a separate process so
+ * peak memory is measured per case, and the best of the repeats is kept.
+ *
+ * A case ending with a different digest_game from the baseline's fails the run. The other metrics are timings and
+ * sizes from whichever machine wrote the baseline, so by default a metric more than BENCH_DEFAULT_TOLERANCE worse is
+ * only reported. Given --tolerance, as on the machine the baseline was written on, a metric worse by more than that
+ * fails the run too. Offscreen cases are only played by both or all once the baseline has numbers for them, or when
+ * writing a baseline, so they are never run with nothing to be checked against.
+ */
+
+#ifndef BREAKOUT_BENCH_DIR
+#define BREAKOUT_BENCH_DIR "bench"
+#endif
+
+/**
+ * Added to case names in fixed point builds, which have their own baselines.
+ */
+#ifdef BREAKOUT_FIXED_POINT
+#define BENCH_BUILD_SUFFIX "/fixed"
+#else
+#define BENCH_BUILD_SUFFIX ""
+#endif
+
+/**
+ * Steps between frames drawn offscreen, the same as the game running at 60 frames a second.
+ */
+#define BENCH_STEPS_PER_FRAME 16u
+
+/**
+ * Width and height of observations drawn in observe mode, and the number of frames stacked.
+ */
+#define BENCH_OBSERVE_SIZE 84u
+#define BENCH_OBSERVE_DEPTH 4u
+
+/**
+ * Calls to digest_game timed after each case.
+ */
+#define BENCH_DIGEST_CALLS 1000000u
+
+/**
+ * Most sessions benchmarked in one run.
+ */
+#define BENCH_MAX_SESSIONS 16u
+
+/**
+ * Change from the baseline reported when no tolerance is given, in percent.
+ */
+#define BENCH_DEFAULT_TOLERANCE 25.0
+
+/**
+ * Ways of playing a session.
+ */
+typedef enum BenchMode
+{
+    BENCH_HEADLESS,
+    BENCH_OFFSCREEN,
+    BENCH_OBSERVE,
+    BENCH_MODES
+} BenchMode;
+
+/**
+ * Metrics measured for a case, in the order they are written out.
+ */
+typedef enum BenchMetric
+{
+    STEPS_PER_SECOND,
+    EVENTS_NS,
+    UPDATE_BALL_NS,
+    HANDLE_COLLISIONS_NS,
+    DIGEST_NS,
+    PARTICLES_NS,
+    RENDER_MS,
+    OBSERVE_US,
+    PEAK_RSS_KB,
+    PEAK_HEAP_BYTES,
+    BENCH_METRICS
+} BenchMetric;
+
+/**
+ * Names of the metrics in the JSON, and whether a larger value is better.
+ */
+static const char *const metric_names[BENCH_METRICS] = {
+    "steps_per_second",
+    "events_ns",
+    "update_ball_ns",
+    "handle_collisions_ns",
+    "digest_ns",
+    "particles_ns",
+    "render_ms",
+    "observe_us",
+    "peak_rss_kb",
+    "peak_heap_bytes"};
+static const bool metric_higher_better[BENCH_METRICS] = {true};
+
+static const char *const mode_names[BENCH_MODES] = {"headless", "offscreen", "observe"};
+
+/**
+ * Result of one run of a case, passed back from the process that ran it.
+ */
+typedef struct BenchResult
+{
+    bool ok;
+    double metrics[BENCH_METRICS];
+
+    // digest_game at the end, every run of a case on every build should agree on it
+    uint64_t digest;
+} BenchResult;
+
+/**
+ * Command line options.
+ */
+typedef struct BenchOptions
+{
+    bool modes[BENCH_MODES];
+    uint32_t repeat;
+    uint32_t threads;
+    const char *baseline_path;
+    bool baseline_given;
+    double tolerance;
+    // metrics only fail the run when a tolerance is given, digests always do
+    bool tolerance_given;
+    // offscreen was asked for on its own rather than as part of both or all
+    bool offscreen_given;
+    const char *write_path;
+    const char *sessions[BENCH_MAX_SESSIONS];
+    size_t session_count;
+} BenchOptions;
+
+/**
+ * Helper function to parse the command line.
+ *
+ * @param argc
+ *   Number of arguments.
+ *
+ * @param argv
+ *   Arguments.
+ *
+ * @param options
+ *   Out parameter for parsed options.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on an unknown argument
+ */
+static Result parse_options(int argc, char *argv[], BenchOptions *options)
+{
+    *options = (BenchOptions){
+        .modes = {true, true, true},
+        .repeat = 5u,
+        .baseline_path = BREAKOUT_BENCH_DIR "/baseline.json",
+        .tolerance = BENCH_DEFAULT_TOLERANCE};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if ((strcmp(argv[i], "--mode") == 0) && ((i + 1) < argc))
+        {
+            ++i;
+            const bool all = strcmp(argv[i], "all") == 0;
+            const bool both = all || (strcmp(argv[i], "both") == 0);
+            options->modes[BENCH_HEADLESS] = both || (strcmp(argv[i], "headless") == 0);
+            options->modes[BENCH_OFFSCREEN] = both || (strcmp(argv[i], "offscreen") == 0);
+            options->modes[BENCH_OBSERVE] = all || (strcmp(argv[i], "observe") == 0);
+            options->offscreen_given = strcmp(argv[i], "offscreen") == 0;
+            if (!options->modes[BENCH_HEADLESS] && !options->modes[BENCH_OFFSCREEN] && !options->modes[BENCH_OBSERVE])
+            {
+                printf("mode must be headless, offscreen, observe, both or all\n");
+                return FAILED;
+            }
+        }
+        else if ((strcmp(argv[i], "--repeat") == 0) && ((i + 1) < argc))
+        {
+            options->repeat = (uint32_t)strtoul(argv[++i], NULL, 10);
+            options->repeat = (options->repeat == 0u) ? 1u : options->repeat;
+        }
+        else if ((strcmp(argv[i], "--threads") == 0) && ((i + 1) < argc))
+        {
+            options->threads = (uint32_t)strtoul(argv[++i], NULL, 10);
+            if (options->threads > (JOB_MAX_WORKERS + 1u))
+            {
+                printf("at most %u threads\n", JOB_MAX_WORKERS + 1u);
+                return FAILED;
+            }
+        }
+        else if ((strcmp(argv[i], "--baseline") == 0) && ((i + 1) < argc))
+        {
+            options->baseline_path = argv[++i];
+            options->baseline_given = true;
+        }
+        else if ((strcmp(argv[i], "--tolerance") == 0) && ((i + 1) < argc))
+        {
+            options->tolerance = strtod(argv[++i], NULL);
+            options->tolerance_given = true;
+        }
+        else if ((strcmp(argv[i], "--write-baseline") == 0) && ((i + 1) < argc))
+        {
+            options->write_path = argv[++i];
+        }
+        else if ((argv[i][0] != '-') && (options->session_count < BENCH_MAX_SESSIONS))
+        {
+            options->sessions[options->session_count++] = argv[i];
+        }
+        else
+        {
+            printf(
+                "usage: %s [--mode headless|offscreen|observe|both|all] [--repeat N] [--threads N]\n"
+                "          [--baseline PATH] [--tolerance PERCENT] [--write-baseline PATH] [SESSION...]\n",
+                argv[0]);
+            return FAILED;
+        }
+    }
+
+    if (options->session_count == 0u)
+    {
+        options->sessions[options->session_count++] = BREAKOUT_BENCH_DIR "/default.session";
+        options->sessions[options->session_count++] = BREAKOUT_BENCH_DIR "/large.session";
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * Helper function to get the name of a case, the session file name without its directory and extension followed by the
+ * mode.
+ *
+ * @param path
+ *   Session file.
+ *
+ * @param mode
+ *   Mode the session is played in.
+ *
+ * @param name
+ *   Where to write the name.
+ *
+ * @param size
+ *   Size of name in bytes.
+ */
+static void get_case_name(const char *path, BenchMode mode, char *name, size_t size)
+{
+    const char *base = strrchr(path, '/');
+    base = (base == NULL) ? path : (base + 1);
+    const char *dot = strrchr(base, '.');
+    const int length = (dot == NULL) ? (int)strlen(base) : (int)(dot - base);
+
+    snprintf(name, size, "%.*s/%s" BENCH_BUILD_SUFFIX, length, base, mode_names[mode]);
+}
+
+/**
+ * Helper function to play a session once and measure it, run in its own process.
+ *
+ * @param path
+ *   Session file.
+ *
+ * @param mode
+ *   Mode to play in.
+ *
+ * @param threads
+ *   Threads for frame work, 0 for one per core.
+ *
+ * @param result
+ *   Out parameter for the measurements.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure, including the game ending differently from when the session was recorded
+ */
+static Result run_case(const char *path, BenchMode mode, uint32_t threads, BenchResult *result)
+{
+    Session *session = NULL;
+    Game *game = NULL;
+    JobSystem *jobs = NULL;
+    ParticleSystem *particles = NULL;
+    Scene *scene = NULL;
+    Window *window = NULL;
+    Result res = SUCCESS;
+
+    *result = (BenchResult){0};
+
+    if ((load_session(&session, path) != SUCCESS) || (create_session_game(session, &game) != SUCCESS))
+    {
+        printf("failed to load %s\n", path);
+        res = FAILED;
+        goto done;
+    }
+
+    if (mode == BENCH_OFFSCREEN)
+    {
+        if (threads == 0u)
+        {
+            const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+            threads = (cores > 0) ? (uint32_t)cores : 1u;
+            threads = (threads > (JOB_MAX_WORKERS + 1u)) ? (JOB_MAX_WORKERS + 1u) : threads;
+        }
+
+        if ((create_job_system(&jobs, threads - 1u) != SUCCESS) ||
+            (create_particle_system(&particles, 131072u) != SUCCESS) ||
+            (create_scene(&scene, game, game->brick_count) != SUCCESS) ||
+            (create_offscreen_window(&window) != SUCCESS) ||
+            (reserve_window_quads(window, game->brick_count) != SUCCESS) ||
+            (reserve_window_quads(window, particle_capacity(particles)) != SUCCESS))
+        {
+            printf("failed to create offscreen window\n");
+            res = FAILED;
+            goto done;
+        }
+    }
+
+    Camera camera = create_camera(scalar_from_int(WINDOW_WIDTH), scalar_from_int(WINDOW_HEIGHT));
+    SessionCursor cursor = start_session(session);
+    uint64_t events_ns = 0u;
+    uint64_t particles_ns = 0u;
+    uint64_t render_ns = 0u;
+    uint64_t observe_ns = 0u;
+    uint64_t frames = 0u;
+    static uint8_t observations[BENCH_OBSERVE_DEPTH * BENCH_OBSERVE_SIZE * BENCH_OBSERVE_SIZE];
+    ObservationStack stack =
+        create_observation_stack(observations, BENCH_OBSERVE_SIZE, BENCH_OBSERVE_SIZE, BENCH_OBSERVE_DEPTH);
+    bool playing = true;
+
+    const uint64_t start = get_time_ns();
+    while (playing)
+    {
+        for (uint32_t i = 0u; playing && ((mode == BENCH_HEADLESS) || (i < BENCH_STEPS_PER_FRAME)); ++i)
+        {
+            // events are the window's queue and the recorded keys
+            const uint64_t events_start = get_time_ns();
+            KeyEvent event;
+            while ((window != NULL) && (get_window_event(window, &event) != NO_EVENT))
+            {
+            }
+            GameInput inputs[GAME_MAX_PLAYERS] = {0};
+            playing = next_session_input(&cursor, &inputs[0]);
+            events_ns += get_time_ns() - events_start;
+
+            if (playing)
+            {
+                StepOutcome outcome;
+                step_game(game, inputs, &outcome);
+
+                if (particles != NULL)
+                {
+                    const uint64_t particles_start = get_time_ns();
+                    for (uint32_t j = 0u; j < outcome.collision_count; ++j)
+                    {
+                        if (outcome.collisions[j].kind == COLLISION_BRICK)
+                        {
+                            const Entity *brick = get_brick(game, (size_t)outcome.collisions[j].other);
+                            spawn_particle_burst(particles, &brick->block, brick->r, brick->g, brick->b, 48u);
+                        }
+                    }
+                    for (uint32_t j = 0u; j < outcome.blasted_count; ++j)
+                    {
+                        const Entity *brick = get_brick(game, (size_t)outcome.blasted[j]);
+                        spawn_particle_burst(particles, &brick->block, brick->r, brick->g, brick->b, 12u);
+                    }
+                    update_particle_system(particles, jobs);
+                    particles_ns += get_time_ns() - particles_start;
+                }
+            }
+        }
+
+        if (window != NULL)
+        {
+            const uint64_t render_start = get_time_ns();
+            if (pre_render_window(window) != SUCCESS)
+            {
+                printf("pre render failed\n");
+                res = FAILED;
+                goto done;
+            }
+
+            follow_camera(&camera, &game->state.ball.block, game->width, game->height);
+            set_camera_window(window, &camera);
+            if (draw_scene(scene, window, jobs, &camera, particles) != SUCCESS)
+            {
+                printf("failed to render scene\n");
+                res = FAILED;
+                goto done;
+            }
+
+            post_render_window(window);
+            render_ns += get_time_ns() - render_start;
+            ++frames;
+        }
+        else if (mode == BENCH_OBSERVE)
+        {
+            const uint64_t observe_start = get_time_ns();
+            follow_camera(&camera, &game->state.ball.block, game->width, game->height);
+            push_observation(&stack, game, &camera.view);
+            observe_ns += get_time_ns() - observe_start;
+            ++frames;
+        }
+    }
+    const uint64_t elapsed = get_time_ns() - start;
+
+    if (session->valid_hash && (hash_game(game) != session->hash))
+    {
+        printf("%s played differently from the recording, the benchmark isn't measuring the same game\n", path);
+        res = FAILED;
+        goto done;
+    }
+
+    // what a desync check would add to every step, timed in one go as a call is about as quick as reading the clock
+    const uint64_t digest_start = get_time_ns();
+    for (uint32_t i = 0u; i < BENCH_DIGEST_CALLS; ++i)
+    {
+        result->digest = digest_game(game);
+    }
+    const uint64_t digest_ns = get_time_ns() - digest_start;
+
+    const double steps = (session->steps > 0u) ? (double)session->steps : 1.0;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    AllocStats alloc_stats;
+    get_alloc_stats(&alloc_stats);
+
+    result->ok = true;
+    result->metrics[STEPS_PER_SECOND] = (elapsed > 0u) ? ((double)session->steps * 1e9 / (double)elapsed) : 0.0;
+    result->metrics[EVENTS_NS] = (double)events_ns / steps;
+    result->metrics[UPDATE_BALL_NS] = (double)game->phase_ns[GAME_PHASE_UPDATE_BALL] / steps;
+    result->metrics[HANDLE_COLLISIONS_NS] = (double)game->phase_ns[GAME_PHASE_HANDLE_COLLISIONS] / steps;
+    result->metrics[DIGEST_NS] = (double)digest_ns / BENCH_DIGEST_CALLS;
+    result->metrics[PARTICLES_NS] = (double)particles_ns / steps;
+    result->metrics[RENDER_MS] = (frames > 0u) ? ((double)render_ns / 1e6 / (double)frames) : 0.0;
+    result->metrics[OBSERVE_US] = (frames > 0u) ? ((double)observe_ns / 1e3 / (double)frames) : 0.0;
+    result->metrics[PEAK_RSS_KB] = (double)usage.ru_maxrss;
+    result->metrics[PEAK_HEAP_BYTES] = (double)alloc_stats.peak_bytes;
+
+done:
+    destroy_window(window);
+    destroy_scene(scene);
+    destroy_particle_system(particles);
+    destroy_job_system(jobs);
+    destroy_game(game);
+    destroy_session(session);
+    return res;
+}
+
+/**
+ * Helper function to run a case in a child process, so its memory use and SDL state are its own.
+ *
+ * @param path
+ *   Session file.
+ *
+ * @param mode
+ *   Mode to play in.
+ *
+ * @param threads
+ *   Threads for frame work, 0 for one per core.
+ *
+ * @param result
+ *   Out parameter for the measurements.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result run_case_process(const char *path, BenchMode mode, uint32_t threads, BenchResult *result)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return FAILED;
+    }
+
+    // anything buffered would be printed twice
+    fflush(stdout);
+
+    const pid_t child = fork();
+    if (child < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return FAILED;
+    }
+
+    if (child == 0)
+    {
+        close(fds[0]);
+        BenchResult child_result;
+        run_case(path, mode, threads, &child_result);
+        const bool written = write(fds[1], &child_result, sizeof(child_result)) == (ssize_t)sizeof(child_result);
+        fflush(stdout);
+        _exit(written ? 0 : 1);
+    }
+
+    close(fds[1]);
+    const bool read_all = read(fds[0], result, sizeof(*result)) == (ssize_t)sizeof(*result);
+    close(fds[0]);
+
+    int status = 0;
+    waitpid(child, &status, 0);
+
+    return (read_all && WIFEXITED(status) && (WEXITSTATUS(status) == 0) && result->ok) ? SUCCESS : FAILED;
+}
+
+/**
+ * Helper function to read a whole file into a string.
+ *
+ * @param path
+ *   File to read.
+ *
+ * @returns
+ *   The contents, to be freed with free_tracked, or NULL on failure.
+ */
+static char *read_text_file(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+
+    char *text = NULL;
+    long size = -1;
+    if ((fseek(file, 0, SEEK_END) == 0) && ((size = ftell(file)) >= 0) && (fseek(file, 0, SEEK_SET) == 0))
+    {
+        text = (char *)TRACKED_CALLOC((size_t)size + 1u, 1u);
+    }
+    if ((text != NULL) && (fread(text, 1u, (size_t)size, file) != (size_t)size))
+    {
+        free_tracked(text);
+        text = NULL;
+    }
+
+    fclose(file);
+    return text;
+}
+
+/**
+ * Helper function to find a metric of a case in a baseline written by write_results. Only reads that layout, not
+ * JSON in general.
+ *
+ * @param baseline
+ *   Baseline text.
+ *
+ * @param name
+ *   Case name.
+ *
+ * @param metric
+ *   Metric to find.
+ *
+ * @param value
+ *   Out parameter for the value.
+ *
+ * @returns
+ *   True if the value was found, otherwise false.
+ */
+static bool find_baseline_value(const char *baseline, const char *name, BenchMetric metric, double *value)
+{
+    char key[96];
+    snprintf(key, sizeof(key), "\"%s\"", name);
+    const char *object = strstr(baseline, key);
+    if (object == NULL)
+    {
+        return false;
+    }
+
+    const char *end = strchr(object, '}');
+    snprintf(key, sizeof(key), "\"%s\":", metric_names[metric]);
+    const char *field = strstr(object, key);
+    if ((field == NULL) || ((end != NULL) && (field > end)))
+    {
+        return false;
+    }
+
+    char *number_end = NULL;
+    *value = strtod(field + strlen(key), &number_end);
+    return number_end != (field + strlen(key));
+}
+
+/**
+ * Helper function to find the final digest of a case in a baseline written by write_results.
+ *
+ * @param baseline
+ *   Baseline text.
+ *
+ * @param name
+ *   Case name.
+ *
+ * @param digest
+ *   Out parameter for the digest.
+ *
+ * @returns
+ *   True if the digest was found, otherwise false.
+ */
+static bool find_baseline_digest(const char *baseline, const char *name, uint64_t *digest)
+{
+    char key[96];
+    snprintf(key, sizeof(key), "\"%s\"", name);
+    const char *object = strstr(baseline, key);
+    if (object == NULL)
+    {
+        return false;
+    }
+
+    const char *end = strchr(object, '}');
+    const char *field = strstr(object, "\"digest\": \"");
+    if ((field == NULL) || ((end != NULL) && (field > end)))
+    {
+        return false;
+    }
+
+    char *number_end = NULL;
+    *digest = strtoull(field + strlen("\"digest\": \""), &number_end, 16);
+    return *number_end == '"';
+}
+
+/**
+ * Helper function to write results as JSON, one case to a line.
+ *
+ * @param file
+ *   File to write to.
+ *
+ * @param names
+ *   Case names.
+ *
+ * @param results
+ *   Results of each case.
+ *
+ * @param count
+ *   Number of cases.
+ */
+static void write_results(FILE *file, char names[][64], const BenchResult *results, size_t count)
+{
+    fprintf(file, "{\n");
+    for (size_t i = 0u; i < count; ++i)
+    {
+        fprintf(file, "  \"%s\": {", names[i]);
+        for (size_t metric = 0u; metric < BENCH_METRICS; ++metric)
+        {
+            fprintf(
+                file, "%s\"%s\": %.6g", (metric == 0u) ? "" : ", ", metric_names[metric], results[i].metrics[metric]);
+        }
+        fprintf(
+            file,
+            ", \"digest\": \"%016llx\"}%s\n",
+            (unsigned long long)results[i].digest,
+            ((i + 1u) < count) ? "," : "");
+    }
+    fprintf(file, "}\n");
+}
+
+/**
+ * Helper function to compare a case with the baseline.
+ *
+ * @param baseline
+ *   Baseline text, or NULL if there is none.
+ *
+ * @param name
+ *   Case name.
+ *
+ * @param result
+ *   Result of the case.
+ *
+ * @param tolerance
+ *   Allowed change in percent.
+ *
+ * @param gate
+ *   True if metrics worse by more than the tolerance count as regressions, otherwise they are only reported.
+ *
+ * @returns
+ *   Number of metrics worse than the baseline by more than the tolerance when gated, plus one if the game ended in a
+ *   different state.
+ */
+static size_t compare_case(
+    const char *baseline,
+    const char *name,
+    const BenchResult *result,
+    double tolerance,
+    bool gate)
+{
+    size_t regressions = 0u;
+    bool found = false;
+
+    // a different final state means the numbers are for a different game, replay archives show where it went astray
+    uint64_t expected_digest = 0u;
+    if ((baseline != NULL) && find_baseline_digest(baseline, name, &expected_digest) &&
+        (expected_digest != result->digest))
+    {
+        printf(
+            "DIGEST %s: %016llx, baseline %016llx\n",
+            name,
+            (unsigned long long)result->digest,
+            (unsigned long long)expected_digest);
+        ++regressions;
+    }
+
+    for (size_t metric = 0u; (baseline != NULL) && (metric < BENCH_METRICS); ++metric)
+    {
+        double expected = 0.0;
+        if (!find_baseline_value(baseline, name, (BenchMetric)metric, &expected))
+        {
+            continue;
+        }
+        found = true;
+
+        // nothing to compare against, e.g. render time for a headless case
+        if (expected <= 0.0)
+        {
+            continue;
+        }
+
+        const double actual = result->metrics[metric];
+        const double change = ((actual - expected) * 100.0) / expected;
+        const bool worse = metric_higher_better[metric] ? (change < -tolerance) : (change > tolerance);
+        if (worse)
+        {
+            printf(
+                "%s %s %s: %.6g, baseline %.6g (%+.1f%%)\n",
+                gate ? "REGRESSION" : "WORSE",
+                name,
+                metric_names[metric],
+                actual,
+                expected,
+                change);
+            regressions += gate ? 1u : 0u;
+        }
+    }
+
+    if (!found)
+    {
+        printf("%s has no baseline\n", name);
+    }
+
+    return regressions;
+}
+
+int main(int argc, char *argv[])
+{
+    BenchOptions options;
+    if (parse_options(argc, argv, &options) != SUCCESS)
+    {
+        return 1;
+    }
+
+    static char names[BENCH_MAX_SESSIONS * BENCH_MODES][64];
+    static BenchResult results[BENCH_MAX_SESSIONS * BENCH_MODES];
+    size_t count = 0u;
+    bool failed = false;
+
+    // which sessions have offscreen numbers to check against, found before any case runs so the baseline's memory
+    // isn't in use while one is measured
+    bool offscreen_recorded[BENCH_MAX_SESSIONS] = {false};
+    char *baseline = read_text_file(options.baseline_path);
+    for (size_t i = 0u; (baseline != NULL) && (i < options.session_count); ++i)
+    {
+        double recorded = 0.0;
+        get_case_name(options.sessions[i], BENCH_OFFSCREEN, names[0], sizeof(names[0]));
+        offscreen_recorded[i] = find_baseline_value(baseline, names[0], RENDER_MS, &recorded);
+    }
+    free_tracked(baseline);
+
+    for (size_t i = 0u; i < options.session_count; ++i)
+    {
+        for (uint32_t mode = 0u; mode < BENCH_MODES; ++mode)
+        {
+            if (!options.modes[mode])
+            {
+                continue;
+            }
+
+            get_case_name(options.sessions[i], (BenchMode)mode, names[count], sizeof(names[count]));
+            if ((mode == BENCH_OFFSCREEN) && !options.offscreen_given && (options.write_path == NULL) &&
+                !offscreen_recorded[i])
+            {
+                printf("%s skipped, the baseline has no offscreen numbers to check it against\n", names[count]);
+                continue;
+            }
+
+            // best of the repeats: the highest rate and the lowest of everything else
+            BenchResult *best = &results[count];
+            bool ran = true;
+            for (uint32_t repeat = 0u; ran && (repeat < options.repeat); ++repeat)
+            {
+                BenchResult result;
+                ran = run_case_process(options.sessions[i], (BenchMode)mode, options.threads, &result) == SUCCESS;
+                if (ran && (repeat > 0u) && (result.digest != best->digest))
+                {
+                    printf("%s ended in a different state on repeat %u\n", names[count], repeat);
+                    ran = false;
+                }
+                best->digest = ran ? result.digest : best->digest;
+                for (size_t metric = 0u; ran && (metric < BENCH_METRICS); ++metric)
+                {
+                    const double value = result.metrics[metric];
+                    double *kept = &best->metrics[metric];
+                    const bool better = metric_higher_better[metric] ? (value > *kept) : (value < *kept);
+                    *kept = ((repeat == 0u) || better) ? value : *kept;
+                }
+            }
+
+            if (!ran)
+            {
+                printf("%s failed\n", names[count]);
+                failed = true;
+                continue;
+            }
+
+            printf(
+                "%-24s %10.0f steps/s  events %6.1fns  update_ball %6.1fns  handle_collisions %6.1fns  digest %5.1fns"
+                "  particles %8.1fns  render %7.3fms  observe %6.2fus  rss %7.0fKB  heap %9.0fB\n",
+                names[count],
+                best->metrics[STEPS_PER_SECOND],
+                best->metrics[EVENTS_NS],
+                best->metrics[UPDATE_BALL_NS],
+                best->metrics[HANDLE_COLLISIONS_NS],
+                best->metrics[DIGEST_NS],
+                best->metrics[PARTICLES_NS],
+                best->metrics[RENDER_MS],
+                best->metrics[OBSERVE_US],
+                best->metrics[PEAK_RSS_KB],
+                best->metrics[PEAK_HEAP_BYTES]);
+            ++count;
+        }
+    }
+
+    write_results(stdout, names, results, count);
+
+    if (options.write_path != NULL)
+    {
+        FILE *file = fopen(options.write_path, "w");
+        if (file == NULL)
+        {
+            printf("failed to write %s\n", options.write_path);
+            return 1;
+        }
+        write_results(file, names, results, count);
+        fclose(file);
+        printf("baseline written to %s\n", options.write_path);
+    }
+    else
+    {
+        // without a baseline there is nothing to fail on, unless one was asked for
+        baseline = read_text_file(options.baseline_path);
+        if (baseline == NULL)
+        {
+            printf("no baseline at %s\n", options.baseline_path);
+            failed = failed || options.baseline_given;
+        }
+
+        size_t regressions = 0u;
+        for (size_t i = 0u; (baseline != NULL) && (i < count); ++i)
+        {
+            regressions += compare_case(baseline, names[i], &results[i], options.tolerance, options.tolerance_given);
+        }
+
+        if (regressions > 0u)
+        {
+            printf("%zu digests or metrics regressed\n", regressions);
+            failed = true;
+        }
+        free_tracked(baseline);
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,309 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "metrics.h"
+
+/**
+ * Look inside metrics files written by breakout --metrics.
+ *
+ * usage: breakout_metrics summary METRICS
+ *        breakout_metrics dump METRICS TABLE [COLUMN...]
+ *
+ * summary prints how many rows each table has, how small each column came out and averages over the games played.
+ * dump prints a table, or some of its columns, as CSV for whatever does the analysis. Only the columns asked for are
+ * decoded.
+ */
+
+/**
+ * Helper function to find a table by name.
+ *
+ * @param name
+ *   Name of the table.
+ *
+ * @param table
+ *   Out parameter for the table.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if there is no such table
+ */
+static Result find_table(const char *name, MetricsTable *table)
+{
+    for (uint32_t i = 0u; i < METRICS_TABLES; ++i)
+    {
+        if (strcmp(name, get_metrics_table_name((MetricsTable)i)) == 0)
+        {
+            *table = (MetricsTable)i;
+            return SUCCESS;
+        }
+    }
+
+    return FAILED;
+}
+
+/**
+ * Helper function to find a column by name.
+ *
+ * @param table
+ *   Table the column is in.
+ *
+ * @param name
+ *   Name of the column.
+ *
+ * @param column
+ *   Out parameter for the column.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the table has no such column
+ */
+static Result find_column(MetricsTable table, const char *name, uint32_t *column)
+{
+    for (uint32_t i = 0u; i < get_metrics_column_count(table); ++i)
+    {
+        if (strcmp(name, get_metrics_column_name(table, i)) == 0)
+        {
+            *column = i;
+            return SUCCESS;
+        }
+    }
+
+    return FAILED;
+}
+
+/**
+ * Helper function to average a column.
+ *
+ * @param metrics
+ *   File to read.
+ *
+ * @param table
+ *   Table the column is in.
+ *
+ * @param column
+ *   Column to average.
+ *
+ * @param values
+ *   Scratch space with room for every row of the table.
+ *
+ * @param mean
+ *   Out parameter for the average, 0 for an empty table.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the column couldn't be read
+ */
+static Result get_column_mean(
+    const MetricsFile *metrics, MetricsTable table, uint32_t column, int64_t *values, double *mean)
+{
+    const uint64_t rows = get_metrics_rows(metrics, table);
+    if (read_metrics_column(metrics, table, column, values) != SUCCESS)
+    {
+        return FAILED;
+    }
+
+    double total = 0.0;
+    for (uint64_t i = 0u; i < rows; ++i)
+    {
+        total += (double)values[i];
+    }
+
+    *mean = (rows > 0u) ? (total / (double)rows) : 0.0;
+    return SUCCESS;
+}
+
+/**
+ * Helper function to print what is in a metrics file.
+ *
+ * @param path
+ *   File to summarise.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result summarise_metrics(const char *path)
+{
+    MetricsFile *metrics = NULL;
+    int64_t *values = NULL;
+    Result res = SUCCESS;
+
+    if (open_metrics(&metrics, path) != SUCCESS)
+    {
+        printf("failed to open %s\n", path);
+        res = FAILED;
+        goto done;
+    }
+
+    for (uint32_t i = 0u; i < METRICS_TABLES; ++i)
+    {
+        const MetricsTable table = (MetricsTable)i;
+        const uint64_t rows = get_metrics_rows(metrics, table);
+        printf("%s: %llu rows\n", get_metrics_table_name(table), (unsigned long long)rows);
+
+        for (uint32_t column = 0u; column < get_metrics_column_count(table); ++column)
+        {
+            const uint64_t bytes = get_metrics_column_bytes(metrics, table, column);
+            printf(
+                "  %-12s %10llu bytes %7.3f bytes/row\n",
+                get_metrics_column_name(table, column),
+                (unsigned long long)bytes,
+                (rows > 0u) ? ((double)bytes / (double)rows) : 0.0);
+        }
+    }
+
+    const uint64_t episodes = get_metrics_rows(metrics, METRICS_EPISODES);
+    values = (int64_t *)TRACKED_CALLOC((episodes == 0u) ? 1u : episodes, sizeof(int64_t));
+    if (values == NULL)
+    {
+        res = FAILED;
+        goto done;
+    }
+
+    double steps = 0.0;
+    double brick_rate = 0.0;
+    double misses = 0.0;
+    double score = 0.0;
+    if ((get_column_mean(metrics, METRICS_EPISODES, EPISODE_METRIC_STEPS, values, &steps) != SUCCESS) ||
+        (get_column_mean(metrics, METRICS_EPISODES, EPISODE_METRIC_BRICK_RATE, values, &brick_rate) != SUCCESS) ||
+        (get_column_mean(metrics, METRICS_EPISODES, EPISODE_METRIC_MISSES, values, &misses) != SUCCESS) ||
+        (get_column_mean(metrics, METRICS_EPISODES, EPISODE_METRIC_SCORE, values, &score) != SUCCESS))
+    {
+        printf("%s is damaged\n", path);
+        res = FAILED;
+        goto done;
+    }
+
+    printf(
+        "per game: %.1f steps %.3f bricks/s %.2f misses %.1f score\n", steps, brick_rate / 1000.0, misses, score);
+
+done:
+    free_tracked(values);
+    close_metrics(metrics);
+    return res;
+}
+
+/**
+ * Helper function to print a table as CSV.
+ *
+ * @param path
+ *   File to read.
+ *
+ * @param table_name
+ *   Table to print.
+ *
+ * @param names
+ *   Columns to print, or NULL for all of them.
+ *
+ * @param count
+ *   Number of columns given.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result dump_metrics(const char *path, const char *table_name, char *names[], size_t count)
+{
+    MetricsFile *metrics = NULL;
+    int64_t *values = NULL;
+    Result res = SUCCESS;
+
+    MetricsTable table = METRICS_STEPS;
+    if (find_table(table_name, &table) != SUCCESS)
+    {
+        printf("no table %s\n", table_name);
+        res = FAILED;
+        goto done;
+    }
+
+    uint32_t columns[METRICS_MAX_COLUMNS];
+    const size_t column_count = (names != NULL) ? count : get_metrics_column_count(table);
+    if (column_count > METRICS_MAX_COLUMNS)
+    {
+        printf("at most %u columns\n", METRICS_MAX_COLUMNS);
+        res = FAILED;
+        goto done;
+    }
+
+    for (size_t i = 0u; i < column_count; ++i)
+    {
+        columns[i] = (uint32_t)i;
+        if ((names != NULL) && (find_column(table, names[i], &columns[i]) != SUCCESS))
+        {
+            printf("no column %s in %s\n", names[i], table_name);
+            res = FAILED;
+            goto done;
+        }
+    }
+
+    if (open_metrics(&metrics, path) != SUCCESS)
+    {
+        printf("failed to open %s\n", path);
+        res = FAILED;
+        goto done;
+    }
+
+    // the columns are decoded side by side, each into its own stretch of values
+    const uint64_t rows = get_metrics_rows(metrics, table);
+    values = (int64_t *)TRACKED_CALLOC((rows * column_count) + 1u, sizeof(int64_t));
+    if (values == NULL)
+    {
+        res = FAILED;
+        goto done;
+    }
+
+    for (size_t i = 0u; i < column_count; ++i)
+    {
+        if (read_metrics_column(metrics, table, columns[i], &values[i * rows]) != SUCCESS)
+        {
+            printf("%s is damaged\n", path);
+            res = FAILED;
+            goto done;
+        }
+
+        printf("%s%s", (i > 0u) ? "," : "", get_metrics_column_name(table, columns[i]));
+    }
+    printf("\n");
+
+    for (uint64_t row = 0u; row < rows; ++row)
+    {
+        for (size_t i = 0u; i < column_count; ++i)
+        {
+            printf("%s%lld", (i > 0u) ? "," : "", (long long)values[(i * rows) + row]);
+        }
+        printf("\n");
+    }
+
+done:
+    free_tracked(values);
+    close_metrics(metrics);
+    return res;
+}
+
+int main(int argc, char *argv[])
+{
+    Result result = FAILED;
+
+    if ((argc >= 3) && (strcmp(argv[1], "summary") == 0))
+    {
+        result = summarise_metrics(argv[2]);
+    }
+    else if ((argc >= 4) && (strcmp(argv[1], "dump") == 0))
+    {
+        result = dump_metrics(argv[2], argv[3], (argc > 4) ? &argv[4] : NULL, (size_t)(argc - 4));
+    }
+    else
+    {
+        printf(
+            "usage: %s summary METRICS\n"
+            "       %s dump METRICS TABLE [COLUMN...]\n",
+            argv[0],
+            argv[0]);
+    }
+
+    return (result == SUCCESS) ? 0 : 1;
+}
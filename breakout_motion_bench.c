@@ -0,0 +1,228 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "game.h"
+#include "grid.h"
+#include "timer.h"
+
+/**
+ * Benchmark for moving bricks, times keeping the brick grid up to date as more and more of a large level moves.
+ *
+ * usage: breakout_motion_bench [--size SIZE] [--steps N]
+ *
+ * Plays the large level of a SIZE world once with none of its rows moving, then with 1, 2, 4 and so on up to all of
+ * them sliding back and forth, and prints for each how long a step spent moving bricks, that time per moving brick and
+ * how many bricks crossed into another grid cell a step. The cost should grow with the number of moving bricks and
+ * stay flat per brick. For scale each case also times building the level's whole grid from scratch, which is what
+ * every step would cost with a grid that can't be updated in place.
+ */
+
+/**
+ * World size and steps played a case when not given.
+ */
+#define MOTION_DEFAULT_SIZE 10000
+#define MOTION_DEFAULT_STEPS 2000u
+
+/**
+ * How far rows slide, every other row the other way, and the steps to get there and back. The large level leaves this
+ * much room at each side, and a brick in every few crosses a cell edge on the way.
+ */
+#define MOTION_REACH SCALAR(20.0f)
+#define MOTION_PERIOD 200u
+
+/**
+ * Grids built from scratch a case, the fastest is kept.
+ */
+#define MOTION_REBUILDS 5u
+
+/**
+ * Helper function to time building a grid over every brick of a game from scratch.
+ *
+ * @param game
+ *   Game whose bricks to index.
+ *
+ * @param ns
+ *   Out parameter for the fastest build in nanoseconds.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result time_rebuild(const Game *game, uint64_t *ns)
+{
+    *ns = UINT64_MAX;
+
+    for (uint32_t i = 0u; i < MOTION_REBUILDS; ++i)
+    {
+        BrickGrid *grid = NULL;
+        if (create_brick_grid(&grid, game->width, game->height, GAME_CELL_SIZE, game->brick_count) != SUCCESS)
+        {
+            return FAILED;
+        }
+
+        const uint64_t start = get_time_ns();
+        Result res = SUCCESS;
+        for (size_t j = 0u; (res == SUCCESS) && (j < game->brick_count); ++j)
+        {
+            res = add_brick_grid(grid, &get_brick(game, j)->block);
+        }
+        res = (res == SUCCESS) ? build_brick_grid(grid) : res;
+        const uint64_t elapsed = get_time_ns() - start;
+
+        destroy_brick_grid(grid);
+        if (res != SUCCESS)
+        {
+            return FAILED;
+        }
+
+        *ns = (elapsed < *ns) ? elapsed : *ns;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * Helper function to play the large level with some of its rows moving and print the costs.
+ *
+ * @param size
+ *   Width and height of the world.
+ *
+ * @param moving_rows
+ *   Rows set moving, from the top.
+ *
+ * @param steps
+ *   Steps to play.
+ *
+ * @param rows
+ *   Out parameter for the number of rows in the level.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result run_case(Scalar size, uint32_t moving_rows, uint64_t steps, uint32_t *rows)
+{
+    Game *game = NULL;
+    BrickMotion *motions = NULL;
+    Result res = SUCCESS;
+
+    if (create_large_game(&game, size) != SUCCESS)
+    {
+        printf("failed to create game\n");
+        res = FAILED;
+        goto done;
+    }
+
+    // the level is filled a row at a time, so the first row is the bricks level with the first
+    uint32_t columns = 0u;
+    while ((columns < game->brick_count) &&
+           (get_brick(game, columns)->block.position.y == get_brick(game, 0u)->block.position.y))
+    {
+        ++columns;
+    }
+    *rows = (columns == 0u) ? 0u : (uint32_t)(game->brick_count / columns);
+    moving_rows = (moving_rows > *rows) ? *rows : moving_rows;
+
+    motions = (BrickMotion *)calloc((moving_rows == 0u) ? 1u : moving_rows, sizeof(BrickMotion));
+    if (motions == NULL)
+    {
+        printf("failed to allocate motions\n");
+        res = FAILED;
+        goto done;
+    }
+
+    for (uint32_t row = 0u; row < moving_rows; ++row)
+    {
+        motions[row] = (BrickMotion){
+            .first_brick = row * columns,
+            .brick_count = columns,
+            .reach = create_vec_xy(((row % 2u) == 0u) ? MOTION_REACH : -MOTION_REACH, SCALAR(0.0f)),
+            .period = MOTION_PERIOD};
+    }
+
+    if (set_brick_motion(game, motions, moving_rows) != SUCCESS)
+    {
+        printf("failed to set %u rows moving\n", moving_rows);
+        res = FAILED;
+        goto done;
+    }
+
+    // nobody plays, the ball just bounces around until the lives run out and then carries on
+    const GameInput inputs[GAME_MAX_PLAYERS] = {{0}};
+    StepOutcome outcome;
+    const uint64_t start = get_time_ns();
+    for (uint64_t i = 0u; i < steps; ++i)
+    {
+        step_game(game, inputs, &outcome);
+    }
+    const uint64_t elapsed = get_time_ns() - start;
+
+    uint64_t rebuild_ns = 0u;
+    if (time_rebuild(game, &rebuild_ns) != SUCCESS)
+    {
+        printf("failed to build a grid\n");
+        res = FAILED;
+        goto done;
+    }
+
+    const size_t moving = (size_t)moving_rows * columns;
+    const double move_ns = (double)game->phase_ns[GAME_PHASE_MOVE_BRICKS] / (double)steps;
+    printf(
+        "%9zu %14.1f %10.2f %12.2f %10.1f %12llu\n",
+        moving,
+        move_ns,
+        (moving == 0u) ? 0.0 : (move_ns / (double)moving),
+        (double)game->moved_cells / (double)steps,
+        (double)elapsed / (double)steps,
+        (unsigned long long)rebuild_ns);
+
+done:
+    free(motions);
+    destroy_game(game);
+    return res;
+}
+
+int main(int argc, char *argv[])
+{
+    int32_t size = MOTION_DEFAULT_SIZE;
+    uint64_t steps = MOTION_DEFAULT_STEPS;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if ((strcmp(argv[i], "--size") == 0) && ((i + 1) < argc))
+        {
+            size = (int32_t)strtol(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(argv[i], "--steps") == 0) && ((i + 1) < argc))
+        {
+            steps = strtoull(argv[++i], NULL, 10);
+        }
+        else
+        {
+            size = 0;
+        }
+    }
+
+    if ((size < 800) || (steps == 0u))
+    {
+        printf("usage: %s [--size SIZE] [--steps N], the size at least 800\n", argv[0]);
+        return 1;
+    }
+
+    printf("%d world, %llu steps a case\n", size, (unsigned long long)steps);
+    printf("   moving   move ns/step   ns/brick   cells/step    step ns   rebuild ns\n");
+
+    // none moving tells how many rows there are, then double the moving rows each case ending with every row
+    uint32_t rows = 0u;
+    Result res = run_case(scalar_from_int(size), 0u, steps, &rows);
+    for (uint32_t moving_rows = 1u; (res == SUCCESS) && (moving_rows < rows); moving_rows *= 2u)
+    {
+        res = run_case(scalar_from_int(size), moving_rows, steps, &rows);
+    }
+    res = (res == SUCCESS) ? run_case(scalar_from_int(size), rows, steps, &rows) : res;
+
+    return (res == SUCCESS) ? 0 : 1;
+}
@@ -0,0 +1,488 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "camera.h"
+#include "game.h"
+#include "jobs.h"
+#include "replay.h"
+#include "scene.h"
+#include "session.h"
+#include "timer.h"
+#include "window.h"
+
+/**
+ * Build, check and watch replay archives.
+ *
+ * usage: breakout_replay build SESSION ARCHIVE [INTERVAL]
+ *        breakout_replay seek ARCHIVE [STEP...]
+ *        breakout_replay view ARCHIVE [STEP]
+ *        breakout_replay diff ARCHIVE ARCHIVE
+ *
+ * build plays a recorded session and writes it out as an archive. seek jumps to each step given, or to a spread of
+ * steps across the whole game, and prints how long each jump took and the state hash. view plays an archive in a
+ * window from a step, left and right jump back and forward by VIEW_JUMP_STEPS. diff finds the first step two archives
+ * of the same game disagree at, say one built by each of two builds from the same session, by bisecting their digests.
+ */
+
+/**
+ * Steps played a second when viewing, the game's own rate.
+ */
+#define VIEW_STEPS_PER_SECOND 1000u
+
+/**
+ * Steps a left or right press jumps when viewing.
+ */
+#define VIEW_JUMP_STEPS 10000u
+
+/**
+ * Seeks made by seek when no steps are given.
+ */
+#define SEEK_SAMPLES 64u
+
+/**
+ * Helper function to write a session out as an archive.
+ *
+ * @param session_path
+ *   Session to play.
+ *
+ * @param archive_path
+ *   Archive to write.
+ *
+ * @param interval
+ *   Steps between keyframes.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result build_archive(const char *session_path, const char *archive_path, uint32_t interval)
+{
+    Session *session = NULL;
+    Game *game = NULL;
+    ReplayWriter *writer = NULL;
+    Result res = SUCCESS;
+
+    if ((load_session(&session, session_path) != SUCCESS) || (create_session_game(session, &game) != SUCCESS))
+    {
+        printf("failed to load %s\n", session_path);
+        res = FAILED;
+        goto done;
+    }
+
+    if (create_replay_writer(&writer, archive_path, game, session->world_size, interval) != SUCCESS)
+    {
+        printf("failed to create %s\n", archive_path);
+        res = FAILED;
+        goto done;
+    }
+
+    SessionCursor cursor = start_session(session);
+    GameInput inputs[GAME_MAX_PLAYERS] = {0};
+    while (next_session_input(&cursor, &inputs[0]))
+    {
+        StepOutcome outcome;
+        step_game(game, inputs, &outcome);
+        if (record_replay_input(writer, game, &inputs[0]) != SUCCESS)
+        {
+            printf("failed to write %s\n", archive_path);
+            res = FAILED;
+            goto done;
+        }
+    }
+
+    if (finish_replay_writer(writer, game) != SUCCESS)
+    {
+        printf("failed to write %s\n", archive_path);
+        res = FAILED;
+        goto done;
+    }
+
+    const uint64_t hash = hash_game(game);
+    printf(
+        "%s: %llu steps, state hash %016llx\n",
+        archive_path,
+        (unsigned long long)game->state.step,
+        (unsigned long long)hash);
+    if (session->valid_hash && (session->hash != hash))
+    {
+        printf("state hash doesn't match the session's %016llx\n", (unsigned long long)session->hash);
+        res = FAILED;
+    }
+
+done:
+    destroy_replay_writer(writer);
+    destroy_game(game);
+    destroy_session(session);
+    return res;
+}
+
+/**
+ * Helper function to time seeks around an archive.
+ *
+ * @param archive_path
+ *   Archive to seek in.
+ *
+ * @param steps
+ *   Steps to seek to, or NULL for a spread across the whole game.
+ *
+ * @param count
+ *   Number of steps given.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure, or if the last step doesn't hash to what the archive recorded
+ */
+static Result seek_archive(const char *archive_path, char *steps[], size_t count)
+{
+    Replay *replay = NULL;
+    Game *game = NULL;
+    Result res = SUCCESS;
+
+    if ((open_replay(&replay, archive_path) != SUCCESS) || (create_replay_game(replay, &game) != SUCCESS))
+    {
+        printf("failed to open %s\n", archive_path);
+        res = FAILED;
+        goto done;
+    }
+
+    const uint64_t total = get_replay_steps(replay);
+    const size_t seeks = (steps != NULL) ? count : SEEK_SAMPLES;
+    uint64_t worst_ns = 0u;
+    uint64_t all_ns = 0u;
+    uint32_t seed = 0x2545f491u;
+
+    for (size_t i = 0u; i < seeks; ++i)
+    {
+        // jump around in no particular order, ending on the last step so the final hash can be checked
+        uint64_t step = total;
+        if (steps != NULL)
+        {
+            step = strtoull(steps[i], NULL, 10);
+        }
+        else if ((i + 1u) < seeks)
+        {
+            seed = (seed * 1664525u) + 1013904223u;
+            step = (uint64_t)(((double)seed / 4294967296.0) * (double)total);
+        }
+
+        const uint64_t start = get_time_ns();
+        if (seek_replay(replay, game, step) != SUCCESS)
+        {
+            printf("failed to seek to step %llu\n", (unsigned long long)step);
+            res = FAILED;
+            goto done;
+        }
+        const uint64_t elapsed = get_time_ns() - start;
+
+        worst_ns = (elapsed > worst_ns) ? elapsed : worst_ns;
+        all_ns += elapsed;
+
+        uint32_t digest = 0u;
+        if ((get_replay_digest(replay, step, &digest) == SUCCESS) && (digest != (uint32_t)digest_game(game)))
+        {
+            printf("digest at step %llu doesn't match the archive\n", (unsigned long long)step);
+            res = FAILED;
+        }
+        if (steps != NULL)
+        {
+            printf(
+                "step %llu: state hash %016llx in %.3fms\n",
+                (unsigned long long)step,
+                (unsigned long long)hash_game(game),
+                (double)elapsed / 1000000.0);
+        }
+    }
+
+    printf(
+        "%zu seeks in %llu steps: mean %.3fms worst %.3fms\n",
+        seeks,
+        (unsigned long long)total,
+        (seeks > 0u) ? ((double)all_ns / (double)seeks / 1000000.0) : 0.0,
+        (double)worst_ns / 1000000.0);
+
+    if ((steps == NULL) && (hash_game(game) != get_replay_hash(replay)))
+    {
+        printf("state hash at the last step doesn't match the archive\n");
+        res = FAILED;
+    }
+
+done:
+    destroy_game(game);
+    close_replay(replay);
+    return res;
+}
+
+/**
+ * Helper function to find the first step two archives disagree at.
+ *
+ * @param first_path
+ *   First archive.
+ *
+ * @param second_path
+ *   Second archive.
+ *
+ * @returns
+ *   SUCCESS if the archives agree at every step they both have
+ *   FAILED on failure, or if they disagree
+ */
+static Result diff_archives(const char *first_path, const char *second_path)
+{
+    Replay *first = NULL;
+    Replay *second = NULL;
+    Result res = SUCCESS;
+
+    if ((open_replay(&first, first_path) != SUCCESS) || (open_replay(&second, second_path) != SUCCESS))
+    {
+        printf("failed to open %s or %s\n", first_path, second_path);
+        res = FAILED;
+        goto done;
+    }
+
+    const uint64_t first_steps = get_replay_steps(first);
+    const uint64_t second_steps = get_replay_steps(second);
+    const uint64_t steps = (first_steps < second_steps) ? first_steps : second_steps;
+
+    // runs that disagree at a step disagree at every step after it, so the digests can be bisected
+    uint64_t low = 1u;
+    uint64_t high = steps + 1u;
+    while (low < high)
+    {
+        const uint64_t middle = low + ((high - low) / 2u);
+        uint32_t a = 0u;
+        uint32_t b = 0u;
+        if ((get_replay_digest(first, middle, &a) != SUCCESS) || (get_replay_digest(second, middle, &b) != SUCCESS))
+        {
+            printf("failed to read the digest of step %llu\n", (unsigned long long)middle);
+            res = FAILED;
+            goto done;
+        }
+
+        if (a == b)
+        {
+            low = middle + 1u;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    if (low <= steps)
+    {
+        // the keys that led to the step tell a change in the input apart from a change in the simulation
+        GameInput a = {0};
+        GameInput b = {0};
+        get_replay_input(first, low - 1u, &a);
+        get_replay_input(second, low - 1u, &b);
+        printf(
+            "first differing step %llu of %llu, %s\n",
+            (unsigned long long)low,
+            (unsigned long long)steps,
+            ((a.left == b.left) && (a.right == b.right)) ? "same keys" : "different keys");
+        res = FAILED;
+    }
+    else if (first_steps != second_steps)
+    {
+        printf(
+            "same for %llu steps, then one archive ends (%llu and %llu steps)\n",
+            (unsigned long long)steps,
+            (unsigned long long)first_steps,
+            (unsigned long long)second_steps);
+        res = FAILED;
+    }
+    else if (get_replay_hash(first) != get_replay_hash(second))
+    {
+        printf("same digests for all %llu steps but the final state hashes differ\n", (unsigned long long)steps);
+        res = FAILED;
+    }
+    else
+    {
+        printf("same for all %llu steps\n", (unsigned long long)steps);
+    }
+
+done:
+    close_replay(second);
+    close_replay(first);
+    return res;
+}
+
+/**
+ * Helper function to play an archive in a window.
+ *
+ * @param archive_path
+ *   Archive to play.
+ *
+ * @param step
+ *   Step to start from.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result view_archive(const char *archive_path, uint64_t step)
+{
+    Replay *replay = NULL;
+    Game *game = NULL;
+    JobSystem *jobs = NULL;
+    Scene *scene = NULL;
+    Window *window = NULL;
+    Result res = SUCCESS;
+
+    if ((open_replay(&replay, archive_path) != SUCCESS) || (create_replay_game(replay, &game) != SUCCESS))
+    {
+        printf("failed to open %s\n", archive_path);
+        res = FAILED;
+        goto done;
+    }
+
+    if ((create_job_system(&jobs, 0u) != SUCCESS) || (create_scene(&scene, game, game->brick_count) != SUCCESS) ||
+        (create_window(&window) != SUCCESS) || (reserve_window_quads(window, game->brick_count) != SUCCESS))
+    {
+        printf("failed to create window\n");
+        res = FAILED;
+        goto done;
+    }
+
+    const uint64_t total = get_replay_steps(replay);
+    Camera camera = create_camera(scalar_from_int(WINDOW_WIDTH), scalar_from_int(WINDOW_HEIGHT));
+    uint64_t target = (step < total) ? step : total;
+    uint64_t seek_ns = 0u;
+    uint64_t clock = get_time_ns();
+    bool seeking = true;
+    bool running = true;
+
+    while (running)
+    {
+        KeyEvent event;
+        Result event_result;
+        while ((event_result = get_window_event(window, &event)) != NO_EVENT)
+        {
+            if ((event_result != SUCCESS) || (event.key_state != K_DOWN))
+            {
+                continue;
+            }
+
+            if (event.key == ESCAPE_K)
+            {
+                running = false;
+            }
+            else if (event.key == LEFT_K)
+            {
+                target = (game->state.step > VIEW_JUMP_STEPS) ? (game->state.step - VIEW_JUMP_STEPS) : 0u;
+                seeking = true;
+            }
+            else if (event.key == RIGHT_K)
+            {
+                target = ((total - game->state.step) > VIEW_JUMP_STEPS) ? (game->state.step + VIEW_JUMP_STEPS) : total;
+                seeking = true;
+            }
+        }
+
+        const uint64_t now = get_time_ns();
+        if (seeking)
+        {
+            if (seek_replay(replay, game, target) != SUCCESS)
+            {
+                printf("failed to seek to step %llu\n", (unsigned long long)target);
+                res = FAILED;
+                goto done;
+            }
+            seek_ns = get_time_ns() - now;
+            clock = now;
+            seeking = false;
+        }
+
+        // play on at the game's rate until the archive runs out
+        const uint64_t due = ((now - clock) * VIEW_STEPS_PER_SECOND) / 1000000000u;
+        clock += (due * 1000000000u) / VIEW_STEPS_PER_SECOND;
+        for (uint64_t i = 0u; i < due; ++i)
+        {
+            GameInput inputs[GAME_MAX_PLAYERS] = {0};
+            if (get_replay_input(replay, game->state.step, &inputs[0]) != SUCCESS)
+            {
+                break;
+            }
+
+            StepOutcome outcome;
+            step_game(game, inputs, &outcome);
+        }
+
+        if (pre_render_window(window) != SUCCESS)
+        {
+            res = FAILED;
+            goto done;
+        }
+
+        follow_camera(&camera, &game->state.ball.block, game->width, game->height);
+        set_camera_window(window, &camera);
+
+        char position[HUD_TEXT_LENGTH];
+        char seek[HUD_TEXT_LENGTH];
+        snprintf(
+            position,
+            sizeof(position),
+            "STEP %llu / %llu",
+            (unsigned long long)game->state.step,
+            (unsigned long long)total);
+        snprintf(seek, sizeof(seek), "SEEK %.2fMS", (double)seek_ns / 1000000.0);
+
+        if ((draw_scene(scene, window, jobs, &camera, NULL) != SUCCESS) ||
+            (draw_text_window(window, 0u, 10.0f, 10.0f, 2.0f, position, 0xff, 0xff, 0xff) != SUCCESS) ||
+            (draw_text_window(window, 1u, 10.0f, 30.0f, 2.0f, seek, 0x80, 0xc0, 0xff) != SUCCESS))
+        {
+            printf("failed to render scene\n");
+            res = FAILED;
+            goto done;
+        }
+
+        post_render_window(window);
+    }
+
+done:
+    destroy_window(window);
+    destroy_scene(scene);
+    destroy_job_system(jobs);
+    destroy_game(game);
+    close_replay(replay);
+    return res;
+}
+
+int main(int argc, char *argv[])
+{
+    Result result = FAILED;
+
+    if ((argc >= 4) && (strcmp(argv[1], "build") == 0))
+    {
+        const uint32_t interval = (argc > 4) ? (uint32_t)strtoul(argv[4], NULL, 10) : REPLAY_DEFAULT_INTERVAL;
+        result = (interval > 0u) ? build_archive(argv[2], argv[3], interval) : FAILED;
+    }
+    else if ((argc >= 3) && (strcmp(argv[1], "seek") == 0))
+    {
+        result = seek_archive(argv[2], (argc > 3) ? &argv[3] : NULL, (size_t)(argc - 3));
+    }
+    else if ((argc >= 3) && (strcmp(argv[1], "view") == 0))
+    {
+        result = view_archive(argv[2], (argc > 3) ? strtoull(argv[3], NULL, 10) : 0u);
+    }
+    else if ((argc >= 4) && (strcmp(argv[1], "diff") == 0))
+    {
+        result = diff_archives(argv[2], argv[3]);
+    }
+    else
+    {
+        printf(
+            "usage: %s build SESSION ARCHIVE [INTERVAL]\n"
+            "       %s seek ARCHIVE [STEP...]\n"
+            "       %s view ARCHIVE [STEP]\n"
+            "       %s diff ARCHIVE ARCHIVE\n",
+            argv[0],
+            argv[0],
+            argv[0],
+            argv[0]);
+    }
+
+    return (result == SUCCESS) ? 0 : 1;
+}
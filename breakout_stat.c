@@ -0,0 +1,83 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "telemetry.h"
+
+/**
+ * Print live statistics from a running game.
+ *
+ * usage: breakout_stat shm_name [interval_ms]
+ *
+ * shm_name is the name the game was given with --telemetry.
+ */
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        printf("usage: %s shm_name [interval_ms]\n", argv[0]);
+        return 1;
+    }
+
+    const char *name = argv[1];
+    const long interval_ms = (argc > 2) ? strtol(argv[2], NULL, 10) : 500;
+
+    Telemetry *telemetry = NULL;
+    if (open_telemetry(&telemetry, name) != SUCCESS)
+    {
+        printf("could not open %s, is the game running with --telemetry %s?\n", name, name);
+        return 1;
+    }
+
+    printf("%10s %10s %9s %9s %10s %10s %8s %9s %6s %5s %8s %9s %9s\n",
+           "frame",
+           "step",
+           "frame_ms",
+           "phys_ms",
+           "steps/s",
+           "coll/s",
+           "entities",
+           "particles",
+           "score",
+           "lives",
+           "allocs/f",
+           "heap_kb",
+           "peak_kb");
+
+    const struct timespec interval = {.tv_sec = interval_ms / 1000, .tv_nsec = (interval_ms % 1000) * 1000000};
+
+    for (;;)
+    {
+        TelemetryStats stats;
+        Result result = read_telemetry(telemetry, &stats);
+        if (result == SUCCESS)
+        {
+            printf("%10llu %10llu %9.3f %9.3f %10.0f %10.1f %8u %9u %6u %5u %8u %9llu %9llu\n",
+                   (unsigned long long)stats.frame,
+                   (unsigned long long)stats.step,
+                   stats.frame_ms,
+                   stats.physics_ms,
+                   stats.steps_per_second,
+                   stats.collisions_per_second,
+                   stats.entity_count,
+                   stats.particle_count,
+                   stats.score,
+                   stats.lives,
+                   stats.frame_allocations,
+                   (unsigned long long)(stats.heap_bytes / 1024u),
+                   (unsigned long long)(stats.peak_heap_bytes / 1024u));
+            fflush(stdout);
+        }
+        else if (result == FAILED)
+        {
+            printf("%s is stuck mid update, the game must have died while publishing\n", name);
+            break;
+        }
+
+        nanosleep(&interval, NULL);
+    }
+
+    destroy_telemetry(telemetry);
+    return 1;
+}
@@ -0,0 +1,60 @@
+#include <assert.h>
+#include <stdbool.h>
+
+#include "camera.h"
+
+/**
+ * Helper function to keep one axis of the view inside the world.
+ *
+ * @param position
+ *   Position of the view on this axis.
+ *
+ * @param size
+ *   Size of the view on this axis.
+ *
+ * @param world_size
+ *   Size of the world on this axis.
+ *
+ * @returns
+ *   Clamped position.
+ */
+static Scalar clamp_view(Scalar position, Scalar size, Scalar world_size)
+{
+    // a world smaller than the view stays pinned to the upper left corner
+    if (position > (world_size - size))
+    {
+        position = world_size - size;
+    }
+
+    return (position < SCALAR(0.0f)) ? SCALAR(0.0f) : position;
+}
+
+Camera create_camera(Scalar width, Scalar height)
+{
+    return (Camera){.view = create_block_xy(SCALAR(0.0f), SCALAR(0.0f), width, height)};
+}
+
+void follow_camera(Camera *camera, const Block *target, Scalar world_width, Scalar world_height)
+{
+    assert(camera != NULL);
+    assert(target != NULL);
+
+    const Scalar x = target->position.x + (target->width / 2) - (camera->view.width / 2);
+    const Scalar y = target->position.y + (target->height / 2) - (camera->view.height / 2);
+
+    camera->view.position.x = clamp_view(x, camera->view.width, world_width);
+    camera->view.position.y = clamp_view(y, camera->view.height, world_height);
+}
+
+bool is_visible_camera(const Camera *camera, const Block *block)
+{
+    assert(camera != NULL);
+    assert(block != NULL);
+
+    const Block *view = &camera->view;
+
+    return (block->position.x < (view->position.x + view->width)) &&
+           ((block->position.x + block->width) > view->position.x) &&
+           (block->position.y < (view->position.y + view->height)) &&
+           ((block->position.y + block->height) > view->position.y);
+}
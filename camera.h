@@ -0,0 +1,66 @@
+#ifndef _CAMERA_H_
+#define _CAMERA_H_
+
+#include <stdbool.h>
+
+#include "block.h"
+#include "scalar.h"
+
+/**
+ * Camera maps world coordinates to screen coordinates so levels can be larger than the window.
+ */
+
+/**
+ * Struct for camera data, the view is the part of the world shown on screen.
+ */
+typedef struct Camera
+{
+    Block view;
+} Camera;
+
+/**
+ * Create a camera showing the upper left corner of the world.
+ *
+ * @param width
+ *   Width of the view, usually the window width.
+ *
+ * @param height
+ *   Height of the view, usually the window height.
+ *
+ * @returns
+ *   Created camera.
+ */
+Camera create_camera(Scalar width, Scalar height);
+
+/**
+ * Centre the camera on a block, without showing anything outside the world.
+ *
+ * @param camera
+ *   Camera to move.
+ *
+ * @param target
+ *   Block to follow.
+ *
+ * @param world_width
+ *   Width of the world.
+ *
+ * @param world_height
+ *   Height of the world.
+ */
+void follow_camera(Camera *camera, const Block *target, Scalar world_width, Scalar world_height);
+
+/**
+ * Check if any part of a block is in view.
+ *
+ * @param camera
+ *   Camera to check against.
+ *
+ * @param block
+ *   Block to check.
+ *
+ * @returns
+ *   True if the block intersects the view, otherwise false.
+ */
+bool is_visible_camera(const Camera *camera, const Block *block);
+
+#endif
@@ -0,0 +1,2103 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "game.h"
+#include "level.h"
+#include "timer.h"
+#include "trace.h"
+
+/**
+ * Number of lives at the start of a game.
+ */
+#define START_LIVES 3u
+
+/**
+ * Speed the paddle moves at while a key is held.
+ */
+#define PADDLE_SPEED SCALAR(0.4f)
+
+/**
+ * Layout of the brick field in large levels, the distance between neighbouring bricks and the empty border.
+ */
+#define FIELD_PITCH_X SCALAR(50.0f)
+#define FIELD_PITCH_Y SCALAR(40.0f)
+#define FIELD_MARGIN_X SCALAR(20.0f)
+#define FIELD_MARGIN_Y SCALAR(50.0f)
+
+/**
+ * Large levels make the bricks of one patch of the field in this many explosive, choosing patches by a hash of where
+ * they are so the same size of world always gets the same level.
+ */
+#define EXPLOSIVE_PATCH 16
+#define EXPLOSIVE_CHANCE 6u
+#define EXPLOSIVE_SEED 0x632be59bd9b4e019u
+
+/**
+ * How far past its edges an explosive brick destroys bricks. Reaches the eight bricks around one in the brick field,
+ * so a patch of explosive bricks goes off as one.
+ */
+#define BLAST_REACH SCALAR(30.0f)
+
+/**
+ * Normal and widened paddle width.
+ */
+#define PADDLE_WIDTH SCALAR(100.0f)
+#define WIDE_PADDLE_WIDTH SCALAR(160.0f)
+
+/**
+ * One destroyed brick in this many drops a power-up.
+ */
+#define DROP_CHANCE 4u
+
+/**
+ * Size and falling speed of a power-up.
+ */
+#define DROP_WIDTH SCALAR(24.0f)
+#define DROP_HEIGHT SCALAR(12.0f)
+#define DROP_SPEED SCALAR(0.15f)
+
+/**
+ * How long each effect lasts and how long multi-ball waits before it works again, in steps.
+ */
+#define WIDE_STEPS 10000u
+#define SLOW_STEPS 8000u
+#define STICKY_STEPS 10000u
+#define STICKY_HOLD_STEPS 500u
+#define MULTI_COOLDOWN_STEPS 15000u
+
+/**
+ * Time a phase of a step into Game.phase_ns, compiled out unless built with BREAKOUT_PROFILE.
+ */
+#ifdef BREAKOUT_PROFILE
+#define PROFILE_START(NAME) const uint64_t NAME = get_time_ns()
+#define PROFILE_STOP(GAME, PHASE, NAME) ((GAME)->phase_ns[(PHASE)] += get_time_ns() - (NAME))
+#else
+#define PROFILE_START(NAME)
+#define PROFILE_STOP(GAME, PHASE, NAME)
+#endif
+
+/**
+ * FNV-1a 64 bit parameters.
+ */
+#define HASH_OFFSET 0xcbf29ce484222325u
+#define HASH_PRIME 0x100000001b3u
+
+/**
+ * Starting value of a digest, the odd multiplier each word is folded in with, and the value each brick index is offset
+ * by before mixing so brick 0 doesn't mix to 0.
+ */
+#define DIGEST_SEED 0x9e3779b97f4a7c15u
+#define DIGEST_PRIME 0xff51afd7ed558ccdu
+#define DIGEST_BRICK_SALT 0x2545f4914f6cdd1du
+
+_Static_assert(sizeof(Scalar) == sizeof(uint32_t), "digests pack scalars into 32 bit words");
+
+/**
+ * What each power-up timer does when it fires, the timer data is the player it applies to.
+ */
+typedef enum TimerKind
+{
+    WIDE_END_TIMER,
+    SLOW_END_TIMER,
+    STICKY_END_TIMER,
+    MULTI_READY_TIMER,
+    RELEASE_TIMER
+} TimerKind;
+
+typedef struct CollosionResult
+{
+    bool overlap;
+    Scalar shift_b_x;
+    Scalar shift_b_y;
+} CollosionResult;
+
+/**
+ * Helper function to scramble a 64 bit value, the splitmix64 finaliser. Every input bit affects every output bit.
+ *
+ * @param value
+ *   Value to scramble.
+ *
+ * @returns
+ *   Scrambled value.
+ */
+static inline uint64_t mix_digest(uint64_t value)
+{
+    value = (value ^ (value >> 30u)) * 0xbf58476d1ce4e5b9u;
+    value = (value ^ (value >> 27u)) * 0x94d049bb133111ebu;
+    return value ^ (value >> 31u);
+}
+
+/**
+ * Helper function to get a brick's share of GameState.brick_digest.
+ *
+ * @param index
+ *   Brick index.
+ *
+ * @returns
+ *   Digest of the brick.
+ */
+static inline uint64_t get_brick_digest(size_t index)
+{
+    return mix_digest((uint64_t)index + DIGEST_BRICK_SALT);
+}
+
+/**
+ * Helper function to add a collision to a step's outcome.
+ *
+ * @param game
+ *   Game being stepped.
+ *
+ * @param outcome
+ *   Outcome of the step.
+ *
+ * @param kind
+ *   What the ball hit.
+ *
+ * @param ball
+ *   0 for the main ball, i + 1 for extra ball i.
+ *
+ * @param other
+ *   Brick index for a brick, player for a paddle, 0 for a wall.
+ *
+ * @returns
+ *   Event added, for the caller to fill in the normal and penetration.
+ */
+static inline CollisionEvent *add_collision(
+    const Game *game, StepOutcome *outcome, CollisionKind kind, uint32_t ball, uint32_t other)
+{
+    assert(outcome->collision_count < GAME_MAX_COLLISIONS);
+
+    CollisionEvent *event = &outcome->collisions[outcome->collision_count++];
+    event->step = game->state.step;
+    event->kind = kind;
+    event->ball = ball;
+    event->other = other;
+    return event;
+}
+
+/**
+ * Helper function to destroy a brick, scoring it for the player who last hit the ball. A brick that grows back is
+ * queued to, unless the queue is full.
+ *
+ * @param game
+ *   Game the brick is in.
+ *
+ * @param index
+ *   Brick index, the brick must be alive.
+ */
+static inline void destroy_brick(Game *game, uint32_t index)
+{
+    GameState *state = &game->state;
+
+    game->brick_alive[index / 64u] &= ~((uint64_t)1u << (index % 64u));
+    state->brick_digest -= get_brick_digest(index);
+    --state->bricks_left;
+    ++state->scores[state->last_player];
+
+    if ((game->brick_regrow != NULL) && (((game->brick_regrow[index / 64u] >> (index % 64u)) & 1u) != 0u) &&
+        (state->regrow_count < GAME_MAX_REGROW))
+    {
+        const uint32_t slot = (state->regrow_first + state->regrow_count) % GAME_MAX_REGROW;
+        state->regrow[slot] = index;
+        state->regrow_at[slot] = state->step + game->regrow_delay;
+        ++state->regrow_count;
+    }
+}
+
+/**
+ * Helper function to queue a destroyed explosive brick to go off, unless the queue is full.
+ *
+ * @param state
+ *   State holding the queue.
+ *
+ * @param index
+ *   Brick index.
+ */
+static inline void queue_blast(GameState *state, uint32_t index)
+{
+    if (state->chain_count < GAME_MAX_CHAIN)
+    {
+        state->chain[(state->chain_first + state->chain_count) % GAME_MAX_CHAIN] = index;
+        ++state->chain_count;
+    }
+}
+
+/**
+ * Helper function to index every brick in the entity list.
+ *
+ * @param game
+ *   Game to index bricks for.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result index_bricks(Game *game)
+{
+    ListIter *iter = NULL;
+    if (create_iter(game->entities, &iter) != SUCCESS)
+    {
+        return FAILED;
+    }
+
+    size_t count = 0u;
+    while (!is_iter_end(iter))
+    {
+        ++count;
+        next_node(&iter);
+    }
+
+    game->brick_count = count;
+    game->bricks = (const Entity **)TRACKED_CALLOC((count == 0u) ? 1u : count, sizeof(Entity *));
+    game->brick_alive = (uint64_t *)TRACKED_CALLOC((count / 64u) + 1u, sizeof(uint64_t));
+    if ((game->bricks == NULL) || (game->brick_alive == NULL) ||
+        (create_brick_grid(&game->grid, game->width, game->height, GAME_CELL_SIZE, count) != SUCCESS))
+    {
+        destroy_iter(iter);
+        return FAILED;
+    }
+
+    reset_iter(game->entities, &iter);
+    for (size_t i = 0u; i < count; ++i)
+    {
+        Entity *brick = (Entity *)iter_value(iter);
+        game->bricks[i] = brick;
+        game->brick_alive[i / 64u] |= (uint64_t)1u << (i % 64u);
+        game->state.brick_digest += get_brick_digest(i);
+        add_brick_grid(game->grid, &brick->block);
+        next_node(&iter);
+    }
+
+    destroy_iter(iter);
+
+    game->state.bricks_left = (uint32_t)count;
+    return build_brick_grid(game->grid);
+}
+
+/**
+ * Helper function to move a ball and bounce it off the edges of the world.
+ *
+ * @param game
+ *   Game the ball is in.
+ *
+ * @param ball
+ *   Ball to move.
+ *
+ * @param ball_velocity
+ *   Velocity of the ball.
+ *
+ * @param ball_index
+ *   0 for the main ball, i + 1 for extra ball i.
+ *
+ * @param outcome
+ *   Outcome to record wall bounces in.
+ *
+ * @returns
+ *   Player whose goal the ball went into, or -1.
+ */
+static int32_t update_ball(Game *game, Entity *ball, Vector2D *ball_velocity, uint32_t ball_index, StepOutcome *outcome)
+{
+    TRACE_ZONE("update_ball");
+
+    // slowing the balls down only shortens each move, so lifting the effect leaves their velocities untouched
+    Vector2D move = *ball_velocity;
+    if (game->state.powerups.slow_timer != NO_TIMER)
+    {
+        move.x = scalar_div(move.x, SCALAR(2.0f));
+        move.y = scalar_div(move.y, SCALAR(2.0f));
+    }
+    add_vec(&ball->block.position, &move);
+
+    int32_t missed = -1;
+
+    // if ball does out of the screen then invert the y velocity
+    if ((ball->block.position.y < SCALAR(0.0f)) || (ball->block.position.y > game->height))
+    {
+        // going off the bottom means the paddle missed it, as does going off the top in versus
+        if ((ball->block.position.y > game->height) && (ball_velocity->y > SCALAR(0.0f)))
+        {
+            missed = 0;
+        }
+        else if ((game->players > 1u) && (ball->block.position.y < SCALAR(0.0f)) && (ball_velocity->y < SCALAR(0.0f)))
+        {
+            missed = 1;
+        }
+
+        ball_velocity->y = -ball_velocity->y;
+
+        const bool top = ball->block.position.y < SCALAR(0.0f);
+        CollisionEvent *event = add_collision(game, outcome, COLLISION_WALL, ball_index, 0u);
+        event->normal = (Vector2D){.x = SCALAR(0.0f), .y = top ? SCALAR(1.0f) : SCALAR(-1.0f)};
+        event->penetration = top ? -ball->block.position.y : (ball->block.position.y - game->height);
+    }
+
+    if ((ball->block.position.x < SCALAR(0.0f)) || (ball->block.position.x > game->width))
+    {
+        ball_velocity->x = -ball_velocity->x;
+
+        const bool left = ball->block.position.x < SCALAR(0.0f);
+        CollisionEvent *event = add_collision(game, outcome, COLLISION_WALL, ball_index, 0u);
+        event->normal = (Vector2D){.x = left ? SCALAR(1.0f) : SCALAR(-1.0f), .y = SCALAR(0.0f)};
+        event->penetration = left ? -ball->block.position.x : (ball->block.position.x - game->width);
+    }
+
+    return missed;
+}
+
+/**
+ * Helper function to check if two entities are colliding.
+ *
+ * @param a
+ *   First entity to check.
+ *
+ * @param b
+ *   Second entity to check.
+ *
+ * @returns
+ *   TCollosionResult : (overlap : true if collosion detedted)
+ */
+static CollosionResult check_collision(const Entity *a, const Entity *b)
+{
+    bool overlap = false;
+    Scalar shift_b_x = SCALAR(0.0f);
+    Scalar shift_b_y = SCALAR(0.0f);
+
+    // b is the one that has to be displaced, and the a should remain in place.
+    if (!((a->block.position.x + a->block.width < b->block.position.x) || (b->block.position.x + b->block.width < a->block.position.x) || (a->block.position.y + a->block.height < b->block.position.y) || (b->block.position.y + b->block.height < a->block.position.y)))
+    {
+        overlap = true;
+        if ((a->block.position.x + a->block.width / 2) < (b->block.position.x + b->block.width / 2))
+        {
+            // b to the right from the center of a; shift b to the right
+            shift_b_x = (a->block.position.x + a->block.width) - b->block.position.x;
+        }
+        else
+        {
+            // b to the left from a; shift to the left
+            shift_b_x = a->block.position.x - (b->block.position.x + b->block.width);
+        }
+        if ((a->block.position.y + a->block.height / 2) < (b->block.position.y + b->block.height / 2))
+        {
+            // same for y axis
+            shift_b_y = (a->block.position.y + a->block.height) - b->block.position.y;
+        }
+        else
+        {
+            // same for y axis
+            shift_b_y = a->block.position.y - (b->block.position.y + b->block.height);
+        }
+    }
+    CollosionResult result = {overlap, shift_b_x, shift_b_y};
+    return result;
+}
+
+/**
+ * Helper function to rebound the ball off an entity it collided with.
+ *
+ * @param ball
+ *   Ball entity.
+ *
+ * @param result
+ *   Result of the collision check.
+ *
+ * @param ball_velocity
+ *   The velocity of the ball.
+ *
+ * @param event
+ *   Collision to fill in the normal and penetration of.
+ */
+static void ball_rebound(Entity *ball, CollosionResult *result, Vector2D *ball_velocity, CollisionEvent *event)
+{
+    // resolve along the axis with the smallest penetration, compared as Scalars so no precision is lost
+    if (scalar_abs(result->shift_b_x) <= scalar_abs(result->shift_b_y))
+    {
+        result->shift_b_y = SCALAR(0.0f);
+    }
+    else
+    {
+        result->shift_b_x = SCALAR(0.0f);
+    }
+    ball->block.position.x += result->shift_b_x;
+    ball->block.position.y += result->shift_b_y;
+
+    // the ball is pushed out along the normal, by as far as it had gone in
+    event->normal = (Vector2D){.x = SCALAR(0.0f), .y = SCALAR(0.0f)};
+    event->penetration = scalar_abs(result->shift_b_x) + scalar_abs(result->shift_b_y);
+
+    if (result->shift_b_x != SCALAR(0.0f))
+    {
+        ball_velocity->x = -ball_velocity->x;
+        event->normal.x = (result->shift_b_x > SCALAR(0.0f)) ? SCALAR(1.0f) : SCALAR(-1.0f);
+    }
+    if (result->shift_b_y != SCALAR(0.0f))
+    {
+        ball_velocity->y = -ball_velocity->y;
+        event->normal.y = (result->shift_b_y > SCALAR(0.0f)) ? SCALAR(1.0f) : SCALAR(-1.0f);
+    }
+}
+
+/**
+ * Helper function to get the next pseudo random number for choosing drops.
+ *
+ * @param powerups
+ *   Power-up state owning the random state.
+ *
+ * @returns
+ *   Random number.
+ */
+static uint32_t next_random(PowerupState *powerups)
+{
+    // xorshift32
+    uint32_t x = powerups->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    powerups->seed = x;
+
+    return x;
+}
+
+/**
+ * Helper function to maybe drop a power-up from a destroyed brick. Drops come from a fixed pool in the game state, the
+ * lowest free one is used so the same steps always use the same drops.
+ *
+ * @param game
+ *   Game the brick was in.
+ *
+ * @param brick
+ *   Brick destroyed.
+ */
+static void spawn_drop(Game *game, const Entity *brick)
+{
+    PowerupState *powerups = &game->state.powerups;
+
+    const uint32_t random = next_random(powerups);
+    if (((random % DROP_CHANCE) != 0u) || (powerups->drops_used == ((1u << GAME_MAX_DROPS) - 1u)))
+    {
+        return;
+    }
+
+    const uint32_t index = (uint32_t)__builtin_ctz(~powerups->drops_used);
+    powerups->drops_used |= 1u << index;
+    powerups->drops[index] = (Drop){
+        .block = create_block_xy(
+            brick->block.position.x + ((brick->block.width - DROP_WIDTH) / 2),
+            brick->block.position.y + ((brick->block.height - DROP_HEIGHT) / 2),
+            DROP_WIDTH,
+            DROP_HEIGHT),
+        .kind = (random >> 8u) % POWERUP_KINDS,
+        .player = game->state.last_player};
+}
+
+/**
+ * Helper function to handle collisions between a ball and other entities.
+ *
+ * @param game
+ *   Game to handle collisions in.
+ *
+ * @param ball
+ *   Ball to check.
+ *
+ * @param ball_velocity
+ *   Velocity of the ball.
+ *
+ * @param ball_index
+ *   0 for the main ball, the only one a sticky paddle catches, i + 1 for extra ball i.
+ *
+ * @param outcome
+ *   Outcome to record hits in.
+ */
+static void handle_collisions(
+    Game *game, Entity *ball, Vector2D *ball_velocity, uint32_t ball_index, StepOutcome *outcome)
+{
+    TRACE_ZONE("handle_collisions");
+
+    PowerupState *powerups = &game->state.powerups;
+
+    // only look at bricks near the ball, taking the first in level order so results match a full scan
+    GridRange range;
+    get_brick_range(game, &ball->block, &range);
+
+    uint32_t hit = UINT32_MAX;
+    CollosionResult hit_result = {0};
+
+    for (int32_t row = range.first_row; row <= range.last_row; ++row)
+    {
+        for (int32_t column = range.first_column; column <= range.last_column; ++column)
+        {
+            size_t count = 0u;
+            const uint32_t *indices = get_cell_bricks(game, column, row, &count);
+
+            for (size_t i = 0u; i < count; ++i)
+            {
+                const uint32_t index = indices[i];
+                if ((index >= hit) || !is_brick_alive(game, index))
+                {
+                    continue;
+                }
+
+                CollosionResult result = check_collision(get_brick(game, index), ball);
+                if (result.overlap)
+                {
+                    hit = index;
+                    hit_result = result;
+                }
+            }
+        }
+    }
+
+    if (hit != UINT32_MAX)
+    {
+        destroy_brick(game, hit);
+        ball_rebound(ball, &hit_result, ball_velocity, add_collision(game, outcome, COLLISION_BRICK, ball_index, hit));
+        spawn_drop(game, get_brick(game, hit));
+
+        if (is_brick_explosive(game, hit))
+        {
+            queue_blast(&game->state, hit);
+        }
+    }
+
+    // handle ball - paddle collisions
+    for (uint32_t player = 0u; player < game->players; ++player)
+    {
+        const Entity *paddle = &game->state.paddles[player];
+        CollosionResult result = check_collision(paddle, ball);
+        if (result.overlap)
+        {
+            CollisionEvent *event = add_collision(game, outcome, COLLISION_PADDLE, ball_index, player);
+            ball_rebound(ball, &result, ball_velocity, event);
+            game->state.last_player = player;
+
+            // a sticky paddle holds the ball where it landed for a moment
+            if ((ball_index == 0u) && (powerups->sticky_timers[player] != NO_TIMER) && (powerups->stuck_player == 0u) &&
+                (schedule_timer(&powerups->timers, STICKY_HOLD_STEPS, RELEASE_TIMER, player, &powerups->release_timer) ==
+                 SUCCESS))
+            {
+                powerups->stuck_player = player + 1u;
+                powerups->stuck_offset = ball->block.position.x - paddle->block.position.x;
+            }
+        }
+    }
+}
+
+/**
+ * Helper function to start an effect, or restart it if it is already running.
+ *
+ * @param powerups
+ *   Power-up state owning the timer.
+ *
+ * @param timer
+ *   Timer ending the effect, NO_TIMER if it isn't running.
+ *
+ * @param steps
+ *   How long the effect lasts.
+ *
+ * @param kind
+ *   Timer kind.
+ *
+ * @param player
+ *   Player the effect applies to.
+ *
+ * @returns
+ *   True if the effect was already running.
+ */
+static bool restart_effect(PowerupState *powerups, uint32_t *timer, uint64_t steps, TimerKind kind, uint32_t player)
+{
+    const bool running = (cancel_timer(&powerups->timers, *timer) == SUCCESS);
+
+    // the wheel has room for every effect at once, so this only fails on a broken state
+    const Result scheduled = schedule_timer(&powerups->timers, steps, kind, player, timer);
+    assert(scheduled == SUCCESS);
+    (void)scheduled;
+
+    return running;
+}
+
+/**
+ * Helper function to give a player a power-up they caught.
+ *
+ * @param game
+ *   Game being played.
+ *
+ * @param kind
+ *   Power-up caught.
+ *
+ * @param player
+ *   Player who caught it.
+ */
+static void apply_powerup(Game *game, PowerupKind kind, uint32_t player)
+{
+    PowerupState *powerups = &game->state.powerups;
+
+    switch (kind)
+    {
+    case POWERUP_WIDE:
+        if (!restart_effect(powerups, &powerups->wide_timers[player], WIDE_STEPS, WIDE_END_TIMER, player))
+        {
+            // grow about the middle
+            Block *paddle = &game->state.paddles[player].block;
+            paddle->position.x -= (WIDE_PADDLE_WIDTH - PADDLE_WIDTH) / 2;
+            paddle->width = WIDE_PADDLE_WIDTH;
+        }
+        break;
+    case POWERUP_SLOW:
+        restart_effect(powerups, &powerups->slow_timer, SLOW_STEPS, SLOW_END_TIMER, player);
+        break;
+    case POWERUP_STICKY:
+        restart_effect(powerups, &powerups->sticky_timers[player], STICKY_STEPS, STICKY_END_TIMER, player);
+        break;
+    case POWERUP_MULTI:
+        if (powerups->multi_cooldown == NO_TIMER)
+        {
+            // new balls split off the main ball, one mirrored sideways and one vertically
+            const Entity *ball = &game->state.ball;
+            const Vector2D *velocity = &game->state.ball_velocity;
+            const Vector2D velocities[GAME_MAX_BALLS - 1u] = {
+                create_vec_xy(-velocity->x, velocity->y), create_vec_xy(velocity->x, -velocity->y)};
+
+            for (uint32_t i = 0u; i < (GAME_MAX_BALLS - 1u); ++i)
+            {
+                if (((powerups->extras_used >> i) & 1u) == 0u)
+                {
+                    powerups->extra_balls[i] = *ball;
+                    powerups->extra_velocities[i] = velocities[i];
+                    powerups->extras_used |= 1u << i;
+                }
+            }
+
+            restart_effect(powerups, &powerups->multi_cooldown, MULTI_COOLDOWN_STEPS, MULTI_READY_TIMER, player);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Helper function to end an effect when its timer fires, a TimerCallback.
+ *
+ * @param context
+ *   Game the timer belongs to.
+ *
+ * @param kind
+ *   Timer kind.
+ *
+ * @param player
+ *   Player the effect applied to.
+ */
+static void end_effect(void *context, uint32_t kind, uint32_t player)
+{
+    Game *game = (Game *)context;
+    PowerupState *powerups = &game->state.powerups;
+
+    switch ((TimerKind)kind)
+    {
+    case WIDE_END_TIMER:
+    {
+        Block *paddle = &game->state.paddles[player].block;
+        paddle->position.x += (WIDE_PADDLE_WIDTH - PADDLE_WIDTH) / 2;
+        paddle->width = PADDLE_WIDTH;
+        powerups->wide_timers[player] = NO_TIMER;
+        break;
+    }
+    case SLOW_END_TIMER:
+        powerups->slow_timer = NO_TIMER;
+        break;
+    case STICKY_END_TIMER:
+        powerups->sticky_timers[player] = NO_TIMER;
+        break;
+    case MULTI_READY_TIMER:
+        powerups->multi_cooldown = NO_TIMER;
+        break;
+    case RELEASE_TIMER:
+        powerups->stuck_player = 0u;
+        powerups->release_timer = NO_TIMER;
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Helper function to move the falling power-ups, giving them to the paddle that catches them.
+ *
+ * @param game
+ *   Game being played.
+ *
+ * @param outcome
+ *   Outcome to record catches in.
+ */
+static void update_drops(Game *game, StepOutcome *outcome)
+{
+    PowerupState *powerups = &game->state.powerups;
+
+    for (uint32_t i = 0u; i < GAME_MAX_DROPS; ++i)
+    {
+        if (((powerups->drops_used >> i) & 1u) == 0u)
+        {
+            continue;
+        }
+
+        Drop *drop = &powerups->drops[i];
+        drop->block.position.y += (drop->player == 0u) ? DROP_SPEED : -DROP_SPEED;
+
+        const Entity falling = {.block = drop->block};
+        if (check_collision(&game->state.paddles[drop->player], &falling).overlap)
+        {
+            apply_powerup(game, (PowerupKind)drop->kind, drop->player);
+            outcome->powerup = (int32_t)drop->kind;
+            powerups->drops_used &= ~(1u << i);
+        }
+        else if ((drop->block.position.y > game->height) || ((drop->block.position.y + drop->block.height) < 0))
+        {
+            powerups->drops_used &= ~(1u << i);
+        }
+    }
+}
+
+/**
+ * Helper function to check if two blocks overlap.
+ *
+ * @param a
+ *   First block.
+ *
+ * @param b
+ *   Second block.
+ *
+ * @returns
+ *   True if the blocks share some area, otherwise false.
+ */
+static inline bool blocks_overlap(const Block *a, const Block *b)
+{
+    return (a->position.x < (b->position.x + b->width)) && (b->position.x < (a->position.x + a->width)) &&
+           (a->position.y < (b->position.y + b->height)) && (b->position.y < (a->position.y + a->height));
+}
+
+/**
+ * Helper function to set off queued explosive bricks, oldest first. Each blast only looks at the grid cells around
+ * its brick, and a step destroys at most GAME_MAX_BLASTED bricks. A blast cut short stays at the front of the queue
+ * and finishes next step, so however many bricks a chain reaction reaches it costs about the same every step.
+ *
+ * @param game
+ *   Game to update.
+ *
+ * @param outcome
+ *   Outcome to record destroyed bricks in.
+ */
+static void update_chain(Game *game, StepOutcome *outcome)
+{
+    TRACE_ZONE("update_chain");
+
+    GameState *state = &game->state;
+
+    while (state->chain_count > 0u)
+    {
+        const Block *source = &get_brick(game, state->chain[state->chain_first])->block;
+        const Block blast = create_block_xy(
+            source->position.x - BLAST_REACH,
+            source->position.y - BLAST_REACH,
+            source->width + (2 * BLAST_REACH),
+            source->height + (2 * BLAST_REACH));
+
+        GridRange range;
+        get_brick_range(game, &blast, &range);
+
+        for (int32_t row = range.first_row; row <= range.last_row; ++row)
+        {
+            for (int32_t column = range.first_column; column <= range.last_column; ++column)
+            {
+                size_t count = 0u;
+                const uint32_t *indices = get_cell_bricks(game, column, row, &count);
+
+                for (size_t i = 0u; i < count; ++i)
+                {
+                    const uint32_t index = indices[i];
+                    if (!is_brick_alive(game, index) || !blocks_overlap(&blast, &get_brick(game, index)->block))
+                    {
+                        continue;
+                    }
+
+                    if (outcome->blasted_count == GAME_MAX_BLASTED)
+                    {
+                        return;
+                    }
+
+                    destroy_brick(game, index);
+                    outcome->blasted[outcome->blasted_count++] = index;
+
+                    if (is_brick_explosive(game, index))
+                    {
+                        queue_blast(state, index);
+                    }
+                }
+            }
+        }
+
+        state->chain_first = (state->chain_first + 1u) % GAME_MAX_CHAIN;
+        --state->chain_count;
+    }
+}
+
+/**
+ * Helper function to bring back destroyed bricks whose time has come, oldest first and at most GAME_MAX_REGROWN a
+ * step. A brick that would grow back on top of a ball waits for it to move away, holding up the ones behind it.
+ *
+ * @param game
+ *   Game to update.
+ *
+ * @param outcome
+ *   Outcome to record bricks growing back in.
+ */
+static void regrow_bricks(Game *game, StepOutcome *outcome)
+{
+    GameState *state = &game->state;
+    const PowerupState *powerups = &state->powerups;
+
+    while ((state->regrow_count > 0u) && (outcome->regrown_count < GAME_MAX_REGROWN) &&
+           (state->regrow_at[state->regrow_first] <= state->step))
+    {
+        const uint32_t index = state->regrow[state->regrow_first];
+        const Block *brick = &get_brick(game, index)->block;
+
+        bool blocked = blocks_overlap(brick, &state->ball.block);
+        for (uint32_t i = 0u; i < (GAME_MAX_BALLS - 1u); ++i)
+        {
+            blocked = blocked || ((((powerups->extras_used >> i) & 1u) != 0u) &&
+                                  blocks_overlap(brick, &powerups->extra_balls[i].block));
+        }
+
+        if (blocked)
+        {
+            return;
+        }
+
+        game->brick_alive[index / 64u] |= (uint64_t)1u << (index % 64u);
+        state->brick_digest += get_brick_digest(index);
+        ++state->bricks_left;
+        outcome->regrown[outcome->regrown_count++] = index;
+
+        state->regrow_first = (state->regrow_first + 1u) % GAME_MAX_REGROW;
+        --state->regrow_count;
+    }
+}
+
+/**
+ * Helper function to slide the moving bricks to where they are this step. A brick only touches the grid when it
+ * crosses into another cell, so the cost follows the number of moving bricks rather than the size of the level.
+ *
+ * @param game
+ *   Game to update.
+ */
+static void move_bricks(Game *game)
+{
+    TRACE_ZONE("move_bricks");
+
+    size_t slot = 0u;
+    for (size_t run = 0u; run < game->motion_count; ++run)
+    {
+        const BrickMotion *motion = &game->motions[run];
+
+        // out to the full reach halfway through the period and back, the same offset for the whole run
+        const uint32_t half = motion->period / 2u;
+        const uint32_t phase = (uint32_t)(game->state.step % motion->period);
+        const uint32_t along = (phase <= half) ? phase : (motion->period - phase);
+        const Scalar fraction = scalar_div(scalar_from_int((int32_t)along), scalar_from_int((int32_t)half));
+        const Vector2D offset =
+            create_vec_xy(scalar_mul(motion->reach.x, fraction), scalar_mul(motion->reach.y, fraction));
+
+        for (uint32_t i = 0u; i < motion->brick_count; ++i, ++slot)
+        {
+            Block *block = &game->moved[slot].block;
+            block->position.x = game->moved_from[slot].x + offset.x;
+            block->position.y = game->moved_from[slot].y + offset.y;
+
+            if (move_brick_grid(game->grid, motion->first_brick + i, block))
+            {
+                ++game->moved_cells;
+            }
+        }
+    }
+}
+
+/**
+ * Helper function to get the number of columns and rows in the brick field of a large level.
+ *
+ * @param size
+ *   Width and height of the world.
+ *
+ * @param columns
+ *   Out parameter for the number of columns.
+ *
+ * @param rows
+ *   Out parameter for the number of rows.
+ */
+static void get_field_size(Scalar size, int32_t *columns, int32_t *rows)
+{
+    // bricks cover the top four fifths of the world, leaving room to play underneath
+    const Scalar field_height = scalar_div(scalar_mul(size, SCALAR(4.0f)), SCALAR(5.0f)) - FIELD_MARGIN_Y;
+    *columns = scalar_to_int(scalar_div(size - (2 * FIELD_MARGIN_X), FIELD_PITCH_X));
+    *rows = scalar_to_int(scalar_div(field_height, FIELD_PITCH_Y));
+}
+
+/**
+ * Helper function to make one brick of the brick field of a large level.
+ *
+ * @param column
+ *   Column of the brick.
+ *
+ * @param row
+ *   Row of the brick.
+ *
+ * @returns
+ *   The brick.
+ */
+static Entity make_field_brick(int32_t column, int32_t row)
+{
+    static const uint8_t colours[3][3] = {{0xff, 0x00, 0x00}, {0xff, 0xa5, 0x00}, {0x00, 0xff, 0x00}};
+
+    const uint8_t *colour = colours[(row / 2) % 3];
+
+    return (Entity){
+        .block = create_block_xy(
+            FIELD_MARGIN_X + scalar_mul(scalar_from_int(column), FIELD_PITCH_X),
+            FIELD_MARGIN_Y + scalar_mul(scalar_from_int(row), FIELD_PITCH_Y),
+            SCALAR(40.0f),
+            SCALAR(20.0f)),
+        .r = colour[0],
+        .g = colour[1],
+        .b = colour[2]};
+}
+
+/**
+ * Helper function to check if a brick of the brick field of a large level is explosive.
+ *
+ * @param column
+ *   Column of the brick.
+ *
+ * @param row
+ *   Row of the brick.
+ *
+ * @returns
+ *   True if the brick is in an explosive patch, otherwise false.
+ */
+static bool is_field_explosive(int32_t column, int32_t row)
+{
+    const uint64_t patch = ((uint64_t)(uint32_t)(row / EXPLOSIVE_PATCH) << 32u) | (uint32_t)(column / EXPLOSIVE_PATCH);
+    return (mix_digest(patch ^ EXPLOSIVE_SEED) % EXPLOSIVE_CHANCE) == 0u;
+}
+
+/**
+ * Helper function to get the first line of a brick field at or after a position.
+ *
+ * @param position
+ *   Position to start from.
+ *
+ * @param margin
+ *   Position of the first line.
+ *
+ * @param pitch
+ *   Distance between lines.
+ *
+ * @returns
+ *   Index of the line, may be past the end of the field.
+ */
+static int32_t get_field_line(Scalar position, Scalar margin, Scalar pitch)
+{
+    if (position <= margin)
+    {
+        return 0;
+    }
+
+    const int32_t line = scalar_to_int(scalar_div(position - margin, pitch));
+    return ((margin + scalar_mul(scalar_from_int(line), pitch)) < position) ? (line + 1) : line;
+}
+
+/**
+ * Helper function to fill the top of the world with evenly spaced bricks, used for levels larger than the screen.
+ *
+ * @param game
+ *   Game to fill, the world size must already be set.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result create_brick_field(Game *game)
+{
+    static const uint8_t explosive_colour[3] = {0xff, 0x40, 0xff};
+
+    int32_t columns = 0;
+    int32_t rows = 0;
+    get_field_size(game->width, &columns, &rows);
+
+    // bricks are indexed in the order they are pushed
+    const size_t count = (size_t)columns * (size_t)rows;
+    game->brick_explosive = (uint64_t *)TRACKED_CALLOC((count / 64u) + 1u, sizeof(uint64_t));
+    if (game->brick_explosive == NULL)
+    {
+        return FAILED;
+    }
+
+    size_t index = 0u;
+    for (int32_t row = 0; row < rows; ++row)
+    {
+        for (int32_t column = 0; column < columns; ++column, ++index)
+        {
+            Entity *e = (Entity *)TRACKED_CALLOC(sizeof(Entity), 1u);
+            if (e == NULL)
+            {
+                return FAILED;
+            }
+
+            *e = make_field_brick(column, row);
+            if (is_field_explosive(column, row))
+            {
+                game->brick_explosive[index / 64u] |= (uint64_t)1u << (index % 64u);
+                e->r = explosive_colour[0];
+                e->g = explosive_colour[1];
+                e->b = explosive_colour[2];
+            }
+
+            if (_push(game->entities, e, &free_tracked) != SUCCESS)
+            {
+                free_tracked(e);
+                return FAILED;
+            }
+        }
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * Helper function to get the grid cell a point of a streamed level is in, matching the brick grid.
+ *
+ * @param game
+ *   Streamed game.
+ *
+ * @param x
+ *   X coordinate.
+ *
+ * @param y
+ *   Y coordinate.
+ *
+ * @param column
+ *   Out parameter for the cell column.
+ *
+ * @param row
+ *   Out parameter for the cell row.
+ */
+static void get_chunk_cell(const Game *game, Scalar x, Scalar y, int32_t *column, int32_t *row)
+{
+    *column = (x < SCALAR(0.0f)) ? 0 : (int32_t)(x / GAME_CELL_SIZE);
+    *row = (y < SCALAR(0.0f)) ? 0 : (int32_t)(y / GAME_CELL_SIZE);
+    *column = (*column >= game->cell_columns) ? (game->cell_columns - 1) : *column;
+    *row = (*row >= game->cell_rows) ? (game->cell_rows - 1) : *row;
+}
+
+/**
+ * Helper function to allocate a game with an empty world and the paddle and ball in their starting positions.
+ *
+ * @param game
+ *   Created game.
+ *
+ * @param width
+ *   Width of the world.
+ *
+ * @param height
+ *   Height of the world.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result create_empty_game(Game **game, Scalar width, Scalar height)
+{
+    Result res = SUCCESS;
+
+    Game *n_game = (Game *)TRACKED_CALLOC(1u, sizeof(Game));
+    if (n_game == NULL)
+    {
+        res = FAILED;
+        return res;
+    }
+
+    n_game->width = width;
+    n_game->height = height;
+    n_game->players = 1u;
+
+    n_game->state.paddles[0] = (Entity){
+        .block = create_block_xy(SCALAR(100.0f), height - SCALAR(20.0f), PADDLE_WIDTH, SCALAR(20.0f)),
+        .r = 0xff,
+        .g = 0xff,
+        .b = 0xff};
+    n_game->state.paddles[1] = (Entity){
+        .block = create_block_xy(width - SCALAR(200.0f), SCALAR(0.0f), PADDLE_WIDTH, SCALAR(20.0f)),
+        .r = 0x40,
+        .g = 0xc0,
+        .b = 0xff};
+    n_game->state.ball = (Entity){
+        .block = create_block_xy((width / 2) + SCALAR(20.0f), height / 2, SCALAR(10.0f), SCALAR(10.0f)),
+        .r = 0xff,
+        .g = 0xff,
+        .b = 0xff};
+    n_game->state.paddle_velocities[0] = create_vec();
+    n_game->state.paddle_velocities[1] = create_vec();
+    n_game->state.ball_velocity = create_vec_xy(SCALAR(0.2f), SCALAR(0.2f));
+    n_game->state.lives[0] = START_LIVES;
+    n_game->state.lives[1] = START_LIVES;
+    n_game->state.powerups.seed = 0x2545f491u;
+    init_timer_wheel(&n_game->state.powerups.timers, 0u);
+
+    if (create_list(&n_game->entities) != SUCCESS)
+    {
+        res = FAILED;
+        destroy_game(n_game);
+        return res;
+    }
+
+    // assign the game to the user supplied pointer
+    *game = n_game;
+    return res;
+}
+
+Result create_baked_game(Game **game, const char *name)
+{
+    Result res = SUCCESS;
+
+    const BakedLevel *level = NULL;
+    for (size_t i = 0u; (i < baked_level_count) && (level == NULL); ++i)
+    {
+        level = (strcmp(baked_levels[i]->name, name) == 0) ? baked_levels[i] : NULL;
+    }
+
+    Game *n_game = NULL;
+    if ((level == NULL) || (create_empty_game(&n_game, level->width, level->height) != SUCCESS))
+    {
+        res = FAILED;
+        return res;
+    }
+
+    const size_t count = level->brick_count;
+    n_game->brick_count = count;
+    n_game->bricks = (const Entity **)TRACKED_CALLOC((count == 0u) ? 1u : count, sizeof(Entity *));
+    n_game->brick_alive = (uint64_t *)TRACKED_CALLOC((count / 64u) + 1u, sizeof(uint64_t));
+    if ((n_game->bricks == NULL) || (n_game->brick_alive == NULL) ||
+        (create_baked_brick_grid(
+             &n_game->grid,
+             level->width,
+             level->height,
+             GAME_CELL_SIZE,
+             level->cell_start,
+             level->cell_count,
+             level->cell_bricks,
+             count) != SUCCESS))
+    {
+        res = FAILED;
+        destroy_game(n_game);
+        return res;
+    }
+
+    for (size_t i = 0u; i < count; ++i)
+    {
+        n_game->bricks[i] = &level->bricks[i];
+        n_game->brick_alive[i / 64u] |= (uint64_t)1u << (i % 64u);
+        n_game->state.brick_digest += get_brick_digest(i);
+    }
+    n_game->state.bricks_left = (uint32_t)count;
+
+    if (level->brick_regrow != NULL)
+    {
+        n_game->brick_regrow = (uint64_t *)TRACKED_CALLOC((count / 64u) + 1u, sizeof(uint64_t));
+        if (n_game->brick_regrow == NULL)
+        {
+            res = FAILED;
+            destroy_game(n_game);
+            return res;
+        }
+
+        memcpy(n_game->brick_regrow, level->brick_regrow, ((count / 64u) + 1u) * sizeof(uint64_t));
+        n_game->regrow_delay = level->regrow_delay;
+    }
+
+    // only the moving bricks are copied, everything else stays in the program's read only data
+    if ((level->motion_count > 0u) && (set_brick_motion(n_game, level->motions, level->motion_count) != SUCCESS))
+    {
+        res = FAILED;
+        destroy_game(n_game);
+        return res;
+    }
+
+    // assign the game to the user supplied pointer
+    *game = n_game;
+    return res;
+}
+
+Result create_game(Game **game)
+{
+    assert(game != NULL);
+
+    Result res = SUCCESS;
+
+    Game *n_game = NULL;
+    if (create_baked_game(&n_game, "default") != SUCCESS)
+    {
+        res = FAILED;
+        return res;
+    }
+
+    // assign the game to the user supplied pointer
+    *game = n_game;
+    return res;
+}
+
+Result create_large_game(Game **game, Scalar size)
+{
+    assert(game != NULL);
+    assert(size >= SCALAR(800.0f));
+
+    Result res = SUCCESS;
+
+    Game *n_game = NULL;
+    if (create_empty_game(&n_game, size, size) != SUCCESS)
+    {
+        res = FAILED;
+        return res;
+    }
+
+    // start the ball in the open space below the bricks
+    n_game->state.ball.block.position.y = scalar_div(scalar_mul(size, SCALAR(9.0f)), SCALAR(10.0f));
+
+    if ((create_brick_field(n_game) != SUCCESS) || (index_bricks(n_game) != SUCCESS))
+    {
+        res = FAILED;
+        destroy_game(n_game);
+        return res;
+    }
+
+    // assign the game to the user supplied pointer
+    *game = n_game;
+    return res;
+}
+
+Result create_streamed_game(Game **game, Scalar size, const uint32_t *chunk_bricks)
+{
+    assert(game != NULL);
+    assert(size >= SCALAR(800.0f));
+    assert(chunk_bricks != NULL);
+
+    Result res = SUCCESS;
+
+    Game *n_game = NULL;
+    if (create_empty_game(&n_game, size, size) != SUCCESS)
+    {
+        res = FAILED;
+        return res;
+    }
+
+    // start the ball in the open space below the bricks
+    n_game->state.ball.block.position.y = scalar_div(scalar_mul(size, SCALAR(9.0f)), SCALAR(10.0f));
+
+    int32_t chunk_rows = 0;
+    get_chunk_layout(size, &n_game->chunk_columns, &chunk_rows);
+    n_game->chunk_count = (size_t)n_game->chunk_columns * (size_t)chunk_rows;
+    n_game->cell_columns = (int32_t)(size / GAME_CELL_SIZE) + 1;
+    n_game->cell_rows = n_game->cell_columns;
+
+    n_game->chunks = (const BrickChunk **)TRACKED_CALLOC(n_game->chunk_count, sizeof(BrickChunk *));
+    n_game->chunk_firsts = (uint32_t *)TRACKED_CALLOC(n_game->chunk_count + 1u, sizeof(uint32_t));
+    if ((n_game->chunks == NULL) || (n_game->chunk_firsts == NULL))
+    {
+        res = FAILED;
+        destroy_game(n_game);
+        return res;
+    }
+
+    size_t count = 0u;
+    for (size_t i = 0u; i < n_game->chunk_count; ++i)
+    {
+        n_game->chunk_firsts[i] = (uint32_t)count;
+        count += chunk_bricks[i];
+        if (count > UINT32_MAX)
+        {
+            res = FAILED;
+            destroy_game(n_game);
+            return res;
+        }
+    }
+    n_game->chunk_firsts[n_game->chunk_count] = (uint32_t)count;
+
+    // only the alive bits are kept for every brick, a bit each
+    n_game->brick_count = count;
+    n_game->brick_alive = (uint64_t *)TRACKED_CALLOC((count / 64u) + 1u, sizeof(uint64_t));
+    if (n_game->brick_alive == NULL)
+    {
+        res = FAILED;
+        destroy_game(n_game);
+        return res;
+    }
+
+    for (size_t i = 0u; i < count; ++i)
+    {
+        n_game->brick_alive[i / 64u] |= (uint64_t)1u << (i % 64u);
+        n_game->state.brick_digest += get_brick_digest(i);
+    }
+    n_game->state.bricks_left = (uint32_t)count;
+
+    // assign the game to the user supplied pointer
+    *game = n_game;
+    return res;
+}
+
+void get_chunk_layout(Scalar size, int32_t *columns, int32_t *rows)
+{
+    assert(columns != NULL);
+    assert(rows != NULL);
+
+    const int32_t cells = (int32_t)(size / GAME_CELL_SIZE) + 1;
+    *columns = (cells + GAME_CHUNK_CELLS - 1) / GAME_CHUNK_CELLS;
+    *rows = *columns;
+}
+
+size_t get_field_bricks(Scalar size, const Block *area, Entity *bricks, size_t capacity)
+{
+    assert(area != NULL);
+    assert((bricks != NULL) || (capacity == 0u));
+
+    int32_t columns = 0;
+    int32_t rows = 0;
+    get_field_size(size, &columns, &rows);
+
+    // the lines of bricks starting inside the area, clipped to the field
+    const int32_t first_column = get_field_line(area->position.x, FIELD_MARGIN_X, FIELD_PITCH_X);
+    const int32_t end_column = get_field_line(area->position.x + area->width, FIELD_MARGIN_X, FIELD_PITCH_X);
+    const int32_t first_row = get_field_line(area->position.y, FIELD_MARGIN_Y, FIELD_PITCH_Y);
+    const int32_t end_row = get_field_line(area->position.y + area->height, FIELD_MARGIN_Y, FIELD_PITCH_Y);
+
+    size_t count = 0u;
+    for (int32_t row = first_row; (row < end_row) && (row < rows); ++row)
+    {
+        for (int32_t column = first_column; (column < end_column) && (column < columns); ++column)
+        {
+            if (count < capacity)
+            {
+                bricks[count] = make_field_brick(column, row);
+            }
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+Result create_versus_game(Game **game)
+{
+    assert(game != NULL);
+
+    Result res = SUCCESS;
+
+    // bricks mirrored about the middle of the screen, each player faces the same colours in the same order
+    Game *n_game = NULL;
+    if (create_baked_game(&n_game, "versus") != SUCCESS)
+    {
+        res = FAILED;
+        return res;
+    }
+
+    n_game->players = 2u;
+
+    // serve towards player 0 from below the bricks, with both paddles starting in the middle
+    n_game->state.ball.block.position.y = SCALAR(560.0f);
+    n_game->state.paddles[0].block.position.x = SCALAR(350.0f);
+    n_game->state.paddles[1].block.position.x = SCALAR(350.0f);
+
+    // assign the game to the user supplied pointer
+    *game = n_game;
+    return res;
+}
+
+void seed_game(Game *game, uint32_t seed)
+{
+    assert(game != NULL);
+    assert(seed != 0u);
+
+    game->state.powerups.seed = seed;
+}
+
+Result set_brick_motion(Game *game, const BrickMotion *motions, size_t count)
+{
+    assert(game != NULL);
+    assert(game->chunks == NULL);
+    assert(game->motions == NULL);
+    assert((motions != NULL) || (count == 0u));
+
+    Result res = SUCCESS;
+
+    size_t moving = 0u;
+    for (size_t i = 0u; i < count; ++i)
+    {
+        assert(motions[i].period >= 2u);
+        assert(((size_t)motions[i].first_brick + motions[i].brick_count) <= game->brick_count);
+        assert((i == 0u) || (motions[i].first_brick >= (motions[i - 1u].first_brick + motions[i - 1u].brick_count)));
+        moving += motions[i].brick_count;
+    }
+
+    BrickGrid *grid = NULL;
+    BrickMotion *n_motions = (BrickMotion *)TRACKED_CALLOC((count == 0u) ? 1u : count, sizeof(BrickMotion));
+    Entity *moved = (Entity *)TRACKED_CALLOC((moving == 0u) ? 1u : moving, sizeof(Entity));
+    Vector2D *moved_from = (Vector2D *)TRACKED_CALLOC((moving == 0u) ? 1u : moving, sizeof(Vector2D));
+    if ((n_motions == NULL) || (moved == NULL) || (moved_from == NULL) ||
+        (create_brick_grid(&grid, game->width, game->height, GAME_CELL_SIZE, game->brick_count) != SUCCESS))
+    {
+        res = FAILED;
+        goto fail;
+    }
+
+    // every brick goes into the new grid in order, the moving ones with how far they go
+    size_t run = 0u;
+    size_t slot = 0u;
+    for (size_t i = 0u; i < game->brick_count; ++i)
+    {
+        while ((run < count) && (i >= ((size_t)motions[run].first_brick + motions[run].brick_count)))
+        {
+            ++run;
+        }
+
+        const Entity *brick = game->bricks[i];
+        if ((run == count) || (i < motions[run].first_brick))
+        {
+            res = add_brick_grid(grid, &brick->block);
+        }
+        else
+        {
+            const Vector2D end = create_vec_xy(
+                brick->block.position.x + motions[run].reach.x, brick->block.position.y + motions[run].reach.y);
+            res = add_moving_brick_grid(grid, &brick->block, &end);
+
+            moved[slot] = *brick;
+            moved_from[slot] = brick->block.position;
+            ++slot;
+        }
+
+        if (res != SUCCESS)
+        {
+            goto fail;
+        }
+    }
+
+    if (build_brick_grid(grid) != SUCCESS)
+    {
+        res = FAILED;
+        goto fail;
+    }
+
+    // the bricks only point at their copies once nothing else can fail
+    slot = 0u;
+    for (size_t i = 0u; i < count; ++i)
+    {
+        for (uint32_t j = 0u; j < motions[i].brick_count; ++j)
+        {
+            game->bricks[motions[i].first_brick + j] = &moved[slot++];
+        }
+    }
+
+    memcpy(n_motions, motions, count * sizeof(BrickMotion));
+    destroy_brick_grid(game->grid);
+    game->grid = grid;
+    game->motions = n_motions;
+    game->motion_count = count;
+    game->moved = moved;
+    game->moved_from = moved_from;
+    return res;
+
+fail:
+    destroy_brick_grid(grid);
+    free_tracked(n_motions);
+    free_tracked(moved);
+    free_tracked(moved_from);
+    return res;
+}
+
+void destroy_game(Game *game)
+{
+    if (game == NULL)
+    {
+        return;
+    }
+
+    destroy_brick_grid(game->grid);
+    free_tracked(game->chunks);
+    free_tracked(game->chunk_firsts);
+    free_tracked(game->brick_alive);
+    free_tracked(game->brick_explosive);
+    free_tracked(game->brick_regrow);
+    free_tracked(game->motions);
+    free_tracked(game->moved);
+    free_tracked(game->moved_from);
+    free_tracked(game->bricks);
+    destory_list(game->entities);
+    free_tracked(game);
+}
+
+void step_game(Game *game, const GameInput *inputs, StepOutcome *outcome)
+{
+    assert(game != NULL);
+    assert(inputs != NULL);
+    assert(outcome != NULL);
+
+    // only the header, the collisions are written as they happen
+    outcome->missed = false;
+    outcome->player = 0u;
+    outcome->powerup = -1;
+    outcome->collision_count = 0u;
+    outcome->blasted_count = 0u;
+    outcome->regrown_count = 0u;
+
+    PowerupState *powerups = &game->state.powerups;
+    advance_timer_wheel(&powerups->timers, game->state.step, end_effect, game);
+
+    // bricks are where they are for this step before anything looks at them
+    if (game->motion_count > 0u)
+    {
+        PROFILE_START(move_start);
+        move_bricks(game);
+        PROFILE_STOP(game, GAME_PHASE_MOVE_BRICKS, move_start);
+    }
+
+    if (game->state.regrow_count > 0u)
+    {
+        regrow_bricks(game, outcome);
+    }
+
+    for (uint32_t player = 0u; player < game->players; ++player)
+    {
+        const GameInput *input = &inputs[player];
+        Vector2D *paddle_velocity = &game->state.paddle_velocities[player];
+
+        if ((input->left && input->right) || (!input->left && !input->right))
+        {
+            paddle_velocity->x = SCALAR(0.0f);
+        }
+        else if (input->left)
+        {
+            paddle_velocity->x = -PADDLE_SPEED;
+        }
+        else if (input->right)
+        {
+            paddle_velocity->x = PADDLE_SPEED;
+        }
+
+        add_vec(&game->state.paddles[player].block.position, paddle_velocity);
+    }
+
+    // a held ball moves with the paddle holding it
+    if (powerups->stuck_player != 0u)
+    {
+        game->state.ball.block.position.x =
+            game->state.paddles[powerups->stuck_player - 1u].block.position.x + powerups->stuck_offset;
+    }
+    else
+    {
+        PROFILE_START(update_start);
+        const int32_t missed = update_ball(game, &game->state.ball, &game->state.ball_velocity, 0u, outcome);
+        PROFILE_STOP(game, GAME_PHASE_UPDATE_BALL, update_start);
+        if (missed >= 0)
+        {
+            outcome->missed = true;
+            outcome->player = (uint32_t)missed;
+        }
+
+        PROFILE_START(collision_start);
+        handle_collisions(game, &game->state.ball, &game->state.ball_velocity, 0u, outcome);
+        PROFILE_STOP(game, GAME_PHASE_HANDLE_COLLISIONS, collision_start);
+    }
+
+    // extra balls are just lost when they get past a paddle
+    for (uint32_t i = 0u; i < (GAME_MAX_BALLS - 1u); ++i)
+    {
+        if (((powerups->extras_used >> i) & 1u) != 0u)
+        {
+            Entity *ball = &powerups->extra_balls[i];
+            Vector2D *velocity = &powerups->extra_velocities[i];
+
+            PROFILE_START(update_start);
+            const bool lost = update_ball(game, ball, velocity, i + 1u, outcome) >= 0;
+            PROFILE_STOP(game, GAME_PHASE_UPDATE_BALL, update_start);
+            if (lost)
+            {
+                powerups->extras_used &= ~(1u << i);
+                continue;
+            }
+
+            PROFILE_START(collision_start);
+            handle_collisions(game, ball, velocity, i + 1u, outcome);
+            PROFILE_STOP(game, GAME_PHASE_HANDLE_COLLISIONS, collision_start);
+        }
+    }
+
+    update_chain(game, outcome);
+    update_drops(game, outcome);
+
+    if (outcome->missed && (game->state.lives[outcome->player] > 0u))
+    {
+        --game->state.lives[outcome->player];
+    }
+
+    ++game->state.step;
+}
+
+bool is_brick_alive(const Game *game, size_t index)
+{
+    assert(game != NULL);
+    assert(index < game->brick_count);
+
+    return ((game->brick_alive[index / 64u] >> (index % 64u)) & 1u) != 0u;
+}
+
+bool is_brick_explosive(const Game *game, size_t index)
+{
+    assert(game != NULL);
+    assert(index < game->brick_count);
+
+    return (game->brick_explosive != NULL) && (((game->brick_explosive[index / 64u] >> (index % 64u)) & 1u) != 0u);
+}
+
+const Entity *get_brick(const Game *game, size_t index)
+{
+    assert(game != NULL);
+    assert(index < game->brick_count);
+
+    if (game->chunks == NULL)
+    {
+        return game->bricks[index];
+    }
+
+    // the last chunk starting at or before the brick, empty chunks before it start at the same brick
+    size_t low = 0u;
+    size_t high = game->chunk_count;
+    while ((high - low) > 1u)
+    {
+        const size_t middle = low + ((high - low) / 2u);
+        if (game->chunk_firsts[middle] <= index)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    const BrickChunk *chunk = game->chunks[low];
+    return (chunk == NULL) ? NULL : &chunk->bricks[index - game->chunk_firsts[low]];
+}
+
+void get_brick_range(const Game *game, const Block *area, GridRange *range)
+{
+    assert(game != NULL);
+    assert(area != NULL);
+    assert(range != NULL);
+
+    if (game->chunks == NULL)
+    {
+        get_grid_range(game->grid, area, range);
+        return;
+    }
+
+    get_chunk_cell(game, area->position.x, area->position.y, &range->first_column, &range->first_row);
+    get_chunk_cell(
+        game, area->position.x + area->width, area->position.y + area->height, &range->last_column, &range->last_row);
+
+    // bricks homed one cell up or left can reach into the area
+    range->first_column = (range->first_column > 0) ? (range->first_column - 1) : 0;
+    range->first_row = (range->first_row > 0) ? (range->first_row - 1) : 0;
+}
+
+const uint32_t *get_cell_bricks(const Game *game, int32_t column, int32_t row, size_t *count)
+{
+    assert(game != NULL);
+    assert(count != NULL);
+
+    if (game->chunks == NULL)
+    {
+        return get_grid_bricks(game->grid, column, row, count);
+    }
+
+    *count = 0u;
+    if ((column < 0) || (row < 0) || (column >= game->cell_columns) || (row >= game->cell_rows))
+    {
+        return NULL;
+    }
+
+    const size_t chunk =
+        ((size_t)(row / GAME_CHUNK_CELLS) * (size_t)game->chunk_columns) + (size_t)(column / GAME_CHUNK_CELLS);
+    const BrickChunk *bricks = game->chunks[chunk];
+    if (bricks == NULL)
+    {
+        return NULL;
+    }
+
+    const size_t cell = ((size_t)(row % GAME_CHUNK_CELLS) * GAME_CHUNK_CELLS) + (size_t)(column % GAME_CHUNK_CELLS);
+    *count = bricks->cell_start[cell + 1u] - bricks->cell_start[cell];
+
+    return &bricks->indices[bricks->cell_start[cell]];
+}
+
+void set_brick_chunk(Game *game, size_t chunk, const BrickChunk *bricks)
+{
+    assert(game != NULL);
+    assert(game->chunks != NULL);
+    assert(chunk < game->chunk_count);
+    assert((bricks == NULL) || (bricks->first_brick == game->chunk_firsts[chunk]));
+
+    game->chunks[chunk] = bricks;
+}
+
+bool can_step_game(const Game *game)
+{
+    assert(game != NULL);
+
+    if (game->chunks == NULL)
+    {
+        return true;
+    }
+
+    const PowerupState *powerups = &game->state.powerups;
+    const Entity *balls[GAME_MAX_BALLS] = {&game->state.ball};
+    size_t ball_count = 1u;
+    for (uint32_t i = 0u; i < (GAME_MAX_BALLS - 1u); ++i)
+    {
+        if (((powerups->extras_used >> i) & 1u) != 0u)
+        {
+            balls[ball_count++] = &powerups->extra_balls[i];
+        }
+    }
+
+    // a ball moves well under a cell a step, so every cell next to one covers wherever it can get to
+    for (size_t i = 0u; i < ball_count; ++i)
+    {
+        const Block *block = &balls[i]->block;
+        const Block reach = create_block_xy(
+            block->position.x - GAME_CELL_SIZE,
+            block->position.y - GAME_CELL_SIZE,
+            block->width + (2 * GAME_CELL_SIZE),
+            block->height + (2 * GAME_CELL_SIZE));
+
+        GridRange range;
+        get_brick_range(game, &reach, &range);
+
+        for (int32_t row = range.first_row / GAME_CHUNK_CELLS; row <= (range.last_row / GAME_CHUNK_CELLS); ++row)
+        {
+            for (int32_t column = range.first_column / GAME_CHUNK_CELLS;
+                 column <= (range.last_column / GAME_CHUNK_CELLS);
+                 ++column)
+            {
+                if (game->chunks[((size_t)row * (size_t)game->chunk_columns) + (size_t)column] == NULL)
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+bool is_game_over(const Game *game)
+{
+    assert(game != NULL);
+
+    for (uint32_t player = 0u; player < game->players; ++player)
+    {
+        if (game->state.lives[player] == 0u)
+        {
+            return true;
+        }
+    }
+
+    return game->state.bricks_left == 0u;
+}
+
+/**
+ * Helper function to add bytes to a hash.
+ *
+ * @param hash
+ *   Hash so far.
+ *
+ * @param data
+ *   Bytes to add.
+ *
+ * @param size
+ *   Number of bytes.
+ *
+ * @returns
+ *   Updated hash.
+ */
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+
+    for (size_t i = 0u; i < size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * HASH_PRIME;
+    }
+
+    return hash;
+}
+
+/**
+ * Helper function to add a block to a hash, field by field so struct padding is left out.
+ *
+ * @param hash
+ *   Hash so far.
+ *
+ * @param block
+ *   Block to add.
+ *
+ * @returns
+ *   Updated hash.
+ */
+static uint64_t hash_block(uint64_t hash, const Block *block)
+{
+    hash = hash_bytes(hash, &block->position.x, sizeof(block->position.x));
+    hash = hash_bytes(hash, &block->position.y, sizeof(block->position.y));
+    hash = hash_bytes(hash, &block->width, sizeof(block->width));
+    return hash_bytes(hash, &block->height, sizeof(block->height));
+}
+
+/**
+ * Helper function to add the power-up state to a hash, leaving out drops, balls and timers not in use.
+ *
+ * @param hash
+ *   Hash so far.
+ *
+ * @param powerups
+ *   Power-up state to add.
+ *
+ * @returns
+ *   Updated hash.
+ */
+static uint64_t hash_powerups(uint64_t hash, const PowerupState *powerups)
+{
+    for (uint32_t i = 0u; i < GAME_MAX_DROPS; ++i)
+    {
+        if (((powerups->drops_used >> i) & 1u) != 0u)
+        {
+            hash = hash_block(hash, &powerups->drops[i].block);
+            hash = hash_bytes(hash, &powerups->drops[i].kind, sizeof(powerups->drops[i].kind));
+            hash = hash_bytes(hash, &powerups->drops[i].player, sizeof(powerups->drops[i].player));
+        }
+    }
+
+    for (uint32_t i = 0u; i < (GAME_MAX_BALLS - 1u); ++i)
+    {
+        if (((powerups->extras_used >> i) & 1u) != 0u)
+        {
+            hash = hash_block(hash, &powerups->extra_balls[i].block);
+            hash = hash_bytes(hash, &powerups->extra_velocities[i].x, sizeof(powerups->extra_velocities[i].x));
+            hash = hash_bytes(hash, &powerups->extra_velocities[i].y, sizeof(powerups->extra_velocities[i].y));
+        }
+    }
+
+    hash = hash_bytes(hash, &powerups->drops_used, sizeof(powerups->drops_used));
+    hash = hash_bytes(hash, &powerups->extras_used, sizeof(powerups->extras_used));
+    hash = hash_bytes(hash, powerups->wide_timers, sizeof(powerups->wide_timers));
+    hash = hash_bytes(hash, powerups->sticky_timers, sizeof(powerups->sticky_timers));
+    hash = hash_bytes(hash, &powerups->slow_timer, sizeof(powerups->slow_timer));
+    hash = hash_bytes(hash, &powerups->multi_cooldown, sizeof(powerups->multi_cooldown));
+    hash = hash_bytes(hash, &powerups->stuck_player, sizeof(powerups->stuck_player));
+    hash = hash_bytes(hash, &powerups->stuck_offset, sizeof(powerups->stuck_offset));
+    hash = hash_bytes(hash, &powerups->release_timer, sizeof(powerups->release_timer));
+    hash = hash_bytes(hash, &powerups->seed, sizeof(powerups->seed));
+
+    const TimerWheel *timers = &powerups->timers;
+    for (uint32_t i = 0u; i < TIMER_WHEEL_CAPACITY; ++i)
+    {
+        if (((timers->used >> i) & 1u) != 0u)
+        {
+            hash = hash_bytes(hash, &timers->timers[i].expires, sizeof(timers->timers[i].expires));
+            hash = hash_bytes(hash, &timers->timers[i].kind, sizeof(timers->timers[i].kind));
+            hash = hash_bytes(hash, &timers->timers[i].data, sizeof(timers->timers[i].data));
+            hash = hash_bytes(hash, &timers->timers[i].generation, sizeof(timers->timers[i].generation));
+        }
+    }
+
+    hash = hash_bytes(hash, &timers->used, sizeof(timers->used));
+    hash = hash_bytes(hash, timers->heads, sizeof(timers->heads));
+    return hash_bytes(hash, timers->tails, sizeof(timers->tails));
+}
+
+uint64_t hash_game(const Game *game)
+{
+    assert(game != NULL);
+
+    const GameState *state = &game->state;
+    uint64_t hash = HASH_OFFSET;
+
+    for (uint32_t player = 0u; player < game->players; ++player)
+    {
+        hash = hash_block(hash, &state->paddles[player].block);
+        hash = hash_bytes(hash, &state->paddle_velocities[player].x, sizeof(state->paddle_velocities[player].x));
+        hash = hash_bytes(hash, &state->scores[player], sizeof(state->scores[player]));
+        hash = hash_bytes(hash, &state->lives[player], sizeof(state->lives[player]));
+    }
+
+    hash = hash_block(hash, &state->ball.block);
+    hash = hash_bytes(hash, &state->ball_velocity.x, sizeof(state->ball_velocity.x));
+    hash = hash_bytes(hash, &state->ball_velocity.y, sizeof(state->ball_velocity.y));
+    hash = hash_bytes(hash, &state->step, sizeof(state->step));
+    hash = hash_bytes(hash, &state->bricks_left, sizeof(state->bricks_left));
+    hash = hash_bytes(hash, &state->last_player, sizeof(state->last_player));
+    hash = hash_bytes(hash, &state->chain_count, sizeof(state->chain_count));
+    for (uint32_t i = 0u; i < state->chain_count; ++i)
+    {
+        hash = hash_bytes(hash, &state->chain[(state->chain_first + i) % GAME_MAX_CHAIN], sizeof(uint32_t));
+    }
+
+    // left out while empty, so levels where nothing grows back hash as they always have
+    if (state->regrow_count > 0u)
+    {
+        hash = hash_bytes(hash, &state->regrow_count, sizeof(state->regrow_count));
+        for (uint32_t i = 0u; i < state->regrow_count; ++i)
+        {
+            const uint32_t slot = (state->regrow_first + i) % GAME_MAX_REGROW;
+            hash = hash_bytes(hash, &state->regrow[slot], sizeof(state->regrow[slot]));
+            hash = hash_bytes(hash, &state->regrow_at[slot], sizeof(state->regrow_at[slot]));
+        }
+    }
+    hash = hash_powerups(hash, &state->powerups);
+
+    return hash_bytes(hash, game->brick_alive, ((game->brick_count / 64u) + 1u) * sizeof(uint64_t));
+}
+
+/**
+ * Helper function to pack two scalars into one word of a digest.
+ *
+ * @param a
+ *   Scalar for the low half.
+ *
+ * @param b
+ *   Scalar for the high half.
+ *
+ * @returns
+ *   Packed word.
+ */
+static inline uint64_t pack_scalars(Scalar a, Scalar b)
+{
+    uint32_t low = 0u;
+    uint32_t high = 0u;
+    memcpy(&low, &a, sizeof(low));
+    memcpy(&high, &b, sizeof(high));
+    return ((uint64_t)high << 32u) | low;
+}
+
+/**
+ * Helper function to add a word to a digest. One multiply a word keeps the chain short, digest_game scrambles the
+ * result once at the end so every bit of every word reaches the low bits.
+ *
+ * @param digest
+ *   Digest so far.
+ *
+ * @param word
+ *   Word to add.
+ *
+ * @returns
+ *   Updated digest.
+ */
+static inline uint64_t add_digest(uint64_t digest, uint64_t word)
+{
+    return (digest ^ word) * DIGEST_PRIME;
+}
+
+/**
+ * Helper function to add a block to a digest.
+ *
+ * @param digest
+ *   Digest so far.
+ *
+ * @param block
+ *   Block to add.
+ *
+ * @returns
+ *   Updated digest.
+ */
+static inline uint64_t add_block_digest(uint64_t digest, const Block *block)
+{
+    digest = add_digest(digest, pack_scalars(block->position.x, block->position.y));
+    return add_digest(digest, pack_scalars(block->width, block->height));
+}
+
+uint64_t digest_game(const Game *game)
+{
+    assert(game != NULL);
+
+    const GameState *state = &game->state;
+    const PowerupState *powerups = &state->powerups;
+
+    // the bricks are already summed up, so the cost doesn't depend on the size of the level
+    uint64_t digest = add_digest(DIGEST_SEED, state->brick_digest);
+    digest = add_digest(digest, state->step);
+    digest = add_digest(digest, ((uint64_t)state->last_player << 32u) | state->bricks_left);
+
+    // the chain queue is empty nearly every step, two blasts a word while it isn't
+    digest = add_digest(digest, state->chain_count);
+    for (uint32_t i = 0u; i < state->chain_count; i += 2u)
+    {
+        const uint32_t first = state->chain[(state->chain_first + i) % GAME_MAX_CHAIN];
+        const uint32_t second =
+            ((i + 1u) < state->chain_count) ? state->chain[(state->chain_first + i + 1u) % GAME_MAX_CHAIN] : 0u;
+        digest = add_digest(digest, ((uint64_t)second << 32u) | first);
+    }
+
+    // bricks join the regrow queue as they are destroyed, which the brick digest already covers, so the length and
+    // the next one due are enough. Left out while empty like in hash_game
+    if (state->regrow_count > 0u)
+    {
+        digest = add_digest(digest, ((uint64_t)state->regrow[state->regrow_first] << 32u) | state->regrow_count);
+        digest = add_digest(digest, state->regrow_at[state->regrow_first]);
+    }
+
+    for (uint32_t player = 0u; player < game->players; ++player)
+    {
+        digest = add_block_digest(digest, &state->paddles[player].block);
+        digest = add_digest(
+            digest, pack_scalars(state->paddle_velocities[player].x, state->paddle_velocities[player].y));
+        digest = add_digest(digest, ((uint64_t)state->lives[player] << 32u) | state->scores[player]);
+        digest = add_digest(digest, ((uint64_t)powerups->sticky_timers[player] << 32u) | powerups->wide_timers[player]);
+    }
+
+    digest = add_block_digest(digest, &state->ball.block);
+    digest = add_digest(digest, pack_scalars(state->ball_velocity.x, state->ball_velocity.y));
+
+    for (uint32_t i = 0u; i < (GAME_MAX_BALLS - 1u); ++i)
+    {
+        if (((powerups->extras_used >> i) & 1u) != 0u)
+        {
+            digest = add_block_digest(digest, &powerups->extra_balls[i].block);
+            digest = add_digest(
+                digest, pack_scalars(powerups->extra_velocities[i].x, powerups->extra_velocities[i].y));
+        }
+    }
+
+    for (uint32_t i = 0u; i < GAME_MAX_DROPS; ++i)
+    {
+        if (((powerups->drops_used >> i) & 1u) != 0u)
+        {
+            digest = add_block_digest(digest, &powerups->drops[i].block);
+            digest = add_digest(digest, ((uint64_t)powerups->drops[i].player << 32u) | powerups->drops[i].kind);
+        }
+    }
+
+    // timers are summed up by which are pending, when they fire shows up in the state soon enough
+    digest = add_digest(digest, ((uint64_t)powerups->extras_used << 32u) | powerups->drops_used);
+    digest = add_digest(digest, ((uint64_t)powerups->multi_cooldown << 32u) | powerups->slow_timer);
+    digest = add_digest(digest, ((uint64_t)powerups->release_timer << 32u) | powerups->stuck_player);
+    digest = add_digest(digest, pack_scalars(powerups->stuck_offset, SCALAR(0.0f)));
+    digest = add_digest(digest, ((uint64_t)powerups->timers.used << 32u) | powerups->seed);
+    return mix_digest(digest);
+}
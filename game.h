@@ -0,0 +1,667 @@
+#ifndef _GAME_H_
+#define _GAME_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "block.h"
+#include "grid.h"
+#include "list.h"
+#include "result.h"
+#include "timer_wheel.h"
+#include "vector.h"
+
+/**
+ * Game owns the level and runs the simulation one step at a time, with no dependency on the window or audio.
+ */
+
+/**
+ * Most players in one game. Player 0 defends the bottom of the world, player 1 the top.
+ */
+#define GAME_MAX_PLAYERS 2u
+
+/**
+ * Most balls in play at once, the main ball plus the ones added by multi-ball.
+ */
+#define GAME_MAX_BALLS 3u
+
+/**
+ * Most power-ups falling at once, a destroyed brick drops nothing while the pool is full.
+ */
+#define GAME_MAX_DROPS 8u
+
+/**
+ * Most collisions in one step. A ball can go past a side wall and an end wall, hit one brick and hit every paddle.
+ */
+#define GAME_MAX_COLLISIONS (GAME_MAX_BALLS * (3u + GAME_MAX_PLAYERS))
+
+/**
+ * Most explosive bricks waiting to go off. One caught in a blast while the queue is full is destroyed without going
+ * off.
+ */
+#define GAME_MAX_CHAIN 256u
+
+/**
+ * Most bricks blasts destroy in one step, a bigger chain reaction carries on over the following steps.
+ */
+#define GAME_MAX_BLASTED 64u
+
+/**
+ * Most destroyed bricks waiting to grow back. One destroyed while the queue is full stays destroyed.
+ */
+#define GAME_MAX_REGROW 128u
+
+/**
+ * Most bricks growing back in one step, the rest grow back over the following steps.
+ */
+#define GAME_MAX_REGROWN 16u
+
+/**
+ * Size of a brick grid cell, must be at least as large as any brick.
+ */
+#define GAME_CELL_SIZE SCALAR(80.0f)
+
+/**
+ * Grid cells along each side of a chunk of a streamed level.
+ */
+#define GAME_CHUNK_CELLS 16
+
+/**
+ * Cells in a chunk of a streamed level.
+ */
+#define GAME_CHUNK_CELL_COUNT (GAME_CHUNK_CELLS * GAME_CHUNK_CELLS)
+
+/**
+ * Parts of a step timed into Game.phase_ns when built with BREAKOUT_PROFILE.
+ */
+typedef enum GamePhase
+{
+    // moving a ball and bouncing it off the walls
+    GAME_PHASE_UPDATE_BALL,
+    // bouncing a ball off the paddles and bricks
+    GAME_PHASE_HANDLE_COLLISIONS,
+    // sliding the moving bricks along and keeping the brick grid up to date
+    GAME_PHASE_MOVE_BRICKS,
+    GAME_PHASES
+} GamePhase;
+
+/**
+ * Power-ups dropped by destroyed bricks, each takes effect when the paddle it falls towards catches it.
+ */
+typedef enum PowerupKind
+{
+    // wider paddle for a while
+    POWERUP_WIDE,
+    // every ball moves at half speed for a while
+    POWERUP_SLOW,
+    // two more balls, then a cooldown before it works again
+    POWERUP_MULTI,
+    // the paddle catches the main ball and holds it for a moment, for a while
+    POWERUP_STICKY,
+    POWERUP_KINDS
+} PowerupKind;
+
+/**
+ * What a ball collided with.
+ */
+typedef enum CollisionKind
+{
+    // an edge of the world, the ball bounces back in
+    COLLISION_WALL,
+    // a brick, which is destroyed
+    COLLISION_BRICK,
+    // a paddle
+    COLLISION_PADDLE
+} CollisionKind;
+
+/**
+ * A ball colliding with something during a step.
+ */
+typedef struct CollisionEvent
+{
+    uint64_t step;
+    CollisionKind kind;
+
+    // 0 for the main ball, i + 1 for extra ball i
+    uint32_t ball;
+
+    // brick index for a brick, player for a paddle, 0 for a wall
+    uint32_t other;
+
+    // direction from the surface hit towards the ball, along one axis, and how far into it the ball had gone. Both
+    // are zero when the ball only touched it, which doesn't bounce the ball
+    Vector2D normal;
+    Scalar penetration;
+} CollisionEvent;
+
+/**
+ * Struct encapsulating the data for a renderable entity.
+ */
+typedef struct Entity
+{
+    Block block;
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+} Entity;
+
+/**
+ * A run of bricks sliding back and forth together, part of the level. Their upper left corners go in a straight line
+ * from where the level puts them to reach away from there and back again every period steps, their positions follow
+ * GameState.step so nothing about them needs saving.
+ */
+typedef struct BrickMotion
+{
+    // bricks first_brick up to (not including) first_brick + brick_count
+    uint32_t first_brick;
+    uint32_t brick_count;
+
+    Vector2D reach;
+
+    // at least 2
+    uint32_t period;
+} BrickMotion;
+
+/**
+ * Keys held down for a step.
+ */
+typedef struct GameInput
+{
+    bool left;
+    bool right;
+} GameInput;
+
+/**
+ * What happened during a step, so the front end can play sounds, spawn effects and keep statistics.
+ *
+ * Collisions are written to one array in the order they happen and nothing reacts to them during the step. Anything
+ * interested walks the array afterwards, so the physics never calls out and each consumer handles a step's worth of
+ * collisions in one go. Only collision_count entries are written, the rest are left as they were.
+ */
+typedef struct StepOutcome
+{
+    // a ball went past a paddle, and the player whose paddle it was
+    bool missed;
+    uint32_t player;
+
+    // kind of power-up caught this step, or -1
+    int32_t powerup;
+
+    uint32_t collision_count;
+    CollisionEvent collisions[GAME_MAX_COLLISIONS];
+
+    // bricks destroyed by explosions, in the order they went. Bricks hit by a ball are collisions instead
+    uint32_t blasted_count;
+    uint32_t blasted[GAME_MAX_BLASTED];
+
+    // bricks that grew back, in the order they did
+    uint32_t regrown_count;
+    uint32_t regrown[GAME_MAX_REGROWN];
+} StepOutcome;
+
+/**
+ * A power-up falling towards a paddle.
+ */
+typedef struct Drop
+{
+    Block block;
+    uint32_t kind;
+
+    // player whose paddle it falls towards
+    uint32_t player;
+} Drop;
+
+/**
+ * Power-ups and their effects. Part of GameState, so everything is plain data referring to other parts by index.
+ */
+typedef struct PowerupState
+{
+    // pool of falling power-ups, bit i of drops_used is set while drops[i] is falling
+    Drop drops[GAME_MAX_DROPS];
+    uint32_t drops_used;
+
+    // balls added by multi-ball, bit i of extras_used is set while extra_balls[i] is in play
+    Entity extra_balls[GAME_MAX_BALLS - 1u];
+    Vector2D extra_velocities[GAME_MAX_BALLS - 1u];
+    uint32_t extras_used;
+
+    // timer ending each effect, NO_TIMER while the effect is off. Multi-ball has a cooldown timer instead
+    uint32_t wide_timers[GAME_MAX_PLAYERS];
+    uint32_t sticky_timers[GAME_MAX_PLAYERS];
+    uint32_t slow_timer;
+    uint32_t multi_cooldown;
+
+    // player plus one whose paddle holds the main ball, or 0. The ball keeps its offset from the paddle until
+    // release_timer fires
+    uint32_t stuck_player;
+    Scalar stuck_offset;
+    uint32_t release_timer;
+
+    // random state for choosing drops
+    uint32_t seed;
+
+    // timers are keyed on GameState.step
+    TimerWheel timers;
+} PowerupState;
+
+/**
+ * Everything that changes from step to step apart from which bricks are alive. Plain data so it can be copied.
+ */
+typedef struct GameState
+{
+    Entity paddles[GAME_MAX_PLAYERS];
+    Entity ball;
+    Vector2D paddle_velocities[GAME_MAX_PLAYERS];
+    Vector2D ball_velocity;
+    uint64_t step;
+    uint32_t scores[GAME_MAX_PLAYERS];
+    uint32_t lives[GAME_MAX_PLAYERS];
+    uint32_t bricks_left;
+
+    // sum of a hash of the index of every live brick, updated as bricks are destroyed so digest_game never has to look
+    // at the bricks themselves. Part of the state so restoring a step restores it too
+    uint64_t brick_digest;
+
+    // player who last hit the ball, bricks score for them and drop power-ups towards them
+    uint32_t last_player;
+
+    // explosive bricks destroyed but not yet gone off, chain[(chain_first + i) % GAME_MAX_CHAIN] for i below
+    // chain_count. The first may have gone off partly, a blast destroys whatever is still alive around it
+    uint32_t chain[GAME_MAX_CHAIN];
+    uint32_t chain_first;
+    uint32_t chain_count;
+
+    // destroyed bricks waiting to grow back, oldest first. regrow[(regrow_first + i) % GAME_MAX_REGROW] for i below
+    // regrow_count grows back at step regrow_at[(regrow_first + i) % GAME_MAX_REGROW], or later if a ball is in the way
+    uint32_t regrow[GAME_MAX_REGROW];
+    uint64_t regrow_at[GAME_MAX_REGROW];
+    uint32_t regrow_first;
+    uint32_t regrow_count;
+
+    PowerupState powerups;
+} GameState;
+
+/**
+ * Bricks of one chunk of a streamed level, filled in by whoever loads the chunk.
+ */
+typedef struct BrickChunk
+{
+    // the chunk's bricks are numbered first_brick onwards, ordered by cell
+    uint32_t first_brick;
+    uint32_t brick_count;
+
+    // cell c of the chunk, counted a row at a time, holds bricks cell_start[c] up to cell_start[c + 1]
+    uint32_t cell_start[GAME_CHUNK_CELL_COUNT + 1];
+
+    // indices[i] is first_brick + i, so a cell's bricks can be handed out the same way as the grid's
+    uint32_t *indices;
+    Entity *bricks;
+} BrickChunk;
+
+/**
+ * Struct for game data. Deliberately public so front ends, controllers and tools can read the state directly.
+ */
+typedef struct Game
+{
+    GameState state;
+
+    // owns every brick, bricks are never removed while playing so they can be brought back by restoring state. Empty
+    // for baked levels, whose bricks stay in the program's read only data
+    List *entities;
+
+    // brick i is bricks[i] (get_brick works for streamed levels too), it is alive when bit i of brick_alive is set
+    const Entity **bricks;
+    uint64_t *brick_alive;
+    size_t brick_count;
+
+    // bit i is set when brick i explodes on being destroyed, NULL if the level has no explosive bricks. Part of the
+    // level rather than the state, it never changes
+    uint64_t *brick_explosive;
+
+    // bit i is set when brick i grows back regrow_delay steps after being destroyed, NULL if no brick does. Part of the
+    // level like brick_explosive
+    uint64_t *brick_regrow;
+    uint32_t regrow_delay;
+
+    // runs of bricks sliding back and forth, see set_brick_motion. A moving brick is a copy in moved which bricks
+    // points at, and moved_from[i] is where moved[i] starts
+    BrickMotion *motions;
+    size_t motion_count;
+    Entity *moved;
+    Vector2D *moved_from;
+
+    BrickGrid *grid;
+
+    // streamed levels keep their bricks in chunks instead of entities, bricks and grid. chunks[c] is NULL while chunk
+    // c is not in memory, chunk_firsts[c] is its first brick and chunk_firsts[chunk_count] is brick_count
+    const BrickChunk **chunks;
+    uint32_t *chunk_firsts;
+    size_t chunk_count;
+    int32_t chunk_columns;
+    int32_t cell_columns;
+    int32_t cell_rows;
+
+    Scalar width;
+    Scalar height;
+
+    // 1, or 2 for versus where the top of the world is player 1's goal instead of a wall
+    uint32_t players;
+
+    // nanoseconds spent in each GamePhase, only counted when built with BREAKOUT_PROFILE. Not part of the state, so
+    // it isn't hashed or rewound
+    uint64_t phase_ns[GAME_PHASES];
+
+    // times a moving brick crossed into another grid cell, counted in every build but not part of the state either
+    uint64_t moved_cells;
+} Game;
+
+/**
+ * Create a new game with the built in level, baked from levels/default.level.
+ *
+ * @param game
+ *   Created game.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result create_game(Game **game);
+
+/**
+ * Create a new game with one of the levels baked into the program, see level.h.
+ *
+ * @param game
+ *   Created game.
+ *
+ * @param name
+ *   Name of the level, the name of its description in levels/ without the extension.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure, or if there is no such level
+ */
+Result create_baked_game(Game **game, const char *name);
+
+/**
+ * Create a new game in a square world filled with bricks, for levels much larger than the screen.
+ *
+ * Bricks cover the top four fifths of the world on a 50 x 40 pitch, a 50000 world holds about a million. The bricks
+ * of some 16 x 16 patches are explosive, so one hit can set off a chain reaction through thousands of them.
+ *
+ * @param game
+ *   Created game.
+ *
+ * @param size
+ *   Width and height of the world, at least 800.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result create_large_game(Game **game, Scalar size);
+
+/**
+ * Create a new game in a square world whose bricks are loaded a chunk at a time by the caller, for levels too large to
+ * keep in memory. The world starts with no chunks in memory, see set_brick_chunk.
+ *
+ * @param game
+ *   Created game.
+ *
+ * @param size
+ *   Width and height of the world, at least 800.
+ *
+ * @param chunk_bricks
+ *   Number of bricks in each chunk, in the order given by get_chunk_layout.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result create_streamed_game(Game **game, Scalar size, const uint32_t *chunk_bricks);
+
+/**
+ * Get the number of chunks a streamed level is split into. Chunk c covers chunk column c % columns and chunk row
+ * c / columns, each GAME_CHUNK_CELLS grid cells across.
+ *
+ * @param size
+ *   Width and height of the world.
+ *
+ * @param columns
+ *   Out parameter for the number of chunk columns.
+ *
+ * @param rows
+ *   Out parameter for the number of chunk rows.
+ */
+void get_chunk_layout(Scalar size, int32_t *columns, int32_t *rows);
+
+/**
+ * Get the bricks of the field that fills large levels whose upper left corners lie in an area, in level order. Lets a
+ * level too large to create in memory be written out a piece at a time.
+ *
+ * @param size
+ *   Width and height of the world.
+ *
+ * @param area
+ *   Area to look in.
+ *
+ * @param bricks
+ *   Where to write the bricks, may be NULL if capacity is 0.
+ *
+ * @param capacity
+ *   Most bricks to write.
+ *
+ * @returns
+ *   Number of bricks in the area, more than capacity if they didn't all fit.
+ */
+size_t get_field_bricks(Scalar size, const Block *area, Entity *bricks, size_t capacity);
+
+/**
+ * Create a new two player game, one paddle at the bottom and one at the top with a mirrored band of bricks between,
+ * baked from levels/versus.level.
+ *
+ * @param game
+ *   Created game.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result create_versus_game(Game **game);
+
+/**
+ * Change the random state that chooses power-up drops, so games of the same level played the same way still turn out
+ * differently. Only meant to be called before the first step.
+ *
+ * @param game
+ *   Game to seed.
+ *
+ * @param seed
+ *   Random state, not 0.
+ */
+void seed_game(Game *game, uint32_t seed);
+
+/**
+ * Make runs of bricks slide back and forth. The brick grid is built again once, keeping a slot for each moving brick
+ * in every cell it can get to, after which a step only touches the grid for bricks crossing into another cell. Only
+ * meant to be called before the first step, once, and not for streamed levels.
+ *
+ * @param game
+ *   Game to set in motion.
+ *
+ * @param motions
+ *   Runs of bricks and how they move, in brick order without overlapping.
+ *
+ * @param count
+ *   Number of runs.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure, leaving the game as it was
+ */
+Result set_brick_motion(Game *game, const BrickMotion *motions, size_t count);
+
+/**
+ * Destroy a game.
+ *
+ * @param game
+ *   Game to destroy.
+ */
+void destroy_game(Game *game);
+
+/**
+ * Advance the simulation by one step.
+ *
+ * @param game
+ *   Game to advance.
+ *
+ * @param inputs
+ *   Keys held for this step, one per player.
+ *
+ * @param outcome
+ *   Out parameter for what happened during the step.
+ */
+void step_game(Game *game, const GameInput *inputs, StepOutcome *outcome);
+
+/**
+ * Check if a brick is alive.
+ *
+ * @param game
+ *   Game to check.
+ *
+ * @param index
+ *   Brick index.
+ *
+ * @returns
+ *   True if the brick has not been destroyed, otherwise false.
+ */
+bool is_brick_alive(const Game *game, size_t index);
+
+/**
+ * Check if a brick explodes when destroyed, destroying the bricks around it and setting off any explosive ones among
+ * them.
+ *
+ * @param game
+ *   Game to check.
+ *
+ * @param index
+ *   Brick index.
+ *
+ * @returns
+ *   True if the brick is explosive, otherwise false.
+ */
+bool is_brick_explosive(const Game *game, size_t index);
+
+/**
+ * Get a brick.
+ *
+ * @param game
+ *   Game to look in.
+ *
+ * @param index
+ *   Brick index.
+ *
+ * @returns
+ *   The brick, or NULL if it is in a chunk that is not in memory.
+ */
+const Entity *get_brick(const Game *game, size_t index);
+
+/**
+ * Get the range of grid cells holding bricks that could overlap an area.
+ *
+ * @param game
+ *   Game to look in.
+ *
+ * @param area
+ *   Area to cover.
+ *
+ * @param range
+ *   Out parameter for the range of cells.
+ */
+void get_brick_range(const Game *game, const Block *area, GridRange *range);
+
+/**
+ * Get the bricks homed in a grid cell, in level order. Cells outside the world and cells in chunks that are not in
+ * memory hold no bricks.
+ *
+ * @param game
+ *   Game to look in.
+ *
+ * @param column
+ *   Cell column.
+ *
+ * @param row
+ *   Cell row.
+ *
+ * @param count
+ *   Out parameter for the number of bricks.
+ *
+ * @returns
+ *   Indices of the bricks.
+ */
+const uint32_t *get_cell_bricks(const Game *game, int32_t column, int32_t row, size_t *count);
+
+/**
+ * Put a chunk of a streamed level in memory or take it out. The chunk must stay valid until it is taken out again.
+ *
+ * @param game
+ *   Streamed game.
+ *
+ * @param chunk
+ *   Chunk index.
+ *
+ * @param bricks
+ *   Bricks of the chunk, or NULL to take the chunk out.
+ */
+void set_brick_chunk(Game *game, size_t chunk, const BrickChunk *bricks);
+
+/**
+ * Check every brick the next step could touch is in memory. Always true unless the level is streamed, a streamed game
+ * must not step until it is.
+ *
+ * @param game
+ *   Game to check.
+ *
+ * @returns
+ *   True if the game can step, otherwise false.
+ */
+bool can_step_game(const Game *game);
+
+/**
+ * Check if the game has finished, either a player has lost all their lives or all bricks are destroyed.
+ *
+ * @param game
+ *   Game to check.
+ *
+ * @returns
+ *   True if the game is over, otherwise false.
+ */
+bool is_game_over(const Game *game);
+
+/**
+ * Hash everything that makes up the state of a game, to check two simulations agree.
+ *
+ * @param game
+ *   Game to hash.
+ *
+ * @returns
+ *   64 bit FNV-1a hash of the game state and live bricks.
+ */
+uint64_t hash_game(const Game *game);
+
+/**
+ * Digest the state of a game cheaply enough to do every step, to find the first step two runs of a game disagree.
+ *
+ * Live bricks count through a sum kept up to date as they are destroyed, so the cost is the same for any size of level.
+ * The digest covers the paddles, balls, power-ups and scores and which timers are pending, but not when they fire,
+ * hash_game is the full check.
+ *
+ * @param game
+ *   Game to digest.
+ *
+ * @returns
+ *   64 bit digest of the game state.
+ */
+uint64_t digest_game(const Game *game);
+
+#endif
@@ -0,0 +1,497 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "alloc.h"
+#include "grid.h"
+
+typedef struct BrickGrid
+{
+    Scalar cell_size;
+    int32_t columns;
+    int32_t rows;
+
+    // home cell of every block, in the order they were added, NULL for a baked grid
+    uint32_t *homes;
+    size_t count;
+    size_t capacity;
+
+    // cell c holds indices[cell_start[c]] up to (not including) indices[cell_end[c]]. They point at starts, ends and
+    // slots, or at the caller's arrays for a baked grid. Cells are packed unless something moves, so cell_end is
+    // cell_start + 1
+    const uint32_t *cell_start;
+    const uint32_t *cell_end;
+    const uint32_t *indices;
+
+    // what the grid builds its cells in, NULL for a baked grid
+    uint32_t *starts;
+    uint32_t *slots;
+
+    // cells whose upper left corner each block can reach, the upper left corner of each block's home cell and the end
+    // of the blocks in each cell, a moving block has a slot kept in every cell it can reach. NULL unless a moving block
+    // was added
+    GridRange *reaches;
+    Vector2D *corners;
+    uint32_t *ends;
+} BrickGrid;
+
+/**
+ * Helper function to clamp a cell coordinate to the grid.
+ *
+ * @param value
+ *   Coordinate to clamp.
+ *
+ * @param limit
+ *   Number of cells along the axis.
+ *
+ * @returns
+ *   Clamped coordinate.
+ */
+static int32_t clamp_cell(int32_t value, int32_t limit)
+{
+    if (value < 0)
+    {
+        return 0;
+    }
+
+    return (value >= limit) ? (limit - 1) : value;
+}
+
+/**
+ * Helper function to get the cell along one axis holding a coordinate, clamped to the grid.
+ *
+ * Dividing can round a coordinate a hair short of a cell's edge up into that cell, so the cell is checked against its
+ * edge. A coordinate is then in a cell exactly when it is between the cell's edges, which lets a moving block be
+ * checked against its cell's edges without dividing and still land where dividing would put it.
+ *
+ * @param value
+ *   Coordinate to look up.
+ *
+ * @param cell_size
+ *   Size of a cell.
+ *
+ * @param limit
+ *   Number of cells along the axis.
+ *
+ * @returns
+ *   Cell holding the coordinate.
+ */
+static int32_t get_cell_along(Scalar value, Scalar cell_size, int32_t limit)
+{
+    if (value < SCALAR(0.0f))
+    {
+        return 0;
+    }
+
+    int32_t cell = (int32_t)(value / cell_size);
+    if (scalar_mul(scalar_from_int(cell), cell_size) > value)
+    {
+        --cell;
+    }
+
+    return clamp_cell(cell, limit);
+}
+
+/**
+ * Helper function to get the upper left corner of a cell.
+ *
+ * @param grid
+ *   Grid the cell is in.
+ *
+ * @param cell
+ *   Index of the cell.
+ *
+ * @returns
+ *   Position of the corner.
+ */
+static Vector2D get_cell_corner(const BrickGrid *grid, uint32_t cell)
+{
+    return create_vec_xy(
+        scalar_mul(scalar_from_int((int32_t)cell % grid->columns), grid->cell_size),
+        scalar_mul(scalar_from_int((int32_t)cell / grid->columns), grid->cell_size));
+}
+
+Result create_brick_grid(BrickGrid **grid, Scalar width, Scalar height, Scalar cell_size, size_t capacity)
+{
+    assert(grid != NULL);
+    assert(cell_size > SCALAR(0.0f));
+
+    Result res = SUCCESS;
+
+    BrickGrid *n_grid = (BrickGrid *)TRACKED_CALLOC(1u, sizeof(BrickGrid));
+    if (n_grid == NULL)
+    {
+        res = FAILED;
+        return res;
+    }
+
+    n_grid->cell_size = cell_size;
+    n_grid->columns = (int32_t)(width / cell_size) + 1;
+    n_grid->rows = (int32_t)(height / cell_size) + 1;
+    n_grid->capacity = capacity;
+
+    n_grid->homes = (uint32_t *)TRACKED_CALLOC((capacity == 0u) ? 1u : capacity, sizeof(uint32_t));
+    n_grid->slots = (uint32_t *)TRACKED_CALLOC((capacity == 0u) ? 1u : capacity, sizeof(uint32_t));
+    n_grid->starts = (uint32_t *)TRACKED_CALLOC((size_t)n_grid->columns * (size_t)n_grid->rows + 1u, sizeof(uint32_t));
+    if ((n_grid->homes == NULL) || (n_grid->slots == NULL) || (n_grid->starts == NULL))
+    {
+        res = FAILED;
+        destroy_brick_grid(n_grid);
+        return res;
+    }
+
+    n_grid->cell_start = n_grid->starts;
+    n_grid->cell_end = n_grid->starts + 1;
+    n_grid->indices = n_grid->slots;
+
+    // assign the grid to the user supplied pointer
+    *grid = n_grid;
+    return res;
+}
+
+void destroy_brick_grid(BrickGrid *grid)
+{
+    if (grid == NULL)
+    {
+        return;
+    }
+
+    free_tracked(grid->homes);
+    free_tracked(grid->slots);
+    free_tracked(grid->starts);
+    free_tracked(grid->reaches);
+    free_tracked(grid->corners);
+    free_tracked(grid->ends);
+    free_tracked(grid);
+}
+
+Result create_baked_brick_grid(
+    BrickGrid **grid,
+    Scalar width,
+    Scalar height,
+    Scalar cell_size,
+    const uint32_t *cell_start,
+    size_t cells,
+    const uint32_t *indices,
+    size_t count)
+{
+    assert(grid != NULL);
+    assert(cell_size > SCALAR(0.0f));
+    assert(cell_start != NULL);
+    assert(indices != NULL);
+
+    Result res = SUCCESS;
+
+    BrickGrid *n_grid = (BrickGrid *)TRACKED_CALLOC(1u, sizeof(BrickGrid));
+    if (n_grid == NULL)
+    {
+        res = FAILED;
+        return res;
+    }
+
+    n_grid->cell_size = cell_size;
+    n_grid->columns = (int32_t)(width / cell_size) + 1;
+    n_grid->rows = (int32_t)(height / cell_size) + 1;
+    n_grid->count = count;
+    n_grid->capacity = count;
+    n_grid->cell_start = cell_start;
+    n_grid->cell_end = cell_start + 1;
+    n_grid->indices = indices;
+
+    // cells worked out for a different world or cell size would send queries to the wrong bricks
+    if ((cells != ((size_t)n_grid->columns * (size_t)n_grid->rows)) || (cell_start[cells] != count))
+    {
+        res = FAILED;
+        destroy_brick_grid(n_grid);
+        return res;
+    }
+
+    // assign the grid to the user supplied pointer
+    *grid = n_grid;
+    return res;
+}
+
+Result add_brick_grid(BrickGrid *grid, const Block *block)
+{
+    assert(grid != NULL);
+    assert(grid->homes != NULL);
+    assert(block != NULL);
+
+    Result result = SUCCESS;
+
+    if (grid->count == grid->capacity)
+    {
+        result = FAILED;
+        return result;
+    }
+
+    int32_t column = 0;
+    int32_t row = 0;
+    get_grid_cell(grid, block->position.x, block->position.y, &column, &row);
+
+    if (grid->reaches != NULL)
+    {
+        grid->reaches[grid->count] =
+            (GridRange){.first_column = column, .first_row = row, .last_column = column, .last_row = row};
+    }
+
+    grid->homes[grid->count] = (uint32_t)((row * grid->columns) + column);
+    if (grid->corners != NULL)
+    {
+        grid->corners[grid->count] = get_cell_corner(grid, grid->homes[grid->count]);
+    }
+
+    ++grid->count;
+
+    return result;
+}
+
+Result add_moving_brick_grid(BrickGrid *grid, const Block *block, const Vector2D *end)
+{
+    assert(grid != NULL);
+    assert(grid->homes != NULL);
+    assert(block != NULL);
+    assert(end != NULL);
+
+    Result result = SUCCESS;
+
+    // the first moving block gives every block a reach, the ones already added stay in their home cells
+    if (grid->reaches == NULL)
+    {
+        grid->reaches = (GridRange *)TRACKED_CALLOC((grid->capacity == 0u) ? 1u : grid->capacity, sizeof(GridRange));
+        grid->corners = (Vector2D *)TRACKED_CALLOC((grid->capacity == 0u) ? 1u : grid->capacity, sizeof(Vector2D));
+        grid->ends = (uint32_t *)TRACKED_CALLOC((size_t)grid->columns * (size_t)grid->rows, sizeof(uint32_t));
+        if ((grid->reaches == NULL) || (grid->corners == NULL) || (grid->ends == NULL))
+        {
+            free_tracked(grid->reaches);
+            free_tracked(grid->corners);
+            free_tracked(grid->ends);
+            grid->reaches = NULL;
+            grid->corners = NULL;
+            grid->ends = NULL;
+            result = FAILED;
+            return result;
+        }
+
+        for (size_t i = 0u; i < grid->count; ++i)
+        {
+            const int32_t column = (int32_t)grid->homes[i] % grid->columns;
+            const int32_t row = (int32_t)grid->homes[i] / grid->columns;
+            grid->reaches[i] =
+                (GridRange){.first_column = column, .first_row = row, .last_column = column, .last_row = row};
+            grid->corners[i] = get_cell_corner(grid, grid->homes[i]);
+        }
+    }
+
+    if (add_brick_grid(grid, block) != SUCCESS)
+    {
+        result = FAILED;
+        return result;
+    }
+
+    const Vector2D *start = &block->position;
+    GridRange *reach = &grid->reaches[grid->count - 1u];
+    get_grid_cell(
+        grid,
+        (end->x < start->x) ? end->x : start->x,
+        (end->y < start->y) ? end->y : start->y,
+        &reach->first_column,
+        &reach->first_row);
+    get_grid_cell(
+        grid,
+        (end->x > start->x) ? end->x : start->x,
+        (end->y > start->y) ? end->y : start->y,
+        &reach->last_column,
+        &reach->last_row);
+
+    return result;
+}
+
+Result build_brick_grid(BrickGrid *grid)
+{
+    assert(grid != NULL);
+    assert(grid->homes != NULL);
+
+    const size_t cells = (size_t)grid->columns * (size_t)grid->rows;
+
+    // counting sort by home cell, which keeps blocks in insertion order within a cell. A moving block is counted in
+    // every cell it can reach, which keeps a slot for it there
+    for (size_t i = 0u; i <= cells; ++i)
+    {
+        grid->starts[i] = 0u;
+    }
+
+    for (size_t i = 0u; i < grid->count; ++i)
+    {
+        if (grid->reaches == NULL)
+        {
+            ++grid->starts[grid->homes[i] + 1u];
+            continue;
+        }
+
+        const GridRange *reach = &grid->reaches[i];
+        for (int32_t row = reach->first_row; row <= reach->last_row; ++row)
+        {
+            for (int32_t column = reach->first_column; column <= reach->last_column; ++column)
+            {
+                ++grid->starts[(row * grid->columns) + column + 1];
+            }
+        }
+    }
+
+    for (size_t i = 0u; i < cells; ++i)
+    {
+        grid->starts[i + 1u] += grid->starts[i];
+    }
+
+    // with moving blocks there are more slots than blocks, and the cells are filled through their own ends
+    uint32_t *cursors = grid->starts;
+    if (grid->reaches != NULL)
+    {
+        uint32_t *slots =
+            (uint32_t *)TRACKED_CALLOC((grid->starts[cells] == 0u) ? 1u : grid->starts[cells], sizeof(uint32_t));
+        if (slots == NULL)
+        {
+            return FAILED;
+        }
+
+        free_tracked(grid->slots);
+        grid->slots = slots;
+        grid->indices = slots;
+        grid->cell_end = grid->ends;
+
+        for (size_t i = 0u; i < cells; ++i)
+        {
+            grid->ends[i] = grid->starts[i];
+        }
+        cursors = grid->ends;
+    }
+
+    // place each block, using its cell's cursor as the write position
+    for (size_t i = 0u; i < grid->count; ++i)
+    {
+        const uint32_t cell = grid->homes[i];
+        const uint32_t slot = cursors[cell]++;
+        grid->slots[slot] = (uint32_t)i;
+    }
+
+    // placing blocks in packed cells advanced every start to the next cell's start, so shift back
+    if (grid->reaches == NULL)
+    {
+        for (size_t i = cells; i > 0u; --i)
+        {
+            grid->starts[i] = grid->starts[i - 1u];
+        }
+        grid->starts[0] = 0u;
+    }
+
+    return SUCCESS;
+}
+
+bool move_brick_grid(BrickGrid *grid, uint32_t index, const Block *block)
+{
+    assert(grid != NULL);
+    assert(grid->reaches != NULL);
+    assert(index < grid->count);
+    assert(block != NULL);
+
+    // most steps a moving block stays inside its cell, which its cell's edges tell without dividing
+    const Vector2D *corner = &grid->corners[index];
+    if ((block->position.x >= corner->x) && (block->position.x < (corner->x + grid->cell_size)) &&
+        (block->position.y >= corner->y) && (block->position.y < (corner->y + grid->cell_size)))
+    {
+        return false;
+    }
+
+    int32_t column = 0;
+    int32_t row = 0;
+    get_grid_cell(grid, block->position.x, block->position.y, &column, &row);
+
+    // a block past the edge of the grid is kept in the last cell
+    const uint32_t cell = (uint32_t)((row * grid->columns) + column);
+    const uint32_t home = grid->homes[index];
+    if (cell == home)
+    {
+        return false;
+    }
+
+    // a block outside its reach has no slot kept for it
+    assert((column >= grid->reaches[index].first_column) && (column <= grid->reaches[index].last_column));
+    assert((row >= grid->reaches[index].first_row) && (row <= grid->reaches[index].last_row));
+
+    // take the block out of its old cell, closing the gap so the rest stay in order
+    uint32_t slot = grid->starts[home];
+    while (grid->slots[slot] != index)
+    {
+        ++slot;
+    }
+
+    for (--grid->ends[home]; slot < grid->ends[home]; ++slot)
+    {
+        grid->slots[slot] = grid->slots[slot + 1u];
+    }
+
+    // and put it into its new cell in order, moving the higher indices up into the slot kept for it
+    assert(grid->ends[cell] < grid->starts[cell + 1u]);
+    for (slot = grid->ends[cell]++; (slot > grid->starts[cell]) && (grid->slots[slot - 1u] > index); --slot)
+    {
+        grid->slots[slot] = grid->slots[slot - 1u];
+    }
+
+    grid->slots[slot] = index;
+    grid->homes[index] = cell;
+    grid->corners[index] = get_cell_corner(grid, cell);
+    return true;
+}
+
+Scalar get_grid_cell_size(const BrickGrid *grid)
+{
+    assert(grid != NULL);
+
+    return grid->cell_size;
+}
+
+void get_grid_cell(const BrickGrid *grid, Scalar x, Scalar y, int32_t *column, int32_t *row)
+{
+    assert(grid != NULL);
+    assert(column != NULL);
+    assert(row != NULL);
+
+    *column = get_cell_along(x, grid->cell_size, grid->columns);
+    *row = get_cell_along(y, grid->cell_size, grid->rows);
+}
+
+void get_grid_range(const BrickGrid *grid, const Block *area, GridRange *range)
+{
+    assert(grid != NULL);
+    assert(area != NULL);
+    assert(range != NULL);
+
+    get_grid_cell(grid, area->position.x, area->position.y, &range->first_column, &range->first_row);
+    get_grid_cell(
+        grid,
+        area->position.x + area->width,
+        area->position.y + area->height,
+        &range->last_column,
+        &range->last_row);
+
+    // blocks homed one cell up or left can reach into the area
+    range->first_column = clamp_cell(range->first_column - 1, grid->columns);
+    range->first_row = clamp_cell(range->first_row - 1, grid->rows);
+}
+
+const uint32_t *get_grid_bricks(const BrickGrid *grid, int32_t column, int32_t row, size_t *count)
+{
+    assert(grid != NULL);
+    assert(count != NULL);
+
+    if ((column < 0) || (row < 0) || (column >= grid->columns) || (row >= grid->rows))
+    {
+        *count = 0u;
+        return grid->indices;
+    }
+
+    const size_t cell = ((size_t)row * (size_t)grid->columns) + (size_t)column;
+    *count = grid->cell_end[cell] - grid->cell_start[cell];
+
+    return &grid->indices[grid->cell_start[cell]];
+}
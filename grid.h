@@ -0,0 +1,247 @@
+#ifndef _GRID_H_
+#define _GRID_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "block.h"
+#include "result.h"
+#include "vector.h"
+
+/**
+ * Uniform grid index over static blocks.
+ *
+ * Each block is stored once, in the cell containing its upper left corner (its home cell). Cells must be at least as
+ * large as the largest block, so any block overlapping an area has its home cell in the cells covering that area or
+ * one cell to the left or above. The grid is built once, so cells are stored packed one after another with no per cell
+ * allocation.
+ *
+ * Blocks that move are added with the area they can move over, and get a slot kept for them in every cell their upper
+ * left corner can reach. Moving one only does anything when its corner crosses into another cell, and then only shifts
+ * the few blocks of its old and new cells along, so the cost of keeping the grid up to date follows the number of
+ * moving blocks and never the size of the grid, and nothing is rebuilt or allocated.
+ */
+
+/**
+ * Grid internal data.
+ */
+typedef struct BrickGrid BrickGrid;
+
+/**
+ * Inclusive range of grid cells.
+ */
+typedef struct GridRange
+{
+    int32_t first_column;
+    int32_t first_row;
+    int32_t last_column;
+    int32_t last_row;
+} GridRange;
+
+/**
+ * Create an empty grid.
+ *
+ * @param grid
+ *   Created grid.
+ *
+ * @param width
+ *   Width of the area covered by the grid.
+ *
+ * @param height
+ *   Height of the area covered by the grid.
+ *
+ * @param cell_size
+ *   Width and height of a cell, must be at least as large as any block added.
+ *
+ * @param capacity
+ *   Maximum number of blocks that will be added.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result create_brick_grid(BrickGrid **grid, Scalar width, Scalar height, Scalar cell_size, size_t capacity);
+
+/**
+ * Create a grid over cells worked out ahead of time, in the layout build_brick_grid produces, such as those of a level
+ * baked into the program. The grid only refers to the arrays, they must outlive it and nothing can be added to it.
+ *
+ * @param grid
+ *   Created grid.
+ *
+ * @param width
+ *   Width of the area covered by the grid.
+ *
+ * @param height
+ *   Height of the area covered by the grid.
+ *
+ * @param cell_size
+ *   Width and height of a cell, must be at least as large as any block.
+ *
+ * @param cell_start
+ *   Cell c holds indices[cell_start[c]] up to (not including) indices[cell_start[c + 1]], cells + 1 entries.
+ *
+ * @param cells
+ *   Number of cells, counted a row at a time.
+ *
+ * @param indices
+ *   Block indices ordered by home cell.
+ *
+ * @param count
+ *   Number of blocks.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure, or if the cells don't match the area and cell size
+ */
+Result create_baked_brick_grid(
+    BrickGrid **grid,
+    Scalar width,
+    Scalar height,
+    Scalar cell_size,
+    const uint32_t *cell_start,
+    size_t cells,
+    const uint32_t *indices,
+    size_t count);
+
+/**
+ * Destroy a grid.
+ *
+ * @param grid
+ *   Grid to destroy.
+ */
+void destroy_brick_grid(BrickGrid *grid);
+
+/**
+ * Add a block to the grid, it is given the next index (starting from 0).
+ *
+ * This *must* be called before build_brick_grid.
+ *
+ * @param grid
+ *   Grid to add to.
+ *
+ * @param block
+ *   Block to add.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the grid is full
+ */
+Result add_brick_grid(BrickGrid *grid, const Block *block);
+
+/**
+ * Add a block that moves to the grid, it is given the next index (starting from 0).
+ *
+ * This *must* be called before build_brick_grid.
+ *
+ * @param grid
+ *   Grid to add to.
+ *
+ * @param block
+ *   Block where it starts.
+ *
+ * @param end
+ *   Farthest its upper left corner moves to, the corner stays inside the rectangle between there and where it starts.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the grid is full or memory ran out
+ */
+Result add_moving_brick_grid(BrickGrid *grid, const Block *block, const Vector2D *end);
+
+/**
+ * Build the cells from all added blocks. Within a cell blocks are kept in the order they were added.
+ *
+ * @param grid
+ *   Grid to build.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result build_brick_grid(BrickGrid *grid);
+
+/**
+ * Move a block added with add_moving_brick_grid to where it is now. Blocks stay in index order within a cell.
+ *
+ * @param grid
+ *   Built grid.
+ *
+ * @param index
+ *   Block index.
+ *
+ * @param block
+ *   Block where it is now, its upper left corner inside the rectangle it was added with.
+ *
+ * @returns
+ *   True if the block changed cells, otherwise false.
+ */
+bool move_brick_grid(BrickGrid *grid, uint32_t index, const Block *block);
+
+/**
+ * Get the size of a grid cell.
+ *
+ * @param grid
+ *   Grid to query.
+ *
+ * @returns
+ *   Width and height of a cell.
+ */
+Scalar get_grid_cell_size(const BrickGrid *grid);
+
+/**
+ * Get the cell containing a point, clamped to the grid.
+ *
+ * @param grid
+ *   Grid to query.
+ *
+ * @param x
+ *   X coordinate of point.
+ *
+ * @param y
+ *   Y coordinate of point.
+ *
+ * @param column
+ *   Out parameter for cell column.
+ *
+ * @param row
+ *   Out parameter for cell row.
+ */
+void get_grid_cell(const BrickGrid *grid, Scalar x, Scalar y, int32_t *column, int32_t *row);
+
+/**
+ * Get the range of cells that may hold blocks overlapping an area.
+ *
+ * @param grid
+ *   Grid to query.
+ *
+ * @param area
+ *   Area to query.
+ *
+ * @param range
+ *   Out parameter for cell range, clamped to the grid.
+ */
+void get_grid_range(const BrickGrid *grid, const Block *area, GridRange *range);
+
+/**
+ * Get the indices of the blocks homed in a cell.
+ *
+ * @param grid
+ *   Grid to query.
+ *
+ * @param column
+ *   Cell column.
+ *
+ * @param row
+ *   Cell row.
+ *
+ * @param count
+ *   Out parameter for number of indices, 0 if the cell is outside the grid.
+ *
+ * @returns
+ *   Indices of blocks in the cell.
+ */
+const uint32_t *get_grid_bricks(const BrickGrid *grid, int32_t column, int32_t row, size_t *count);
+
+#endif
@@ -0,0 +1,474 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "alloc.h"
+#include "jobs.h"
+#include "trace.h"
+
+/**
+ * Marks the end of a job's dependent list.
+ */
+#define NO_EDGE UINT32_MAX
+
+/**
+ * Deque capacity, a power of two no smaller than JOB_MAX_JOBS so a run can never overflow a deque.
+ */
+#define DEQUE_CAPACITY 1024u
+
+/**
+ * Keeps each deque on its own cache lines so workers don't contend on each other's indices.
+ */
+#define CACHE_LINE 64
+
+typedef struct Job
+{
+    JobFunction function;
+    void *data;
+    size_t index;
+
+    // dependencies not finished yet
+    atomic_uint pending;
+
+    // jobs with no dependencies are pushed when the run starts
+    bool root;
+
+    // first edge in the list of jobs waiting on this one
+    uint32_t first_dependent;
+} Job;
+
+/**
+ * One entry in a job's list of dependents.
+ */
+typedef struct Edge
+{
+    JobId job;
+    uint32_t next;
+} Edge;
+
+/**
+ * Chase-Lev work-stealing deque. The owner pushes and takes at the bottom, other threads steal from the top.
+ */
+typedef struct Deque
+{
+    _Alignas(CACHE_LINE) atomic_int_fast64_t top;
+    _Alignas(CACHE_LINE) atomic_int_fast64_t bottom;
+    atomic_uint items[DEQUE_CAPACITY];
+} Deque;
+
+typedef struct Worker
+{
+    JobSystem *system;
+    size_t deque;
+    pthread_t thread;
+    bool started;
+} Worker;
+
+typedef struct JobSystem
+{
+    Job jobs[JOB_MAX_JOBS];
+    uint32_t job_count;
+
+    Edge edges[JOB_MAX_DEPENDENCIES];
+    uint32_t edge_count;
+
+    // deque 0 belongs to the thread calling run_jobs, deque i + 1 to worker i
+    Deque deques[JOB_MAX_WORKERS + 1u];
+    Worker workers[JOB_MAX_WORKERS];
+    size_t worker_count;
+
+    // jobs in the current run not finished yet
+    atomic_uint remaining;
+
+    // workers sleep between runs, a new generation wakes them
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    uint64_t generation;
+    bool quit;
+} JobSystem;
+
+/**
+ * Helper function to push a job onto the bottom of a deque, only called by the deque's owner.
+ *
+ * @param deque
+ *   Deque to push to.
+ *
+ * @param id
+ *   Job to push.
+ */
+static void push_deque(Deque *deque, JobId id)
+{
+    const int_fast64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    atomic_store_explicit(&deque->items[bottom & (DEQUE_CAPACITY - 1u)], id, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+}
+
+/**
+ * Helper function to take the job most recently pushed to a deque, only called by the deque's owner.
+ *
+ * @param deque
+ *   Deque to take from.
+ *
+ * @param id
+ *   Out parameter for the job.
+ *
+ * @returns
+ *   True if a job was taken, false if the deque was empty.
+ */
+static bool take_deque(Deque *deque, JobId *id)
+{
+    const int_fast64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int_fast64_t top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return false;
+    }
+
+    *id = atomic_load_explicit(&deque->items[bottom & (DEQUE_CAPACITY - 1u)], memory_order_relaxed);
+    if (top < bottom)
+    {
+        return true;
+    }
+
+    // last job, race any thief for it
+    const bool taken = atomic_compare_exchange_strong_explicit(
+        &deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return taken;
+}
+
+/**
+ * Helper function to steal the oldest job from a deque, called by any thread.
+ *
+ * @param deque
+ *   Deque to steal from.
+ *
+ * @param id
+ *   Out parameter for the job.
+ *
+ * @returns
+ *   True if a job was stolen, false if the deque was empty or another thread got it first.
+ */
+static bool steal_deque(Deque *deque, JobId *id)
+{
+    int_fast64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    const int_fast64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (top >= bottom)
+    {
+        return false;
+    }
+
+    *id = atomic_load_explicit(&deque->items[top & (DEQUE_CAPACITY - 1u)], memory_order_relaxed);
+    return atomic_compare_exchange_strong_explicit(
+        &deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+}
+
+/**
+ * Helper function to run a job and release the jobs waiting on it.
+ *
+ * @param jobs
+ *   Job system the job belongs to.
+ *
+ * @param deque
+ *   Deque of the thread running the job, released jobs are pushed here.
+ *
+ * @param id
+ *   Job to run.
+ */
+static void execute_job(JobSystem *jobs, size_t deque, JobId id)
+{
+    const Job *job = &jobs->jobs[id];
+    {
+        TRACE_ZONE("job");
+        job->function(job->data, job->index);
+    }
+
+    for (uint32_t edge = job->first_dependent; edge != NO_EDGE; edge = jobs->edges[edge].next)
+    {
+        const JobId dependent = jobs->edges[edge].job;
+        if (atomic_fetch_sub_explicit(&jobs->jobs[dependent].pending, 1u, memory_order_acq_rel) == 1u)
+        {
+            push_deque(&jobs->deques[deque], dependent);
+        }
+    }
+
+    atomic_fetch_sub_explicit(&jobs->remaining, 1u, memory_order_release);
+}
+
+/**
+ * Helper function to run jobs until the current run is finished, stealing when the thread's own deque is empty.
+ *
+ * @param jobs
+ *   Job system to work for.
+ *
+ * @param deque
+ *   Deque of the calling thread.
+ */
+static void work_jobs(JobSystem *jobs, size_t deque)
+{
+    const size_t deques = jobs->worker_count + 1u;
+
+    while (atomic_load_explicit(&jobs->remaining, memory_order_acquire) > 0u)
+    {
+        JobId id = 0u;
+        bool found = take_deque(&jobs->deques[deque], &id);
+
+        // start with the next thread along so thieves spread out
+        for (size_t i = 1u; !found && (i < deques); ++i)
+        {
+            found = steal_deque(&jobs->deques[(deque + i) % deques], &id);
+        }
+
+        if (found)
+        {
+            execute_job(jobs, deque, id);
+        }
+        else
+        {
+            // everything left is running or waiting on something running
+            sched_yield();
+        }
+    }
+}
+
+/**
+ * Worker thread entry point.
+ *
+ * @param arg
+ *   Worker the thread runs.
+ *
+ * @returns
+ *   NULL.
+ */
+static void *run_worker(void *arg)
+{
+    Worker *worker = (Worker *)arg;
+    JobSystem *jobs = worker->system;
+    uint64_t generation = 0u;
+
+    TRACE_THREAD("job worker");
+
+    pthread_mutex_lock(&jobs->lock);
+    for (;;)
+    {
+        while (!jobs->quit && (jobs->generation == generation))
+        {
+            pthread_cond_wait(&jobs->wake, &jobs->lock);
+        }
+
+        if (jobs->quit)
+        {
+            break;
+        }
+
+        generation = jobs->generation;
+        pthread_mutex_unlock(&jobs->lock);
+
+        work_jobs(jobs, worker->deque);
+
+        pthread_mutex_lock(&jobs->lock);
+    }
+    pthread_mutex_unlock(&jobs->lock);
+
+    return NULL;
+}
+
+Result create_job_system(JobSystem **jobs, size_t workers)
+{
+    assert(jobs != NULL);
+
+    Result res = SUCCESS;
+
+    if (workers > JOB_MAX_WORKERS)
+    {
+        res = FAILED;
+        return res;
+    }
+
+    JobSystem *n_jobs = (JobSystem *)TRACKED_ALIGNED_CALLOC(CACHE_LINE, sizeof(JobSystem));
+    if (n_jobs == NULL)
+    {
+        res = FAILED;
+        return res;
+    }
+
+    *n_jobs = (JobSystem){0};
+    pthread_mutex_init(&n_jobs->lock, NULL);
+    pthread_cond_init(&n_jobs->wake, NULL);
+
+    for (size_t i = 0u; i < workers; ++i)
+    {
+        Worker *worker = &n_jobs->workers[i];
+        worker->system = n_jobs;
+        worker->deque = i + 1u;
+        if (pthread_create(&worker->thread, NULL, run_worker, worker) != 0)
+        {
+            res = FAILED;
+            destroy_job_system(n_jobs);
+            return res;
+        }
+        worker->started = true;
+        ++n_jobs->worker_count;
+    }
+
+    // assign the job system to the user supplied pointer
+    *jobs = n_jobs;
+    return res;
+}
+
+void destroy_job_system(JobSystem *jobs)
+{
+    if (jobs == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&jobs->lock);
+    jobs->quit = true;
+    pthread_cond_broadcast(&jobs->wake);
+    pthread_mutex_unlock(&jobs->lock);
+
+    for (size_t i = 0u; i < JOB_MAX_WORKERS; ++i)
+    {
+        if (jobs->workers[i].started)
+        {
+            pthread_join(jobs->workers[i].thread, NULL);
+        }
+    }
+
+    pthread_cond_destroy(&jobs->wake);
+    pthread_mutex_destroy(&jobs->lock);
+    free_tracked(jobs);
+}
+
+Result pin_job_workers(JobSystem *jobs, uint32_t first_core, int32_t fifo_priority)
+{
+    assert(jobs != NULL);
+
+    if ((first_core + jobs->worker_count) > CPU_SETSIZE)
+    {
+        return FAILED;
+    }
+
+    Result result = SUCCESS;
+    for (size_t i = 0u; i < jobs->worker_count; ++i)
+    {
+        cpu_set_t cores;
+        CPU_ZERO(&cores);
+        CPU_SET(first_core + i, &cores);
+        if (pthread_setaffinity_np(jobs->workers[i].thread, sizeof(cores), &cores) != 0)
+        {
+            result = FAILED;
+        }
+
+        const struct sched_param param = {.sched_priority = fifo_priority};
+        if ((fifo_priority > 0) && (pthread_setschedparam(jobs->workers[i].thread, SCHED_FIFO, &param) != 0))
+        {
+            result = FAILED;
+        }
+    }
+
+    return result;
+}
+
+size_t get_job_threads(const JobSystem *jobs)
+{
+    assert(jobs != NULL);
+
+    return jobs->worker_count + 1u;
+}
+
+Result add_job(
+    JobSystem *jobs,
+    JobFunction function,
+    void *data,
+    size_t index,
+    const JobId *dependencies,
+    size_t dependency_count,
+    JobId *id)
+{
+    assert(jobs != NULL);
+    assert(function != NULL);
+    assert((dependencies != NULL) || (dependency_count == 0u));
+
+    Result result = SUCCESS;
+
+    if ((jobs->job_count == JOB_MAX_JOBS) || (dependency_count > (JOB_MAX_DEPENDENCIES - jobs->edge_count)))
+    {
+        result = FAILED;
+        return result;
+    }
+
+    const JobId n_id = jobs->job_count++;
+    Job *job = &jobs->jobs[n_id];
+    job->function = function;
+    job->data = data;
+    job->index = index;
+    job->root = (dependency_count == 0u);
+    job->first_dependent = NO_EDGE;
+    atomic_store_explicit(&job->pending, (unsigned int)dependency_count, memory_order_relaxed);
+
+    // only jobs added earlier can be waited on, so the graph can't have cycles
+    for (size_t i = 0u; i < dependency_count; ++i)
+    {
+        assert(dependencies[i] < n_id);
+
+        Job *dependency = &jobs->jobs[dependencies[i]];
+        const uint32_t edge = jobs->edge_count++;
+        jobs->edges[edge] = (Edge){.job = n_id, .next = dependency->first_dependent};
+        dependency->first_dependent = edge;
+    }
+
+    if (id != NULL)
+    {
+        *id = n_id;
+    }
+
+    return result;
+}
+
+void run_jobs(JobSystem *jobs)
+{
+    assert(jobs != NULL);
+
+    if (jobs->job_count == 0u)
+    {
+        return;
+    }
+
+    // a worker still leaving the last run may pick up jobs as soon as they are pushed, so count them first
+    atomic_store_explicit(&jobs->remaining, jobs->job_count, memory_order_release);
+
+    for (JobId id = 0u; id < jobs->job_count; ++id)
+    {
+        if (jobs->jobs[id].root)
+        {
+            push_deque(&jobs->deques[0], id);
+        }
+    }
+
+    if (jobs->worker_count > 0u)
+    {
+        pthread_mutex_lock(&jobs->lock);
+        ++jobs->generation;
+        pthread_cond_broadcast(&jobs->wake);
+        pthread_mutex_unlock(&jobs->lock);
+    }
+
+    work_jobs(jobs, 0u);
+
+    jobs->job_count = 0u;
+    jobs->edge_count = 0u;
+}
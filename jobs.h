@@ -0,0 +1,158 @@
+#ifndef _JOBS_H_
+#define _JOBS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "result.h"
+
+/**
+ * Jobs splits work within a frame across worker threads.
+ *
+ * A frame's work is added as a graph of jobs, each job may wait for earlier jobs to finish first. Running the graph
+ * pushes every job without pending dependencies onto a worker's deque, workers pop from their own deque and steal from
+ * the others when it is empty. Finishing a job pushes the dependents it released onto the deque of the thread that
+ * finished it. The thread calling run_jobs works too, so a system with no workers runs everything on the caller.
+ *
+ * Jobs run in no particular order, so for results to be deterministic each job must write its own part of the output
+ * and anything combining the parts must be a job depending on all of them that merges them in a fixed order.
+ *
+ * Jobs live in a fixed pool that is emptied by each run, adding and running jobs never allocates.
+ */
+
+/**
+ * Most jobs in one run.
+ */
+#define JOB_MAX_JOBS 1024u
+
+/**
+ * Most dependencies across all jobs in one run.
+ */
+#define JOB_MAX_DEPENDENCIES 4096u
+
+/**
+ * Most worker threads, not counting the thread calling run_jobs.
+ */
+#define JOB_MAX_WORKERS 15u
+
+/**
+ * Job system internal data.
+ */
+typedef struct JobSystem JobSystem;
+
+/**
+ * Identifies a job added in the current run.
+ */
+typedef uint32_t JobId;
+
+/**
+ * Work done by a job.
+ *
+ * @param data
+ *   Data given when the job was added.
+ *
+ * @param index
+ *   Index given when the job was added, so one function and data can be split into many jobs.
+ */
+typedef void (*JobFunction)(void *data, size_t index);
+
+/**
+ * Create a new job system and start its workers.
+ *
+ * @param jobs
+ *   Created job system.
+ *
+ * @param workers
+ *   Number of worker threads, at most JOB_MAX_WORKERS. 0 runs every job on the thread calling run_jobs.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result create_job_system(JobSystem **jobs, size_t workers);
+
+/**
+ * Stop the workers and destroy a job system.
+ *
+ * @param jobs
+ *   Job system to destroy.
+ */
+void destroy_job_system(JobSystem *jobs);
+
+/**
+ * Keep each worker on a core of its own, worker i on first_core + i, so they don't land on the core of the thread
+ * calling run_jobs.
+ *
+ * @param jobs
+ *   Job system to pin.
+ *
+ * @param first_core
+ *   Core for the first worker.
+ *
+ * @param fifo_priority
+ *   SCHED_FIFO priority to run the workers at, 0 to leave them on the normal scheduler.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if any worker couldn't be pinned or given the priority, the rest are still done
+ */
+Result pin_job_workers(JobSystem *jobs, uint32_t first_core, int32_t fifo_priority);
+
+/**
+ * Get the number of threads jobs run on, including the thread calling run_jobs. Useful for choosing how finely to
+ * split work.
+ *
+ * @param jobs
+ *   Job system to query.
+ *
+ * @returns
+ *   Number of threads.
+ */
+size_t get_job_threads(const JobSystem *jobs);
+
+/**
+ * Add a job to the next run.
+ *
+ * @param jobs
+ *   Job system to add to.
+ *
+ * @param function
+ *   Work to do.
+ *
+ * @param data
+ *   Passed to function.
+ *
+ * @param index
+ *   Passed to function.
+ *
+ * @param dependencies
+ *   Jobs from this run that must finish before this one starts, may be NULL if dependency_count is 0.
+ *
+ * @param dependency_count
+ *   Number of dependencies.
+ *
+ * @param id
+ *   Out parameter for the job's id, may be NULL.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the run has no room for the job or its dependencies
+ */
+Result add_job(
+    JobSystem *jobs,
+    JobFunction function,
+    void *data,
+    size_t index,
+    const JobId *dependencies,
+    size_t dependency_count,
+    JobId *id);
+
+/**
+ * Run every job added since the last run and wait for them all to finish.
+ *
+ * @param jobs
+ *   Job system to run.
+ */
+void run_jobs(JobSystem *jobs);
+
+#endif
@@ -18,6 +18,8 @@ typedef enum Key
     ESCAPE_K,
     LEFT_K,
     RIGHT_K,
+    REWIND_K,
+    TRACE_K,
 } Key;
 
 /**
@@ -0,0 +1,57 @@
+#ifndef _LEVEL_H_
+#define _LEVEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "game.h"
+
+/**
+ * Levels baked into the program at build time.
+ *
+ * breakout_bake turns the level descriptions in levels/ into constant arrays: every brick as it is played and the brick
+ * grid already sorted into cells. They live in the program's read only data, so a game made from one parses nothing and
+ * allocates nothing per brick, and every process running the program shares the same pages.
+ */
+
+/**
+ * A level as breakout_bake writes it.
+ */
+typedef struct BakedLevel
+{
+    // name of the description file without its extension
+    const char *name;
+
+    Scalar width;
+    Scalar height;
+
+    // bricks in the order they are described, brick i of the game is bricks[i]
+    const Entity *bricks;
+    size_t brick_count;
+
+    // brick grid with GAME_CELL_SIZE cells, cell c holds cell_bricks[cell_start[c]] up to (not including)
+    // cell_bricks[cell_start[c + 1]]
+    const uint32_t *cell_start;
+    size_t cell_count;
+    const uint32_t *cell_bricks;
+
+    // runs of bricks sliding back and forth, NULL and 0 if none do
+    const BrickMotion *motions;
+    size_t motion_count;
+
+    // bit i is set when brick i grows back regrow_delay steps after being destroyed, NULL if none do
+    const uint64_t *brick_regrow;
+    uint32_t regrow_delay;
+} BakedLevel;
+
+/**
+ * Every baked level, in the order breakout_bake was given them.
+ */
+extern const BakedLevel *const baked_levels[];
+
+/**
+ * Number of baked levels.
+ */
+extern const size_t baked_level_count;
+
+#endif
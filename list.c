@@ -2,6 +2,7 @@
 #include <assert.h>
 #include <stdlib.h>
 
+#include "alloc.h"
 #include "list.h"
 #include "result.h"
 /**
@@ -18,11 +19,12 @@ typedef struct Node
 } Node;
 
 /**
- * List struct store head of list.
+ * List struct store head of list, and the last node so pushing doesn't have to walk the list.
  */
 typedef struct List
 {
     Node *head;
+    Node *tail;
 } List;
 
 /**
@@ -41,7 +43,7 @@ Result create_list(List **list)
 
     // allocate multiple blocks of memory each of the same size all bytes is set to 1u(unisgned value with single bit 0 set)
 
-    List *n_list = (List *)calloc(sizeof(List), 1u);
+    List *n_list = (List *)TRACKED_CALLOC(1u, sizeof(List));
     if (n_list == NULL)
     {
         // Failed to allocaten_list
@@ -51,14 +53,15 @@ Result create_list(List **list)
     }
 
     // allocate the head node
-    n_list->head = (Node *)calloc(sizeof(Node), 1u);
+    n_list->head = (Node *)TRACKED_CALLOC(1u, sizeof(Node));
 
-    if (n_list == NULL)
+    if (n_list->head == NULL)
     {
         result = FAILED;
         destory_list(n_list);
         return result;
     }
+    n_list->tail = n_list->head;
     // user pointer
     *list = n_list;
 
@@ -78,7 +81,7 @@ void destory_list(List *list)
     // if current node dtor is not null call it on value
     // free curr node
     // set curr to next(advance)
-    do
+    while (curr != NULL)
     {
         Node *next = curr->next;
 
@@ -86,12 +89,12 @@ void destory_list(List *list)
         {
             curr->dtor(curr->value);
         }
-        free(curr);
+        free_tracked(curr);
         curr = next;
-    } while (curr != NULL);
+    }
 
     // free list
-    free(list);
+    free_tracked(list);
 }
 
 Result push(List *list, void *value)
@@ -104,13 +107,9 @@ Result _push(List *list, void *value, void (*dtor)(void *))
     assert(list != NULL);
 
     Result result = SUCCESS;
-    Node *curr = list->head;
-    while (curr->next != NULL)
-    {
-        curr = curr->next;
-    }
+    Node *curr = list->tail;
 
-    Node *n_node = (Node *)calloc(sizeof(Node), 1u);
+    Node *n_node = (Node *)TRACKED_CALLOC(1u, sizeof(Node));
 
     if (n_node == NULL)
     {
@@ -122,6 +121,7 @@ Result _push(List *list, void *value, void (*dtor)(void *))
     curr->next = n_node;
     n_node->value = value;
     n_node->dtor = dtor;
+    list->tail = n_node;
     return result;
 }
 
@@ -149,8 +149,14 @@ void remove_node(List *list, const ListIter *iter)
             trash->dtor(trash->value);
         }
 
+        // removing the last node makes the previous one the tail
+        if (trash == list->tail)
+        {
+            list->tail = curr;
+        }
+
         // delete trash node
-        free(trash);
+        free_tracked(trash);
         // reconnect the curr node to next next
         curr->next = next;
     }
@@ -162,7 +168,7 @@ Result create_iter(const List *list, ListIter **iter)
     assert(iter != NULL);
 
     Result result = SUCCESS;
-    ListIter *n_iter = (ListIter *)calloc(sizeof(ListIter), 1u);
+    ListIter *n_iter = (ListIter *)TRACKED_CALLOC(1u, sizeof(ListIter));
 
     if (n_iter == NULL)
     {
@@ -178,7 +184,7 @@ Result create_iter(const List *list, ListIter **iter)
 
 void destroy_iter(ListIter *iter)
 {
-    free(iter);
+    free_tracked(iter);
 }
 
 void next_node(ListIter **iter)
@@ -1,21 +1,58 @@
 #include <assert.h>
+#include <math.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include "list.h"
+#include <string.h>
+#include <unistd.h>
+
+#include "alloc.h"
+#include "audio.h"
+#include "autopilot.h"
+#include "camera.h"
+#include "game.h"
+#include "jobs.h"
+#include "metrics.h"
+#include "netplay.h"
+#include "particle.h"
+#include "realtime.h"
+#include "replay.h"
+#include "rewind.h"
+#include "scene.h"
+#include "session.h"
+#include "spectate.h"
+#include "stream.h"
+#include "telemetry.h"
+#include "timer.h"
+#include "trace.h"
 #include "window.h"
 
 /**
- * Struct encapsulating the data for a renderable entity.
+ * Number of frames kept for the HUD frame time graph.
  */
-typedef struct Entity
-{
-    Block block;
-    uint8_t r;
-    uint8_t g;
-    uint8_t b;
-} Entity;
+#define FRAME_HISTORY 120u
+
+/**
+ * Physics rate, the game advances this many steps per second of real time regardless of frame rate.
+ */
+#define STEPS_PER_SECOND 1000u
+
+/**
+ * Most steps run in one frame, after a longer stall the game slows down instead of trying to catch up.
+ */
+#define MAX_STEPS_PER_FRAME 250u
+
+/**
+ * Seconds of play kept for rewinding.
+ */
+#define REWIND_SECONDS 30u
+
+/**
+ * How long a finished netplay game keeps answering the other side, so it can see every input arrived.
+ */
+#define NETPLAY_LINGER_NS 500000000u
 
 /**
  * Helper macro for checking if a value is SUCCESS. If not it prints a FAILED
@@ -32,315 +69,1425 @@ typedef struct Entity
     } while (false)
 
 /**
- * Helper function to create a row of ten bricks.
- *
- * @param entities
- *   List to store entities in.
+ * Command line options.
+ */
+typedef struct Options
+{
+    // run without a window as fast as possible, silent unless SDL_AUDIODRIVER picks an audio driver
+    bool headless;
+    // let the autopilot drive the paddle instead of the keyboard
+    bool autopilot;
+    // stop after this many steps, 0 for no limit
+    uint64_t max_steps;
+    // size of a generated square world, 0 for the built in level
+    uint32_t world_size;
+    // name of a level in levels/ to play instead of the built in one, NULL for the built in level
+    const char *level_name;
+    // level file to stream, written first when world_size is set, and the memory to stream it in
+    const char *stream_path;
+    size_t stream_budget;
+    // play versus against another process, with this side playing options.player
+    bool netplay;
+    uint32_t player;
+    const char *peer;
+    uint16_t port;
+    uint32_t latency_ms;
+    uint32_t loss_percent;
+    // what to do about allocations once the game is running
+    AllocGuard alloc_guard;
+    // threads to split frame work across, 0 for one per core
+    uint32_t threads;
+    // session file to record the keys played into
+    const char *record_path;
+    // seekable archive to record the game into
+    const char *archive_path;
+    // file to dump traced zones to
+    const char *trace_path;
+    // shared memory name to publish live statistics under for breakout_stat, NULL to publish none
+    const char *telemetry_name;
+    // lock and prefault memory, and with pin_core pin the game to a core and the job workers to the ones after it.
+    // Threads run SCHED_FIFO at fifo_priority when it isn't 0
+    bool low_jitter;
+    int32_t pin_core;
+    int32_t fifo_priority;
+    // games to play one after another, each with its own power-up seed
+    uint64_t games;
+    // metrics file to stream statistics into, with a steps row every metrics_every steps or none for 0
+    const char *metrics_path;
+    uint32_t metrics_every;
+    // games to play at once on background threads and watch as tiles, 0 to play one game normally
+    uint32_t spectate;
+} Options;
+
+/**
+ * Running totals for the game being played, for the metrics.
+ */
+typedef struct EpisodeTotals
+{
+    uint64_t bricks;
+    uint64_t paddle_hits;
+    uint64_t misses;
+} EpisodeTotals;
+
+/**
+ * Set by SIGUSR1 to ask for a trace dump, so a game running in the field can be traced without touching it.
+ */
+static volatile sig_atomic_t trace_requested = 0;
+
+/**
+ * Helper function to parse the command line.
  *
- * @param y
- *   Y coordinate of row.
+ * @param argc
+ *   Number of arguments.
  *
- * @param r
- *   Red component of brick colour.
+ * @param argv
+ *   Arguments.
  *
- * @param g
- *   Green component of brick colour.
+ * @param options
+ *   Out parameter for parsed options.
  *
- * @param b
- *  Blue component of brick colour.
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on an unknown argument
  */
-static void create_brick_row(List *entities, float y, uint8_t r, uint8_t g, uint8_t b)
+static Result parse_options(int argc, char *argv[], Options *options)
 {
-    float x = 20.0f;
+    *options = (Options){
+        .peer = "127.0.0.1",
+        .port = NETPLAY_DEFAULT_PORT,
+        .stream_budget = STREAM_DEFAULT_BUDGET,
+        .pin_core = -1,
+        .games = 1u,
+        .metrics_every = 1u};
 
-    for (int i = 0; i < 10; ++i)
+    for (int i = 1; i < argc; ++i)
     {
-        Entity *e = (Entity *)calloc(sizeof(Entity), 1u);
-        e->block.position.x = x;
-        e->block.position.y = y;
-        e->block.width = 58.0f;
-        e->block.height = 20.0f;
-        e->r = r;
-        e->g = g;
-        e->b = b;
+        if (strcmp(argv[i], "--headless") == 0)
+        {
+            options->headless = true;
+        }
+        else if (strcmp(argv[i], "--autopilot") == 0)
+        {
+            options->autopilot = true;
+        }
+        else if ((strcmp(argv[i], "--steps") == 0) && ((i + 1) < argc))
+        {
+            options->max_steps = strtoull(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(argv[i], "--world") == 0) && ((i + 1) < argc))
+        {
+            options->world_size = (uint32_t)strtoul(argv[++i], NULL, 10);
+            if (options->world_size < 800u)
+            {
+                printf("world size must be at least 800\n");
+                return FAILED;
+            }
+        }
+        else if ((strcmp(argv[i], "--level") == 0) && ((i + 1) < argc))
+        {
+            options->level_name = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--netplay") == 0) && ((i + 1) < argc))
+        {
+            options->netplay = true;
+            options->player = (uint32_t)strtoul(argv[++i], NULL, 10);
+            if (options->player >= GAME_MAX_PLAYERS)
+            {
+                printf("netplay player must be 0 or 1\n");
+                return FAILED;
+            }
+        }
+        else if ((strcmp(argv[i], "--peer") == 0) && ((i + 1) < argc))
+        {
+            options->peer = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--port") == 0) && ((i + 1) < argc))
+        {
+            options->port = (uint16_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(argv[i], "--latency") == 0) && ((i + 1) < argc))
+        {
+            options->latency_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(argv[i], "--loss") == 0) && ((i + 1) < argc))
+        {
+            options->loss_percent = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(argv[i], "--threads") == 0) && ((i + 1) < argc))
+        {
+            options->threads = (uint32_t)strtoul(argv[++i], NULL, 10);
+            if (options->threads > (JOB_MAX_WORKERS + 1u))
+            {
+                printf("at most %u threads\n", JOB_MAX_WORKERS + 1u);
+                return FAILED;
+            }
+        }
+        else if ((strcmp(argv[i], "--stream") == 0) && ((i + 1) < argc))
+        {
+            options->stream_path = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--stream-budget") == 0) && ((i + 1) < argc))
+        {
+            options->stream_budget = (size_t)strtoul(argv[++i], NULL, 10) * 1024u * 1024u;
+        }
+        else if ((strcmp(argv[i], "--trace") == 0) && ((i + 1) < argc))
+        {
+            options->trace_path = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--telemetry") == 0) && ((i + 1) < argc))
+        {
+            options->telemetry_name = argv[++i];
+            if (options->telemetry_name[0] != '/')
+            {
+                printf("telemetry name must start with /\n");
+                return FAILED;
+            }
+        }
+        else if ((strcmp(argv[i], "--record") == 0) && ((i + 1) < argc))
+        {
+            options->record_path = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--archive") == 0) && ((i + 1) < argc))
+        {
+            options->archive_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--low-jitter") == 0)
+        {
+            options->low_jitter = true;
+        }
+        else if ((strcmp(argv[i], "--pin") == 0) && ((i + 1) < argc))
+        {
+            options->pin_core = (int32_t)strtol(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(argv[i], "--fifo") == 0) && ((i + 1) < argc))
+        {
+            options->fifo_priority = (int32_t)strtol(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(argv[i], "--games") == 0) && ((i + 1) < argc))
+        {
+            options->games = strtoull(argv[++i], NULL, 10);
+            if (options->games == 0u)
+            {
+                printf("at least 1 game\n");
+                return FAILED;
+            }
+        }
+        else if ((strcmp(argv[i], "--metrics") == 0) && ((i + 1) < argc))
+        {
+            options->metrics_path = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--metrics-every") == 0) && ((i + 1) < argc))
+        {
+            options->metrics_every = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(argv[i], "--spectate") == 0) && ((i + 1) < argc))
+        {
+            options->spectate = (uint32_t)strtoul(argv[++i], NULL, 10);
+            if ((options->spectate == 0u) || (options->spectate > SPECTATE_MAX_GAMES))
+            {
+                printf("spectate 1 to %u games\n", SPECTATE_MAX_GAMES);
+                return FAILED;
+            }
+        }
+        else if ((strcmp(argv[i], "--alloc-guard") == 0) && ((i + 1) < argc))
+        {
+            ++i;
+            if (strcmp(argv[i], "report") == 0)
+            {
+                options->alloc_guard = ALLOC_GUARD_REPORT;
+            }
+            else if (strcmp(argv[i], "abort") == 0)
+            {
+                options->alloc_guard = ALLOC_GUARD_ABORT;
+            }
+            else
+            {
+                printf("alloc guard must be report or abort\n");
+                return FAILED;
+            }
+        }
+        else
+        {
+            printf(
+                "usage: %s [--headless] [--autopilot] [--steps N] [--world SIZE | --level NAME] [--threads N]\n"
+                "          [--stream PATH [--stream-budget MB]] [--record PATH] [--archive PATH] [--trace PATH]\n"
+                "          [--alloc-guard report|abort] [--low-jitter [--pin CORE] [--fifo PRIORITY]]\n"
+                "          [--games N] [--metrics PATH [--metrics-every STEPS]] [--spectate N] [--telemetry NAME]\n"
+                "          [--netplay PLAYER [--peer ADDRESS] [--port BASE] [--latency MS] [--loss PERCENT]]\n",
+                argv[0]);
+            return FAILED;
+        }
+    }
 
-        CHECK_SUCCESS(_push(entities, e, &free), "failed to add brick\n");
+    if (options->netplay && (options->stream_path != NULL))
+    {
+        printf("streamed levels are single player\n");
+        return FAILED;
+    }
 
-        x += 78.0f;
+    if (((options->record_path != NULL) || (options->archive_path != NULL)) &&
+        (options->netplay || (options->stream_path != NULL)))
+    {
+        printf("only single player games of the built in or a generated level can be recorded\n");
+        return FAILED;
+    }
+
+    if ((options->games > 1u) && (!options->headless || options->netplay || (options->stream_path != NULL) ||
+                                  (options->record_path != NULL) || (options->archive_path != NULL)))
+    {
+        printf("several games can only be played headless, on the built in or a generated level, unrecorded\n");
+        return FAILED;
+    }
+
+    if ((options->level_name != NULL) &&
+        ((options->world_size != 0u) || options->netplay || (options->stream_path != NULL) ||
+         (options->record_path != NULL) || (options->archive_path != NULL) || (options->spectate != 0u)))
+    {
+        printf("a named level is played on its own by one player, unrecorded\n");
+        return FAILED;
     }
+
+    if ((options->spectate != 0u) &&
+        (options->headless || options->netplay || (options->world_size != 0u) || (options->stream_path != NULL) ||
+         (options->record_path != NULL) || (options->archive_path != NULL) || (options->games > 1u) ||
+         (options->metrics_path != NULL)))
+    {
+        printf("spectating plays the built in level in a window, unrecorded\n");
+        return FAILED;
+    }
+
+    return SUCCESS;
 }
 
 /**
- * Helper function to update the ball.
+ * Helper function to create a game of the built in, a named or a generated level.
+ *
+ * @param options
+ *   Parsed options giving the level.
  *
- * @param ball
- *   Entity for ball.
+ * @param game
+ *   Created game.
  *
- * @param ball_velocity
- *   Velocity of ball.
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
  */
-static void update_ball(Entity *ball, Vector2D *ball_velocity)
+static Result create_level(const Options *options, Game **game)
 {
-    add_vec(&ball->block.position, ball_velocity);
+    if (options->level_name != NULL)
+    {
+        return create_baked_game(game, options->level_name);
+    }
 
-    // if ball does out of the screen then invert the y velocity
-    if ((ball->block.position.y < 0.0f) || (ball->block.position.y > 800.0f))
+    if (options->world_size == 0u)
     {
-        ball_velocity->y *= -1.0f;
+        return create_game(game);
     }
 
-    if ((ball->block.position.x < 0.0f) || (ball->block.position.x > 800.0f))
+    return create_large_game(game, scalar_from_int((int32_t)options->world_size));
+}
+
+/**
+ * Helper function to add up a step for the metrics, and write a steps row every so often and a row for each miss.
+ *
+ * @param metrics
+ *   Metrics to write to.
+ *
+ * @param game
+ *   Game after the step.
+ *
+ * @param outcome
+ *   What happened during the step.
+ *
+ * @param episode
+ *   Game being played, counted from 0.
+ *
+ * @param options
+ *   Parsed options giving how often to write a steps row and the player.
+ *
+ * @param totals
+ *   Totals for the game to add the step to.
+ */
+static void record_step_metrics(
+    MetricsWriter *metrics,
+    const Game *game,
+    const StepOutcome *outcome,
+    uint64_t episode,
+    const Options *options,
+    EpisodeTotals *totals)
+{
+    uint64_t bricks = outcome->blasted_count;
+    uint64_t paddle_hits = 0u;
+    for (uint32_t i = 0u; i < outcome->collision_count; ++i)
     {
-        ball_velocity->x *= -1.0f;
+        bricks += (outcome->collisions[i].kind == COLLISION_BRICK) ? 1u : 0u;
+        paddle_hits += (outcome->collisions[i].kind == COLLISION_PADDLE) ? 1u : 0u;
+    }
+    totals->bricks += bricks;
+    totals->paddle_hits += paddle_hits;
+
+    const Entity *ball = &game->state.ball;
+    if (outcome->missed)
+    {
+        ++totals->misses;
+
+        const int64_t row[MISS_METRICS] = {
+            [MISS_METRIC_EPISODE] = (int64_t)episode,
+            [MISS_METRIC_STEP] = (int64_t)game->state.step,
+            [MISS_METRIC_PLAYER] = (int64_t)outcome->player,
+            [MISS_METRIC_X] = llround((double)scalar_to_float(ball->block.position.x) * 1000.0),
+            [MISS_METRIC_Y] = llround((double)scalar_to_float(ball->block.position.y) * 1000.0)};
+        add_metrics_row(metrics, METRICS_MISSES, row);
+    }
+
+    if ((options->metrics_every != 0u) && ((game->state.step % options->metrics_every) == 0u))
+    {
+        const double vx = (double)scalar_to_float(game->state.ball_velocity.x);
+        const double vy = (double)scalar_to_float(game->state.ball_velocity.y);
+        const int64_t row[STEP_METRICS] = {
+            [STEP_METRIC_EPISODE] = (int64_t)episode,
+            [STEP_METRIC_STEP] = (int64_t)game->state.step,
+            [STEP_METRIC_BRICKS] = (int64_t)bricks,
+            [STEP_METRIC_PADDLE_HITS] = (int64_t)paddle_hits,
+            [STEP_METRIC_BALL_SPEED] = llround(sqrt((vx * vx) + (vy * vy)) * 1000.0),
+            [STEP_METRIC_SCORE] = (int64_t)game->state.scores[options->player]};
+        add_metrics_row(metrics, METRICS_STEPS, row);
     }
 }
 
-typedef struct CollosionResult
+/**
+ * Helper function to write the episodes row for a finished game.
+ *
+ * @param metrics
+ *   Metrics to write to.
+ *
+ * @param game
+ *   Finished game.
+ *
+ * @param episode
+ *   Game played, counted from 0.
+ *
+ * @param player
+ *   Player whose score to record.
+ *
+ * @param totals
+ *   Totals for the game.
+ */
+static void record_episode_metrics(
+    MetricsWriter *metrics, const Game *game, uint64_t episode, uint32_t player, const EpisodeTotals *totals)
 {
-    bool overlap;
-    float shift_b_x;
-    float shift_b_y;
-} CollosionResult;
+    const uint64_t steps = game->state.step;
+    const int64_t row[EPISODE_METRICS] = {
+        [EPISODE_METRIC_EPISODE] = (int64_t)episode,
+        [EPISODE_METRIC_STEPS] = (int64_t)steps,
+        [EPISODE_METRIC_BRICKS] = (int64_t)totals->bricks,
+        [EPISODE_METRIC_BRICK_RATE] =
+            (steps == 0u) ? 0 : (int64_t)((totals->bricks * STEPS_PER_SECOND * 1000u) / steps),
+        [EPISODE_METRIC_PADDLE_HITS] = (int64_t)totals->paddle_hits,
+        [EPISODE_METRIC_MISSES] = (int64_t)totals->misses,
+        [EPISODE_METRIC_SCORE] = (int64_t)game->state.scores[player]};
+    add_metrics_row(metrics, METRICS_EPISODES, row);
+}
 
 /**
- * Helper function to check if two entities are colliding.
+ * Helper function to react to what happened in a step with sound and effects, going through its collisions in one
+ * pass after the step.
+ *
+ * @param game
+ *   Game the step happened in.
  *
- * @param a
- *   First entity to check.
+ * @param outcome
+ *   What happened.
  *
- * @param b
- *   Second entity to check.
+ * @param audio
+ *   Audio to play sounds on, may be NULL.
+ *
+ * @param particles
+ *   Particle system to spawn brick debris in, may be NULL.
  *
  * @returns
- *   TCollosionResult : (overlap : true if collosion detedted)
+ *   Number of bricks and paddles hit, for the telemetry rates.
  */
-CollosionResult static check_collision(const Entity *a, const Entity *b)
+static uint32_t apply_outcome(const Game *game, const StepOutcome *outcome, Audio *audio, ParticleSystem *particles)
 {
-    bool overlap = false;
-    float shift_b_x, shift_b_y = 0.0f;
+    bool sounds[SOUND_COUNT] = {false};
+    uint32_t hits = 0u;
 
-    // b is the one that has to be displaced, and the a should remain in place.
-    if (!((a->block.position.x + a->block.width < b->block.position.x) || (b->block.position.x + b->block.width < a->block.position.x) || (a->block.position.y + a->block.height < b->block.position.y) || (b->block.position.y + b->block.height < a->block.position.y)))
+    for (uint32_t i = 0u; i < outcome->collision_count; ++i)
     {
-        overlap = true;
-        if ((a->block.position.x + a->block.width / 2) < (b->block.position.x + b->block.width / 2))
+        const CollisionEvent *event = &outcome->collisions[i];
+        if (event->kind == COLLISION_BRICK)
         {
-            // b to the right from the center of a; shift b to the right
-            shift_b_x = (a->block.position.x + a->block.width) - b->block.position.x;
+            if (particles != NULL)
+            {
+                const Entity *brick = get_brick(game, (size_t)event->other);
+                spawn_particle_burst(particles, &brick->block, brick->r, brick->g, brick->b, 48u);
+            }
+            sounds[BRICK_SOUND] = true;
+            ++hits;
         }
-        else
+        else if (event->kind == COLLISION_PADDLE)
         {
-            // b to the left from a; shift to the left
-            shift_b_x = a->block.position.x - (b->block.position.x + b->block.width);
+            sounds[PADDLE_SOUND] = true;
+            ++hits;
         }
-        if ((a->block.position.y + a->block.height / 2) < (b->block.position.y + b->block.height / 2))
+        else
         {
-            // same for y axis
-            shift_b_y = (a->block.position.y + a->block.height) - b->block.position.y;
+            sounds[WALL_SOUND] = true;
         }
-        else
+    }
+    sounds[PADDLE_SOUND] = sounds[PADDLE_SOUND] || (outcome->powerup >= 0);
+
+    // a chain reaction can take out dozens of bricks a step, so each gets a smaller burst
+    for (uint32_t i = 0u; (particles != NULL) && (i < outcome->blasted_count); ++i)
+    {
+        const Entity *brick = get_brick(game, (size_t)outcome->blasted[i]);
+        spawn_particle_burst(particles, &brick->block, brick->r, brick->g, brick->b, 12u);
+    }
+    sounds[BRICK_SOUND] = sounds[BRICK_SOUND] || (outcome->blasted_count > 0u);
+
+    // one of each sound a step however many things were hit
+    for (uint32_t sound = 0u; (audio != NULL) && (sound < SOUND_COUNT); ++sound)
+    {
+        if (sounds[sound])
         {
-            // same for y axis
-            shift_b_y = a->block.position.y - (b->block.position.y + b->block.height);
+            play_sound_audio(audio, (Sound)sound);
         }
     }
-    CollosionResult result = {overlap, shift_b_x, shift_b_y};
-    return result;
+
+    return hits;
 }
 
-static void ball_rebound(Entity *ball, CollosionResult *result, Vector2D *ball_velocity)
+/**
+ * Helper function to draw the HUD.
+ *
+ * @param window
+ *   Window to draw to.
+ *
+ * @param game
+ *   Game to show the score and lives of.
+ *
+ * @param player
+ *   Player playing on this screen.
+ *
+ * @param frame_times
+ *   Ring buffer of frame times in milliseconds.
+ *
+ * @param physics_times
+ *   Ring buffer of physics times in milliseconds.
+ *
+ * @param frame_index
+ *   Index of the current frame in the ring buffers.
+ *
+ * @param fps
+ *   Frames per second to show.
+ *
+ * @param frame_ms
+ *   Average frame time to show.
+ *
+ * @param rewinding
+ *   True if play is being rewound.
+ */
+static void draw_hud(
+    Window *window,
+    const Game *game,
+    uint32_t player,
+    const float *frame_times,
+    const float *physics_times,
+    size_t frame_index,
+    float fps,
+    float frame_ms,
+    bool rewinding)
 {
-    printf("Ball Postion : (%f,%f)\n", ball->block.position.x, ball->block.position.y);
+    char text[HUD_TEXT_LENGTH];
+    snprintf(text, sizeof(text), "SCORE %u", game->state.scores[player]);
+    CHECK_SUCCESS(draw_text_window(window, 0u, 10.0f, 10.0f, 3.0f, text, 0xff, 0xff, 0xff), "failed to draw hud\n");
+    snprintf(text, sizeof(text), "LIVES %u", game->state.lives[player]);
+    CHECK_SUCCESS(draw_text_window(window, 1u, 680.0f, 10.0f, 3.0f, text, 0xff, 0xff, 0xff), "failed to draw hud\n");
+    if (game->players > 1u)
+    {
+        const uint32_t rival = 1u - player;
+        snprintf(text, sizeof(text), "RIVAL %u  LIVES %u", game->state.scores[rival], game->state.lives[rival]);
+        CHECK_SUCCESS(
+            draw_text_window(window, 5u, 10.0f, 40.0f, 2.0f, text, 0x40, 0xc0, 0xff), "failed to draw hud\n");
+    }
+    snprintf(text, sizeof(text), "FPS %.0f  FRAME %.2fMS", fps, frame_ms);
+    CHECK_SUCCESS(draw_text_window(window, 2u, 10.0f, 740.0f, 2.0f, text, 0x80, 0xff, 0x80), "failed to draw hud\n");
+    if (is_game_over(game))
+    {
+        const bool won = (game->players > 1u) ? (game->state.lives[player] > 0u) && (game->state.lives[1u - player] == 0u)
+                                              : (game->state.lives[player] > 0u);
+        const char *message = won ? "YOU WIN" : "GAME OVER";
+        CHECK_SUCCESS(
+            draw_text_window(window, 3u, 310.0f, 390.0f, 5.0f, message, 0xff, 0x40, 0x40), "failed to draw hud\n");
+    }
+    if (rewinding)
+    {
+        CHECK_SUCCESS(
+            draw_text_window(window, 4u, 340.0f, 10.0f, 3.0f, "<< REWIND", 0x80, 0xc0, 0xff), "failed to draw hud\n");
+    }
+
+    // frame time in green with the physics share of it in orange on top
+    CHECK_SUCCESS(
+        draw_graph_window(
+            window,
+            10.0f,
+            755.0f,
+            240.0f,
+            40.0f,
+            frame_times,
+            FRAME_HISTORY,
+            frame_index + 1u,
+            10.0f,
+            0x40,
+            0xc0,
+            0x40),
+        "failed to draw hud\n");
+    CHECK_SUCCESS(
+        draw_graph_window(
+            window,
+            10.0f,
+            755.0f,
+            240.0f,
+            40.0f,
+            physics_times,
+            FRAME_HISTORY,
+            frame_index + 1u,
+            10.0f,
+            0xff,
+            0xa5,
+            0x00),
+        "failed to draw hud\n");
+}
 
-    float min_shift = abs(result->shift_b_x) < abs(result->shift_b_y) ? result->shift_b_x : result->shift_b_y;
+/**
+ * Helper function to ask for a trace dump, a signal handler.
+ *
+ * @param signal
+ *   Signal received.
+ */
+static void request_trace(int signal)
+{
+    (void)signal;
+    trace_requested = 1;
+}
 
-    if (abs(result->shift_b_x) == min_shift)
+/**
+ * Helper function to dump the trace and say where it went.
+ *
+ * @param path
+ *   File to write.
+ */
+static void write_trace(const char *path)
+{
+    if (dump_trace(path) == SUCCESS)
     {
-        result->shift_b_y = 0.0f;
-        printf("Shift ball y = 0\n");
+        printf("trace written to %s\n", path);
     }
     else
     {
-        printf("Shift ball x = 0\n");
-        result->shift_b_x = 0.0f;
+        printf("failed to write trace to %s\n", path);
     }
-    ball->block.position.x += result->shift_b_x;
-    ball->block.position.y += result->shift_b_y;
+}
+
+/**
+ * Helper function to print allocation totals and the call sites that allocated the most.
+ */
+static void print_alloc_report(void)
+{
+    AllocStats stats;
+    get_alloc_stats(&stats);
+    printf(
+        "allocations: %llu frees: %llu in use: %llu bytes peak: %llu bytes after load: %llu\n",
+        (unsigned long long)stats.allocations,
+        (unsigned long long)stats.frees,
+        (unsigned long long)stats.bytes_in_use,
+        (unsigned long long)stats.peak_bytes,
+        (unsigned long long)stats.guarded_allocations);
+
+    AllocSite sites[ALLOC_MAX_SITES];
+    const size_t count = get_alloc_sites(sites, ALLOC_MAX_SITES);
 
-    if (result->shift_b_x != 0)
+    // a handful of sites, sort by allocations so the busiest come first
+    for (size_t i = 1u; i < count; ++i)
     {
-        printf("reverse ball velocity on x\n");
-        ball_velocity->x = -ball_velocity->x;
+        const AllocSite site = sites[i];
+        size_t j = i;
+        for (; (j > 0u) && (sites[j - 1u].allocations < site.allocations); --j)
+        {
+            sites[j] = sites[j - 1u];
+        }
+        sites[j] = site;
     }
-    if (result->shift_b_y != 0)
+
+    for (size_t i = 0u; (i < count) && (i < 8u); ++i)
     {
-        printf("reverse ball velocity on y\n");
-        ball_velocity->y = -ball_velocity->y;
+        printf(
+            "  %s:%d %llu allocations %llu bytes\n",
+            sites[i].file,
+            sites[i].line,
+            (unsigned long long)sites[i].allocations,
+            (unsigned long long)sites[i].bytes);
     }
 }
 
 /**
- * Helper function to handle collisions between the ball and other entities.
+ * Helper function to play a batch of games on background threads and watch them all in the window until it is closed.
  *
- * @param entities
- *   List of all entities.
+ * @param options
+ *   Parsed options giving the number of games, the threads to play them on and when to start a game again.
  *
- * @param ball
- *   Ball entity.
- *
- * @param ball_velocity
- *   The velocity of the ball.
- *
- * @param paddle
- *   Paddle entity.
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
  */
-static void handle_collisions(List *entities, Entity *ball, Vector2D *ball_velocity, const Entity *paddle)
+static Result run_spectator(const Options *options)
 {
-    // keep iterator scoped so we can't use it after it's been destroyed
+    Result res = SUCCESS;
+    Window *window = NULL;
+    Spectator *spectator = NULL;
+
+    // this thread draws, the games get the rest of the cores
+    size_t threads = options->threads;
+    if (threads == 0u)
     {
-        ListIter *iter;
-        CHECK_SUCCESS(create_iter(entities, &iter), "could not create iterator\n");
+        const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cores > 1) ? ((size_t)cores - 1u) : 1u;
+    }
 
-        // move past ball and paddle
-        next_node(&iter);
-        next_node(&iter);
+    if ((create_window(&window) != SUCCESS) ||
+        (create_spectator(&spectator, options->spectate, threads, options->max_steps) != SUCCESS) ||
+        (reserve_window_quads(window, get_spectator_rect_capacity(spectator)) != SUCCESS))
+    {
+        res = FAILED;
+        goto done;
+    }
 
-        // see if the ball intersects with any bricks
-        while (!is_iter_end(iter))
-        {
-            Entity *block = (Entity *)iter_value(iter);
+    KeyEvent event;
+    bool running = true;
+    const uint64_t start = get_time_ns();
+    uint64_t rate_start = start;
+    uint64_t rate_steps = 0u;
+    float steps_per_second = 0.0f;
+    uint64_t frames = 0u;
 
-            CollosionResult result = check_collision(block, ball);
-            if (result.overlap)
+    while (running)
+    {
+        Result event_result = SUCCESS;
+        while ((event_result = get_window_event(window, &event)) == SUCCESS)
+        {
+            if ((event.key_state == K_DOWN) && (event.key == ESCAPE_K))
             {
-                remove_node(entities, iter);
-                ball_rebound(ball, &result, ball_velocity);
-                // if we modify the list this will invalidate the iterator, so stop
-                break;
+                running = false;
+            }
+            else if ((event.key_state == K_DOWN) && (event.key == TRACE_K))
+            {
+                trace_requested = 1;
             }
+        }
+        if (event_result == FAILED)
+        {
+            printf("error getting event\n");
+        }
 
-            next_node(&iter);
+        SpectatorStats stats;
+        get_spectator_stats(spectator, &stats);
+        const uint64_t now = get_time_ns();
+        if ((now - rate_start) >= 1000000000u)
+        {
+            steps_per_second = (float)(stats.steps - rate_steps) / ((float)(now - rate_start) / 1000000000.0f);
+            rate_steps = stats.steps;
+            rate_start = now;
         }
 
-        destroy_iter(iter);
-    }
+        if ((pre_render_window(window) != SUCCESS) || (draw_spectator(spectator, window) != SUCCESS))
+        {
+            res = FAILED;
+            goto done;
+        }
 
-    // handle ball - paddle collision
-    CollosionResult result = check_collision(paddle, ball);
-    if (result.overlap)
-    {
-        ball_rebound(ball, &result, ball_velocity);
+        char text[HUD_TEXT_LENGTH];
+        snprintf(
+            text,
+            sizeof(text),
+            "%u GAMES  %.2fM STEPS/S  %llu DONE",
+            options->spectate,
+            steps_per_second / 1000000.0f,
+            (unsigned long long)stats.finished);
+        if (draw_text_window(window, 0u, 10.0f, 780.0f, 2.0f, text, 0x80, 0xff, 0x80) != SUCCESS)
+        {
+            res = FAILED;
+            goto done;
+        }
+
+        post_render_window(window);
+        ++frames;
+
+        if (trace_requested && (options->trace_path != NULL))
+        {
+            trace_requested = 0;
+            write_trace(options->trace_path);
+        }
     }
+
+    SpectatorStats stats;
+    get_spectator_stats(spectator, &stats);
+    const float seconds = (float)(get_time_ns() - start) / 1000000000.0f;
+    printf(
+        "spectated %u games: steps: %llu finished: %llu frames: %llu time: %.3fs (%.0f steps/s)\n",
+        options->spectate,
+        (unsigned long long)stats.steps,
+        (unsigned long long)stats.finished,
+        (unsigned long long)frames,
+        seconds,
+        (seconds > 0.0f) ? ((float)stats.steps / seconds) : 0.0f);
+
+done:
+    destroy_spectator(spectator);
+    destroy_window(window);
+    return res;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+    Options options;
+    if (parse_options(argc, argv, &options) != SUCCESS)
+    {
+        return 1;
+    }
+
     printf("Game Starting\n");
 
-    Entity paddle = {
-        .block = create_block_xy(100.0f, 780.0f, 100.0f, 20.0f), .r = 0xff, .g = 0xff, .b = 0xff};
-    Entity ball = {.block = create_block_xy(420.0f, 400.0f, 10.0f, 10.0f), .r = 0xff, .g = 0xff, .b = 0xff};
+    // zones are only recorded when compiled in, the game runs the same without them
+    if (options.trace_path != NULL)
+    {
+        if (start_trace() == SUCCESS)
+        {
+            TRACE_THREAD("main");
+            signal(SIGUSR1, request_trace);
+        }
+        else
+        {
+            printf("failed to start tracing, zones are only recorded when built with BREAKOUT_TRACE\n");
+            options.trace_path = NULL;
+        }
+    }
 
-    Vector2D paddle_velocity = create_vec();
-    Vector2D ball_velocity = create_vec_xy(0.2f, 0.2f);
+    // watching a batch of games shares nothing with playing one
+    if (options.spectate != 0u)
+    {
+        CHECK_SUCCESS(run_spectator(&options), "failed to spectate\n");
+        if (options.trace_path != NULL)
+        {
+            write_trace(options.trace_path);
+        }
+        stop_trace();
 
-    List *entities = NULL;
-    CHECK_SUCCESS(create_list(&entities), "failed to create entity list\n");
+        printf("Thank You for playing\n");
+        return 0;
+    }
 
-    CHECK_SUCCESS(push(entities, &paddle), "failed to add paddle to list\n");
-    CHECK_SUCCESS(push(entities, &ball), "failed to add ball to list\n");
+    Game *game = NULL;
+    LevelStream *stream = NULL;
+    if (options.netplay)
+    {
+        CHECK_SUCCESS(create_versus_game(&game), "failed to create game\n");
+    }
+    else if (options.stream_path != NULL)
+    {
+        if (options.world_size != 0u)
+        {
+            CHECK_SUCCESS(
+                write_streamed_level(options.stream_path, scalar_from_int((int32_t)options.world_size)),
+                "failed to write level\n");
+        }
+        CHECK_SUCCESS(
+            create_level_stream(&stream, &game, options.stream_path, options.stream_budget), "failed to stream level\n");
+    }
+    else
+    {
+        CHECK_SUCCESS(create_level(&options, &game), "failed to create game\n");
+    }
 
-    create_brick_row(entities, 50.0f, 0xff, 0x00, 0x00);
-    create_brick_row(entities, 80.0f, 0xff, 0x00, 0x00);
-    create_brick_row(entities, 110.0f, 0xff, 0xa5, 0x00);
-    create_brick_row(entities, 140.0f, 0xff, 0xa5, 0x00);
-    create_brick_row(entities, 170.0f, 0x00, 0xff, 0x00);
-    create_brick_row(entities, 200.0f, 0x00, 0xff, 0x00);
+    Camera camera = create_camera(scalar_from_int(WINDOW_WIDTH), scalar_from_int(WINDOW_HEIGHT));
 
-    ListIter *iter = NULL;
-    CHECK_SUCCESS(create_iter(entities, &iter), "failed to get entity iterator\n");
+    Window *window = NULL;
+    Audio *audio = NULL;
+    ParticleSystem *particles = NULL;
+    JobSystem *jobs = NULL;
+    Scene *scene = NULL;
 
-    // create window
-    Window *window;
-    CHECK_SUCCESS(create_window(&window), "failed to create window\n");
+    if (!options.headless)
+    {
+        // the calling thread works too, so one thread needs no workers
+        size_t threads = options.threads;
+        if (threads == 0u)
+        {
+            const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+            threads = (cores > 0) ? (size_t)cores : 1u;
+            threads = (threads > (JOB_MAX_WORKERS + 1u)) ? (JOB_MAX_WORKERS + 1u) : threads;
+        }
+        CHECK_SUCCESS(create_job_system(&jobs, threads - 1u), "failed to create job system\n");
+
+        // a streamed level only ever has some of its bricks in memory to draw
+        const size_t brick_capacity = (stream != NULL) ? get_stream_brick_capacity(stream) : game->brick_count;
+        CHECK_SUCCESS(create_scene(&scene, game, brick_capacity), "failed to create scene\n");
+
+        CHECK_SUCCESS(create_particle_system(&particles, 131072u), "failed to create particle system\n");
+
+        // create window
+        CHECK_SUCCESS(create_window(&window), "failed to create window\n");
+
+        // bricks and particles are drawn in separate batches so the geometry only needs to fit the larger of them
+        CHECK_SUCCESS(reserve_window_quads(window, brick_capacity), "failed to reserve window geometry\n");
+        CHECK_SUCCESS(
+            reserve_window_quads(window, particle_capacity(particles)), "failed to reserve window geometry\n");
+    }
+
+    // headless games only make sound when asked to, SDL_AUDIODRIVER=dummy runs the mixer without a device
+    if (!options.headless || (getenv("SDL_AUDIODRIVER") != NULL))
+    {
+        // the game is still playable without sound, so carry on if there is no audio device
+        if (create_audio(&audio) != SUCCESS)
+        {
+            printf("failed to create audio, continuing without sound\n");
+            audio = NULL;
+        }
+    }
+
+    // monitoring is only published when asked for, under a name no other run may already have
+    Telemetry *telemetry = NULL;
+    if (options.telemetry_name != NULL)
+    {
+        CHECK_SUCCESS(
+            create_telemetry(&telemetry, options.telemetry_name),
+            "failed to create telemetry, is another game already publishing under that name?\n");
+    }
+
+    // player 0 listens on the base port and player 1 on the next one up
+    Netplay *netplay = NULL;
+    if (options.netplay)
+    {
+        const NetplayConfig config = {
+            .player = options.player,
+            .remote_address = options.peer,
+            .remote_port = (uint16_t)(options.port + (1u - options.player)),
+            .local_port = (uint16_t)(options.port + options.player),
+            .latency_ms = options.latency_ms,
+            .loss_percent = options.loss_percent};
+        CHECK_SUCCESS(create_netplay(&netplay, game, &config), "failed to start netplay\n");
+    }
+
+    SessionRecorder *recorder = NULL;
+    if (options.record_path != NULL)
+    {
+        CHECK_SUCCESS(
+            create_session_recorder(&recorder, options.record_path, options.world_size), "failed to record session\n");
+    }
+
+    ReplayWriter *archive = NULL;
+    if (options.archive_path != NULL)
+    {
+        CHECK_SUCCESS(
+            create_replay_writer(&archive, options.archive_path, game, options.world_size, REPLAY_DEFAULT_INTERVAL),
+            "failed to record archive\n");
+    }
+
+    MetricsWriter *metrics = NULL;
+    if (options.metrics_path != NULL)
+    {
+        CHECK_SUCCESS(
+            create_metrics_writer(&metrics, options.metrics_path, METRICS_DEFAULT_BLOCKS), "failed to write metrics\n");
+    }
+    uint64_t episode = 0u;
+    uint64_t earlier_steps = 0u;
+    EpisodeTotals totals = {0};
+
+    // so is rewinding, which is only offered when there is someone to hold the key and nobody else to disagree. A
+    // recording can't be rewound, the keys played before rewinding would still be in it
+    Rewind *rewind = NULL;
+    if ((window != NULL) && (netplay == NULL) && (recorder == NULL) && (archive == NULL))
+    {
+        if (create_rewind(&rewind, REWIND_SECONDS * STEPS_PER_SECOND) != SUCCESS)
+        {
+            printf("failed to create rewind history, continuing without it\n");
+            rewind = NULL;
+        }
+        else
+        {
+            record_rewind(rewind, game, NULL);
+        }
+    }
+
+    // everything is created, so locking now covers it all. Each part helps on its own and most need privileges, so
+    // carry on without the ones that are refused
+    if (options.low_jitter)
+    {
+        if ((options.pin_core >= 0) && (pin_current_thread((uint32_t)options.pin_core) != SUCCESS))
+        {
+            printf("failed to pin the game to core %d, continuing unpinned\n", options.pin_core);
+        }
+        if ((options.pin_core >= 0) && (jobs != NULL) &&
+            (pin_job_workers(jobs, (uint32_t)options.pin_core + 1u, options.fifo_priority) != SUCCESS))
+        {
+            printf("failed to pin the job workers to the cores after %d, continuing unpinned\n", options.pin_core);
+        }
+        if ((options.fifo_priority != 0) && (set_current_thread_fifo(options.fifo_priority) != SUCCESS))
+        {
+            printf(
+                "failed to run at SCHED_FIFO priority %d, continuing on the normal scheduler\n", options.fifo_priority);
+        }
+        if (lock_memory() != SUCCESS)
+        {
+            printf("failed to lock memory, continuing without it\n");
+        }
+        if (prefault_memory(REALTIME_DEFAULT_HEAP, REALTIME_DEFAULT_STACK) != SUCCESS)
+        {
+            printf("failed to prefault memory, continuing without it\n");
+        }
+    }
 
     KeyEvent event;
     bool running = true;
 
-    const float paddle_speed = 0.4f;
     bool left_press = false;
     bool right_press = false;
+    bool rewind_press = false;
+
+    // counters for the telemetry rates, reset every second
+    TelemetryStats stats = {0};
+    uint32_t window_steps = 0u;
+    uint32_t window_collisions = 0u;
+    uint64_t rate_start = get_time_ns();
+
+    // rolling HUD timings in milliseconds
+    float frame_times[FRAME_HISTORY] = {0.0f};
+    float physics_times[FRAME_HISTORY] = {0.0f};
+    size_t frame_index = 0u;
+    const uint64_t game_start = get_time_ns();
+    uint64_t frame_start = game_start;
+    uint64_t fps_refresh = frame_start;
+    uint64_t physics_clock = game_start;
+    uint64_t settled_since = 0u;
+    float displayed_fps = 0.0f;
+    float displayed_frame_ms = 0.0f;
+    FrameJitter jitter = create_frame_jitter();
+    bool alloc_guard_armed = false;
+    uint64_t stream_stalls = 0u;
 
     while (running)
     {
+        TRACE_ZONE("frame");
+        begin_alloc_frame();
+
         // process all events
-        for (;;)
         {
-            Result event_result = get_window_event(window, &event);
-            if (event_result == SUCCESS)
+            TRACE_ZONE("events");
+            while (window != NULL)
             {
-                if ((event.key_state == K_DOWN) && (event.key == ESCAPE_K))
+                Result event_result = get_window_event(window, &event);
+                if (event_result == SUCCESS)
                 {
-                    running = false;
+                    if ((event.key_state == K_DOWN) && (event.key == ESCAPE_K))
+                    {
+                        running = false;
+                    }
+                    else if (event.key == LEFT_K)
+                    {
+                        left_press = (event.key_state == K_DOWN) ? true : false;
+                    }
+                    else if (event.key == RIGHT_K)
+                    {
+                        right_press = (event.key_state == K_DOWN) ? true : false;
+                    }
+                    else if (event.key == REWIND_K)
+                    {
+                        rewind_press = (event.key_state == K_DOWN) ? true : false;
+                    }
+                    else if ((event.key_state == K_DOWN) && (event.key == TRACE_K))
+                    {
+                        trace_requested = 1;
+                    }
                 }
-                else if (event.key == LEFT_K)
+                else if (event_result == NO_EVENT)
                 {
-                    left_press = (event.key_state == K_DOWN) ? true : false;
+                    break;
                 }
-                else if (event.key == RIGHT_K)
+                else
                 {
-                    right_press = (event.key_state == K_DOWN) ? true : false;
+                    printf("error getting event\n");
                 }
             }
-            else if (event_result == NO_EVENT)
+        }
+
+        const uint64_t physics_start = get_time_ns();
+
+        // headless runs one step per loop as fast as it can, otherwise steps are paced to real time
+        uint64_t steps_due = 1u;
+        if (window != NULL)
+        {
+            steps_due = ((physics_start - physics_clock) * STEPS_PER_SECOND) / 1000000000u;
+            physics_clock += (steps_due * 1000000000u) / STEPS_PER_SECOND;
+            if (steps_due > MAX_STEPS_PER_FRAME)
+            {
+                steps_due = MAX_STEPS_PER_FRAME;
+                physics_clock = physics_start;
+            }
+        }
+
+        // chunks are read in the background, the game waits for the ones it needs without holding up the frame
+        if (stream != NULL)
+        {
+            CHECK_SUCCESS(
+                update_level_stream(stream, game, (window != NULL) ? &camera.view : NULL), "failed to stream level\n");
+        }
+
+        const bool rewinding = rewind_press && (rewind != NULL);
+        if (rewinding)
+        {
+            // wind back at the same rate play moves forward
+            uint64_t oldest = 0u;
+            uint64_t newest = 0u;
+            if (get_rewind_range(rewind, &oldest, &newest) == SUCCESS)
             {
+                const uint64_t target = ((newest - oldest) > steps_due) ? (newest - steps_due) : oldest;
+                CHECK_SUCCESS(restore_rewind(rewind, game, target), "failed to rewind\n");
+            }
+        }
+
+        // the world freezes once the game is over
+        for (uint64_t i = 0u; !rewinding && (i < steps_due) && !is_game_over(game) &&
+                               ((options.max_steps == 0u) || (game->state.step < options.max_steps));
+             ++i)
+        {
+            TRACE_ZONE("step");
+
+            if (!can_step_game(game))
+            {
+                ++stream_stalls;
                 break;
             }
+
+            GameInput inputs[GAME_MAX_PLAYERS] = {0};
+            GameInput *input = &inputs[options.player];
+            input->left = left_press;
+            input->right = right_press;
+            if (options.autopilot)
+            {
+                autopilot_input(game, options.player, input);
+            }
+
+            StepOutcome outcome;
+            if (netplay != NULL)
+            {
+                const Result advanced = advance_netplay(netplay, input, &outcome);
+                if (advanced == NO_EVENT)
+                {
+                    // too far ahead of the other side, wait for it
+                    break;
+                }
+                CHECK_SUCCESS(advanced, "netplay failed\n");
+            }
             else
             {
-                printf("error getting event\n");
+                step_game(game, inputs, &outcome);
+            }
+
+            if (recorder != NULL)
+            {
+                CHECK_SUCCESS(record_session_input(recorder, input), "failed to record session\n");
             }
+            if (archive != NULL)
+            {
+                CHECK_SUCCESS(record_replay_input(archive, game, input), "failed to record archive\n");
+            }
+
+            window_collisions += apply_outcome(game, &outcome, audio, particles);
+            if (metrics != NULL)
+            {
+                record_step_metrics(metrics, game, &outcome, episode, &options, &totals);
+            }
+            if (rewind != NULL)
+            {
+                record_rewind(rewind, game, &outcome);
+            }
+
+            if (particles != NULL)
+            {
+                update_particle_system(particles, jobs);
+            }
+
+            ++window_steps;
         }
 
-        if ((left_press && right_press) || (!left_press && !right_press))
+        bool finished = is_game_over(game) || ((options.max_steps != 0u) && (game->state.step >= options.max_steps));
+
+        // only headless single player games get this far with games left, nothing else holds on to the game
+        if (finished && ((episode + 1u) < options.games))
         {
-            paddle_velocity.x = 0.0f;
+            if (metrics != NULL)
+            {
+                record_episode_metrics(metrics, game, episode, options.player, &totals);
+            }
+
+            // making the next game allocates, the guard is armed again once its first frame is done
+            set_alloc_guard(ALLOC_GUARD_OFF);
+            alloc_guard_armed = false;
+
+            earlier_steps += game->state.step;
+            destroy_game(game);
+            CHECK_SUCCESS(create_level(&options, &game), "failed to create game\n");
+            ++episode;
+            seed_game(game, (uint32_t)(episode * 0x9e3779b9u) | 1u);
+            totals = (EpisodeTotals){0};
+            finished = false;
         }
-        else if (left_press)
+
+        if (netplay != NULL)
         {
-            paddle_velocity.x = -paddle_speed;
+            // keep exchanging inputs after the game ends, a late input can still roll it back
+            CHECK_SUCCESS(poll_netplay(netplay), "netplay failed\n");
+
+            const bool settled = finished && is_netplay_settled(netplay);
+            settled_since = !settled ? 0u : ((settled_since == 0u) ? get_time_ns() : settled_since);
+            if ((options.headless || (options.max_steps != 0u)) && (settled_since != 0u) &&
+                ((get_time_ns() - settled_since) > NETPLAY_LINGER_NS))
+            {
+                running = false;
+            }
         }
-        else if (right_press)
+        else if ((options.headless && is_game_over(game)) || (finished && (options.max_steps != 0u)))
         {
-            paddle_velocity.x = paddle_speed;
+            running = false;
         }
 
-        add_vec(&paddle.block.position, &paddle_velocity);
-        update_ball(&ball, &ball_velocity);
-        handle_collisions(entities, &ball, &ball_velocity, &paddle);
-
-        // reset iterator as we may have modified the list and we will want to start from the beginning anyway
-        reset_iter(entities, &iter);
+        physics_times[frame_index] = (float)(get_time_ns() - physics_start) / 1000000.0f;
 
         // render our scene
+        if (window != NULL)
+        {
+            TRACE_ZONE("render");
+
+            CHECK_SUCCESS(pre_render_window(window), "pre render failed\n");
 
-        CHECK_SUCCESS(pre_render_window(window), "pre render failed\n");
+            follow_camera(&camera, &game->state.ball.block, game->width, game->height);
+            set_camera_window(window, &camera);
 
-        while (!is_iter_end(iter))
+            CHECK_SUCCESS(draw_scene(scene, window, jobs, &camera, particles), "failed to render scene\n");
+
+            // refresh the numbers a few times a second so they are readable and the cached text is reused in between
+            const uint64_t now = get_time_ns();
+            if ((now - fps_refresh) > 250000000u)
+            {
+                float total_ms = 0.0f;
+                for (size_t i = 0u; i < FRAME_HISTORY; ++i)
+                {
+                    total_ms += frame_times[i];
+                }
+                displayed_frame_ms = total_ms / FRAME_HISTORY;
+                displayed_fps = (displayed_frame_ms > 0.0f) ? (1000.0f / displayed_frame_ms) : 0.0f;
+                fps_refresh = now;
+            }
+
+            draw_hud(
+                window,
+                game,
+                options.player,
+                frame_times,
+                physics_times,
+                frame_index,
+                displayed_fps,
+                displayed_frame_ms,
+                rewinding);
+
+            post_render_window(window);
+        }
+
+        const uint64_t frame_end = get_time_ns();
+        frame_times[frame_index] = (float)(frame_end - frame_start) / 1000000.0f;
+        record_frame_time(&jitter, frame_end - frame_start);
+        if (telemetry != NULL)
         {
-            Entity *entity = (Entity *)iter_value(iter);
-            CHECK_SUCCESS(
-                draw_block_window(window, &entity->block, entity->r, entity->g, entity->b),
-                "failed to render entity\n");
+            TRACE_ZONE("telemetry");
 
-            next_node(&iter);
+            if ((frame_end - rate_start) >= 1000000000u)
+            {
+                const float seconds = (float)(frame_end - rate_start) / 1000000000.0f;
+                stats.steps_per_second = (float)window_steps / seconds;
+                stats.collisions_per_second = (float)window_collisions / seconds;
+                window_steps = 0u;
+                window_collisions = 0u;
+                rate_start = frame_end;
+            }
+
+            ++stats.frame;
+            stats.step = game->state.step;
+            stats.frame_ms = frame_times[frame_index];
+            stats.physics_ms = physics_times[frame_index];
+            stats.entity_count = game->state.bricks_left + 2u;
+            stats.particle_count = (particles != NULL) ? (uint32_t)particle_count(particles) : 0u;
+            stats.score = game->state.scores[options.player];
+            stats.lives = game->state.lives[options.player];
+
+            AllocStats alloc_stats;
+            get_alloc_stats(&alloc_stats);
+            stats.frame_allocations = (uint32_t)alloc_stats.frame_allocations;
+            stats.heap_bytes = alloc_stats.bytes_in_use;
+            stats.peak_heap_bytes = alloc_stats.peak_bytes;
+
+            publish_telemetry(telemetry, &stats);
         }
 
-        post_render_window(window);
+        // everything is loaded and the first frame has sized SDL's and the window's buffers, from here on nothing
+        // should need to allocate
+        if (!alloc_guard_armed)
+        {
+            set_alloc_guard(options.alloc_guard);
+            alloc_guard_armed = true;
+        }
+
+        // dumped at the end of the frame, so the time taken to write it only shows up in this frame's zone
+        if (trace_requested && (options.trace_path != NULL))
+        {
+            trace_requested = 0;
+            write_trace(options.trace_path);
+        }
+
+        frame_start = frame_end;
+        frame_index = (frame_index + 1u) % FRAME_HISTORY;
+    }
+
+    if (options.trace_path != NULL)
+    {
+        write_trace(options.trace_path);
+    }
+
+    // the rate covers every game played, the rest is about the last one
+    const float seconds = (float)(get_time_ns() - game_start) / 1000000000.0f;
+    const uint64_t total_steps = earlier_steps + game->state.step;
+    printf(
+        "steps: %llu score: %u lives: %u bricks left: %u time: %.3fs (%.0f steps/s)\n",
+        (unsigned long long)game->state.step,
+        game->state.scores[options.player],
+        game->state.lives[options.player],
+        game->state.bricks_left,
+        seconds,
+        (seconds > 0.0f) ? ((float)total_steps / seconds) : 0.0f);
+
+    if (options.games > 1u)
+    {
+        printf("games: %llu steps in all: %llu\n", (unsigned long long)(episode + 1u), (unsigned long long)total_steps);
+    }
+
+    // the spread between the median and the tail is the jitter, compare runs with and without --low-jitter
+    JitterStats jitter_stats;
+    get_frame_jitter(&jitter, &jitter_stats);
+    printf(
+        "frames: %llu (%s) frame time mean: %.3fms p50: %.3fms p90: %.3fms p99: %.3fms p99.9: %.3fms max: %.3fms "
+        "jitter p99 - p50: %.3fms\n",
+        (unsigned long long)jitter_stats.frames,
+        options.low_jitter ? "low jitter" : "default",
+        jitter_stats.mean_ms,
+        jitter_stats.p50_ms,
+        jitter_stats.p90_ms,
+        jitter_stats.p99_ms,
+        jitter_stats.p999_ms,
+        jitter_stats.max_ms,
+        jitter_stats.p99_ms - jitter_stats.p50_ms);
+
+    if (netplay != NULL)
+    {
+        NetplayStats netplay_stats;
+        get_netplay_stats(netplay, &netplay_stats);
+        printf(
+            "rival score: %u lives: %u state hash: %016llx\n"
+            "rollbacks: %llu (max %llu steps, %llu steps resimulated in %.3fms) packets sent: %llu dropped: %llu "
+            "received: %llu\n",
+            game->state.scores[1u - options.player],
+            game->state.lives[1u - options.player],
+            (unsigned long long)hash_game(game),
+            (unsigned long long)netplay_stats.rollbacks,
+            (unsigned long long)netplay_stats.max_rollback,
+            (unsigned long long)netplay_stats.resimulated_steps,
+            (double)netplay_stats.resimulate_ns / 1000000.0,
+            (unsigned long long)netplay_stats.packets_sent,
+            (unsigned long long)netplay_stats.packets_dropped,
+            (unsigned long long)netplay_stats.packets_received);
+    }
+
+    if (audio != NULL)
+    {
+        // the mixer takes sounds on its own thread, let it catch up so every queued sound shows as mixed
+        AudioStats audio_stats;
+        const Result flushed = flush_audio(audio, 1000u);
+        get_audio_stats(audio, &audio_stats);
+        printf(
+            "sounds queued: %llu mixed: %llu dropped: %llu%s\n",
+            (unsigned long long)audio_stats.queued,
+            (unsigned long long)audio_stats.mixed,
+            (unsigned long long)audio_stats.dropped,
+            (flushed == SUCCESS) ? "" : " (mixer stalled)");
     }
 
-    destroy_iter(iter);
+    if (stream != NULL)
+    {
+        LevelStreamStats stream_stats;
+        get_level_stream_stats(stream, &stream_stats);
+        printf(
+            "chunks read: %llu dropped: %llu in memory: %zu of %zu (%zu KB) stalls: %llu\n",
+            (unsigned long long)stream_stats.loads,
+            (unsigned long long)stream_stats.evictions,
+            stream_stats.resident,
+            stream_stats.slots,
+            stream_stats.bytes / 1024u,
+            (unsigned long long)stream_stalls);
+    }
+
+    if (recorder != NULL)
+    {
+        CHECK_SUCCESS(finish_session_recorder(recorder, game), "failed to record session\n");
+    }
+    if (archive != NULL)
+    {
+        CHECK_SUCCESS(finish_replay_writer(archive, game), "failed to record archive\n");
+    }
+    if (metrics != NULL)
+    {
+        // the game being played when the run stopped gets its row too, finished or not
+        record_episode_metrics(metrics, game, episode, options.player, &totals);
+        CHECK_SUCCESS(finish_metrics_writer(metrics), "failed to write metrics\n");
+
+        MetricsWriterStats metrics_stats;
+        get_metrics_writer_stats(metrics, &metrics_stats);
+        printf(
+            "metrics rows: %llu steps %llu episodes %llu misses, %llu blocks %llu bytes (%.1fx smaller) stalls: %llu\n",
+            (unsigned long long)metrics_stats.rows[METRICS_STEPS],
+            (unsigned long long)metrics_stats.rows[METRICS_EPISODES],
+            (unsigned long long)metrics_stats.rows[METRICS_MISSES],
+            (unsigned long long)metrics_stats.blocks,
+            (unsigned long long)metrics_stats.encoded_bytes,
+            (metrics_stats.encoded_bytes > 0u) ? ((double)metrics_stats.raw_bytes / (double)metrics_stats.encoded_bytes)
+                                                : 0.0,
+            (unsigned long long)metrics_stats.stalls);
+    }
+
+    set_alloc_guard(ALLOC_GUARD_OFF);
+    print_alloc_report();
+
+    destroy_netplay(netplay);
+    destroy_session_recorder(recorder);
+    destroy_replay_writer(archive);
+    destroy_metrics_writer(metrics);
+    destroy_rewind(rewind);
+    destroy_particle_system(particles);
+    destroy_scene(scene);
+    destroy_job_system(jobs);
+    destroy_telemetry(telemetry);
+    destroy_audio(audio);
     destroy_window(window);
+    destroy_game(game);
+    destroy_level_stream(stream);
+    stop_trace();
 
     printf("Thank You for playing\n");
 
@@ -0,0 +1,797 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "alloc.h"
+#include "metrics.h"
+#include "queue.h"
+#include "trace.h"
+
+/**
+ * Bytes at the start of the header and the end of the trailer.
+ */
+#define METRICS_MAGIC "BRKMETRC"
+
+/**
+ * Version of the file layout.
+ */
+#define METRICS_VERSION 1u
+
+/**
+ * Longest varint, a 64 bit value seven bits a byte.
+ */
+#define MAX_VARINT_SIZE 10u
+
+/**
+ * Largest encoded column of a block, a run of one for every value.
+ */
+#define MAX_COLUMN_SIZE (METRICS_BLOCK_ROWS * (MAX_VARINT_SIZE + 2u))
+
+/**
+ * Marks a table with no block being filled.
+ */
+#define NO_BLOCK UINT32_MAX
+
+/**
+ * Start of a metrics file.
+ */
+typedef struct MetricsHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t block_rows;
+    uint32_t columns[METRICS_TABLES];
+    uint32_t reserved;
+} MetricsHeader;
+
+/**
+ * Where a block starts and how big each of its columns is, column c starts after columns 0 to c - 1.
+ */
+typedef struct MetricsIndexEntry
+{
+    uint64_t offset;
+    uint64_t first_row;
+    uint32_t table;
+    uint32_t rows;
+    uint32_t sizes[METRICS_MAX_COLUMNS];
+} MetricsIndexEntry;
+
+/**
+ * End of a metrics file.
+ */
+typedef struct MetricsTrailer
+{
+    uint64_t index_offset;
+    uint64_t block_count;
+    uint64_t rows[METRICS_TABLES];
+    char magic[8];
+} MetricsTrailer;
+
+/**
+ * Rows of one table being gathered or waiting to be written. Column c of row r is values[(c * METRICS_BLOCK_ROWS) + r].
+ * The game thread owns a block from taking it off the free queue until it puts it on the full queue, the writer thread
+ * from then until it puts it back.
+ */
+typedef struct MetricsBlock
+{
+    int64_t *values;
+    uint64_t first_row;
+    uint32_t table;
+    uint32_t rows;
+} MetricsBlock;
+
+typedef struct MetricsWriter
+{
+    FILE *file;
+
+    // index entries are spooled here by the writer thread until the end
+    FILE *index;
+
+    // every block's values are cut from the same array
+    MetricsBlock *blocks;
+    size_t block_count;
+    int64_t *values;
+
+    // the game thread hands over full blocks, the writer thread gives them back written
+    Queue full;
+    Queue free;
+
+    // the writer sleeps until a block is handed over, the game thread until one is given back
+    pthread_t thread;
+    bool started;
+    sem_t wake;
+    bool wake_created;
+    sem_t freed;
+    bool freed_created;
+    atomic_bool quit;
+    atomic_bool failed;
+
+    // only touched by the game thread
+    uint32_t current[METRICS_TABLES];
+    uint64_t rows[METRICS_TABLES];
+    uint64_t stalls;
+
+    // only touched by the writer thread until it stops
+    uint8_t *scratch;
+    uint64_t offset;
+    uint64_t blocks_written;
+    uint64_t raw_bytes;
+    uint64_t encoded_bytes;
+} MetricsWriter;
+
+typedef struct MetricsFile
+{
+    const uint8_t *data;
+    size_t size;
+
+    MetricsHeader header;
+    MetricsTrailer trailer;
+} MetricsFile;
+
+/**
+ * Names of the tables and their columns.
+ */
+static const char *const table_names[METRICS_TABLES] = {"steps", "episodes", "misses"};
+static const uint32_t column_counts[METRICS_TABLES] = {STEP_METRICS, EPISODE_METRICS, MISS_METRICS};
+static const char *const column_names[METRICS_TABLES][METRICS_MAX_COLUMNS] = {
+    {"episode", "step", "bricks", "paddle_hits", "ball_speed", "score"},
+    {"episode", "steps", "bricks", "brick_rate", "paddle_hits", "misses", "score"},
+    {"episode", "step", "player", "x", "y"}};
+
+_Static_assert(STEP_METRICS <= METRICS_MAX_COLUMNS, "steps table has too many columns");
+_Static_assert(EPISODE_METRICS <= METRICS_MAX_COLUMNS, "episodes table has too many columns");
+_Static_assert(MISS_METRICS <= METRICS_MAX_COLUMNS, "misses table has too many columns");
+
+/**
+ * Helper function to write an unsigned varint, seven bits per byte with the top bit set on all but the last byte.
+ *
+ * @param out
+ *   Buffer to write to, must have room for MAX_VARINT_SIZE bytes.
+ *
+ * @param value
+ *   Value to write.
+ *
+ * @returns
+ *   Number of bytes written.
+ */
+static size_t write_varint(uint8_t *out, uint64_t value)
+{
+    size_t size = 0u;
+
+    while (value >= 0x80u)
+    {
+        out[size++] = (uint8_t)(value | 0x80u);
+        value >>= 7u;
+    }
+    out[size++] = (uint8_t)value;
+
+    return size;
+}
+
+/**
+ * Helper function to read an unsigned varint.
+ *
+ * @param in
+ *   Buffer to read from.
+ *
+ * @param end
+ *   End of the buffer.
+ *
+ * @param value
+ *   Out parameter for the value read.
+ *
+ * @returns
+ *   Number of bytes read, 0 if the varint runs past the end or is too long.
+ */
+static size_t read_varint(const uint8_t *in, const uint8_t *end, uint64_t *value)
+{
+    *value = 0u;
+
+    for (size_t size = 0u; (size < MAX_VARINT_SIZE) && (&in[size] < end); ++size)
+    {
+        *value |= (uint64_t)(in[size] & 0x7fu) << (7u * size);
+        if ((in[size] & 0x80u) == 0u)
+        {
+            return size + 1u;
+        }
+    }
+
+    return 0u;
+}
+
+/**
+ * Helper function to encode a column of a block as runs of equal differences, each a varint run length followed by
+ * the difference zigzag encoded so small negative ones stay small. The first difference is from 0.
+ *
+ * @param out
+ *   Buffer to write to, must have room for MAX_COLUMN_SIZE bytes.
+ *
+ * @param values
+ *   Values of the column.
+ *
+ * @param rows
+ *   Number of values, at least 1.
+ *
+ * @returns
+ *   Number of bytes written.
+ */
+static size_t encode_column(uint8_t *out, const int64_t *values, uint32_t rows)
+{
+    size_t size = 0u;
+    int64_t previous = 0;
+    uint32_t row = 0u;
+
+    while (row < rows)
+    {
+        const uint64_t delta = (uint64_t)values[row] - (uint64_t)previous;
+        uint32_t run = 1u;
+        while (((row + run) < rows) && (((uint64_t)values[row + run] - (uint64_t)values[row + run - 1u]) == delta))
+        {
+            ++run;
+        }
+
+        // zigzag, 0, -1, 1, -2 ... become 0, 1, 2, 3 ...
+        const uint64_t zigzag = (delta << 1u) ^ (uint64_t)((int64_t)delta >> 63u);
+        size += write_varint(&out[size], run);
+        size += write_varint(&out[size], zigzag);
+
+        previous = values[row + run - 1u];
+        row += run;
+    }
+
+    return size;
+}
+
+/**
+ * Helper function to decode a column written by encode_column.
+ *
+ * @param in
+ *   Encoded column.
+ *
+ * @param size
+ *   Bytes in the encoded column.
+ *
+ * @param values
+ *   Where to write the values.
+ *
+ * @param rows
+ *   Number of values.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the runs don't add up to rows or run past the end
+ */
+static Result decode_column(const uint8_t *in, size_t size, int64_t *values, uint32_t rows)
+{
+    const uint8_t *end = &in[size];
+    uint64_t value = 0u;
+    uint32_t row = 0u;
+
+    while (row < rows)
+    {
+        uint64_t run = 0u;
+        uint64_t zigzag = 0u;
+        const size_t run_size = read_varint(in, end, &run);
+        const size_t delta_size = (run_size == 0u) ? 0u : read_varint(&in[run_size], end, &zigzag);
+        if ((delta_size == 0u) || (run == 0u) || (run > (rows - row)))
+        {
+            return FAILED;
+        }
+        in += run_size + delta_size;
+
+        const uint64_t delta = (zigzag >> 1u) ^ (~(zigzag & 1u) + 1u);
+        for (uint64_t i = 0u; i < run; ++i)
+        {
+            value += delta;
+            values[row++] = (int64_t)value;
+        }
+    }
+
+    return (in == end) ? SUCCESS : FAILED;
+}
+
+/**
+ * Helper function to encode and write a full block, on the writer thread.
+ *
+ * @param writer
+ *   Writer the block belongs to.
+ *
+ * @param block
+ *   Block to write.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the file could not be written
+ */
+static Result write_block(MetricsWriter *writer, const MetricsBlock *block)
+{
+    TRACE_ZONE("write_metrics_block");
+
+    MetricsIndexEntry entry = {
+        .offset = writer->offset, .first_row = block->first_row, .table = block->table, .rows = block->rows};
+
+    for (uint32_t column = 0u; column < column_counts[block->table]; ++column)
+    {
+        const size_t size =
+            encode_column(writer->scratch, &block->values[column * METRICS_BLOCK_ROWS], block->rows);
+        if (fwrite(writer->scratch, 1u, size, writer->file) != size)
+        {
+            return FAILED;
+        }
+
+        entry.sizes[column] = (uint32_t)size;
+        writer->offset += size;
+        writer->encoded_bytes += size;
+        writer->raw_bytes += block->rows * sizeof(int64_t);
+    }
+
+    ++writer->blocks_written;
+    return (fwrite(&entry, sizeof(entry), 1u, writer->index) == 1u) ? SUCCESS : FAILED;
+}
+
+/**
+ * Helper function run by the writer thread, writing blocks as they are handed over until asked to quit. Blocks go
+ * back to the pool even after a failed write, so the game thread never waits forever.
+ *
+ * @param data
+ *   The writer.
+ *
+ * @returns
+ *   NULL.
+ */
+static void *run_writer(void *data)
+{
+    MetricsWriter *writer = (MetricsWriter *)data;
+
+    for (;;)
+    {
+        sem_wait(&writer->wake);
+
+        // read before draining, so every block handed over before quit was set gets written
+        const bool quit = atomic_load_explicit(&writer->quit, memory_order_acquire);
+
+        uint32_t index = 0u;
+        while (pop_queue(&writer->full, &index))
+        {
+            if (!atomic_load_explicit(&writer->failed, memory_order_relaxed) &&
+                (write_block(writer, &writer->blocks[index]) != SUCCESS))
+            {
+                atomic_store_explicit(&writer->failed, true, memory_order_relaxed);
+            }
+
+            push_queue(&writer->free, index);
+            sem_post(&writer->freed);
+        }
+
+        if (quit)
+        {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Helper function to hand a block to the writer thread.
+ *
+ * @param writer
+ *   Writer owning the block.
+ *
+ * @param table
+ *   Table whose current block to hand over.
+ */
+static void submit_block(MetricsWriter *writer, MetricsTable table)
+{
+    // the full queue has room for every block, so this can't fail
+    push_queue(&writer->full, writer->current[table]);
+    writer->current[table] = NO_BLOCK;
+    sem_post(&writer->wake);
+}
+
+/**
+ * Helper function to stop the writer thread once it has written everything handed to it.
+ *
+ * @param writer
+ *   Writer to stop.
+ */
+static void stop_writer(MetricsWriter *writer)
+{
+    if (writer->started)
+    {
+        atomic_store_explicit(&writer->quit, true, memory_order_release);
+        sem_post(&writer->wake);
+        pthread_join(writer->thread, NULL);
+        writer->started = false;
+    }
+}
+
+const char *get_metrics_table_name(MetricsTable table)
+{
+    assert(table < METRICS_TABLES);
+
+    return table_names[table];
+}
+
+uint32_t get_metrics_column_count(MetricsTable table)
+{
+    assert(table < METRICS_TABLES);
+
+    return column_counts[table];
+}
+
+const char *get_metrics_column_name(MetricsTable table, uint32_t column)
+{
+    assert(table < METRICS_TABLES);
+    assert(column < column_counts[table]);
+
+    return column_names[table][column];
+}
+
+Result create_metrics_writer(MetricsWriter **writer, const char *path, size_t blocks)
+{
+    assert(writer != NULL);
+    assert(path != NULL);
+    assert(blocks > METRICS_TABLES);
+
+    Result res = SUCCESS;
+
+    MetricsWriter *n_writer = (MetricsWriter *)TRACKED_ALIGNED_CALLOC(CACHE_LINE, sizeof(MetricsWriter));
+    if (n_writer == NULL)
+    {
+        res = FAILED;
+        return res;
+    }
+
+    *n_writer = (MetricsWriter){.block_count = blocks, .offset = sizeof(MetricsHeader)};
+    atomic_init(&n_writer->quit, false);
+    atomic_init(&n_writer->failed, false);
+    for (uint32_t table = 0u; table < METRICS_TABLES; ++table)
+    {
+        n_writer->current[table] = NO_BLOCK;
+    }
+
+    n_writer->blocks = (MetricsBlock *)TRACKED_CALLOC(blocks, sizeof(MetricsBlock));
+    n_writer->values = (int64_t *)TRACKED_CALLOC(blocks * METRICS_MAX_COLUMNS * METRICS_BLOCK_ROWS, sizeof(int64_t));
+    n_writer->scratch = (uint8_t *)TRACKED_CALLOC(MAX_COLUMN_SIZE, sizeof(uint8_t));
+    n_writer->file = fopen(path, "wb");
+    n_writer->index = tmpfile();
+    if ((n_writer->blocks == NULL) || (n_writer->values == NULL) || (n_writer->scratch == NULL) ||
+        (n_writer->file == NULL) || (n_writer->index == NULL) || (create_queue(&n_writer->full, blocks) != SUCCESS) ||
+        (create_queue(&n_writer->free, blocks) != SUCCESS))
+    {
+        res = FAILED;
+        destroy_metrics_writer(n_writer);
+        return res;
+    }
+
+    for (size_t i = 0u; i < blocks; ++i)
+    {
+        n_writer->blocks[i].values = &n_writer->values[i * METRICS_MAX_COLUMNS * METRICS_BLOCK_ROWS];
+        push_queue(&n_writer->free, (uint32_t)i);
+    }
+
+    MetricsHeader header = {.version = METRICS_VERSION, .block_rows = METRICS_BLOCK_ROWS};
+    memcpy(header.magic, METRICS_MAGIC, sizeof(header.magic));
+    memcpy(header.columns, column_counts, sizeof(header.columns));
+
+    n_writer->wake_created = sem_init(&n_writer->wake, 0, 0u) == 0;
+    n_writer->freed_created = sem_init(&n_writer->freed, 0, 0u) == 0;
+    if ((fwrite(&header, sizeof(header), 1u, n_writer->file) != 1u) || !n_writer->wake_created ||
+        !n_writer->freed_created)
+    {
+        res = FAILED;
+        destroy_metrics_writer(n_writer);
+        return res;
+    }
+
+    n_writer->started = pthread_create(&n_writer->thread, NULL, run_writer, n_writer) == 0;
+    if (!n_writer->started)
+    {
+        res = FAILED;
+        destroy_metrics_writer(n_writer);
+        return res;
+    }
+
+    // assign the writer to the user supplied pointer
+    *writer = n_writer;
+    return res;
+}
+
+void add_metrics_row(MetricsWriter *writer, MetricsTable table, const int64_t *values)
+{
+    assert(writer != NULL);
+    assert(table < METRICS_TABLES);
+    assert(values != NULL);
+
+    if (writer->current[table] == NO_BLOCK)
+    {
+        uint32_t index = 0u;
+        if (!pop_queue(&writer->free, &index))
+        {
+            // every block is waiting to be written, wait for one rather than lose rows
+            ++writer->stalls;
+            do
+            {
+                sem_wait(&writer->freed);
+            } while (!pop_queue(&writer->free, &index));
+        }
+
+        MetricsBlock *block = &writer->blocks[index];
+        block->table = (uint32_t)table;
+        block->rows = 0u;
+        block->first_row = writer->rows[table];
+        writer->current[table] = index;
+    }
+
+    MetricsBlock *block = &writer->blocks[writer->current[table]];
+    for (uint32_t column = 0u; column < column_counts[table]; ++column)
+    {
+        block->values[(column * METRICS_BLOCK_ROWS) + block->rows] = values[column];
+    }
+    ++block->rows;
+    ++writer->rows[table];
+
+    if (block->rows == METRICS_BLOCK_ROWS)
+    {
+        submit_block(writer, table);
+    }
+}
+
+Result finish_metrics_writer(MetricsWriter *writer)
+{
+    assert(writer != NULL);
+    assert(writer->file != NULL);
+
+    for (uint32_t table = 0u; table < METRICS_TABLES; ++table)
+    {
+        if (writer->current[table] != NO_BLOCK)
+        {
+            submit_block(writer, (MetricsTable)table);
+        }
+    }
+
+    stop_writer(writer);
+    if (atomic_load_explicit(&writer->failed, memory_order_relaxed) || (fflush(writer->index) != 0))
+    {
+        return FAILED;
+    }
+
+    rewind(writer->index);
+    for (uint64_t i = 0u; i < writer->blocks_written; ++i)
+    {
+        MetricsIndexEntry entry;
+        if ((fread(&entry, sizeof(entry), 1u, writer->index) != 1u) ||
+            (fwrite(&entry, sizeof(entry), 1u, writer->file) != 1u))
+        {
+            return FAILED;
+        }
+    }
+
+    MetricsTrailer trailer = {.index_offset = writer->offset, .block_count = writer->blocks_written};
+    memcpy(trailer.rows, writer->rows, sizeof(trailer.rows));
+    memcpy(trailer.magic, METRICS_MAGIC, sizeof(trailer.magic));
+
+    const bool written = fwrite(&trailer, sizeof(trailer), 1u, writer->file) == 1u;
+    const bool closed = fclose(writer->file) == 0;
+    writer->file = NULL;
+
+    return (written && closed) ? SUCCESS : FAILED;
+}
+
+void get_metrics_writer_stats(const MetricsWriter *writer, MetricsWriterStats *stats)
+{
+    assert(writer != NULL);
+    assert(stats != NULL);
+    assert(!writer->started);
+
+    *stats = (MetricsWriterStats){
+        .blocks = writer->blocks_written,
+        .raw_bytes = writer->raw_bytes,
+        .encoded_bytes = writer->encoded_bytes,
+        .stalls = writer->stalls};
+    memcpy(stats->rows, writer->rows, sizeof(stats->rows));
+}
+
+void destroy_metrics_writer(MetricsWriter *writer)
+{
+    if (writer == NULL)
+    {
+        return;
+    }
+
+    stop_writer(writer);
+
+    if (writer->wake_created)
+    {
+        sem_destroy(&writer->wake);
+    }
+    if (writer->freed_created)
+    {
+        sem_destroy(&writer->freed);
+    }
+    if (writer->file != NULL)
+    {
+        fclose(writer->file);
+    }
+    if (writer->index != NULL)
+    {
+        fclose(writer->index);
+    }
+
+    free_tracked(writer->blocks);
+    free_tracked(writer->values);
+    free_tracked(writer->scratch);
+    destroy_queue(&writer->full);
+    destroy_queue(&writer->free);
+    free_tracked(writer);
+}
+
+/**
+ * Helper function to read an index entry.
+ *
+ * @param metrics
+ *   File to read.
+ *
+ * @param block
+ *   Block to look up.
+ *
+ * @returns
+ *   The entry.
+ */
+static MetricsIndexEntry get_index_entry(const MetricsFile *metrics, uint64_t block)
+{
+    MetricsIndexEntry entry;
+    memcpy(
+        &entry,
+        &metrics->data[metrics->trailer.index_offset + (block * sizeof(MetricsIndexEntry))],
+        sizeof(MetricsIndexEntry));
+    return entry;
+}
+
+Result open_metrics(MetricsFile **metrics, const char *path)
+{
+    assert(metrics != NULL);
+    assert(path != NULL);
+
+    MetricsFile *n_metrics = (MetricsFile *)TRACKED_CALLOC(1u, sizeof(MetricsFile));
+    if (n_metrics == NULL)
+    {
+        return FAILED;
+    }
+
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        close_metrics(n_metrics);
+        return FAILED;
+    }
+
+    struct stat info;
+    if ((fstat(fd, &info) != 0) || ((size_t)info.st_size < (sizeof(MetricsHeader) + sizeof(MetricsTrailer))))
+    {
+        close(fd);
+        close_metrics(n_metrics);
+        return FAILED;
+    }
+
+    void *address = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // the mapping keeps the file open
+    close(fd);
+
+    if (address == MAP_FAILED)
+    {
+        close_metrics(n_metrics);
+        return FAILED;
+    }
+    n_metrics->data = (const uint8_t *)address;
+    n_metrics->size = (size_t)info.st_size;
+
+    memcpy(&n_metrics->header, n_metrics->data, sizeof(MetricsHeader));
+    memcpy(&n_metrics->trailer, &n_metrics->data[n_metrics->size - sizeof(MetricsTrailer)], sizeof(MetricsTrailer));
+
+    const MetricsHeader *header = &n_metrics->header;
+    const MetricsTrailer *trailer = &n_metrics->trailer;
+    const uint64_t index_size = n_metrics->size - sizeof(MetricsTrailer) - trailer->index_offset;
+    if ((memcmp(header->magic, METRICS_MAGIC, sizeof(header->magic)) != 0) ||
+        (memcmp(trailer->magic, METRICS_MAGIC, sizeof(trailer->magic)) != 0) ||
+        (header->version != METRICS_VERSION) || (header->block_rows != METRICS_BLOCK_ROWS) ||
+        (memcmp(header->columns, column_counts, sizeof(header->columns)) != 0) ||
+        (trailer->index_offset < sizeof(MetricsHeader)) ||
+        (trailer->index_offset > (n_metrics->size - sizeof(MetricsTrailer))) ||
+        ((index_size / sizeof(MetricsIndexEntry)) != trailer->block_count) ||
+        ((index_size % sizeof(MetricsIndexEntry)) != 0u))
+    {
+        close_metrics(n_metrics);
+        return FAILED;
+    }
+
+    // assign the file to the user supplied pointer
+    *metrics = n_metrics;
+    return SUCCESS;
+}
+
+void close_metrics(MetricsFile *metrics)
+{
+    if (metrics == NULL)
+    {
+        return;
+    }
+
+    if (metrics->data != NULL)
+    {
+        munmap((void *)metrics->data, metrics->size);
+    }
+    free_tracked(metrics);
+}
+
+uint64_t get_metrics_rows(const MetricsFile *metrics, MetricsTable table)
+{
+    assert(metrics != NULL);
+    assert(table < METRICS_TABLES);
+
+    return metrics->trailer.rows[table];
+}
+
+uint64_t get_metrics_column_bytes(const MetricsFile *metrics, MetricsTable table, uint32_t column)
+{
+    assert(metrics != NULL);
+    assert(table < METRICS_TABLES);
+    assert(column < column_counts[table]);
+
+    uint64_t bytes = 0u;
+    for (uint64_t i = 0u; i < metrics->trailer.block_count; ++i)
+    {
+        const MetricsIndexEntry entry = get_index_entry(metrics, i);
+        bytes += (entry.table == (uint32_t)table) ? entry.sizes[column] : 0u;
+    }
+
+    return bytes;
+}
+
+Result read_metrics_column(const MetricsFile *metrics, MetricsTable table, uint32_t column, int64_t *values)
+{
+    assert(metrics != NULL);
+    assert(table < METRICS_TABLES);
+    assert(column < column_counts[table]);
+    assert(values != NULL);
+
+    const uint64_t rows = metrics->trailer.rows[table];
+
+    for (uint64_t i = 0u; i < metrics->trailer.block_count; ++i)
+    {
+        const MetricsIndexEntry entry = get_index_entry(metrics, i);
+        if (entry.table != (uint32_t)table)
+        {
+            continue;
+        }
+
+        uint64_t offset = entry.offset;
+        for (uint32_t before = 0u; before < column; ++before)
+        {
+            offset += entry.sizes[before];
+        }
+
+        if ((entry.rows > METRICS_BLOCK_ROWS) || (entry.first_row > rows) || (entry.rows > (rows - entry.first_row)) ||
+            (offset > metrics->trailer.index_offset) ||
+            (entry.sizes[column] > (metrics->trailer.index_offset - offset)) ||
+            (decode_column(&metrics->data[offset], entry.sizes[column], &values[entry.first_row], entry.rows) !=
+             SUCCESS))
+        {
+            return FAILED;
+        }
+    }
+
+    return SUCCESS;
+}
@@ -0,0 +1,307 @@
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "result.h"
+
+/**
+ * Metrics stream statistics from long headless runs to a compact columnar file, for balance analysis over many games.
+ *
+ * A file holds three tables of 64 bit integers: a row per step (or every few steps), a row per game and a row per
+ * missed ball. Rows are gathered a block of METRICS_BLOCK_ROWS at a time, each column of a block in its own array. A
+ * full block is handed to a background thread, which encodes each column on its own as runs of equal differences
+ * between neighbouring values, so counters, steps and anything that rarely changes take a byte or two per block.
+ *
+ * The game thread only copies values into a block. Blocks come from a fixed pool allocated up front, so memory stays
+ * bounded however long the run is. If the writer falls behind and the pool runs dry the game thread waits for a block
+ * to come back rather than losing rows, and the wait is counted.
+ *
+ * A file is in the byte order of the machine that wrote it:
+ *  - a header giving the number of columns in each table
+ *  - the blocks, each column's runs straight after the last
+ *  - an index of where every block starts, which table it belongs to, its first row and the size of each column
+ *  - a trailer giving where the index starts and the rows in each table
+ *
+ * A reader maps the file and decodes only the columns asked for, skipping the rest with the index.
+ */
+
+/**
+ * Rows in a block.
+ */
+#define METRICS_BLOCK_ROWS 4096u
+
+/**
+ * Blocks in the pool when nothing else is asked for, room for every table's current block and a few more waiting to
+ * be written.
+ */
+#define METRICS_DEFAULT_BLOCKS 8u
+
+/**
+ * Most columns in a table.
+ */
+#define METRICS_MAX_COLUMNS 8u
+
+/**
+ * Tables in a metrics file.
+ */
+typedef enum MetricsTable
+{
+    // a row every few steps of every game
+    METRICS_STEPS,
+    // a row at the end of every game
+    METRICS_EPISODES,
+    // a row whenever a ball gets past a paddle
+    METRICS_MISSES,
+    METRICS_TABLES
+} MetricsTable;
+
+/**
+ * Columns of the steps table. Positions and speeds are in thousandths of a pixel.
+ */
+typedef enum StepMetric
+{
+    STEP_METRIC_EPISODE,
+    STEP_METRIC_STEP,
+    // bricks destroyed and paddle hits during the step
+    STEP_METRIC_BRICKS,
+    STEP_METRIC_PADDLE_HITS,
+    // distance the main ball moves a step
+    STEP_METRIC_BALL_SPEED,
+    STEP_METRIC_SCORE,
+    STEP_METRICS
+} StepMetric;
+
+/**
+ * Columns of the episodes table.
+ */
+typedef enum EpisodeMetric
+{
+    EPISODE_METRIC_EPISODE,
+    EPISODE_METRIC_STEPS,
+    EPISODE_METRIC_BRICKS,
+    // bricks destroyed per second of play, in thousandths
+    EPISODE_METRIC_BRICK_RATE,
+    EPISODE_METRIC_PADDLE_HITS,
+    EPISODE_METRIC_MISSES,
+    EPISODE_METRIC_SCORE,
+    EPISODE_METRICS
+} EpisodeMetric;
+
+/**
+ * Columns of the misses table, the position is the main ball's after the step it got past the paddle.
+ */
+typedef enum MissMetric
+{
+    MISS_METRIC_EPISODE,
+    MISS_METRIC_STEP,
+    MISS_METRIC_PLAYER,
+    MISS_METRIC_X,
+    MISS_METRIC_Y,
+    MISS_METRICS
+} MissMetric;
+
+/**
+ * Metrics writer internal data.
+ */
+typedef struct MetricsWriter MetricsWriter;
+
+/**
+ * Metrics file internal data.
+ */
+typedef struct MetricsFile MetricsFile;
+
+/**
+ * Counters for how a writer did.
+ */
+typedef struct MetricsWriterStats
+{
+    // rows added to each table
+    uint64_t rows[METRICS_TABLES];
+
+    // blocks written, and the bytes their values took before and after encoding
+    uint64_t blocks;
+    uint64_t raw_bytes;
+    uint64_t encoded_bytes;
+
+    // times the game thread had to wait for the writer to hand back a block
+    uint64_t stalls;
+} MetricsWriterStats;
+
+/**
+ * Get the name of a table.
+ *
+ * @param table
+ *   Table.
+ *
+ * @returns
+ *   Name of the table.
+ */
+const char *get_metrics_table_name(MetricsTable table);
+
+/**
+ * Get the number of columns in a table.
+ *
+ * @param table
+ *   Table.
+ *
+ * @returns
+ *   Number of columns.
+ */
+uint32_t get_metrics_column_count(MetricsTable table);
+
+/**
+ * Get the name of a column.
+ *
+ * @param table
+ *   Table the column is in.
+ *
+ * @param column
+ *   Column, less than get_metrics_column_count.
+ *
+ * @returns
+ *   Name of the column.
+ */
+const char *get_metrics_column_name(MetricsTable table, uint32_t column);
+
+/**
+ * Create a writer for a new metrics file and start its background thread.
+ *
+ * @param writer
+ *   Created writer.
+ *
+ * @param path
+ *   File to write.
+ *
+ * @param blocks
+ *   Blocks in the pool, at least METRICS_TABLES + 1.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result create_metrics_writer(MetricsWriter **writer, const char *path, size_t blocks);
+
+/**
+ * Add a row to a table. Only waits if every block in the pool is full and waiting to be written.
+ *
+ * @param writer
+ *   Writer to add to.
+ *
+ * @param table
+ *   Table to add to.
+ *
+ * @param values
+ *   A value for each column of the table.
+ */
+void add_metrics_row(MetricsWriter *writer, MetricsTable table, const int64_t *values);
+
+/**
+ * Write the partly filled blocks, wait for the background thread to write everything, then write the index and
+ * trailer. No rows can be added afterwards.
+ *
+ * @param writer
+ *   Writer to finish.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if anything couldn't be written
+ */
+Result finish_metrics_writer(MetricsWriter *writer);
+
+/**
+ * Get the counters of a finished writer.
+ *
+ * @param writer
+ *   Writer finished with finish_metrics_writer.
+ *
+ * @param stats
+ *   Out parameter for the counters.
+ */
+void get_metrics_writer_stats(const MetricsWriter *writer, MetricsWriterStats *stats);
+
+/**
+ * Destroy a writer, stopping its background thread. A writer that wasn't finished leaves an unreadable file.
+ *
+ * @param writer
+ *   Writer to destroy.
+ */
+void destroy_metrics_writer(MetricsWriter *writer);
+
+/**
+ * Open a metrics file for reading.
+ *
+ * @param metrics
+ *   Opened file.
+ *
+ * @param path
+ *   File written by a metrics writer.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the file can't be read or isn't a finished metrics file
+ */
+Result open_metrics(MetricsFile **metrics, const char *path);
+
+/**
+ * Close a metrics file.
+ *
+ * @param metrics
+ *   File to close.
+ */
+void close_metrics(MetricsFile *metrics);
+
+/**
+ * Get the number of rows in a table.
+ *
+ * @param metrics
+ *   File to look in.
+ *
+ * @param table
+ *   Table.
+ *
+ * @returns
+ *   Number of rows.
+ */
+uint64_t get_metrics_rows(const MetricsFile *metrics, MetricsTable table);
+
+/**
+ * Get the bytes a column takes in the file.
+ *
+ * @param metrics
+ *   File to look in.
+ *
+ * @param table
+ *   Table the column is in.
+ *
+ * @param column
+ *   Column.
+ *
+ * @returns
+ *   Encoded size of the column.
+ */
+uint64_t get_metrics_column_bytes(const MetricsFile *metrics, MetricsTable table, uint32_t column);
+
+/**
+ * Decode every value of a column, reading only that column's part of each block.
+ *
+ * @param metrics
+ *   File to read.
+ *
+ * @param table
+ *   Table the column is in.
+ *
+ * @param column
+ *   Column.
+ *
+ * @param values
+ *   Where to write the values, room for get_metrics_rows of the table.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the column is damaged
+ */
+Result read_metrics_column(const MetricsFile *metrics, MetricsTable table, uint32_t column, int64_t *values);
+
+#endif
@@ -0,0 +1,542 @@
+#include <arpa/inet.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "alloc.h"
+#include "netplay.h"
+#include "rewind.h"
+#include "timer.h"
+
+/**
+ * Number of steps of inputs kept for each side, must cover the rollback window plus inputs still in flight.
+ */
+#define INPUT_RING 1024u
+
+/**
+ * Identifies our packets, "BRKN".
+ */
+#define PACKET_MAGIC 0x42524b4eu
+
+/**
+ * Packet header: magic, player, acknowledged step count, first step and number of steps of keys that follow.
+ */
+#define PACKET_HEADER_SIZE (4u + 1u + 8u + 8u + 2u)
+#define MAX_PACKET_SIZE (PACKET_HEADER_SIZE + NETPLAY_MAX_ROLLBACK)
+
+/**
+ * Packets are sent at most this often, inputs for the steps in between are batched into the next packet.
+ */
+#define SEND_INTERVAL_NS 1000000u
+
+/**
+ * Give up if nothing arrives from the other side for this long.
+ */
+#define TIMEOUT_NS 10000000000u
+
+/**
+ * Number of outgoing packets that can be held back to simulate latency.
+ */
+#define DELAY_QUEUE_SIZE 1024u
+
+/**
+ * Keys packed into a byte.
+ */
+#define KEY_LEFT 0x01u
+#define KEY_RIGHT 0x02u
+
+/**
+ * Outgoing packet held back to simulate latency.
+ */
+typedef struct DelayedPacket
+{
+    uint64_t due_ns;
+    size_t size;
+    uint8_t data[MAX_PACKET_SIZE];
+} DelayedPacket;
+
+typedef struct Netplay
+{
+    Game *game;
+    Rewind *history;
+    uint32_t player;
+
+    int socket;
+    struct sockaddr_in remote;
+
+    // keys for step s are at [s % INPUT_RING]
+    uint8_t local_keys[INPUT_RING];
+    uint8_t remote_keys[INPUT_RING];
+    // remote keys each simulated step actually used, real or predicted
+    uint8_t used_remote_keys[INPUT_RING];
+
+    // remote keys are known for steps before remote_count, the other side has ours for steps before peer_ack
+    uint64_t remote_count;
+    uint64_t peer_ack;
+
+    // first step simulated with a wrong prediction, UINT64_MAX if there isn't one
+    uint64_t rollback_from;
+
+    uint64_t last_send_ns;
+    uint64_t last_receive_ns;
+
+    // network simulation
+    uint32_t latency_ms;
+    uint32_t loss_percent;
+    uint32_t seed;
+    DelayedPacket *queue;
+    size_t queue_first;
+    size_t queue_count;
+
+    NetplayStats stats;
+} Netplay;
+
+/**
+ * Helper function to pack keys into a byte.
+ *
+ * @param input
+ *   Keys to pack.
+ *
+ * @returns
+ *   Packed keys.
+ */
+static uint8_t pack_keys(const GameInput *input)
+{
+    return (uint8_t)((input->left ? KEY_LEFT : 0u) | (input->right ? KEY_RIGHT : 0u));
+}
+
+/**
+ * Helper function to unpack keys from a byte.
+ *
+ * @param keys
+ *   Packed keys.
+ *
+ * @returns
+ *   Unpacked keys.
+ */
+static GameInput unpack_keys(uint8_t keys)
+{
+    return (GameInput){.left = (keys & KEY_LEFT) != 0u, .right = (keys & KEY_RIGHT) != 0u};
+}
+
+/**
+ * Helper function to roll a random number for dropping packets (xorshift32).
+ *
+ * @param seed
+ *   Random state to advance.
+ *
+ * @returns
+ *   Random number.
+ */
+static uint32_t next_random(uint32_t *seed)
+{
+    uint32_t x = *seed;
+    x ^= x << 13u;
+    x ^= x >> 17u;
+    x ^= x << 5u;
+    *seed = x;
+    return x;
+}
+
+/**
+ * Helper function to send any held back packets that are due.
+ *
+ * @param netplay
+ *   Netplay session to send for.
+ *
+ * @param now
+ *   Current time.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result flush_packets(Netplay *netplay, uint64_t now)
+{
+    while (netplay->queue_count > 0u)
+    {
+        const DelayedPacket *packet = &netplay->queue[netplay->queue_first];
+        if (packet->due_ns > now)
+        {
+            break;
+        }
+
+        // a full socket buffer is just more packet loss, the next packet repeats everything
+        if ((sendto(
+                 netplay->socket,
+                 packet->data,
+                 packet->size,
+                 0,
+                 (const struct sockaddr *)&netplay->remote,
+                 sizeof(netplay->remote)) < 0) &&
+            (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != ECONNREFUSED))
+        {
+            return FAILED;
+        }
+
+        netplay->queue_first = (netplay->queue_first + 1u) % DELAY_QUEUE_SIZE;
+        --netplay->queue_count;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * Helper function to send every local input the other side hasn't acknowledged.
+ *
+ * @param netplay
+ *   Netplay session to send for.
+ *
+ * @param now
+ *   Current time.
+ */
+static void send_inputs(Netplay *netplay, uint64_t now)
+{
+    const uint64_t local_count = netplay->game->state.step;
+    const uint64_t first = netplay->peer_ack;
+    const uint64_t available = (local_count > first) ? (local_count - first) : 0u;
+    const uint16_t count = (uint16_t)((available > NETPLAY_MAX_ROLLBACK) ? NETPLAY_MAX_ROLLBACK : available);
+
+    netplay->last_send_ns = now;
+    ++netplay->stats.packets_sent;
+
+    if ((next_random(&netplay->seed) % 100u) < netplay->loss_percent)
+    {
+        ++netplay->stats.packets_dropped;
+        return;
+    }
+
+    if (netplay->queue_count == DELAY_QUEUE_SIZE)
+    {
+        ++netplay->stats.packets_dropped;
+        return;
+    }
+
+    DelayedPacket *packet = &netplay->queue[(netplay->queue_first + netplay->queue_count) % DELAY_QUEUE_SIZE];
+    ++netplay->queue_count;
+
+    const uint32_t magic = PACKET_MAGIC;
+    const uint8_t player = (uint8_t)netplay->player;
+    memcpy(&packet->data[0], &magic, sizeof(magic));
+    memcpy(&packet->data[4], &player, sizeof(player));
+    memcpy(&packet->data[5], &netplay->remote_count, sizeof(netplay->remote_count));
+    memcpy(&packet->data[13], &first, sizeof(first));
+    memcpy(&packet->data[21], &count, sizeof(count));
+    for (uint16_t i = 0u; i < count; ++i)
+    {
+        packet->data[PACKET_HEADER_SIZE + i] = netplay->local_keys[(first + i) % INPUT_RING];
+    }
+
+    packet->size = PACKET_HEADER_SIZE + count;
+    packet->due_ns = now + ((uint64_t)netplay->latency_ms * 1000000u);
+}
+
+/**
+ * Helper function to take the new inputs out of a received packet.
+ *
+ * @param netplay
+ *   Netplay session that received the packet.
+ *
+ * @param data
+ *   Packet data.
+ *
+ * @param size
+ *   Packet size.
+ */
+static void read_packet(Netplay *netplay, const uint8_t *data, size_t size)
+{
+    uint32_t magic = 0u;
+    uint8_t player = 0u;
+    uint64_t ack = 0u;
+    uint64_t first = 0u;
+    uint16_t count = 0u;
+
+    if (size < PACKET_HEADER_SIZE)
+    {
+        return;
+    }
+
+    memcpy(&magic, &data[0], sizeof(magic));
+    memcpy(&player, &data[4], sizeof(player));
+    memcpy(&ack, &data[5], sizeof(ack));
+    memcpy(&first, &data[13], sizeof(first));
+    memcpy(&count, &data[21], sizeof(count));
+    if ((magic != PACKET_MAGIC) || (player == netplay->player) || (size != (PACKET_HEADER_SIZE + count)))
+    {
+        return;
+    }
+
+    ++netplay->stats.packets_received;
+
+    if (ack > netplay->peer_ack)
+    {
+        netplay->peer_ack = ack;
+    }
+
+    // only take the next inputs in order, anything after a gap is sent again in a later packet
+    const uint64_t step = netplay->game->state.step;
+    while ((netplay->remote_count >= first) && (netplay->remote_count < (first + count)) &&
+           (netplay->remote_count < (step + INPUT_RING - NETPLAY_MAX_ROLLBACK)))
+    {
+        const uint64_t index = netplay->remote_count;
+        const uint8_t keys = data[PACKET_HEADER_SIZE + (index - first)];
+
+        netplay->remote_keys[index % INPUT_RING] = keys;
+        if ((index < step) && (netplay->used_remote_keys[index % INPUT_RING] != keys) &&
+            (index < netplay->rollback_from))
+        {
+            netplay->rollback_from = index;
+        }
+
+        ++netplay->remote_count;
+    }
+}
+
+/**
+ * Helper function to simulate one step with the best inputs known.
+ *
+ * @param netplay
+ *   Netplay session to simulate.
+ *
+ * @param outcome
+ *   Out parameter for what happened during the step.
+ */
+static void simulate_step(Netplay *netplay, StepOutcome *outcome)
+{
+    Game *game = netplay->game;
+    const uint64_t step = game->state.step;
+    const uint32_t remote_player = 1u - netplay->player;
+
+    // predict the other side keeps holding what it last held
+    uint8_t remote = 0u;
+    if (step < netplay->remote_count)
+    {
+        remote = netplay->remote_keys[step % INPUT_RING];
+    }
+    else if (netplay->remote_count > 0u)
+    {
+        remote = netplay->remote_keys[(netplay->remote_count - 1u) % INPUT_RING];
+    }
+    netplay->used_remote_keys[step % INPUT_RING] = remote;
+
+    GameInput inputs[GAME_MAX_PLAYERS];
+    inputs[netplay->player] = unpack_keys(netplay->local_keys[step % INPUT_RING]);
+    inputs[remote_player] = unpack_keys(remote);
+
+    step_game(game, inputs, outcome);
+    record_rewind(netplay->history, game, outcome);
+}
+
+/**
+ * Helper function to go back to the first mispredicted step and simulate forward again.
+ *
+ * @param netplay
+ *   Netplay session to fix up.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the step is no longer in the history
+ */
+static Result rollback(Netplay *netplay)
+{
+    Game *game = netplay->game;
+    const uint64_t target = game->state.step;
+    const uint64_t from = netplay->rollback_from;
+    const uint64_t start = get_time_ns();
+
+    netplay->rollback_from = UINT64_MAX;
+
+    if (restore_rewind(netplay->history, game, from) != SUCCESS)
+    {
+        return FAILED;
+    }
+
+    // the effects of these steps were shown when they were first simulated
+    StepOutcome outcome;
+    while ((game->state.step < target) && !is_game_over(game))
+    {
+        simulate_step(netplay, &outcome);
+    }
+
+    const uint64_t depth = target - from;
+    ++netplay->stats.rollbacks;
+    netplay->stats.resimulated_steps += depth;
+    netplay->stats.max_rollback = (depth > netplay->stats.max_rollback) ? depth : netplay->stats.max_rollback;
+    netplay->stats.resimulate_ns += get_time_ns() - start;
+
+    return SUCCESS;
+}
+
+Result create_netplay(Netplay **netplay, Game *game, const NetplayConfig *config)
+{
+    assert(netplay != NULL);
+    assert(game != NULL);
+    assert(config != NULL);
+    assert(config->player < GAME_MAX_PLAYERS);
+
+    Result res = SUCCESS;
+
+    if (game->players != 2u)
+    {
+        res = FAILED;
+        return res;
+    }
+
+    Netplay *n_netplay = (Netplay *)TRACKED_CALLOC(1u, sizeof(Netplay));
+    if (n_netplay == NULL)
+    {
+        res = FAILED;
+        return res;
+    }
+
+    n_netplay->socket = -1;
+    n_netplay->game = game;
+    n_netplay->player = config->player;
+    n_netplay->rollback_from = UINT64_MAX;
+    n_netplay->latency_ms = config->latency_ms;
+    n_netplay->loss_percent = config->loss_percent;
+    n_netplay->seed = 0x9e3779b9u ^ ((uint32_t)config->local_port << 8u) ^ config->player;
+    n_netplay->last_receive_ns = get_time_ns();
+
+    n_netplay->remote.sin_family = AF_INET;
+    n_netplay->remote.sin_port = htons(config->remote_port);
+
+    struct sockaddr_in local = {0};
+    local.sin_family = AF_INET;
+    local.sin_port = htons(config->local_port);
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    n_netplay->queue = (DelayedPacket *)TRACKED_CALLOC(DELAY_QUEUE_SIZE, sizeof(DelayedPacket));
+    n_netplay->socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if ((n_netplay->queue == NULL) || (n_netplay->socket < 0) ||
+        (inet_pton(AF_INET, config->remote_address, &n_netplay->remote.sin_addr) != 1) ||
+        (bind(n_netplay->socket, (const struct sockaddr *)&local, sizeof(local)) != 0) ||
+        (fcntl(n_netplay->socket, F_SETFL, O_NONBLOCK) != 0) ||
+        (create_rewind(&n_netplay->history, 2u * NETPLAY_MAX_ROLLBACK) != SUCCESS))
+    {
+        res = FAILED;
+        destroy_netplay(n_netplay);
+        return res;
+    }
+
+    record_rewind(n_netplay->history, game, NULL);
+
+    // assign the netplay session to the user supplied pointer
+    *netplay = n_netplay;
+    return res;
+}
+
+void destroy_netplay(Netplay *netplay)
+{
+    if (netplay == NULL)
+    {
+        return;
+    }
+
+    if (netplay->socket >= 0)
+    {
+        close(netplay->socket);
+    }
+
+    destroy_rewind(netplay->history);
+    free_tracked(netplay->queue);
+    free_tracked(netplay);
+}
+
+Result poll_netplay(Netplay *netplay)
+{
+    assert(netplay != NULL);
+
+    Result result = SUCCESS;
+    const uint64_t now = get_time_ns();
+
+    uint8_t data[MAX_PACKET_SIZE + 1u];
+    for (;;)
+    {
+        const ssize_t size = recv(netplay->socket, data, sizeof(data), 0);
+        if (size < 0)
+        {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == ECONNREFUSED))
+            {
+                break;
+            }
+
+            result = FAILED;
+            return result;
+        }
+
+        netplay->last_receive_ns = now;
+        read_packet(netplay, data, (size_t)size);
+    }
+
+    if ((netplay->rollback_from != UINT64_MAX) && (rollback(netplay) != SUCCESS))
+    {
+        result = FAILED;
+        return result;
+    }
+
+    if ((now - netplay->last_send_ns) >= SEND_INTERVAL_NS)
+    {
+        send_inputs(netplay, now);
+    }
+
+    if ((flush_packets(netplay, now) != SUCCESS) || ((now - netplay->last_receive_ns) > TIMEOUT_NS))
+    {
+        result = FAILED;
+        return result;
+    }
+
+    return result;
+}
+
+Result advance_netplay(Netplay *netplay, const GameInput *input, StepOutcome *outcome)
+{
+    assert(netplay != NULL);
+    assert(input != NULL);
+    assert(outcome != NULL);
+
+    if (poll_netplay(netplay) != SUCCESS)
+    {
+        return FAILED;
+    }
+
+    // wait rather than get further ahead than a rollback can reach
+    const uint64_t step = netplay->game->state.step;
+    uint64_t oldest = 0u;
+    uint64_t newest = 0u;
+    get_rewind_range(netplay->history, &oldest, &newest);
+    if ((step > netplay->remote_count) &&
+        (((step - netplay->remote_count) >= NETPLAY_MAX_ROLLBACK) || (netplay->remote_count < oldest)))
+    {
+        return NO_EVENT;
+    }
+
+    netplay->local_keys[step % INPUT_RING] = pack_keys(input);
+    simulate_step(netplay, outcome);
+
+    return SUCCESS;
+}
+
+bool is_netplay_settled(const Netplay *netplay)
+{
+    assert(netplay != NULL);
+
+    const uint64_t step = netplay->game->state.step;
+
+    return (netplay->rollback_from == UINT64_MAX) && (netplay->remote_count >= step) && (netplay->peer_ack >= step);
+}
+
+void get_netplay_stats(const Netplay *netplay, NetplayStats *stats)
+{
+    assert(netplay != NULL);
+    assert(stats != NULL);
+
+    *stats = netplay->stats;
+}
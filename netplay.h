@@ -0,0 +1,148 @@
+#ifndef _NETPLAY_H_
+#define _NETPLAY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "game.h"
+#include "result.h"
+
+/**
+ * Netplay runs a two player game between two processes over UDP using rollback.
+ *
+ * Each side only sends the keys its player holds each step. The game always steps straight away using the local keys
+ * and a prediction of the remote keys (whatever they held last). When the real remote keys arrive and differ from the
+ * prediction the game is restored to the first mispredicted step from a rewind history and simulated forward again.
+ * The simulation must be deterministic, both sides run the same steps with the same inputs.
+ *
+ * Every packet carries all the keys the other side hasn't acknowledged yet, so lost packets are covered by the next one
+ * and there are no retransmit timers. Latency and loss can be added to outgoing packets to test on one machine.
+ */
+
+/**
+ * Most steps one side can get ahead of the inputs it has from the other, it waits for the other side beyond this.
+ */
+#define NETPLAY_MAX_ROLLBACK 256u
+
+/**
+ * Default UDP port for player 0, player 1 uses the next port up.
+ */
+#define NETPLAY_DEFAULT_PORT 7000u
+
+/**
+ * Netplay internal data.
+ */
+typedef struct Netplay Netplay;
+
+/**
+ * Settings for a netplay session.
+ */
+typedef struct NetplayConfig
+{
+    // player this side controls, 0 or 1
+    uint32_t player;
+
+    // address and port of the other side, and the port to listen on
+    const char *remote_address;
+    uint16_t remote_port;
+    uint16_t local_port;
+
+    // simulated network conditions applied to packets this side sends
+    uint32_t latency_ms;
+    uint32_t loss_percent;
+} NetplayConfig;
+
+/**
+ * Statistics about rollbacks so far.
+ */
+typedef struct NetplayStats
+{
+    uint64_t rollbacks;
+    uint64_t resimulated_steps;
+    uint64_t max_rollback;
+    uint64_t resimulate_ns;
+    uint64_t packets_sent;
+    uint64_t packets_received;
+    uint64_t packets_dropped;
+} NetplayStats;
+
+/**
+ * Create a new netplay session.
+ *
+ * @param netplay
+ *   Created netplay session.
+ *
+ * @param game
+ *   Two player game to run, it must be in the same state on both sides.
+ *
+ * @param config
+ *   Session settings.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result create_netplay(Netplay **netplay, Game *game, const NetplayConfig *config);
+
+/**
+ * Destroy a netplay session.
+ *
+ * @param netplay
+ *   Netplay session to destroy.
+ */
+void destroy_netplay(Netplay *netplay);
+
+/**
+ * Exchange inputs with the other side and fix up the game if earlier predictions were wrong.
+ *
+ * @param netplay
+ *   Netplay session to update.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the network failed, the sides fell out of step or the other side stopped responding
+ */
+Result poll_netplay(Netplay *netplay);
+
+/**
+ * Poll, then advance the game one step with the local player's keys.
+ *
+ * @param netplay
+ *   Netplay session to advance.
+ *
+ * @param input
+ *   Keys held by the local player for this step.
+ *
+ * @param outcome
+ *   Out parameter for what happened during the step.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   NO_EVENT if the game is too far ahead of the other side and has to wait
+ *   FAILED if polling failed
+ */
+Result advance_netplay(Netplay *netplay, const GameInput *input, StepOutcome *outcome);
+
+/**
+ * Check if both sides agree on every step up to the current one, so the game can't change under a rollback.
+ *
+ * @param netplay
+ *   Netplay session to check.
+ *
+ * @returns
+ *   True if all inputs up to the current step have been exchanged both ways, otherwise false.
+ */
+bool is_netplay_settled(const Netplay *netplay);
+
+/**
+ * Get rollback statistics.
+ *
+ * @param netplay
+ *   Netplay session to get statistics for.
+ *
+ * @param stats
+ *   Out parameter for statistics.
+ */
+void get_netplay_stats(const Netplay *netplay, NetplayStats *stats);
+
+#endif
@@ -0,0 +1,287 @@
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "observe.h"
+
+/**
+ * Number of pixels written by one vector store.
+ */
+#define LANES 16u
+
+/**
+ * Sixteen packed pixels, the compiler maps stores of these to SSE/NEON instructions.
+ */
+typedef uint8_t Pixel16 __attribute__((vector_size(LANES)));
+
+/**
+ * A batch being drawn, shared by its jobs.
+ */
+typedef struct ObservationBatch
+{
+    const Game *const *games;
+    const Block *views;
+    size_t count;
+    size_t groups;
+    uint8_t *pixels;
+    uint32_t width;
+    uint32_t height;
+} ObservationBatch;
+
+/**
+ * Mapping from world coordinates to pixels for one observation.
+ */
+typedef struct Raster
+{
+    uint8_t *pixels;
+    int32_t width;
+    int32_t height;
+    float left;
+    float top;
+    float scale_x;
+    float scale_y;
+} Raster;
+
+/**
+ * Helper function to fill a span of a row, a vector at a time while it lasts.
+ *
+ * @param row
+ *   Row to fill.
+ *
+ * @param first
+ *   First pixel of the span.
+ *
+ * @param end
+ *   One past the last pixel of the span.
+ *
+ * @param shade
+ *   Shade to fill with.
+ */
+static inline void fill_span(uint8_t *row, int32_t first, int32_t end, uint8_t shade)
+{
+    const Pixel16 fill = (Pixel16){0} + shade;
+    int32_t x = first;
+
+    for (; (x + (int32_t)LANES) <= end; x += (int32_t)LANES)
+    {
+        memcpy(&row[x], &fill, sizeof(fill));
+    }
+
+    // a span at least a vector wide ends with one more store overlapping what was already filled
+    if ((x < end) && ((end - first) >= (int32_t)LANES))
+    {
+        memcpy(&row[end - (int32_t)LANES], &fill, sizeof(fill));
+        return;
+    }
+
+    for (; x < end; ++x)
+    {
+        row[x] = shade;
+    }
+}
+
+/**
+ * Helper function to fill the pixels whose centres are inside a block.
+ *
+ * @param raster
+ *   Observation being drawn.
+ *
+ * @param block
+ *   Block to fill.
+ *
+ * @param shade
+ *   Shade to fill with.
+ */
+static void fill_block(const Raster *raster, const Block *block, uint8_t shade)
+{
+    const float x = (scalar_to_float(block->position.x) - raster->left) * raster->scale_x;
+    const float y = (scalar_to_float(block->position.y) - raster->top) * raster->scale_y;
+    const float right = x + (scalar_to_float(block->width) * raster->scale_x);
+    const float bottom = y + (scalar_to_float(block->height) * raster->scale_y);
+
+    // pixel i has its centre at i + 0.5, so it is covered when x <= i + 0.5 < right
+    int32_t first_x = (int32_t)ceilf(x - 0.5f);
+    int32_t end_x = (int32_t)ceilf(right - 0.5f);
+    int32_t first_y = (int32_t)ceilf(y - 0.5f);
+    int32_t end_y = (int32_t)ceilf(bottom - 0.5f);
+
+    first_x = (first_x > 0) ? first_x : 0;
+    first_y = (first_y > 0) ? first_y : 0;
+    end_x = (end_x < raster->width) ? end_x : raster->width;
+    end_y = (end_y < raster->height) ? end_y : raster->height;
+
+    for (int32_t row = first_y; (row < end_y) && (first_x < end_x); ++row)
+    {
+        fill_span(&raster->pixels[(size_t)row * (size_t)raster->width], first_x, end_x, shade);
+    }
+}
+
+void render_observation(const Game *game, const Block *view, uint8_t *pixels, uint32_t width, uint32_t height)
+{
+    assert(game != NULL);
+    assert(pixels != NULL);
+
+    const Block world = create_block_xy(SCALAR(0.0f), SCALAR(0.0f), game->width, game->height);
+    view = (view != NULL) ? view : &world;
+
+    const Raster raster = {
+        .pixels = pixels,
+        .width = (int32_t)width,
+        .height = (int32_t)height,
+        .left = scalar_to_float(view->position.x),
+        .top = scalar_to_float(view->position.y),
+        .scale_x = (float)width / scalar_to_float(view->width),
+        .scale_y = (float)height / scalar_to_float(view->height)};
+
+    memset(pixels, OBSERVE_BACKGROUND, (size_t)width * height);
+
+    // only the grid cells under the view, so a small view of a large level stays cheap
+    GridRange range;
+    get_brick_range(game, view, &range);
+    for (int32_t row = range.first_row; row <= range.last_row; ++row)
+    {
+        for (int32_t column = range.first_column; column <= range.last_column; ++column)
+        {
+            size_t count = 0u;
+            const uint32_t *indices = get_cell_bricks(game, column, row, &count);
+
+            for (size_t i = 0u; i < count; ++i)
+            {
+                if (is_brick_alive(game, indices[i]))
+                {
+                    fill_block(&raster, &get_brick(game, indices[i])->block, OBSERVE_BRICK);
+                }
+            }
+        }
+    }
+
+    const PowerupState *powerups = &game->state.powerups;
+    for (uint32_t i = 0u; i < GAME_MAX_DROPS; ++i)
+    {
+        if (((powerups->drops_used >> i) & 1u) != 0u)
+        {
+            fill_block(&raster, &powerups->drops[i].block, OBSERVE_DROP);
+        }
+    }
+
+    for (uint32_t player = 0u; player < game->players; ++player)
+    {
+        fill_block(&raster, &game->state.paddles[player].block, OBSERVE_PADDLE);
+    }
+
+    // balls last so nothing hides them
+    for (uint32_t i = 0u; i < (GAME_MAX_BALLS - 1u); ++i)
+    {
+        if (((powerups->extras_used >> i) & 1u) != 0u)
+        {
+            fill_block(&raster, &powerups->extra_balls[i].block, OBSERVE_BALL);
+        }
+    }
+    fill_block(&raster, &game->state.ball.block, OBSERVE_BALL);
+}
+
+/**
+ * Helper function to draw one group of a batch, a job function.
+ *
+ * @param data
+ *   Batch being drawn.
+ *
+ * @param group
+ *   Group to draw.
+ */
+static void render_batch_group(void *data, size_t group)
+{
+    const ObservationBatch *batch = (const ObservationBatch *)data;
+    const size_t size = (size_t)batch->width * batch->height;
+    const size_t first = (group * batch->count) / batch->groups;
+    const size_t end = ((group + 1u) * batch->count) / batch->groups;
+
+    for (size_t i = first; i < end; ++i)
+    {
+        render_observation(
+            batch->games[i],
+            (batch->views != NULL) ? &batch->views[i] : NULL,
+            &batch->pixels[i * size],
+            batch->width,
+            batch->height);
+    }
+}
+
+Result render_observation_batch(
+    JobSystem *jobs,
+    const Game *const *games,
+    const Block *views,
+    size_t count,
+    uint8_t *pixels,
+    uint32_t width,
+    uint32_t height)
+{
+    assert(games != NULL);
+    assert(pixels != NULL);
+
+    // a few groups per thread so uneven games even out, each group writes its own observations
+    const size_t threads = (jobs != NULL) ? get_job_threads(jobs) : 1u;
+    size_t groups = (jobs != NULL) ? (threads * 4u) : 1u;
+    groups = (groups < count) ? groups : count;
+    groups = (groups < JOB_MAX_JOBS) ? groups : JOB_MAX_JOBS;
+
+    ObservationBatch batch = {
+        .games = games,
+        .views = views,
+        .count = count,
+        .groups = groups,
+        .pixels = pixels,
+        .width = width,
+        .height = height};
+
+    if ((jobs == NULL) || (groups <= 1u))
+    {
+        for (size_t group = 0u; group < groups; ++group)
+        {
+            render_batch_group(&batch, group);
+        }
+        return SUCCESS;
+    }
+
+    for (size_t group = 0u; group < groups; ++group)
+    {
+        if (add_job(jobs, render_batch_group, &batch, group, NULL, 0u, NULL) != SUCCESS)
+        {
+            return FAILED;
+        }
+    }
+    run_jobs(jobs);
+
+    return SUCCESS;
+}
+
+ObservationStack create_observation_stack(uint8_t *frames, uint32_t width, uint32_t height, uint32_t depth)
+{
+    assert(frames != NULL);
+    assert(depth > 0u);
+
+    memset(frames, OBSERVE_BACKGROUND, (size_t)width * height * depth);
+
+    // the first push goes in frame 0
+    return (ObservationStack){.frames = frames, .width = width, .height = height, .depth = depth, .newest = depth - 1u};
+}
+
+void push_observation(ObservationStack *stack, const Game *game, const Block *view)
+{
+    assert(stack != NULL);
+
+    stack->newest = (stack->newest + 1u) % stack->depth;
+    render_observation(
+        game, view, &stack->frames[(size_t)stack->newest * stack->width * stack->height], stack->width, stack->height);
+}
+
+const uint8_t *get_observation(const ObservationStack *stack, uint32_t age)
+{
+    assert(stack != NULL);
+    assert(age < stack->depth);
+
+    const uint32_t frame = (stack->newest + stack->depth - age) % stack->depth;
+    return &stack->frames[(size_t)frame * stack->width * stack->height];
+}
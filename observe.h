@@ -0,0 +1,165 @@
+#ifndef _OBSERVE_H_
+#define _OBSERVE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "block.h"
+#include "game.h"
+#include "jobs.h"
+#include "result.h"
+
+/**
+ * Observe draws small grayscale pictures of a game (84 x 84 say) for agents and automated checks, straight from the
+ * game state into a byte buffer without going near SDL.
+ *
+ * Everything is drawn as a filled rectangle of whole pixels, a pixel is covered when its centre is inside a block.
+ * Each kind of object has its own shade, so the buffer can be read as grayscale or as a palette index. Pixels are one
+ * byte each, a row at a time from the top.
+ */
+
+/**
+ * Shade of pixels with nothing in them.
+ */
+#define OBSERVE_BACKGROUND 0u
+
+/**
+ * Shade of a falling power-up.
+ */
+#define OBSERVE_DROP 64u
+
+/**
+ * Shade of a brick.
+ */
+#define OBSERVE_BRICK 128u
+
+/**
+ * Shade of a paddle.
+ */
+#define OBSERVE_PADDLE 192u
+
+/**
+ * Shade of a ball.
+ */
+#define OBSERVE_BALL 255u
+
+/**
+ * The most recent observations of a game, kept in a buffer owned by the caller so agents can be given a stack of
+ * frames to see motion.
+ */
+typedef struct ObservationStack
+{
+    // depth frames of width * height pixels, frame newest is the latest
+    uint8_t *frames;
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth;
+    uint32_t newest;
+} ObservationStack;
+
+/**
+ * Draw an observation of a game.
+ *
+ * @param game
+ *   Game to draw.
+ *
+ * @param view
+ *   Part of the world to draw, or NULL for the whole world.
+ *
+ * @param pixels
+ *   Where to draw, width * height bytes.
+ *
+ * @param width
+ *   Width in pixels.
+ *
+ * @param height
+ *   Height in pixels.
+ */
+void render_observation(const Game *game, const Block *view, uint8_t *pixels, uint32_t width, uint32_t height);
+
+/**
+ * Draw an observation of each of a batch of games, split across the job system.
+ *
+ * @param jobs
+ *   Job system to draw with, or NULL to draw them all on the calling thread.
+ *
+ * @param games
+ *   Games to draw.
+ *
+ * @param views
+ *   Part of the world to draw for each game, or NULL for the whole world of every game.
+ *
+ * @param count
+ *   Number of games.
+ *
+ * @param pixels
+ *   Where to draw, count observations of width * height bytes one after the other.
+ *
+ * @param width
+ *   Width in pixels.
+ *
+ * @param height
+ *   Height in pixels.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the jobs could not be added
+ */
+Result render_observation_batch(
+    JobSystem *jobs,
+    const Game *const *games,
+    const Block *views,
+    size_t count,
+    uint8_t *pixels,
+    uint32_t width,
+    uint32_t height);
+
+/**
+ * Create a stack of observations in a caller supplied buffer. Every frame starts out blank.
+ *
+ * @param frames
+ *   Buffer of depth * width * height bytes, must outlive the stack.
+ *
+ * @param width
+ *   Width in pixels.
+ *
+ * @param height
+ *   Height in pixels.
+ *
+ * @param depth
+ *   Number of frames kept.
+ *
+ * @returns
+ *   Created stack.
+ */
+ObservationStack create_observation_stack(uint8_t *frames, uint32_t width, uint32_t height, uint32_t depth);
+
+/**
+ * Draw an observation of a game over the oldest frame of a stack, making it the newest.
+ *
+ * @param stack
+ *   Stack to draw into.
+ *
+ * @param game
+ *   Game to draw.
+ *
+ * @param view
+ *   Part of the world to draw, or NULL for the whole world.
+ */
+void push_observation(ObservationStack *stack, const Game *game, const Block *view);
+
+/**
+ * Get a frame of a stack.
+ *
+ * @param stack
+ *   Stack to look in.
+ *
+ * @param age
+ *   0 for the newest frame up to depth - 1 for the oldest.
+ *
+ * @returns
+ *   Pixels of the frame.
+ */
+const uint8_t *get_observation(const ObservationStack *stack, uint32_t age);
+
+#endif
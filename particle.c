@@ -0,0 +1,338 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "alloc.h"
+#include "particle.h"
+
+/**
+ * Downward acceleration applied every step.
+ */
+#define GRAVITY 0.0006f
+
+/**
+ * Size of each particle in pixels.
+ */
+#define PARTICLE_SIZE 3.0f
+
+/**
+ * Number of floats processed per SIMD lane group.
+ */
+#define LANES 4u
+
+/**
+ * Fewest lane groups integrated by one job, smaller systems are updated on the calling thread.
+ */
+#define BATCH_GROUPS 2048u
+
+/**
+ * Most batches one update is split into.
+ */
+#define MAX_BATCHES 64u
+
+/**
+ * Four packed floats, the compiler maps operations on these to SSE/NEON instructions.
+ */
+typedef float Float4 __attribute__((vector_size(LANES * sizeof(float))));
+
+/**
+ * Four packed comparison results, each lane is 0 or -1.
+ */
+typedef int32_t Int4 __attribute__((vector_size(LANES * sizeof(int32_t))));
+
+typedef struct ParticleSystem
+{
+    size_t capacity;
+    size_t count;
+
+    // structure of arrays, index i across all arrays is one particle. The float arrays are aligned and padded to a
+    // multiple of LANES so they can be processed as Float4
+    float *x;
+    float *y;
+    float *velocity_x;
+    float *velocity_y;
+    float *life;
+    uint32_t *colour;
+
+    // groups of LANES particles that had at least one particle expire this step. Each batch writes from its first
+    // group onwards, so batches never overlap
+    size_t *expired_groups;
+
+    // how the current update is split, and how many expired groups each batch found
+    size_t groups;
+    size_t batch_groups;
+    size_t batch_expired[MAX_BATCHES];
+
+    uint32_t seed;
+} ParticleSystem;
+
+/**
+ * Helper function to get a pseudo random number in [0, 1).
+ *
+ * @param particles
+ *   Particle system owning the random state.
+ *
+ * @returns
+ *   Random number.
+ */
+static float random_unit(ParticleSystem *particles)
+{
+    // xorshift32
+    uint32_t x = particles->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    particles->seed = x;
+
+    return (float)(x >> 8) / 16777216.0f;
+}
+
+/**
+ * Helper function to allocate a zeroed float array aligned and padded for Float4 access.
+ *
+ * @param capacity
+ *   Number of floats required.
+ *
+ * @returns
+ *   Allocated array or NULL on failure.
+ */
+static float *create_lane_array(size_t capacity)
+{
+    const size_t padded = ((capacity + LANES - 1u) / LANES) * LANES;
+    const size_t bytes = (padded == 0u ? LANES : padded) * sizeof(float);
+
+    return (float *)TRACKED_ALIGNED_CALLOC(sizeof(Float4), bytes);
+}
+
+Result create_particle_system(ParticleSystem **particles, size_t capacity)
+{
+    assert(particles != NULL);
+
+    Result res = SUCCESS;
+
+    ParticleSystem *n_particles = (ParticleSystem *)TRACKED_CALLOC(1u, sizeof(ParticleSystem));
+    if (n_particles == NULL)
+    {
+        res = FAILED;
+        return res;
+    }
+
+    n_particles->capacity = capacity;
+    n_particles->seed = 0x9e3779b9u;
+    n_particles->x = create_lane_array(capacity);
+    n_particles->y = create_lane_array(capacity);
+    n_particles->velocity_x = create_lane_array(capacity);
+    n_particles->velocity_y = create_lane_array(capacity);
+    n_particles->life = create_lane_array(capacity);
+    n_particles->colour = (uint32_t *)TRACKED_CALLOC(capacity, sizeof(uint32_t));
+    n_particles->expired_groups = (size_t *)TRACKED_CALLOC((capacity / LANES) + 1u, sizeof(size_t));
+
+    if ((n_particles->x == NULL) || (n_particles->y == NULL) || (n_particles->velocity_x == NULL) ||
+        (n_particles->velocity_y == NULL) || (n_particles->life == NULL) || (n_particles->colour == NULL) ||
+        (n_particles->expired_groups == NULL))
+    {
+        res = FAILED;
+        destroy_particle_system(n_particles);
+        return res;
+    }
+
+    // assign the particle system to the user supplied pointer
+    *particles = n_particles;
+    return res;
+}
+
+void destroy_particle_system(ParticleSystem *particles)
+{
+    if (particles == NULL)
+    {
+        return;
+    }
+
+    free_tracked(particles->x);
+    free_tracked(particles->y);
+    free_tracked(particles->velocity_x);
+    free_tracked(particles->velocity_y);
+    free_tracked(particles->life);
+    free_tracked(particles->colour);
+    free_tracked(particles->expired_groups);
+    free_tracked(particles);
+}
+
+void spawn_particle_burst(ParticleSystem *particles, const Block *block, uint8_t r, uint8_t g, uint8_t b, size_t count)
+{
+    assert(particles != NULL);
+    assert(block != NULL);
+
+    const float x = scalar_to_float(block->position.x);
+    const float y = scalar_to_float(block->position.y);
+    const float width = scalar_to_float(block->width);
+    const float height = scalar_to_float(block->height);
+    const uint32_t colour = ((uint32_t)r << 24u) | ((uint32_t)g << 16u) | ((uint32_t)b << 8u) | 0xffu;
+
+    for (size_t i = 0u; (i < count) && (particles->count < particles->capacity); ++i)
+    {
+        const size_t index = particles->count++;
+
+        particles->x[index] = x + (random_unit(particles) * width);
+        particles->y[index] = y + (random_unit(particles) * height);
+        particles->velocity_x[index] = (random_unit(particles) - 0.5f) * 0.6f;
+        particles->velocity_y[index] = (random_unit(particles) - 0.7f) * 0.5f;
+        particles->life[index] = 800.0f + (random_unit(particles) * 800.0f);
+        particles->colour[index] = colour;
+    }
+}
+
+/**
+ * Helper function to integrate one batch of lane groups, a job function.
+ *
+ * @param data
+ *   Particle system to update.
+ *
+ * @param batch
+ *   Batch to integrate.
+ */
+static void integrate_particle_batch(void *data, size_t batch)
+{
+    ParticleSystem *particles = (ParticleSystem *)data;
+
+    // integrate LANES particles at a time, the padding past count is harmless to update
+    Float4 *x4 = (Float4 *)particles->x;
+    Float4 *y4 = (Float4 *)particles->y;
+    const Float4 *velocity_x4 = (const Float4 *)particles->velocity_x;
+    Float4 *velocity_y4 = (Float4 *)particles->velocity_y;
+    Float4 *life4 = (Float4 *)particles->life;
+    const Float4 gravity = {GRAVITY, GRAVITY, GRAVITY, GRAVITY};
+    const Float4 one = {1.0f, 1.0f, 1.0f, 1.0f};
+    const Float4 zero = {0.0f, 0.0f, 0.0f, 0.0f};
+
+    const size_t first = batch * particles->batch_groups;
+    const size_t last = (first + particles->batch_groups < particles->groups) ? (first + particles->batch_groups)
+                                                                               : particles->groups;
+    size_t *expired_groups = &particles->expired_groups[first];
+    size_t expired_count = 0u;
+    for (size_t i = first; i < last; ++i)
+    {
+        velocity_y4[i] += gravity;
+        x4[i] += velocity_x4[i];
+        y4[i] += velocity_y4[i];
+        life4[i] -= one;
+
+        // remember which groups need looking at so the removal pass doesn't touch every particle
+        const Int4 expired = life4[i] <= zero;
+        if ((expired[0] | expired[1] | expired[2] | expired[3]) != 0)
+        {
+            expired_groups[expired_count++] = i;
+        }
+    }
+
+    particles->batch_expired[batch] = expired_count;
+}
+
+/**
+ * Helper function to remove the particles that expired in every batch, a job function.
+ *
+ * @param data
+ *   Particle system to update.
+ *
+ * @param batches
+ *   Number of batches integrated.
+ */
+static void remove_expired_particles(void *data, size_t batches)
+{
+    ParticleSystem *particles = (ParticleSystem *)data;
+    float *x = particles->x;
+    float *y = particles->y;
+    float *velocity_x = particles->velocity_x;
+    float *velocity_y = particles->velocity_y;
+    float *life = particles->life;
+
+    // swap-remove expired particles, walking backwards through the batches and their groups so the particle swapped
+    // in from the end has already been checked
+    size_t live = particles->count;
+    for (size_t batch = batches; batch > 0u; --batch)
+    {
+        const size_t *expired_groups = &particles->expired_groups[(batch - 1u) * particles->batch_groups];
+        for (size_t g = particles->batch_expired[batch - 1u]; g > 0u; --g)
+        {
+            const size_t first = expired_groups[g - 1u] * LANES;
+            for (size_t i = first + LANES; i > first; --i)
+            {
+                const size_t index = i - 1u;
+                if ((index < live) && (life[index] <= 0.0f))
+                {
+                    --live;
+                    x[index] = x[live];
+                    y[index] = y[live];
+                    velocity_x[index] = velocity_x[live];
+                    velocity_y[index] = velocity_y[live];
+                    life[index] = life[live];
+                    particles->colour[index] = particles->colour[live];
+                }
+            }
+        }
+    }
+
+    particles->count = live;
+}
+
+void update_particle_system(ParticleSystem *particles, JobSystem *jobs)
+{
+    assert(particles != NULL);
+
+    particles->groups = (particles->count + LANES - 1u) / LANES;
+    particles->batch_groups = particles->groups;
+    size_t batches = 1u;
+
+    if ((jobs != NULL) && (get_job_threads(jobs) > 1u) && (particles->groups > BATCH_GROUPS))
+    {
+        // a few batches per thread so stealing can even out the load
+        const size_t target = (get_job_threads(jobs) * 4u < MAX_BATCHES) ? (get_job_threads(jobs) * 4u) : MAX_BATCHES;
+        particles->batch_groups = (particles->groups + target - 1u) / target;
+        particles->batch_groups = (particles->batch_groups < BATCH_GROUPS) ? BATCH_GROUPS : particles->batch_groups;
+        batches = (particles->groups + particles->batch_groups - 1u) / particles->batch_groups;
+    }
+
+    if (batches == 1u)
+    {
+        integrate_particle_batch(particles, 0u);
+        remove_expired_particles(particles, 1u);
+        return;
+    }
+
+    // removal has to see every batch, it merges them in batch order so the result doesn't depend on timing
+    JobId integrated[MAX_BATCHES];
+    Result added = SUCCESS;
+    for (size_t batch = 0u; (batch < batches) && (added == SUCCESS); ++batch)
+    {
+        added = add_job(jobs, integrate_particle_batch, particles, batch, NULL, 0u, &integrated[batch]);
+    }
+    if (added == SUCCESS)
+    {
+        added = add_job(jobs, remove_expired_particles, particles, batches, integrated, batches, NULL);
+    }
+
+    // the pool only runs out if the caller left too many jobs queued, which is a programming error
+    assert(added == SUCCESS);
+    run_jobs(jobs);
+}
+
+size_t particle_count(const ParticleSystem *particles)
+{
+    assert(particles != NULL);
+
+    return particles->count;
+}
+
+size_t particle_capacity(const ParticleSystem *particles)
+{
+    assert(particles != NULL);
+
+    return particles->capacity;
+}
+
+Result draw_particle_system(const ParticleSystem *particles, Window *window)
+{
+    assert(particles != NULL);
+
+    return draw_particles_window(
+        window, particles->x, particles->y, particles->colour, particles->count, PARTICLE_SIZE);
+}
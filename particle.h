@@ -0,0 +1,121 @@
+#ifndef _PARTICLE_H_
+#define _PARTICLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "block.h"
+#include "jobs.h"
+#include "result.h"
+#include "window.h"
+
+/**
+ * Particle system for debris effects.
+ *
+ * Particles are stored as a fixed capacity structure of arrays, expired particles are swap-removed so the live
+ * particles are always packed at the front of the arrays. Nothing is allocated after creation.
+ */
+
+/**
+ * Particle system internal data.
+ */
+typedef struct ParticleSystem ParticleSystem;
+
+/**
+ * Create a new particle system.
+ *
+ * @param particles
+ *   Created particle system.
+ *
+ * @param capacity
+ *   Maximum number of live particles, new particles are dropped when full.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result create_particle_system(ParticleSystem **particles, size_t capacity);
+
+/**
+ * Destroy a particle system.
+ *
+ * @param particles
+ *   Particle system to destroy.
+ */
+void destroy_particle_system(ParticleSystem *particles);
+
+/**
+ * Spawn a burst of debris from a block.
+ *
+ * @param particles
+ *   Particle system to spawn in.
+ *
+ * @param block
+ *   Block the debris comes from, particles start at random points inside it.
+ *
+ * @param r
+ *   Red channel value.
+ *
+ * @param g
+ *   Green channel value.
+ *
+ * @param b
+ *   Blue channel value.
+ *
+ * @param count
+ *   Number of particles to spawn.
+ */
+void spawn_particle_burst(ParticleSystem *particles, const Block *block, uint8_t r, uint8_t g, uint8_t b, size_t count);
+
+/**
+ * Advance all particles by one step and remove expired ones. Large systems are integrated in batches across the job
+ * system, the result is the same however the work is split.
+ *
+ * @param particles
+ *   Particle system to update.
+ *
+ * @param jobs
+ *   Job system to split the update across, may be NULL to update on the calling thread.
+ */
+void update_particle_system(ParticleSystem *particles, JobSystem *jobs);
+
+/**
+ * Get the number of live particles.
+ *
+ * @param particles
+ *   Particle system to query.
+ *
+ * @returns
+ *   Number of live particles.
+ */
+size_t particle_count(const ParticleSystem *particles);
+
+/**
+ * Get the most particles the system can hold, which is also the largest batch draw_particle_system will draw.
+ *
+ * @param particles
+ *   Particle system to query.
+ *
+ * @returns
+ *   Number of particles.
+ */
+size_t particle_capacity(const ParticleSystem *particles);
+
+/**
+ * Draw all live particles in a single batch.
+ *
+ * This *must* be called after window_pre_render and before window_post_render for any given frame.
+ *
+ * @param particles
+ *   Particle system to draw.
+ *
+ * @param window
+ *   Window to draw to.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result draw_particle_system(const ParticleSystem *particles, Window *window);
+
+#endif
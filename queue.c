@@ -0,0 +1,63 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "alloc.h"
+#include "queue.h"
+
+Result create_queue(Queue *queue, size_t capacity)
+{
+    assert(queue != NULL);
+
+    size_t size = 1u;
+    while (size < capacity)
+    {
+        size *= 2u;
+    }
+
+    queue->items = (uint32_t *)TRACKED_CALLOC(size, sizeof(uint32_t));
+    queue->mask = size - 1u;
+    atomic_init(&queue->head, 0u);
+    atomic_init(&queue->tail, 0u);
+
+    return (queue->items == NULL) ? FAILED : SUCCESS;
+}
+
+void destroy_queue(Queue *queue)
+{
+    if (queue == NULL)
+    {
+        return;
+    }
+
+    free_tracked(queue->items);
+    queue->items = NULL;
+}
+
+bool push_queue(Queue *queue, uint32_t item)
+{
+    const size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    if ((tail - atomic_load_explicit(&queue->head, memory_order_acquire)) > queue->mask)
+    {
+        return false;
+    }
+
+    queue->items[tail & queue->mask] = item;
+    atomic_store_explicit(&queue->tail, tail + 1u, memory_order_release);
+    return true;
+}
+
+bool pop_queue(Queue *queue, uint32_t *item)
+{
+    const size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    if (head == atomic_load_explicit(&queue->tail, memory_order_acquire))
+    {
+        return false;
+    }
+
+    *item = queue->items[head & queue->mask];
+    atomic_store_explicit(&queue->head, head + 1u, memory_order_release);
+    return true;
+}
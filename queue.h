@@ -0,0 +1,83 @@
+#ifndef _QUEUE_H_
+#define _QUEUE_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "result.h"
+
+/**
+ * Queue is a bounded single producer single consumer queue of 32 bit items, for handing slot or block numbers between
+ * two threads without a lock. One thread only pushes and the other only pops.
+ *
+ * The queue is plain data so it can be embedded in whatever the two threads share, which should be allocated aligned
+ * to CACHE_LINE.
+ */
+
+/**
+ * Keeps each end of a queue on its own cache line so the two threads don't contend on each other's index.
+ */
+#define CACHE_LINE 64
+
+typedef struct Queue
+{
+    _Alignas(CACHE_LINE) atomic_size_t head;
+    _Alignas(CACHE_LINE) atomic_size_t tail;
+    uint32_t *items;
+    size_t mask;
+} Queue;
+
+/**
+ * Set up an empty queue.
+ *
+ * @param queue
+ *   Queue to set up.
+ *
+ * @param capacity
+ *   Most items the queue has to hold, rounded up to a power of two.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result create_queue(Queue *queue, size_t capacity);
+
+/**
+ * Free the items of a queue set up by create_queue, or left zeroed.
+ *
+ * @param queue
+ *   Queue to destroy.
+ */
+void destroy_queue(Queue *queue);
+
+/**
+ * Add an item to a queue, only called by the producer.
+ *
+ * @param queue
+ *   Queue to add to.
+ *
+ * @param item
+ *   Item to add.
+ *
+ * @returns
+ *   True if the item was added, false if the queue was full.
+ */
+bool push_queue(Queue *queue, uint32_t item);
+
+/**
+ * Take the oldest item from a queue, only called by the consumer.
+ *
+ * @param queue
+ *   Queue to take from.
+ *
+ * @param item
+ *   Out parameter for the item.
+ *
+ * @returns
+ *   True if an item was taken, false if the queue was empty.
+ */
+bool pop_queue(Queue *queue, uint32_t *item);
+
+#endif
@@ -0,0 +1,183 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "realtime.h"
+
+/**
+ * Helper function to find the bucket a time goes in. Times below JITTER_LINEAR_BUCKETS get a bucket each, above that
+ * each power of two is split into JITTER_SUB_BUCKETS by the bits after the top one.
+ *
+ * @param ns
+ *   Time in nanoseconds.
+ *
+ * @returns
+ *   Bucket index.
+ */
+static uint32_t get_jitter_bucket(uint64_t ns)
+{
+    if (ns < JITTER_LINEAR_BUCKETS)
+    {
+        return (uint32_t)ns;
+    }
+
+    // ns >= 64 so the top bit is at least bit 6, and the top five bits after shifting are 32 to 63
+    const uint32_t top = 63u - (uint32_t)__builtin_clzll(ns);
+    const uint32_t shift = top - 5u;
+    return JITTER_LINEAR_BUCKETS + ((top - 6u) * JITTER_SUB_BUCKETS) + (uint32_t)((ns >> shift) - JITTER_SUB_BUCKETS);
+}
+
+/**
+ * Helper function to get the middle of a bucket.
+ *
+ * @param bucket
+ *   Bucket index.
+ *
+ * @returns
+ *   Time in nanoseconds.
+ */
+static double get_bucket_middle(uint32_t bucket)
+{
+    if (bucket < JITTER_LINEAR_BUCKETS)
+    {
+        return (double)bucket;
+    }
+
+    const uint32_t shift = ((bucket - JITTER_LINEAR_BUCKETS) / JITTER_SUB_BUCKETS) + 1u;
+    const uint64_t top_bits = ((bucket - JITTER_LINEAR_BUCKETS) % JITTER_SUB_BUCKETS) + JITTER_SUB_BUCKETS;
+    const uint64_t low = top_bits << shift;
+    return (double)low + ((double)((uint64_t)1u << shift) / 2.0);
+}
+
+/**
+ * Helper function to touch every page of a block of stack, kept out of line so the block is really on the stack.
+ *
+ * @param bytes
+ *   Bytes of stack to touch.
+ *
+ * @param page
+ *   Page size.
+ */
+static void __attribute__((noinline)) prefault_stack(size_t bytes, size_t page)
+{
+    uint8_t stack[bytes];
+    volatile uint8_t *touch = stack;
+    for (size_t i = 0u; i < bytes; i += page)
+    {
+        touch[i] = 0u;
+    }
+}
+
+Result pin_current_thread(uint32_t core)
+{
+    if (core >= CPU_SETSIZE)
+    {
+        return FAILED;
+    }
+
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    CPU_SET(core, &cores);
+    return (pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores) == 0) ? SUCCESS : FAILED;
+}
+
+Result set_current_thread_fifo(int32_t priority)
+{
+    const struct sched_param param = {.sched_priority = priority};
+    return (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0) ? SUCCESS : FAILED;
+}
+
+Result lock_memory(void)
+{
+    return (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) ? SUCCESS : FAILED;
+}
+
+Result prefault_memory(size_t heap_bytes, size_t stack_bytes)
+{
+    const long page_size = sysconf(_SC_PAGESIZE);
+    const size_t page = (page_size > 0) ? (size_t)page_size : 4096u;
+
+    // keep freed memory in the heap and big blocks out of mmap, so the pages touched here are the ones reused later
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    if (heap_bytes > 0u)
+    {
+        volatile uint8_t *heap = (volatile uint8_t *)malloc(heap_bytes);
+        if (heap == NULL)
+        {
+            return FAILED;
+        }
+
+        for (size_t i = 0u; i < heap_bytes; i += page)
+        {
+            heap[i] = 0u;
+        }
+        free((void *)heap);
+    }
+
+    if (stack_bytes > 0u)
+    {
+        prefault_stack(stack_bytes, page);
+    }
+
+    return SUCCESS;
+}
+
+FrameJitter create_frame_jitter(void)
+{
+    return (FrameJitter){0};
+}
+
+void record_frame_time(FrameJitter *jitter, uint64_t frame_ns)
+{
+    assert(jitter != NULL);
+
+    ++jitter->counts[get_jitter_bucket(frame_ns)];
+    ++jitter->frames;
+    jitter->total_ns += frame_ns;
+    jitter->max_ns = (frame_ns > jitter->max_ns) ? frame_ns : jitter->max_ns;
+}
+
+void get_frame_jitter(const FrameJitter *jitter, JitterStats *stats)
+{
+    assert(jitter != NULL);
+    assert(stats != NULL);
+
+    *stats = (JitterStats){.frames = jitter->frames};
+    if (jitter->frames == 0u)
+    {
+        return;
+    }
+
+    // walk the buckets once, filling in each percentile as the count passes it
+    const double fractions[] = {0.5, 0.9, 0.99, 0.999};
+    double *const values[] = {&stats->p50_ms, &stats->p90_ms, &stats->p99_ms, &stats->p999_ms};
+    const size_t percentiles = sizeof(fractions) / sizeof(fractions[0]);
+    const double max_ms = (double)jitter->max_ns / 1000000.0;
+    uint64_t seen = 0u;
+    size_t next = 0u;
+
+    for (uint32_t bucket = 0u; (bucket < JITTER_BUCKETS) && (next < percentiles); ++bucket)
+    {
+        seen += jitter->counts[bucket];
+        while ((next < percentiles) && ((double)seen >= (fractions[next] * (double)jitter->frames)) && (seen > 0u))
+        {
+            // the middle of the top bucket can be past the slowest frame
+            const double value = get_bucket_middle(bucket) / 1000000.0;
+            *values[next] = (value < max_ms) ? value : max_ms;
+            ++next;
+        }
+    }
+
+    stats->mean_ms = ((double)jitter->total_ns / (double)jitter->frames) / 1000000.0;
+    stats->max_ms = max_ms;
+}
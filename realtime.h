@@ -0,0 +1,147 @@
+#ifndef _REALTIME_H_
+#define _REALTIME_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "result.h"
+
+/**
+ * Realtime cuts down the ways the operating system can hold up the game loop on a busy machine, and measures how much
+ * frame times wander so the difference can be seen.
+ *
+ * The thread running the loop can be kept on one core and given a SCHED_FIFO priority so ordinary processes can't
+ * preempt it. Memory can be locked so none of it is paged out, and the heap and stack touched up front so the first
+ * use of a page mid game doesn't fault. Each of these needs privileges a normal user may not have (CAP_SYS_NICE for
+ * SCHED_FIFO, CAP_IPC_LOCK or a large RLIMIT_MEMLOCK for locking), so each is asked for separately and the game can
+ * carry on without any of them.
+ *
+ * Frame times go into a histogram with buckets about 3% wide, so recording never allocates and the percentiles can be
+ * read at any point.
+ */
+
+/**
+ * Heap and stack touched by prefault_memory in low jitter mode.
+ */
+#define REALTIME_DEFAULT_HEAP (64u * 1024u * 1024u)
+#define REALTIME_DEFAULT_STACK (512u * 1024u)
+
+/**
+ * Exact buckets for the smallest times, and the buckets each power of two above them is split into.
+ */
+#define JITTER_LINEAR_BUCKETS 64u
+#define JITTER_SUB_BUCKETS 32u
+
+/**
+ * Buckets covering every time up to 2^64 - 1 nanoseconds.
+ */
+#define JITTER_BUCKETS (JITTER_LINEAR_BUCKETS + (58u * JITTER_SUB_BUCKETS))
+
+/**
+ * Histogram of frame times.
+ */
+typedef struct FrameJitter
+{
+    uint64_t counts[JITTER_BUCKETS];
+    uint64_t frames;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} FrameJitter;
+
+/**
+ * Frame time percentiles in milliseconds.
+ */
+typedef struct JitterStats
+{
+    uint64_t frames;
+    double mean_ms;
+    double p50_ms;
+    double p90_ms;
+    double p99_ms;
+    double p999_ms;
+    double max_ms;
+} JitterStats;
+
+/**
+ * Keep the calling thread on one core.
+ *
+ * @param core
+ *   Core to run on.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the core doesn't exist or can't be used
+ */
+Result pin_current_thread(uint32_t core);
+
+/**
+ * Run the calling thread under SCHED_FIFO, so it only gives up its core to higher priority threads.
+ *
+ * The thread must block now and then, waiting for vsync say. Linux keeps 5% of every second from realtime threads by
+ * default (sched_rt_runtime_us), so a thread that never sleeps is stopped for 50ms once a second.
+ *
+ * @param priority
+ *   Priority from sched_get_priority_min(SCHED_FIFO) up to sched_get_priority_max(SCHED_FIFO).
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the priority is out of range or not allowed
+ */
+Result set_current_thread_fifo(int32_t priority);
+
+/**
+ * Lock every page of the process in memory, including pages mapped later.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if locking isn't allowed or would go over the limit
+ */
+Result lock_memory(void);
+
+/**
+ * Grow the heap and the calling thread's stack and touch every page, so later allocations and deep calls find their
+ * pages already there. Freed heap memory is kept rather than handed back to the system.
+ *
+ * @param heap_bytes
+ *   Bytes of heap to touch.
+ *
+ * @param stack_bytes
+ *   Bytes of stack to touch, must fit in the thread's stack.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the heap couldn't be grown
+ */
+Result prefault_memory(size_t heap_bytes, size_t stack_bytes);
+
+/**
+ * Create an empty frame time histogram.
+ *
+ * @returns
+ *   Created histogram.
+ */
+FrameJitter create_frame_jitter(void);
+
+/**
+ * Add a frame time to a histogram.
+ *
+ * @param jitter
+ *   Histogram to add to.
+ *
+ * @param frame_ns
+ *   Frame time in nanoseconds.
+ */
+void record_frame_time(FrameJitter *jitter, uint64_t frame_ns);
+
+/**
+ * Get the percentiles of the frame times in a histogram, to within a bucket.
+ *
+ * @param jitter
+ *   Histogram to read.
+ *
+ * @param stats
+ *   Out parameter for the percentiles, all 0 if there are no frames.
+ */
+void get_frame_jitter(const FrameJitter *jitter, JitterStats *stats);
+
+#endif
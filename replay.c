@@ -0,0 +1,614 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "alloc.h"
+#include "replay.h"
+
+/**
+ * Bytes at the start of the header and the end of the trailer.
+ */
+#define REPLAY_MAGIC "BRKREPLY"
+
+/**
+ * Version of the archive layout.
+ */
+#define REPLAY_VERSION 2u
+
+/**
+ * Arithmetic this build simulates with, keyframes from the other arithmetic can't be restored.
+ */
+#ifdef BREAKOUT_FIXED_POINT
+#define REPLAY_ARITHMETIC 1u
+#else
+#define REPLAY_ARITHMETIC 0u
+#endif
+
+/**
+ * Steps whose keys are packed into a byte.
+ */
+#define STEPS_PER_BYTE 4u
+
+/**
+ * Start of an archive.
+ */
+typedef struct ReplayHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t arithmetic;
+    uint32_t state_size;
+    uint32_t world_size;
+    uint32_t interval;
+    uint32_t reserved;
+    uint64_t brick_count;
+} ReplayHeader;
+
+/**
+ * Where a block's keyframe, keys and digests start.
+ */
+typedef struct ReplayIndexEntry
+{
+    uint64_t keyframe;
+    uint64_t inputs;
+    uint64_t digests;
+} ReplayIndexEntry;
+
+/**
+ * Run of equal words of the brick alive bitmap in a keyframe, which follow the GameState and a count of runs.
+ */
+typedef struct ReplayRun
+{
+    uint64_t word;
+    uint64_t count;
+} ReplayRun;
+
+/**
+ * End of an archive.
+ */
+typedef struct ReplayTrailer
+{
+    uint64_t index_offset;
+    uint64_t block_count;
+    uint64_t steps;
+    uint64_t hash;
+    char magic[8];
+} ReplayTrailer;
+
+typedef struct ReplayWriter
+{
+    FILE *file;
+
+    // index entries are spooled here until the end, so a game of any length is recorded without allocating
+    FILE *index;
+
+    uint32_t interval;
+    uint64_t steps;
+    uint64_t block_count;
+    size_t bitmap_words;
+
+    // keys and digests for the steps of the current block and where its keyframe starts
+    uint8_t *inputs;
+    uint32_t *digests;
+    uint64_t keyframe;
+} ReplayWriter;
+
+typedef struct Replay
+{
+    const uint8_t *data;
+    size_t size;
+
+    ReplayHeader header;
+    ReplayTrailer trailer;
+} Replay;
+
+/**
+ * Helper function to get the number of words in a game's brick alive bitmap.
+ *
+ * @param game
+ *   Game to check.
+ *
+ * @returns
+ *   Number of words.
+ */
+static size_t get_bitmap_words(const Game *game)
+{
+    return (game->brick_count / 64u) + 1u;
+}
+
+/**
+ * Helper function to write a keyframe of a game at the end of an archive.
+ *
+ * @param writer
+ *   Writer to write with.
+ *
+ * @param game
+ *   Game to write.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the file could not be written
+ */
+static Result write_keyframe(ReplayWriter *writer, const Game *game)
+{
+    const off_t offset = ftello(writer->file);
+    if (offset < 0)
+    {
+        return FAILED;
+    }
+    writer->keyframe = (uint64_t)offset;
+
+    // destroyed bricks cluster where the balls have been, so the bitmap is mostly long runs of full or empty words
+    uint64_t run_count = 0u;
+    for (size_t i = 0u; i < writer->bitmap_words; ++i)
+    {
+        if ((i == 0u) || (game->brick_alive[i] != game->brick_alive[i - 1u]))
+        {
+            ++run_count;
+        }
+    }
+
+    if ((fwrite(&game->state, sizeof(GameState), 1u, writer->file) != 1u) ||
+        (fwrite(&run_count, sizeof(run_count), 1u, writer->file) != 1u))
+    {
+        return FAILED;
+    }
+
+    ReplayRun run = {.word = game->brick_alive[0], .count = 0u};
+    for (size_t i = 0u; i < writer->bitmap_words; ++i)
+    {
+        if (game->brick_alive[i] != run.word)
+        {
+            if (fwrite(&run, sizeof(run), 1u, writer->file) != 1u)
+            {
+                return FAILED;
+            }
+            run = (ReplayRun){.word = game->brick_alive[i], .count = 0u};
+        }
+        ++run.count;
+    }
+
+    return (fwrite(&run, sizeof(run), 1u, writer->file) == 1u) ? SUCCESS : FAILED;
+}
+
+/**
+ * Helper function to write the keys and digests of the current block and its index entry.
+ *
+ * @param writer
+ *   Writer to write with.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the file could not be written
+ */
+static Result write_block_inputs(ReplayWriter *writer)
+{
+    const off_t offset = ftello(writer->file);
+    if (offset < 0)
+    {
+        return FAILED;
+    }
+
+    const size_t steps = (size_t)(writer->steps - (writer->block_count * writer->interval));
+    const size_t bytes = (steps + STEPS_PER_BYTE - 1u) / STEPS_PER_BYTE;
+    const ReplayIndexEntry entry = {
+        .keyframe = writer->keyframe, .inputs = (uint64_t)offset, .digests = (uint64_t)offset + bytes};
+
+    if (((bytes > 0u) && (fwrite(writer->inputs, 1u, bytes, writer->file) != bytes)) ||
+        ((steps > 0u) && (fwrite(writer->digests, sizeof(uint32_t), steps, writer->file) != steps)) ||
+        (fwrite(&entry, sizeof(entry), 1u, writer->index) != 1u))
+    {
+        return FAILED;
+    }
+
+    memset(writer->inputs, 0, bytes);
+    ++writer->block_count;
+    return SUCCESS;
+}
+
+Result create_replay_writer(
+    ReplayWriter **writer, const char *path, const Game *game, uint32_t world_size, uint32_t interval)
+{
+    assert(writer != NULL);
+    assert(path != NULL);
+    assert(game != NULL);
+    assert(interval > 0u);
+
+    if ((game->state.step != 0u) || (game->players != 1u) || (game->chunks != NULL))
+    {
+        return FAILED;
+    }
+
+    ReplayWriter *n_writer = (ReplayWriter *)TRACKED_CALLOC(1u, sizeof(ReplayWriter));
+    if (n_writer == NULL)
+    {
+        return FAILED;
+    }
+
+    n_writer->interval = interval;
+    n_writer->bitmap_words = get_bitmap_words(game);
+    n_writer->inputs = (uint8_t *)TRACKED_CALLOC((interval + STEPS_PER_BYTE - 1u) / STEPS_PER_BYTE, sizeof(uint8_t));
+    n_writer->digests = (uint32_t *)TRACKED_CALLOC(interval, sizeof(uint32_t));
+    n_writer->file = fopen(path, "wb");
+    n_writer->index = tmpfile();
+    if ((n_writer->inputs == NULL) || (n_writer->digests == NULL) || (n_writer->file == NULL) ||
+        (n_writer->index == NULL))
+    {
+        destroy_replay_writer(n_writer);
+        return FAILED;
+    }
+
+    ReplayHeader header = {
+        .version = REPLAY_VERSION,
+        .arithmetic = REPLAY_ARITHMETIC,
+        .state_size = (uint32_t)sizeof(GameState),
+        .world_size = world_size,
+        .interval = interval,
+        .brick_count = game->brick_count};
+    memcpy(header.magic, REPLAY_MAGIC, sizeof(header.magic));
+
+    if ((fwrite(&header, sizeof(header), 1u, n_writer->file) != 1u) || (write_keyframe(n_writer, game) != SUCCESS))
+    {
+        destroy_replay_writer(n_writer);
+        return FAILED;
+    }
+
+    // assign the writer to the user supplied pointer
+    *writer = n_writer;
+    return SUCCESS;
+}
+
+Result record_replay_input(ReplayWriter *writer, const Game *game, const GameInput *input)
+{
+    assert(writer != NULL);
+    assert(game != NULL);
+    assert(input != NULL);
+
+    const size_t step = (size_t)(writer->steps % writer->interval);
+    const uint8_t keys = (uint8_t)((input->left ? 1u : 0u) | (input->right ? 2u : 0u));
+    writer->inputs[step / STEPS_PER_BYTE] |= (uint8_t)(keys << ((step % STEPS_PER_BYTE) * 2u));
+    writer->digests[step] = (uint32_t)digest_game(game);
+    ++writer->steps;
+
+    // the block is full, the game is now at the step the next keyframe is for
+    if ((step + 1u) == writer->interval)
+    {
+        if ((write_block_inputs(writer) != SUCCESS) || (write_keyframe(writer, game) != SUCCESS))
+        {
+            return FAILED;
+        }
+    }
+
+    return SUCCESS;
+}
+
+Result finish_replay_writer(ReplayWriter *writer, const Game *game)
+{
+    assert(writer != NULL);
+    assert(game != NULL);
+    assert(game->state.step == writer->steps);
+
+    // the last block always gets an entry, even with no keys after its keyframe
+    if (write_block_inputs(writer) != SUCCESS)
+    {
+        return FAILED;
+    }
+
+    const off_t offset = ftello(writer->file);
+    if ((offset < 0) || (fflush(writer->index) != 0))
+    {
+        return FAILED;
+    }
+
+    rewind(writer->index);
+    for (uint64_t i = 0u; i < writer->block_count; ++i)
+    {
+        ReplayIndexEntry entry;
+        if ((fread(&entry, sizeof(entry), 1u, writer->index) != 1u) ||
+            (fwrite(&entry, sizeof(entry), 1u, writer->file) != 1u))
+        {
+            return FAILED;
+        }
+    }
+
+    ReplayTrailer trailer = {
+        .index_offset = (uint64_t)offset,
+        .block_count = writer->block_count,
+        .steps = writer->steps,
+        .hash = hash_game(game)};
+    memcpy(trailer.magic, REPLAY_MAGIC, sizeof(trailer.magic));
+
+    const bool written = fwrite(&trailer, sizeof(trailer), 1u, writer->file) == 1u;
+    const bool closed = fclose(writer->file) == 0;
+    writer->file = NULL;
+
+    return (written && closed) ? SUCCESS : FAILED;
+}
+
+void destroy_replay_writer(ReplayWriter *writer)
+{
+    if (writer == NULL)
+    {
+        return;
+    }
+
+    if (writer->file != NULL)
+    {
+        fclose(writer->file);
+    }
+    if (writer->index != NULL)
+    {
+        fclose(writer->index);
+    }
+    free_tracked(writer->inputs);
+    free_tracked(writer->digests);
+    free_tracked(writer);
+}
+
+/**
+ * Helper function to read an index entry.
+ *
+ * @param replay
+ *   Archive to read.
+ *
+ * @param block
+ *   Block to look up.
+ *
+ * @returns
+ *   The entry.
+ */
+static ReplayIndexEntry get_index_entry(const Replay *replay, uint64_t block)
+{
+    ReplayIndexEntry entry;
+    memcpy(
+        &entry,
+        &replay->data[replay->trailer.index_offset + (block * sizeof(ReplayIndexEntry))],
+        sizeof(ReplayIndexEntry));
+    return entry;
+}
+
+Result open_replay(Replay **replay, const char *path)
+{
+    assert(replay != NULL);
+    assert(path != NULL);
+
+    Replay *n_replay = (Replay *)TRACKED_CALLOC(1u, sizeof(Replay));
+    if (n_replay == NULL)
+    {
+        return FAILED;
+    }
+
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        close_replay(n_replay);
+        return FAILED;
+    }
+
+    struct stat info;
+    if ((fstat(fd, &info) != 0) || ((size_t)info.st_size < (sizeof(ReplayHeader) + sizeof(ReplayTrailer))))
+    {
+        close(fd);
+        close_replay(n_replay);
+        return FAILED;
+    }
+
+    void *address = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // the mapping keeps the file open
+    close(fd);
+
+    if (address == MAP_FAILED)
+    {
+        close_replay(n_replay);
+        return FAILED;
+    }
+    n_replay->data = (const uint8_t *)address;
+    n_replay->size = (size_t)info.st_size;
+
+    // seeks jump around the file, reading ahead of them is wasted
+    madvise(address, n_replay->size, MADV_RANDOM);
+
+    memcpy(&n_replay->header, n_replay->data, sizeof(ReplayHeader));
+    memcpy(&n_replay->trailer, &n_replay->data[n_replay->size - sizeof(ReplayTrailer)], sizeof(ReplayTrailer));
+
+    const ReplayHeader *header = &n_replay->header;
+    const ReplayTrailer *trailer = &n_replay->trailer;
+    const uint64_t index_size = n_replay->size - sizeof(ReplayTrailer) - trailer->index_offset;
+    if ((memcmp(header->magic, REPLAY_MAGIC, sizeof(header->magic)) != 0) ||
+        (memcmp(trailer->magic, REPLAY_MAGIC, sizeof(trailer->magic)) != 0) || (header->version != REPLAY_VERSION) ||
+        (header->arithmetic != REPLAY_ARITHMETIC) || (header->state_size != sizeof(GameState)) ||
+        (header->interval == 0u) || (trailer->index_offset < sizeof(ReplayHeader)) ||
+        (trailer->index_offset > (n_replay->size - sizeof(ReplayTrailer))) ||
+        (trailer->block_count != ((trailer->steps / header->interval) + 1u)) ||
+        ((index_size / sizeof(ReplayIndexEntry)) != trailer->block_count) ||
+        ((index_size % sizeof(ReplayIndexEntry)) != 0u))
+    {
+        close_replay(n_replay);
+        return FAILED;
+    }
+
+    // assign the archive to the user supplied pointer
+    *replay = n_replay;
+    return SUCCESS;
+}
+
+void close_replay(Replay *replay)
+{
+    if (replay == NULL)
+    {
+        return;
+    }
+
+    if (replay->data != NULL)
+    {
+        munmap((void *)replay->data, replay->size);
+    }
+    free_tracked(replay);
+}
+
+Result create_replay_game(const Replay *replay, Game **game)
+{
+    assert(replay != NULL);
+    assert(game != NULL);
+
+    Game *n_game = NULL;
+    const Result result = (replay->header.world_size == 0u)
+                              ? create_game(&n_game)
+                              : create_large_game(&n_game, scalar_from_int((int32_t)replay->header.world_size));
+    if (result != SUCCESS)
+    {
+        return FAILED;
+    }
+
+    if (n_game->brick_count != replay->header.brick_count)
+    {
+        destroy_game(n_game);
+        return FAILED;
+    }
+
+    // assign the game to the user supplied pointer
+    *game = n_game;
+    return SUCCESS;
+}
+
+uint64_t get_replay_steps(const Replay *replay)
+{
+    assert(replay != NULL);
+
+    return replay->trailer.steps;
+}
+
+uint64_t get_replay_hash(const Replay *replay)
+{
+    assert(replay != NULL);
+
+    return replay->trailer.hash;
+}
+
+Result get_replay_input(const Replay *replay, uint64_t step, GameInput *input)
+{
+    assert(replay != NULL);
+    assert(input != NULL);
+
+    if (step >= replay->trailer.steps)
+    {
+        return NO_EVENT;
+    }
+
+    const uint64_t interval = replay->header.interval;
+    const ReplayIndexEntry entry = get_index_entry(replay, step / interval);
+    const uint64_t offset = entry.inputs + ((step % interval) / STEPS_PER_BYTE);
+    if (offset >= replay->trailer.index_offset)
+    {
+        return NO_EVENT;
+    }
+
+    const uint8_t keys = (uint8_t)(replay->data[offset] >> (((step % interval) % STEPS_PER_BYTE) * 2u));
+    *input = (GameInput){.left = (keys & 1u) != 0u, .right = (keys & 2u) != 0u};
+    return SUCCESS;
+}
+
+Result get_replay_digest(const Replay *replay, uint64_t step, uint32_t *digest)
+{
+    assert(replay != NULL);
+    assert(digest != NULL);
+
+    if ((step == 0u) || (step > replay->trailer.steps))
+    {
+        return NO_EVENT;
+    }
+
+    // block b holds the digests after its steps, the states b * interval + 1 up to (b + 1) * interval
+    const uint64_t interval = replay->header.interval;
+    const ReplayIndexEntry entry = get_index_entry(replay, (step - 1u) / interval);
+    const uint64_t offset = entry.digests + (((step - 1u) % interval) * sizeof(uint32_t));
+    if ((offset + sizeof(uint32_t)) > replay->trailer.index_offset)
+    {
+        return NO_EVENT;
+    }
+
+    memcpy(digest, &replay->data[offset], sizeof(uint32_t));
+    return SUCCESS;
+}
+
+Result seek_replay(const Replay *replay, Game *game, uint64_t step)
+{
+    assert(replay != NULL);
+    assert(game != NULL);
+
+    if ((step > replay->trailer.steps) || (game->brick_count != replay->header.brick_count))
+    {
+        return FAILED;
+    }
+
+    const uint64_t interval = replay->header.interval;
+    const ReplayIndexEntry entry = get_index_entry(replay, step / interval);
+    const size_t words = get_bitmap_words(game);
+
+    const uint64_t offset = entry.keyframe;
+    uint64_t run_count = 0u;
+    if ((offset + sizeof(GameState) + sizeof(run_count)) > replay->trailer.index_offset)
+    {
+        return FAILED;
+    }
+    memcpy(&run_count, &replay->data[offset + sizeof(GameState)], sizeof(run_count));
+
+    const uint64_t runs = offset + sizeof(GameState) + sizeof(run_count);
+    if ((run_count > words) || ((runs + (run_count * sizeof(ReplayRun))) > replay->trailer.index_offset))
+    {
+        return FAILED;
+    }
+
+    // check the runs fill the bitmap exactly before touching the game
+    size_t filled = 0u;
+    for (uint64_t i = 0u; i < run_count; ++i)
+    {
+        ReplayRun run;
+        memcpy(&run, &replay->data[runs + (i * sizeof(ReplayRun))], sizeof(ReplayRun));
+        if (run.count > (words - filled))
+        {
+            return FAILED;
+        }
+        filled += (size_t)run.count;
+    }
+    GameState state;
+    memcpy(&state, &replay->data[offset], sizeof(GameState));
+    if ((filled != words) || (state.step != ((step / interval) * interval)))
+    {
+        return FAILED;
+    }
+
+    filled = 0u;
+    for (uint64_t i = 0u; i < run_count; ++i)
+    {
+        ReplayRun run;
+        memcpy(&run, &replay->data[runs + (i * sizeof(ReplayRun))], sizeof(ReplayRun));
+        for (uint64_t j = 0u; j < run.count; ++j)
+        {
+            game->brick_alive[filled++] = run.word;
+        }
+    }
+    game->state = state;
+
+    // play the rest of the way from the keyframe
+    for (uint64_t i = game->state.step; i < step; ++i)
+    {
+        GameInput inputs[GAME_MAX_PLAYERS] = {0};
+        if (get_replay_input(replay, i, &inputs[0]) != SUCCESS)
+        {
+            return FAILED;
+        }
+
+        StepOutcome outcome;
+        step_game(game, inputs, &outcome);
+    }
+
+    return SUCCESS;
+}
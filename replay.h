@@ -0,0 +1,225 @@
+#ifndef _REPLAY_H_
+#define _REPLAY_H_
+
+#include <stdint.h>
+
+#include "game.h"
+#include "result.h"
+
+/**
+ * Replay archives hold a whole single player game in a form that can be opened at any step without playing it from
+ * the start, so hours of play can be scrubbed through.
+ *
+ * An archive is a binary file in the byte order of the machine that wrote it:
+ *  - a header naming the level, the keyframe interval and the arithmetic (float or fixed point) the game ran with
+ *  - a block every interval steps: a keyframe (the GameState and the brick alive bitmap, stored as runs of equal
+ *    words) followed by the keys held for the steps up to the next keyframe, two bits a step, and the low 32 bits of
+ *    digest_game after each of those steps
+ *  - an index of where each block's keyframe, keys and digests start
+ *  - a trailer giving where the index starts, the number of steps and the hash_game of the final state
+ *
+ * Archives are opened with mmap and only the pages a seek touches are read. Seeking restores the keyframe at or before
+ * the step and plays the keys from there, so it costs at most interval steps whatever the length of the game.
+ *
+ * The digests let two archives of the same game, from different builds or machines, be compared without playing
+ * either: once two runs disagree they stay that way, so the first step they differ at can be found by bisection.
+ */
+
+/**
+ * Steps between keyframes when nothing else is asked for, a second of play.
+ */
+#define REPLAY_DEFAULT_INTERVAL 1000u
+
+/**
+ * Replay archive internal data.
+ */
+typedef struct Replay Replay;
+
+/**
+ * Replay archive writer internal data.
+ */
+typedef struct ReplayWriter ReplayWriter;
+
+/**
+ * Create a writer for a new archive, the game's current state becomes the first keyframe.
+ *
+ * @param writer
+ *   Created writer.
+ *
+ * @param path
+ *   File to write.
+ *
+ * @param game
+ *   Game being recorded, a single player game of the built in or a generated level that hasn't taken a step.
+ *
+ * @param world_size
+ *   Size of the generated world being played, 0 for the built in level.
+ *
+ * @param interval
+ *   Steps between keyframes.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result create_replay_writer(
+    ReplayWriter **writer, const char *path, const Game *game, uint32_t world_size, uint32_t interval);
+
+/**
+ * Record the keys held for a step, called after the step is taken. Steps must be recorded in order with none missed.
+ *
+ * Never allocates, so it is safe to call with the allocation guard armed.
+ *
+ * @param writer
+ *   Writer to record with.
+ *
+ * @param game
+ *   Game after the step.
+ *
+ * @param input
+ *   Keys held for the step.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the file could not be written
+ */
+Result record_replay_input(ReplayWriter *writer, const Game *game, const GameInput *input);
+
+/**
+ * Write the index and trailer and close the file.
+ *
+ * @param writer
+ *   Writer to finish.
+ *
+ * @param game
+ *   Game after the last step recorded.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the file could not be written
+ */
+Result finish_replay_writer(ReplayWriter *writer, const Game *game);
+
+/**
+ * Destroy a writer, a writer that wasn't finished leaves an archive that can't be opened.
+ *
+ * @param writer
+ *   Writer to destroy.
+ */
+void destroy_replay_writer(ReplayWriter *writer);
+
+/**
+ * Open an archive.
+ *
+ * @param replay
+ *   Opened archive.
+ *
+ * @param path
+ *   File to open.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure, including an archive that is incomplete or was written with the other arithmetic
+ */
+Result open_replay(Replay **replay, const char *path);
+
+/**
+ * Close an archive.
+ *
+ * @param replay
+ *   Archive to close.
+ */
+void close_replay(Replay *replay);
+
+/**
+ * Create a game with the level an archive was recorded on, at the first step.
+ *
+ * @param replay
+ *   Archive to play.
+ *
+ * @param game
+ *   Created game.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result create_replay_game(const Replay *replay, Game **game);
+
+/**
+ * Get the number of steps in an archive.
+ *
+ * @param replay
+ *   Archive to check.
+ *
+ * @returns
+ *   Number of steps.
+ */
+uint64_t get_replay_steps(const Replay *replay);
+
+/**
+ * Get the hash_game of the state after the last step of an archive.
+ *
+ * @param replay
+ *   Archive to check.
+ *
+ * @returns
+ *   Hash of the final state.
+ */
+uint64_t get_replay_hash(const Replay *replay);
+
+/**
+ * Get the keys held for a step.
+ *
+ * @param replay
+ *   Archive to read.
+ *
+ * @param step
+ *   Step to get the keys for, the one taken from state step to state step + 1.
+ *
+ * @param input
+ *   Out parameter for the keys.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   NO_EVENT if the archive ends before the step
+ */
+Result get_replay_input(const Replay *replay, uint64_t step, GameInput *input);
+
+/**
+ * Get the digest recorded after a step.
+ *
+ * @param replay
+ *   Archive to read.
+ *
+ * @param step
+ *   State step to get the digest of, from 1 up to get_replay_steps.
+ *
+ * @param digest
+ *   Out parameter for the low 32 bits of digest_game.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   NO_EVENT if the archive has no digest for the step
+ */
+Result get_replay_digest(const Replay *replay, uint64_t step, uint32_t *digest);
+
+/**
+ * Put a game in the state it was in at a step, by restoring the nearest keyframe before it and playing the rest.
+ *
+ * @param replay
+ *   Archive to read.
+ *
+ * @param game
+ *   Game created by create_replay_game.
+ *
+ * @param step
+ *   Step to seek to, at most get_replay_steps.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the step is past the end or the archive doesn't match the game
+ */
+Result seek_replay(const Replay *replay, Game *game, uint64_t step);
+
+#endif
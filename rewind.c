@@ -0,0 +1,510 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "rewind.h"
+
+/**
+ * Number of 32 bit words in a GameState.
+ */
+#define STATE_WORDS (sizeof(GameState) / sizeof(uint32_t))
+
+_Static_assert((sizeof(GameState) % sizeof(uint32_t)) == 0u, "GameState must be a whole number of words");
+
+_Static_assert(STATE_WORDS < (1u << 14u), "record gaps must fit in two varint bytes");
+
+/**
+ * Largest possible record, a two byte gap and a five byte XOR for every word plus the terminator.
+ */
+#define MAX_RECORD_SIZE ((STATE_WORDS * 7u) + 1u)
+
+/**
+ * Bytes reserved per step for records. A step normally only changes the step counter, balls, drops and paddles so
+ * records average well under this even with every extra ball and drop in play, heavier records just shorten the
+ * history.
+ */
+#define RECORD_BUDGET 64u
+
+/**
+ * Brick diffs reserved per step, most steps don't destroy a brick.
+ */
+#define BRICK_DIFF_RATIO 8u
+
+/**
+ * Full copy of the game state, records are stored relative to these.
+ */
+typedef struct Keyframe
+{
+    // step the keyframe was taken at, UINT64_MAX if unused
+    uint64_t step;
+    GameState state;
+} Keyframe;
+
+/**
+ * Change to one word of the brick alive bitmap.
+ */
+typedef struct BrickDiff
+{
+    uint64_t step;
+    uint64_t bits;
+    uint32_t word;
+} BrickDiff;
+
+typedef struct Rewind
+{
+    // recorded steps run from oldest to newest, count is zero when nothing is recorded
+    size_t capacity;
+    size_t count;
+    uint64_t oldest;
+    uint64_t newest;
+
+    // record for step s starts at bytes[offsets[s % capacity]], new records are written at head
+    uint32_t *offsets;
+    uint8_t *bytes;
+    size_t byte_capacity;
+    size_t head;
+
+    // keyframe for step s is keyframes[(s / REWIND_KEYFRAME_INTERVAL) % keyframe_count]
+    Keyframe *keyframes;
+    size_t keyframe_count;
+
+    // ring of brick diffs in step order
+    BrickDiff *diffs;
+    size_t diff_capacity;
+    size_t diff_first;
+    size_t diff_count;
+} Rewind;
+
+/**
+ * Helper function to write an unsigned varint, seven bits per byte with the top bit set on all but the last byte.
+ *
+ * @param out
+ *   Buffer to write to, must have room for 5 bytes.
+ *
+ * @param value
+ *   Value to write.
+ *
+ * @returns
+ *   Number of bytes written.
+ */
+static size_t write_varint(uint8_t *out, uint32_t value)
+{
+    size_t size = 0u;
+
+    while (value >= 0x80u)
+    {
+        out[size++] = (uint8_t)(value | 0x80u);
+        value >>= 7u;
+    }
+    out[size++] = (uint8_t)value;
+
+    return size;
+}
+
+/**
+ * Helper function to read an unsigned varint.
+ *
+ * @param in
+ *   Buffer to read from.
+ *
+ * @param value
+ *   Out parameter for the value read.
+ *
+ * @returns
+ *   Number of bytes read.
+ */
+static size_t read_varint(const uint8_t *in, uint32_t *value)
+{
+    size_t size = 0u;
+    uint32_t result = 0u;
+    uint32_t shift = 0u;
+
+    do
+    {
+        result |= (uint32_t)(in[size] & 0x7fu) << shift;
+        shift += 7u;
+    } while ((in[size++] & 0x80u) != 0u);
+
+    *value = result;
+    return size;
+}
+
+/**
+ * Helper function to encode a state against a keyframe.
+ *
+ * Each word that differs is written as the gap from the previous one followed by the XOR of the two, and a zero gap
+ * ends the record. Most of the state (bricks aside) sits still between keyframes, so the cost follows the number of
+ * words that move rather than the size of the state.
+ *
+ * @param out
+ *   Buffer to write to, must have room for MAX_RECORD_SIZE bytes.
+ *
+ * @param state
+ *   State to encode.
+ *
+ * @param key
+ *   Keyframe state.
+ *
+ * @returns
+ *   Number of bytes written.
+ */
+static size_t encode_record(uint8_t *out, const GameState *state, const GameState *key)
+{
+    uint32_t words[STATE_WORDS];
+    uint32_t key_words[STATE_WORDS];
+    memcpy(words, state, sizeof(words));
+    memcpy(key_words, key, sizeof(key_words));
+
+    size_t size = 0u;
+    size_t previous = 0u;
+    for (size_t i = 0u; i < STATE_WORDS; ++i)
+    {
+        const uint32_t diff = words[i] ^ key_words[i];
+        if (diff != 0u)
+        {
+            // gaps count from one past the previous word so they are never zero
+            size += write_varint(&out[size], (uint32_t)(i + 1u - previous));
+            size += write_varint(&out[size], diff);
+            previous = i + 1u;
+        }
+    }
+    out[size++] = 0u;
+
+    return size;
+}
+
+/**
+ * Helper function to decode a state encoded against a keyframe.
+ *
+ * @param in
+ *   Buffer to read from.
+ *
+ * @param key
+ *   Keyframe state the record was encoded against.
+ *
+ * @param state
+ *   Out parameter for decoded state.
+ *
+ * @returns
+ *   Number of bytes read.
+ */
+static size_t decode_record(const uint8_t *in, const GameState *key, GameState *state)
+{
+    uint32_t words[STATE_WORDS];
+    memcpy(words, key, sizeof(words));
+
+    size_t size = 0u;
+    size_t previous = 0u;
+    for (;;)
+    {
+        uint32_t gap = 0u;
+        size += read_varint(&in[size], &gap);
+        if (gap == 0u)
+        {
+            break;
+        }
+
+        uint32_t diff = 0u;
+        size += read_varint(&in[size], &diff);
+        previous += gap;
+        words[previous - 1u] ^= diff;
+    }
+
+    memcpy(state, words, sizeof(words));
+    return size;
+}
+
+/**
+ * Helper function to forget everything recorded.
+ *
+ * @param rewind
+ *   Rewind history to clear.
+ */
+static void clear_rewind(Rewind *rewind)
+{
+    rewind->count = 0u;
+    rewind->head = 0u;
+    rewind->diff_first = 0u;
+    rewind->diff_count = 0u;
+
+    for (size_t i = 0u; i < rewind->keyframe_count; ++i)
+    {
+        rewind->keyframes[i].step = UINT64_MAX;
+    }
+}
+
+/**
+ * Helper function to forget the oldest recorded step.
+ *
+ * @param rewind
+ *   Rewind history to drop the step from.
+ */
+static void drop_oldest(Rewind *rewind)
+{
+    if (--rewind->count == 0u)
+    {
+        clear_rewind(rewind);
+        return;
+    }
+
+    ++rewind->oldest;
+
+    // restoring the oldest step only undoes diffs made after it
+    while ((rewind->diff_count > 0u) && (rewind->diffs[rewind->diff_first].step <= rewind->oldest))
+    {
+        rewind->diff_first = (rewind->diff_first + 1u) % rewind->diff_capacity;
+        --rewind->diff_count;
+    }
+}
+
+/**
+ * Helper function to make room for a record at the head of the byte ring.
+ *
+ * @param rewind
+ *   Rewind history to make room in.
+ */
+static void reserve_record(Rewind *rewind)
+{
+    // records never wrap, skip the end of the ring if a record might not fit
+    if ((rewind->head + MAX_RECORD_SIZE) > rewind->byte_capacity)
+    {
+        rewind->head = 0u;
+    }
+
+    // the oldest records are the first ones after the head, drop any in the way
+    while (rewind->count > 0u)
+    {
+        const uint32_t offset = rewind->offsets[rewind->oldest % rewind->capacity];
+        if ((offset < rewind->head) || (offset >= (rewind->head + MAX_RECORD_SIZE)))
+        {
+            break;
+        }
+
+        drop_oldest(rewind);
+    }
+}
+
+/**
+ * Helper function to record a brick destroyed or grown back by a step. Bricks destroyed together are often next to each
+ * other, so a brick in the same bitmap word as the newest diff of the same step joins that diff.
+ *
+ * @param rewind
+ *   Rewind history to add the diff to, must not be empty.
+ *
+ * @param step
+ *   Step being recorded.
+ *
+ * @param index
+ *   Brick index.
+ */
+static void add_brick_diff(Rewind *rewind, uint64_t step, size_t index)
+{
+    const uint64_t bit = (uint64_t)1u << (index % 64u);
+    const uint32_t word = (uint32_t)(index / 64u);
+
+    if (rewind->diff_count > 0u)
+    {
+        BrickDiff *newest = &rewind->diffs[(rewind->diff_first + rewind->diff_count - 1u) % rewind->diff_capacity];
+        if ((newest->step == step) && (newest->word == word))
+        {
+            // a brick can grow back and be destroyed again in one step, which is no change at all
+            newest->bits ^= bit;
+            return;
+        }
+    }
+
+    if (rewind->diff_count == rewind->diff_capacity)
+    {
+        // keep dropping steps until the oldest diff is no longer needed
+        const uint64_t needed = rewind->diffs[rewind->diff_first].step;
+        while ((rewind->count > 0u) && (rewind->oldest < needed))
+        {
+            drop_oldest(rewind);
+        }
+    }
+
+    // dropping steps can empty the history, in which case this diff is not needed either
+    if (rewind->count > 0u)
+    {
+        const size_t slot = (rewind->diff_first + rewind->diff_count) % rewind->diff_capacity;
+        rewind->diffs[slot] = (BrickDiff){.step = step, .bits = bit, .word = word};
+        ++rewind->diff_count;
+    }
+}
+
+Result create_rewind(Rewind **rewind, size_t steps)
+{
+    assert(rewind != NULL);
+    assert(steps > 0u);
+
+    Result res = SUCCESS;
+
+    Rewind *n_rewind = (Rewind *)TRACKED_CALLOC(1u, sizeof(Rewind));
+    if (n_rewind == NULL)
+    {
+        res = FAILED;
+        return res;
+    }
+
+    n_rewind->capacity = steps;
+    // the window kept free ahead of the head and the unused end of the ring before it wraps both come out of the budget
+    n_rewind->byte_capacity = (steps * RECORD_BUDGET) + (2u * MAX_RECORD_SIZE);
+    n_rewind->keyframe_count = (steps / REWIND_KEYFRAME_INTERVAL) + 2u;
+    n_rewind->diff_capacity = (steps / BRICK_DIFF_RATIO) + 64u;
+
+    n_rewind->offsets = (uint32_t *)TRACKED_CALLOC(steps, sizeof(uint32_t));
+    n_rewind->bytes = (uint8_t *)TRACKED_CALLOC(n_rewind->byte_capacity, sizeof(uint8_t));
+    n_rewind->keyframes = (Keyframe *)TRACKED_CALLOC(n_rewind->keyframe_count, sizeof(Keyframe));
+    n_rewind->diffs = (BrickDiff *)TRACKED_CALLOC(n_rewind->diff_capacity, sizeof(BrickDiff));
+    if ((n_rewind->offsets == NULL) || (n_rewind->bytes == NULL) || (n_rewind->keyframes == NULL) ||
+        (n_rewind->diffs == NULL) || (n_rewind->byte_capacity > UINT32_MAX))
+    {
+        res = FAILED;
+        destroy_rewind(n_rewind);
+        return res;
+    }
+
+    clear_rewind(n_rewind);
+
+    // assign the rewind history to the user supplied pointer
+    *rewind = n_rewind;
+    return res;
+}
+
+void destroy_rewind(Rewind *rewind)
+{
+    if (rewind == NULL)
+    {
+        return;
+    }
+
+    free_tracked(rewind->offsets);
+    free_tracked(rewind->bytes);
+    free_tracked(rewind->keyframes);
+    free_tracked(rewind->diffs);
+    free_tracked(rewind);
+}
+
+void record_rewind(Rewind *rewind, const Game *game, const StepOutcome *outcome)
+{
+    assert(rewind != NULL);
+    assert(game != NULL);
+
+    const uint64_t step = game->state.step;
+
+    if ((rewind->count > 0u) && (step != (rewind->newest + 1u)))
+    {
+        clear_rewind(rewind);
+    }
+
+    if (rewind->count == rewind->capacity)
+    {
+        drop_oldest(rewind);
+    }
+
+    // a brick destroyed getting to the first step never needs undoing
+    for (uint32_t i = 0u; (rewind->count > 0u) && (outcome != NULL) && (i < outcome->collision_count); ++i)
+    {
+        if (outcome->collisions[i].kind == COLLISION_BRICK)
+        {
+            add_brick_diff(rewind, step, (size_t)outcome->collisions[i].other);
+        }
+    }
+    for (uint32_t i = 0u; (rewind->count > 0u) && (outcome != NULL) && (i < outcome->blasted_count); ++i)
+    {
+        add_brick_diff(rewind, step, (size_t)outcome->blasted[i]);
+    }
+    for (uint32_t i = 0u; (rewind->count > 0u) && (outcome != NULL) && (i < outcome->regrown_count); ++i)
+    {
+        add_brick_diff(rewind, step, (size_t)outcome->regrown[i]);
+    }
+
+    reserve_record(rewind);
+
+    // take a keyframe at the start of every interval, or at the first step recorded in it
+    const uint64_t block = step / REWIND_KEYFRAME_INTERVAL;
+    Keyframe *keyframe = &rewind->keyframes[block % rewind->keyframe_count];
+    if (((step % REWIND_KEYFRAME_INTERVAL) == 0u) || (keyframe->step == UINT64_MAX) ||
+        ((keyframe->step / REWIND_KEYFRAME_INTERVAL) != block))
+    {
+        keyframe->step = step;
+        keyframe->state = game->state;
+    }
+
+    rewind->offsets[step % rewind->capacity] = (uint32_t)rewind->head;
+    rewind->head += encode_record(&rewind->bytes[rewind->head], &game->state, &keyframe->state);
+
+    if (rewind->count == 0u)
+    {
+        rewind->oldest = step;
+    }
+    rewind->newest = step;
+    ++rewind->count;
+}
+
+Result restore_rewind(Rewind *rewind, Game *game, uint64_t step)
+{
+    assert(rewind != NULL);
+    assert(game != NULL);
+
+    Result result = SUCCESS;
+
+    if ((rewind->count == 0u) || (step < rewind->oldest) || (step > rewind->newest))
+    {
+        result = FAILED;
+        return result;
+    }
+
+    // undo brick changes newest first
+    while (rewind->diff_count > 0u)
+    {
+        const BrickDiff *diff =
+            &rewind->diffs[(rewind->diff_first + rewind->diff_count - 1u) % rewind->diff_capacity];
+        if (diff->step <= step)
+        {
+            break;
+        }
+
+        game->brick_alive[diff->word] ^= diff->bits;
+        --rewind->diff_count;
+    }
+
+    const Keyframe *keyframe = &rewind->keyframes[(step / REWIND_KEYFRAME_INTERVAL) % rewind->keyframe_count];
+    assert(keyframe->step <= step);
+
+    const uint32_t offset = rewind->offsets[step % rewind->capacity];
+    rewind->head = offset + decode_record(&rewind->bytes[offset], &keyframe->state, &game->state);
+
+    // the steps after this one are gone, recording carries on from here
+    rewind->count = (size_t)(step - rewind->oldest) + 1u;
+    rewind->newest = step;
+
+    return result;
+}
+
+Result get_rewind_range(const Rewind *rewind, uint64_t *oldest, uint64_t *newest)
+{
+    assert(rewind != NULL);
+    assert(oldest != NULL);
+    assert(newest != NULL);
+
+    if (rewind->count == 0u)
+    {
+        return NO_EVENT;
+    }
+
+    *oldest = rewind->oldest;
+    *newest = rewind->newest;
+    return SUCCESS;
+}
+
+size_t get_rewind_memory(const Rewind *rewind)
+{
+    assert(rewind != NULL);
+
+    return sizeof(Rewind) + (rewind->capacity * sizeof(uint32_t)) + rewind->byte_capacity +
+           (rewind->keyframe_count * sizeof(Keyframe)) + (rewind->diff_capacity * sizeof(BrickDiff));
+}
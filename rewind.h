@@ -0,0 +1,122 @@
+#ifndef _REWIND_H_
+#define _REWIND_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "game.h"
+#include "result.h"
+
+/**
+ * Rewind keeps a history of recent game states so play can be wound back to any recorded step.
+ *
+ * Everything lives in buffers allocated up front, the oldest steps are dropped as new ones are recorded:
+ *  - a keyframe (full GameState) is kept every REWIND_KEYFRAME_INTERVAL steps
+ *  - every step stores the GameState XORed against its keyframe, only the words that differ are stored, as varints
+ *  - the brick alive bitmap is stored as XOR diffs against the previous step, which are only recorded when a brick is
+ *    destroyed, so a quiet step costs nothing
+ *
+ * XOR diffs undo themselves, so the bitmap is restored by reapplying the diffs newer than the target step to the live
+ * bitmap. Restoring touches one keyframe, one record and the brick diffs being undone.
+ */
+
+/**
+ * Number of steps between keyframes.
+ */
+#define REWIND_KEYFRAME_INTERVAL 256u
+
+/**
+ * Rewind internal data.
+ */
+typedef struct Rewind Rewind;
+
+/**
+ * Create a new rewind history.
+ *
+ * @param rewind
+ *   Created rewind history.
+ *
+ * @param steps
+ *   Number of steps to keep.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result create_rewind(Rewind **rewind, size_t steps);
+
+/**
+ * Destroy a rewind history.
+ *
+ * @param rewind
+ *   Rewind history to destroy.
+ */
+void destroy_rewind(Rewind *rewind);
+
+/**
+ * Record the state of a game after a step.
+ *
+ * Steps must be recorded in order with none missed, if a step doesn't follow the last one recorded the history is
+ * cleared and starts again from this step.
+ *
+ * @param rewind
+ *   Rewind history to record in.
+ *
+ * @param game
+ *   Game to record.
+ *
+ * @param outcome
+ *   Outcome of the step just taken, or NULL for the first record (nothing changed to get here).
+ */
+void record_rewind(Rewind *rewind, const Game *game, const StepOutcome *outcome);
+
+/**
+ * Restore a game to a recorded step, steps recorded after it are forgotten.
+ *
+ * The game must be the one that was recorded and must not have changed since the last record.
+ *
+ * @param rewind
+ *   Rewind history to restore from.
+ *
+ * @param game
+ *   Game to restore.
+ *
+ * @param step
+ *   Step to restore.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the step isn't in the history
+ */
+Result restore_rewind(Rewind *rewind, Game *game, uint64_t step);
+
+/**
+ * Get the range of recorded steps.
+ *
+ * @param rewind
+ *   Rewind history to check.
+ *
+ * @param oldest
+ *   Out parameter for the oldest step that can be restored.
+ *
+ * @param newest
+ *   Out parameter for the newest step that can be restored.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   NO_EVENT if nothing has been recorded
+ */
+Result get_rewind_range(const Rewind *rewind, uint64_t *oldest, uint64_t *newest);
+
+/**
+ * Get the number of bytes allocated for the history.
+ *
+ * @param rewind
+ *   Rewind history to check.
+ *
+ * @returns
+ *   Allocated size in bytes.
+ */
+size_t get_rewind_memory(const Rewind *rewind);
+
+#endif
@@ -0,0 +1,344 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "alloc.h"
+#include "scene.h"
+
+/**
+ * Most bands of grid rows the visible bricks are split into for building the render list.
+ */
+#define RENDER_BANDS 16u
+
+/**
+ * Render list of the bricks in view, built in parallel by draw_visible_bricks.
+ */
+typedef struct BrickList
+{
+    const Game *game;
+    const Camera *camera;
+    GridRange range;
+    int32_t band_rows;
+
+    // bricks found in each band and where each band starts in rects
+    size_t counts[RENDER_BANDS];
+    size_t offsets[RENDER_BANDS];
+
+    DrawRect *rects;
+    size_t count;
+} BrickList;
+
+typedef struct Scene
+{
+    const Game *game;
+    BrickList bricks;
+} Scene;
+
+/**
+ * Helper function to visit the live bricks in view in one band of grid rows, in a fixed order.
+ *
+ * @param list
+ *   Brick list being built.
+ *
+ * @param band
+ *   Band of rows to visit.
+ *
+ * @param rects
+ *   Where to write the bricks found, NULL to only count them.
+ *
+ * @returns
+ *   Number of bricks found.
+ */
+static size_t visit_brick_band(const BrickList *list, size_t band, DrawRect *rects)
+{
+    const Game *game = list->game;
+    const GridRange *range = &list->range;
+    const int32_t first_row = range->first_row + ((int32_t)band * list->band_rows);
+    const int32_t last_row =
+        ((first_row + list->band_rows - 1) < range->last_row) ? (first_row + list->band_rows - 1) : range->last_row;
+    size_t found = 0u;
+
+    for (int32_t row = first_row; row <= last_row; ++row)
+    {
+        for (int32_t column = range->first_column; column <= range->last_column; ++column)
+        {
+            size_t count = 0u;
+            const uint32_t *indices = get_cell_bricks(game, column, row, &count);
+
+            for (size_t i = 0u; i < count; ++i)
+            {
+                const Entity *brick = get_brick(game, indices[i]);
+                if (is_brick_alive(game, indices[i]) && is_visible_camera(list->camera, &brick->block))
+                {
+                    if (rects != NULL)
+                    {
+                        rects[found] = (DrawRect){
+                            .block = brick->block,
+                            .colour = ((uint32_t)brick->r << 24u) | ((uint32_t)brick->g << 16u) |
+                                      ((uint32_t)brick->b << 8u) | 0xffu};
+                    }
+                    ++found;
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+/**
+ * Helper function to count the bricks in a band, a job function.
+ *
+ * @param data
+ *   Brick list being built.
+ *
+ * @param band
+ *   Band to count.
+ */
+static void count_brick_band(void *data, size_t band)
+{
+    BrickList *list = (BrickList *)data;
+    list->counts[band] = visit_brick_band(list, band, NULL);
+}
+
+/**
+ * Helper function to give each band its place in the list, a job function.
+ *
+ * @param data
+ *   Brick list being built.
+ *
+ * @param bands
+ *   Number of bands.
+ */
+static void place_brick_bands(void *data, size_t bands)
+{
+    BrickList *list = (BrickList *)data;
+
+    list->count = 0u;
+    for (size_t band = 0u; band < bands; ++band)
+    {
+        list->offsets[band] = list->count;
+        list->count += list->counts[band];
+    }
+}
+
+/**
+ * Helper function to write the bricks in a band, a job function.
+ *
+ * @param data
+ *   Brick list being built.
+ *
+ * @param band
+ *   Band to write.
+ */
+static void fill_brick_band(void *data, size_t band)
+{
+    BrickList *list = (BrickList *)data;
+    visit_brick_band(list, band, &list->rects[list->offsets[band]]);
+}
+
+/**
+ * Helper function to draw the live bricks in view, looking only at the grid cells under the camera so the cost doesn't
+ * depend on the size of the level.
+ *
+ * The rows under the camera are split into bands, each band is counted and then written by its own job. Bands are
+ * placed in row order, so the list comes out the same however the jobs ran.
+ *
+ * @param window
+ *   Window to draw to.
+ *
+ * @param jobs
+ *   Job system to build the list with.
+ *
+ * @param list
+ *   Brick list with room for every brick in the game.
+ *
+ * @param camera
+ *   Camera the window is drawing with.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result draw_visible_bricks(Window *window, JobSystem *jobs, BrickList *list, const Camera *camera)
+{
+    list->camera = camera;
+    get_brick_range(list->game, &camera->view, &list->range);
+    list->count = 0u;
+
+    const int32_t rows = list->range.last_row - list->range.first_row + 1;
+    if ((rows <= 0) || (list->range.last_column < list->range.first_column))
+    {
+        return SUCCESS;
+    }
+
+    size_t bands = ((size_t)rows < RENDER_BANDS) ? (size_t)rows : RENDER_BANDS;
+    list->band_rows = (int32_t)(((size_t)rows + bands - 1u) / bands);
+    bands = ((size_t)rows + (size_t)list->band_rows - 1u) / (size_t)list->band_rows;
+
+    JobId counted[RENDER_BANDS];
+    JobId placed = 0u;
+    for (size_t band = 0u; band < bands; ++band)
+    {
+        if (add_job(jobs, count_brick_band, list, band, NULL, 0u, &counted[band]) != SUCCESS)
+        {
+            return FAILED;
+        }
+    }
+    if (add_job(jobs, place_brick_bands, list, bands, counted, bands, &placed) != SUCCESS)
+    {
+        return FAILED;
+    }
+    for (size_t band = 0u; band < bands; ++band)
+    {
+        if (add_job(jobs, fill_brick_band, list, band, &placed, 1u, NULL) != SUCCESS)
+        {
+            return FAILED;
+        }
+    }
+    run_jobs(jobs);
+
+    return draw_rects_window(window, list->rects, list->count);
+}
+
+/**
+ * Helper function to draw the falling power-ups and the balls added by multi-ball.
+ *
+ * @param window
+ *   Window to draw to.
+ *
+ * @param game
+ *   Game with the power-ups.
+ *
+ * @param camera
+ *   Camera the window is drawing with.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result draw_powerups(Window *window, const Game *game, const Camera *camera)
+{
+    // wide, slow, multi, sticky
+    static const uint8_t colours[POWERUP_KINDS][3] = {
+        {0x40, 0x80, 0xff}, {0xc0, 0x40, 0xff}, {0xff, 0xff, 0x40}, {0x40, 0xff, 0xc0}};
+
+    const PowerupState *powerups = &game->state.powerups;
+
+    for (uint32_t i = 0u; i < GAME_MAX_DROPS; ++i)
+    {
+        const Drop *drop = &powerups->drops[i];
+        if ((((powerups->drops_used >> i) & 1u) != 0u) && is_visible_camera(camera, &drop->block))
+        {
+            const uint8_t *colour = colours[drop->kind];
+            if (draw_block_window(window, &drop->block, colour[0], colour[1], colour[2]) != SUCCESS)
+            {
+                return FAILED;
+            }
+        }
+    }
+
+    for (uint32_t i = 0u; i < (GAME_MAX_BALLS - 1u); ++i)
+    {
+        const Entity *ball = &powerups->extra_balls[i];
+        if ((((powerups->extras_used >> i) & 1u) != 0u) && is_visible_camera(camera, &ball->block) &&
+            (draw_block_window(window, &ball->block, ball->r, ball->g, ball->b) != SUCCESS))
+        {
+            return FAILED;
+        }
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * Helper function to draw an entity if it is in view.
+ *
+ * @param window
+ *   Window to draw to.
+ *
+ * @param entity
+ *   Entity to draw.
+ *
+ * @param camera
+ *   Camera the window is drawing with.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result draw_entity(Window *window, const Entity *entity, const Camera *camera)
+{
+    if (!is_visible_camera(camera, &entity->block))
+    {
+        return SUCCESS;
+    }
+    return draw_block_window(window, &entity->block, entity->r, entity->g, entity->b);
+}
+
+Result create_scene(Scene **scene, const Game *game, size_t brick_capacity)
+{
+    assert(scene != NULL);
+    assert(game != NULL);
+
+    Scene *n_scene = (Scene *)TRACKED_CALLOC(1u, sizeof(Scene));
+    if (n_scene == NULL)
+    {
+        return FAILED;
+    }
+
+    n_scene->game = game;
+    n_scene->bricks.game = game;
+    n_scene->bricks.rects = (DrawRect *)TRACKED_CALLOC(brick_capacity + 1u, sizeof(DrawRect));
+    if (n_scene->bricks.rects == NULL)
+    {
+        destroy_scene(n_scene);
+        return FAILED;
+    }
+
+    // assign the scene to the user supplied pointer
+    *scene = n_scene;
+    return SUCCESS;
+}
+
+void destroy_scene(Scene *scene)
+{
+    if (scene == NULL)
+    {
+        return;
+    }
+
+    free_tracked(scene->bricks.rects);
+    free_tracked(scene);
+}
+
+Result draw_scene(Scene *scene, Window *window, JobSystem *jobs, const Camera *camera, const ParticleSystem *particles)
+{
+    assert(scene != NULL);
+    assert(window != NULL);
+    assert(camera != NULL);
+
+    const Game *game = scene->game;
+
+    if ((draw_visible_bricks(window, jobs, &scene->bricks, camera) != SUCCESS) ||
+        (draw_powerups(window, game, camera) != SUCCESS))
+    {
+        return FAILED;
+    }
+
+    for (uint32_t player = 0u; player < game->players; ++player)
+    {
+        if (draw_entity(window, &game->state.paddles[player], camera) != SUCCESS)
+        {
+            return FAILED;
+        }
+    }
+
+    if ((draw_entity(window, &game->state.ball, camera) != SUCCESS) ||
+        ((particles != NULL) && (draw_particle_system(particles, window) != SUCCESS)))
+    {
+        return FAILED;
+    }
+
+    return SUCCESS;
+}
@@ -0,0 +1,74 @@
+#ifndef _SCENE_H_
+#define _SCENE_H_
+
+#include <stddef.h>
+
+#include "camera.h"
+#include "game.h"
+#include "jobs.h"
+#include "particle.h"
+#include "result.h"
+#include "window.h"
+
+/**
+ * Scene draws a game into a window: the bricks, power-ups, paddles, balls and particles in view. The HUD is left to the
+ * caller.
+ */
+
+/**
+ * Scene internal data.
+ */
+typedef struct Scene Scene;
+
+/**
+ * Create a new scene.
+ *
+ * @param scene
+ *   Created scene.
+ *
+ * @param game
+ *   Game to draw.
+ *
+ * @param brick_capacity
+ *   Most bricks that can be in view, the game's brick count unless only some of the bricks are ever in memory.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result create_scene(Scene **scene, const Game *game, size_t brick_capacity);
+
+/**
+ * Destroy a scene.
+ *
+ * @param scene
+ *   Scene to destroy.
+ */
+void destroy_scene(Scene *scene);
+
+/**
+ * Draw everything in view. Must be called between pre_render_window and post_render_window, after the window's camera
+ * is set.
+ *
+ * @param scene
+ *   Scene to draw.
+ *
+ * @param window
+ *   Window to draw to.
+ *
+ * @param jobs
+ *   Job system to build the brick list with.
+ *
+ * @param camera
+ *   Camera the window is drawing with.
+ *
+ * @param particles
+ *   Particles to draw.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result draw_scene(Scene *scene, Window *window, JobSystem *jobs, const Camera *camera, const ParticleSystem *particles);
+
+#endif
@@ -0,0 +1,334 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "session.h"
+
+/**
+ * First line of every session file.
+ */
+#define SESSION_HEADER "breakout-session 1"
+
+/**
+ * Name of the arithmetic this build simulates with, recorded next to the final hash.
+ */
+#ifdef BREAKOUT_FIXED_POINT
+#define SESSION_ARITHMETIC "fixed"
+#else
+#define SESSION_ARITHMETIC "float"
+#endif
+
+typedef struct SessionRecorder
+{
+    FILE *file;
+
+    // run being recorded, written out when the keys change
+    GameInput input;
+    uint32_t steps;
+    uint64_t total_steps;
+} SessionRecorder;
+
+/**
+ * Helper function to get the character for a set of keys.
+ *
+ * @param input
+ *   Keys held.
+ *
+ * @returns
+ *   Key character.
+ */
+static char get_key_char(const GameInput *input)
+{
+    if (input->left && input->right)
+    {
+        return 'B';
+    }
+    if (input->left)
+    {
+        return 'L';
+    }
+    return input->right ? 'R' : '-';
+}
+
+/**
+ * Helper function to get the keys for a character.
+ *
+ * @param key
+ *   Key character.
+ *
+ * @param input
+ *   Out parameter for the keys.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the character is not a key character
+ */
+static Result parse_key_char(char key, GameInput *input)
+{
+    switch (key)
+    {
+    case '-':
+        *input = (GameInput){0};
+        return SUCCESS;
+    case 'L':
+        *input = (GameInput){.left = true};
+        return SUCCESS;
+    case 'R':
+        *input = (GameInput){.right = true};
+        return SUCCESS;
+    case 'B':
+        *input = (GameInput){.left = true, .right = true};
+        return SUCCESS;
+    default:
+        return FAILED;
+    }
+}
+
+/**
+ * Helper function to read the runs and end line of a session.
+ *
+ * @param file
+ *   File positioned after the header.
+ *
+ * @param session
+ *   Session to fill in.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result read_runs(FILE *file, Session *session)
+{
+    size_t capacity = 0u;
+    char word[16];
+
+    while (fscanf(file, "%15s", word) == 1)
+    {
+        if (strcmp(word, "end") == 0)
+        {
+            unsigned long long steps = 0u;
+            unsigned long long hash = 0u;
+            char arithmetic[8];
+            if ((fscanf(file, "%llu %7s %llx", &steps, arithmetic, &hash) != 3) || (steps != session->steps))
+            {
+                return FAILED;
+            }
+            session->hash = (uint64_t)hash;
+            session->valid_hash = strcmp(arithmetic, SESSION_ARITHMETIC) == 0;
+            return SUCCESS;
+        }
+
+        char key[2];
+        SessionRun run = {0};
+        if ((sscanf(word, "%u", &run.steps) != 1) || (run.steps == 0u) || (fscanf(file, "%1s", key) != 1) ||
+            (parse_key_char(key[0], &run.input) != SUCCESS))
+        {
+            return FAILED;
+        }
+
+        if (session->run_count == capacity)
+        {
+            capacity = (capacity == 0u) ? 1024u : (capacity * 2u);
+            SessionRun *runs = (SessionRun *)TRACKED_REALLOC(session->runs, capacity * sizeof(SessionRun));
+            if (runs == NULL)
+            {
+                return FAILED;
+            }
+            session->runs = runs;
+        }
+
+        session->runs[session->run_count++] = run;
+        session->steps += run.steps;
+    }
+
+    // no end line, the recording was cut short
+    return FAILED;
+}
+
+/**
+ * Helper function to write out the run being recorded.
+ *
+ * @param recorder
+ *   Recorder to write with.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the file could not be written
+ */
+static Result write_run(SessionRecorder *recorder)
+{
+    if ((recorder->steps > 0u) &&
+        (fprintf(recorder->file, "%u %c\n", recorder->steps, get_key_char(&recorder->input)) < 0))
+    {
+        return FAILED;
+    }
+
+    recorder->steps = 0u;
+    return SUCCESS;
+}
+
+Result load_session(Session **session, const char *path)
+{
+    assert(session != NULL);
+    assert(path != NULL);
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        printf("failed to open session %s\n", path);
+        return FAILED;
+    }
+
+    Session *n_session = (Session *)TRACKED_CALLOC(1u, sizeof(Session));
+    char header[sizeof(SESSION_HEADER)];
+    if ((n_session == NULL) || (fgets(header, sizeof(header), file) == NULL) || (strcmp(header, SESSION_HEADER) != 0) ||
+        (fscanf(file, " level %u", &n_session->world_size) != 1) ||
+        ((n_session->world_size != 0u) && (n_session->world_size < 800u)) || (read_runs(file, n_session) != SUCCESS))
+    {
+        printf("%s is not a complete session\n", path);
+        fclose(file);
+        destroy_session(n_session);
+        return FAILED;
+    }
+
+    fclose(file);
+
+    // assign the session to the user supplied pointer
+    *session = n_session;
+    return SUCCESS;
+}
+
+void destroy_session(Session *session)
+{
+    if (session == NULL)
+    {
+        return;
+    }
+
+    free_tracked(session->runs);
+    free_tracked(session);
+}
+
+Result create_session_game(const Session *session, Game **game)
+{
+    assert(session != NULL);
+
+    if (session->world_size == 0u)
+    {
+        return create_game(game);
+    }
+    return create_large_game(game, scalar_from_int((int32_t)session->world_size));
+}
+
+SessionCursor start_session(const Session *session)
+{
+    assert(session != NULL);
+
+    return (SessionCursor){.session = session};
+}
+
+bool next_session_input(SessionCursor *cursor, GameInput *input)
+{
+    assert(cursor != NULL);
+    assert(input != NULL);
+
+    const Session *session = cursor->session;
+    if (cursor->run == session->run_count)
+    {
+        return false;
+    }
+
+    const SessionRun *run = &session->runs[cursor->run];
+    *input = run->input;
+    if (++cursor->step == run->steps)
+    {
+        cursor->step = 0u;
+        ++cursor->run;
+    }
+
+    return true;
+}
+
+Result create_session_recorder(SessionRecorder **recorder, const char *path, uint32_t world_size)
+{
+    assert(recorder != NULL);
+    assert(path != NULL);
+
+    SessionRecorder *n_recorder = (SessionRecorder *)TRACKED_CALLOC(1u, sizeof(SessionRecorder));
+    if (n_recorder == NULL)
+    {
+        return FAILED;
+    }
+
+    n_recorder->file = fopen(path, "w");
+    if ((n_recorder->file == NULL) || (fprintf(n_recorder->file, SESSION_HEADER "\nlevel %u\n", world_size) < 0))
+    {
+        printf("failed to create session %s\n", path);
+        destroy_session_recorder(n_recorder);
+        return FAILED;
+    }
+
+    // assign the recorder to the user supplied pointer
+    *recorder = n_recorder;
+    return SUCCESS;
+}
+
+Result record_session_input(SessionRecorder *recorder, const GameInput *input)
+{
+    assert(recorder != NULL);
+    assert(input != NULL);
+
+    if ((recorder->input.left != input->left) || (recorder->input.right != input->right))
+    {
+        if (write_run(recorder) != SUCCESS)
+        {
+            return FAILED;
+        }
+        recorder->input = *input;
+    }
+
+    ++recorder->steps;
+    ++recorder->total_steps;
+    return SUCCESS;
+}
+
+Result finish_session_recorder(SessionRecorder *recorder, const Game *game)
+{
+    assert(recorder != NULL);
+    assert(game != NULL);
+
+    Result result = write_run(recorder);
+    if ((result == SUCCESS) && (fprintf(
+                                    recorder->file,
+                                    "end %llu " SESSION_ARITHMETIC " %016llx\n",
+                                    (unsigned long long)recorder->total_steps,
+                                    (unsigned long long)hash_game(game)) < 0))
+    {
+        result = FAILED;
+    }
+
+    if (fclose(recorder->file) != 0)
+    {
+        result = FAILED;
+    }
+    recorder->file = NULL;
+
+    return result;
+}
+
+void destroy_session_recorder(SessionRecorder *recorder)
+{
+    if (recorder == NULL)
+    {
+        return;
+    }
+
+    if (recorder->file != NULL)
+    {
+        fclose(recorder->file);
+    }
+    free_tracked(recorder);
+}
@@ -0,0 +1,191 @@
+#ifndef _SESSION_H_
+#define _SESSION_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "game.h"
+#include "result.h"
+
+/**
+ * Session records the keys a single player held for every step of a game so it can be played back exactly, the game is
+ * deterministic so the same level and keys always give the same game.
+ *
+ * Sessions are text files, a header naming the level followed by one line per run of steps with the same keys held:
+ *
+ *     breakout-session 1
+ *     level 0
+ *     1520 -
+ *     33 L
+ *     12 R
+ *     ...
+ *     end 200416 float 5d1c2f0e4a8b7c13
+ *
+ * The level is 0 for the built in level or the size of a generated world. Keys are - for none, L for left, R for right
+ * and B for both. The end line gives the number of steps and the hash_game of the final state, for the arithmetic the
+ * session was recorded with.
+ */
+
+/**
+ * Steps of a session with the same keys held.
+ */
+typedef struct SessionRun
+{
+    uint32_t steps;
+    GameInput input;
+} SessionRun;
+
+/**
+ * A loaded session.
+ */
+typedef struct Session
+{
+    // size of the generated world played, 0 for the built in level
+    uint32_t world_size;
+
+    SessionRun *runs;
+    size_t run_count;
+
+    // total steps and the hash of the game after them, valid_hash is false if the session was recorded with the other
+    // arithmetic (float or fixed point) so the hash can't be compared
+    uint64_t steps;
+    uint64_t hash;
+    bool valid_hash;
+} Session;
+
+/**
+ * Position reached playing back a session.
+ */
+typedef struct SessionCursor
+{
+    const Session *session;
+    size_t run;
+    uint32_t step;
+} SessionCursor;
+
+/**
+ * Session recorder internal data.
+ */
+typedef struct SessionRecorder SessionRecorder;
+
+/**
+ * Load a session file.
+ *
+ * @param session
+ *   Loaded session.
+ *
+ * @param path
+ *   File to load.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure, including a file that isn't a complete session
+ */
+Result load_session(Session **session, const char *path);
+
+/**
+ * Destroy a session.
+ *
+ * @param session
+ *   Session to destroy.
+ */
+void destroy_session(Session *session);
+
+/**
+ * Create a game with the level a session was recorded on.
+ *
+ * @param session
+ *   Session to play.
+ *
+ * @param game
+ *   Created game.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result create_session_game(const Session *session, Game **game);
+
+/**
+ * Start playing back a session from the first step.
+ *
+ * @param session
+ *   Session to play.
+ *
+ * @returns
+ *   Cursor at the first step.
+ */
+SessionCursor start_session(const Session *session);
+
+/**
+ * Get the keys for the next step of a session.
+ *
+ * @param cursor
+ *   Cursor to advance.
+ *
+ * @param input
+ *   Out parameter for the keys.
+ *
+ * @returns
+ *   True if there was a step left, otherwise false.
+ */
+bool next_session_input(SessionCursor *cursor, GameInput *input);
+
+/**
+ * Create a recorder writing a new session file.
+ *
+ * @param recorder
+ *   Created recorder.
+ *
+ * @param path
+ *   File to write.
+ *
+ * @param world_size
+ *   Size of the generated world being played, 0 for the built in level.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result create_session_recorder(SessionRecorder **recorder, const char *path, uint32_t world_size);
+
+/**
+ * Record the keys held for a step, steps must be recorded in order with none missed.
+ *
+ * @param recorder
+ *   Recorder to record with.
+ *
+ * @param input
+ *   Keys held.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the file could not be written
+ */
+Result record_session_input(SessionRecorder *recorder, const GameInput *input);
+
+/**
+ * Write the end of a session and close the file.
+ *
+ * @param recorder
+ *   Recorder to finish.
+ *
+ * @param game
+ *   Game after the last step recorded.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the file could not be written
+ */
+Result finish_session_recorder(SessionRecorder *recorder, const Game *game);
+
+/**
+ * Destroy a session recorder, a recorder that wasn't finished leaves an incomplete file behind.
+ *
+ * @param recorder
+ *   Recorder to destroy.
+ */
+void destroy_session_recorder(SessionRecorder *recorder);
+
+#endif
@@ -0,0 +1,577 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "autopilot.h"
+#include "camera.h"
+#include "game.h"
+#include "spectate.h"
+#include "trace.h"
+
+/**
+ * Keeps what each side of a handover writes on its own cache line.
+ */
+#define CACHE_LINE 64
+
+/**
+ * Steps a thread plays of one game before moving on to its next, a snapshot is offered after each turn.
+ */
+#define TURN_STEPS 256u
+
+/**
+ * Pixels left empty between tiles.
+ */
+#define TILE_GAP 2
+
+/**
+ * Colour of the empty part of a tile, packed as 0xRRGGBBAA.
+ */
+#define TILE_COLOUR 0x181820ffu
+
+/**
+ * Colour of a falling power-up, tiles are too small to tell the kinds apart.
+ */
+#define DROP_COLOUR 0xc0c0c0ffu
+
+/**
+ * Snapshot number in a handover.
+ */
+#define SNAPSHOT_INDEX 3u
+
+/**
+ * Set in a handover from the snapshot being handed over until the window takes it.
+ */
+#define SNAPSHOT_FRESH 4u
+
+/**
+ * A game as it was at the end of a turn.
+ */
+typedef struct Snapshot
+{
+    GameState state;
+    uint64_t *alive;
+} Snapshot;
+
+/**
+ * A game being watched. The simulation thread playing it fills snapshots[back], the window draws snapshots[front] and
+ * they swap the one they are done with for the one in middle.
+ */
+typedef struct WatchedGame
+{
+    Game *game;
+
+    // state to start again from when the game ends, and how many times it has
+    GameState start;
+    uint64_t episode;
+
+    Snapshot snapshots[3];
+    uint32_t back;
+    uint32_t front;
+
+    _Alignas(CACHE_LINE) atomic_uint middle;
+} WatchedGame;
+
+/**
+ * A thread playing every thread_count'th game from index.
+ */
+typedef struct SpectatorThread
+{
+    Spectator *spectator;
+    size_t index;
+    pthread_t thread;
+    bool started;
+
+    _Alignas(CACHE_LINE) atomic_uint_fast64_t steps;
+    atomic_uint_fast64_t finished;
+} SpectatorThread;
+
+typedef struct Spectator
+{
+    WatchedGame *games;
+    size_t game_count;
+    uint64_t max_steps;
+
+    SpectatorThread *threads;
+    size_t thread_count;
+
+    // every game plays the same level, so they all start with the same bricks alive. The snapshots' alive bits are
+    // cut from alive
+    uint64_t *start_alive;
+    uint64_t *alive;
+    size_t alive_words;
+
+    // tiles are tile_size pixels apart, columns to a row, and a game is drawn at scale inside its tile
+    int32_t columns;
+    int32_t tile_size;
+    Scalar scale;
+
+    // every tile goes in one batch
+    DrawRect *rects;
+    size_t rect_capacity;
+
+    atomic_bool quit;
+} Spectator;
+
+/**
+ * Helper function to get the power-up seed of one game of the batch, different for every game and every time it
+ * starts again.
+ *
+ * @param index
+ *   Game in the batch.
+ *
+ * @param episode
+ *   Times the game has started again.
+ *
+ * @returns
+ *   Seed, never 0.
+ */
+static uint32_t get_spectate_seed(size_t index, uint64_t episode)
+{
+    return (uint32_t)((((episode * SPECTATE_MAX_GAMES) + index + 1u) * 0x9e3779b9u)) | 1u;
+}
+
+/**
+ * Helper function to start a game again from where every game starts, with a new power-up seed.
+ *
+ * @param spectator
+ *   Spectator watching the game.
+ *
+ * @param watched
+ *   Game to start again.
+ *
+ * @param index
+ *   Game in the batch.
+ */
+static void restart_game(const Spectator *spectator, WatchedGame *watched, size_t index)
+{
+    Game *game = watched->game;
+
+    ++watched->episode;
+    game->state = watched->start;
+    memcpy(game->brick_alive, spectator->start_alive, spectator->alive_words * sizeof(uint64_t));
+    seed_game(game, get_spectate_seed(index, watched->episode));
+}
+
+/**
+ * Helper function to hand the window the game as it is now. Skipped while the window has yet to take the last one, it
+ * would only be copied over again.
+ *
+ * @param spectator
+ *   Spectator watching the game.
+ *
+ * @param watched
+ *   Game to snapshot.
+ */
+static void publish_snapshot(const Spectator *spectator, WatchedGame *watched)
+{
+    if ((atomic_load_explicit(&watched->middle, memory_order_relaxed) & SNAPSHOT_FRESH) != 0u)
+    {
+        return;
+    }
+
+    Snapshot *snapshot = &watched->snapshots[watched->back];
+    snapshot->state = watched->game->state;
+    memcpy(snapshot->alive, watched->game->brick_alive, spectator->alive_words * sizeof(uint64_t));
+
+    // release the snapshot just written, acquire the one the window let go of
+    watched->back = atomic_exchange_explicit(&watched->middle, watched->back | SNAPSHOT_FRESH, memory_order_acq_rel) &
+                    SNAPSHOT_INDEX;
+}
+
+/**
+ * Helper function run by each simulation thread, playing its games a turn at a time until asked to quit.
+ *
+ * @param data
+ *   The thread.
+ *
+ * @returns
+ *   NULL.
+ */
+static void *run_games(void *data)
+{
+    SpectatorThread *thread = (SpectatorThread *)data;
+    Spectator *spectator = thread->spectator;
+
+    TRACE_THREAD("spectated games");
+
+    GameInput inputs[GAME_MAX_PLAYERS] = {0};
+    StepOutcome outcome;
+
+    while (!atomic_load_explicit(&spectator->quit, memory_order_relaxed))
+    {
+        for (size_t i = thread->index; i < spectator->game_count; i += spectator->thread_count)
+        {
+            WatchedGame *watched = &spectator->games[i];
+            Game *game = watched->game;
+            uint64_t finished = 0u;
+
+            for (uint32_t step = 0u; step < TURN_STEPS; ++step)
+            {
+                autopilot_input(game, 0u, &inputs[0]);
+                step_game(game, inputs, &outcome);
+
+                if (is_game_over(game) ||
+                    ((spectator->max_steps != 0u) && (game->state.step >= spectator->max_steps)))
+                {
+                    restart_game(spectator, watched, i);
+                    ++finished;
+                }
+            }
+
+            publish_snapshot(spectator, watched);
+
+            atomic_fetch_add_explicit(&thread->steps, TURN_STEPS, memory_order_relaxed);
+            if (finished != 0u)
+            {
+                atomic_fetch_add_explicit(&thread->finished, finished, memory_order_relaxed);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Where a game is drawn: its world, width by height, scaled by scale with the upper left corner at origin.
+ */
+typedef struct Tile
+{
+    Vector2D origin;
+    Scalar scale;
+    Scalar width;
+    Scalar height;
+} Tile;
+
+/**
+ * Helper function to queue a block of a game scaled into its tile. The block is cut to the world first, so a ball on
+ * its way out doesn't spill into the next tile, and anything left smaller than a pixel is drawn a pixel across so
+ * balls stay visible.
+ *
+ * @param rects
+ *   Rectangles queued so far.
+ *
+ * @param count
+ *   Number of rectangles queued, counted up if the block is queued.
+ *
+ * @param tile
+ *   Tile to draw in.
+ *
+ * @param block
+ *   Block in world coordinates.
+ *
+ * @param colour
+ *   Colour packed as 0xRRGGBBAA.
+ */
+static void add_tile_rect(DrawRect *rects, size_t *count, const Tile *tile, const Block *block, uint32_t colour)
+{
+    const Scalar left = (block->position.x < SCALAR(0.0f)) ? SCALAR(0.0f) : block->position.x;
+    const Scalar top = (block->position.y < SCALAR(0.0f)) ? SCALAR(0.0f) : block->position.y;
+    const Scalar right =
+        ((block->position.x + block->width) > tile->width) ? tile->width : (block->position.x + block->width);
+    const Scalar bottom =
+        ((block->position.y + block->height) > tile->height) ? tile->height : (block->position.y + block->height);
+    if ((right <= left) || (bottom <= top))
+    {
+        return;
+    }
+
+    const Scalar width = scalar_mul(right - left, tile->scale);
+    const Scalar height = scalar_mul(bottom - top, tile->scale);
+
+    rects[(*count)++] = (DrawRect){
+        .block = create_block_xy(
+            tile->origin.x + scalar_mul(left, tile->scale),
+            tile->origin.y + scalar_mul(top, tile->scale),
+            (width < SCALAR_ONE) ? SCALAR_ONE : width,
+            (height < SCALAR_ONE) ? SCALAR_ONE : height),
+        .colour = colour};
+}
+
+/**
+ * Helper function to pack an entity's colour.
+ *
+ * @param entity
+ *   Entity to get the colour of.
+ *
+ * @returns
+ *   Colour packed as 0xRRGGBBAA.
+ */
+static uint32_t get_entity_colour(const Entity *entity)
+{
+    return ((uint32_t)entity->r << 24u) | ((uint32_t)entity->g << 16u) | ((uint32_t)entity->b << 8u) | 0xffu;
+}
+
+/**
+ * Helper function to queue one game's tile: the background, live bricks, power-ups, paddles and balls.
+ *
+ * @param spectator
+ *   Spectator drawing.
+ *
+ * @param game
+ *   Game the snapshot is of, only its level is read.
+ *
+ * @param snapshot
+ *   State to draw.
+ *
+ * @param index
+ *   Game in the batch, which decides the tile.
+ *
+ * @param rects
+ *   Where to queue the tile, room for everything a game can have.
+ *
+ * @returns
+ *   Number of rectangles queued.
+ */
+static size_t add_tile(
+    const Spectator *spectator, const Game *game, const Snapshot *snapshot, size_t index, DrawRect *rects)
+{
+    const GameState *state = &snapshot->state;
+    const PowerupState *powerups = &state->powerups;
+    const Scalar size = scalar_from_int(spectator->tile_size);
+    const Tile tile = {
+        .origin = create_vec_xy(
+            scalar_mul(scalar_from_int((int32_t)index % spectator->columns), size) + scalar_from_int(TILE_GAP / 2),
+            scalar_mul(scalar_from_int((int32_t)index / spectator->columns), size) + scalar_from_int(TILE_GAP / 2)),
+        .scale = spectator->scale,
+        .width = game->width,
+        .height = game->height};
+    const Block world = create_block_xy(SCALAR(0.0f), SCALAR(0.0f), game->width, game->height);
+    size_t count = 0u;
+
+    add_tile_rect(rects, &count, &tile, &world, TILE_COLOUR);
+
+    for (size_t word = 0u; word < spectator->alive_words; ++word)
+    {
+        for (uint64_t bits = snapshot->alive[word]; bits != 0u; bits &= bits - 1u)
+        {
+            const Entity *brick = get_brick(game, (word * 64u) + (size_t)__builtin_ctzll(bits));
+            add_tile_rect(rects, &count, &tile, &brick->block, get_entity_colour(brick));
+        }
+    }
+
+    for (uint32_t i = 0u; i < GAME_MAX_DROPS; ++i)
+    {
+        if (((powerups->drops_used >> i) & 1u) != 0u)
+        {
+            add_tile_rect(rects, &count, &tile, &powerups->drops[i].block, DROP_COLOUR);
+        }
+    }
+
+    for (uint32_t player = 0u; player < game->players; ++player)
+    {
+        const Entity *paddle = &state->paddles[player];
+        add_tile_rect(rects, &count, &tile, &paddle->block, get_entity_colour(paddle));
+    }
+
+    add_tile_rect(rects, &count, &tile, &state->ball.block, get_entity_colour(&state->ball));
+    for (uint32_t i = 0u; i < (GAME_MAX_BALLS - 1u); ++i)
+    {
+        const Entity *ball = &powerups->extra_balls[i];
+        if (((powerups->extras_used >> i) & 1u) != 0u)
+        {
+            add_tile_rect(rects, &count, &tile, &ball->block, get_entity_colour(ball));
+        }
+    }
+
+    return count;
+}
+
+Result create_spectator(Spectator **spectator, size_t games, size_t threads, uint64_t max_steps)
+{
+    assert(spectator != NULL);
+    assert((games > 0u) && (games <= SPECTATE_MAX_GAMES));
+    assert(threads > 0u);
+
+    Result res = SUCCESS;
+
+    Spectator *n_spectator = (Spectator *)TRACKED_CALLOC(1u, sizeof(Spectator));
+    if (n_spectator == NULL)
+    {
+        res = FAILED;
+        return res;
+    }
+
+    atomic_init(&n_spectator->quit, false);
+    n_spectator->max_steps = max_steps;
+    n_spectator->thread_count = (threads > games) ? games : threads;
+
+    // each has a member on a cache line of its own
+    n_spectator->games = (WatchedGame *)TRACKED_ALIGNED_CALLOC(CACHE_LINE, games * sizeof(WatchedGame));
+    n_spectator->threads =
+        (SpectatorThread *)TRACKED_ALIGNED_CALLOC(CACHE_LINE, n_spectator->thread_count * sizeof(SpectatorThread));
+    if ((n_spectator->games == NULL) || (n_spectator->threads == NULL))
+    {
+        res = FAILED;
+        destroy_spectator(n_spectator);
+        return res;
+    }
+
+    for (size_t i = 0u; i < games; ++i)
+    {
+        n_spectator->games[i] = (WatchedGame){.front = 0u, .back = 2u};
+        atomic_init(&n_spectator->games[i].middle, 1u);
+    }
+
+    for (size_t i = 0u; i < n_spectator->thread_count; ++i)
+    {
+        SpectatorThread *thread = &n_spectator->threads[i];
+        *thread = (SpectatorThread){.spectator = n_spectator, .index = i};
+        atomic_init(&thread->steps, 0u);
+        atomic_init(&thread->finished, 0u);
+    }
+
+    for (size_t i = 0u; i < games; ++i)
+    {
+        WatchedGame *watched = &n_spectator->games[i];
+        if (create_game(&watched->game) != SUCCESS)
+        {
+            res = FAILED;
+            destroy_spectator(n_spectator);
+            return res;
+        }
+        n_spectator->game_count = i + 1u;
+
+        seed_game(watched->game, get_spectate_seed(i, 0u));
+        watched->start = watched->game->state;
+    }
+
+    const Game *first = n_spectator->games[0].game;
+    n_spectator->alive_words = (first->brick_count / 64u) + 1u;
+    n_spectator->start_alive = (uint64_t *)TRACKED_CALLOC(n_spectator->alive_words, sizeof(uint64_t));
+    n_spectator->alive = (uint64_t *)TRACKED_CALLOC(games * 3u * n_spectator->alive_words, sizeof(uint64_t));
+
+    n_spectator->rect_capacity = games * (1u + first->brick_count + GAME_MAX_DROPS + GAME_MAX_PLAYERS + GAME_MAX_BALLS);
+    n_spectator->rects = (DrawRect *)TRACKED_CALLOC(n_spectator->rect_capacity, sizeof(DrawRect));
+    if ((n_spectator->start_alive == NULL) || (n_spectator->alive == NULL) || (n_spectator->rects == NULL))
+    {
+        res = FAILED;
+        destroy_spectator(n_spectator);
+        return res;
+    }
+
+    memcpy(n_spectator->start_alive, first->brick_alive, n_spectator->alive_words * sizeof(uint64_t));
+    for (size_t i = 0u; i < games; ++i)
+    {
+        WatchedGame *watched = &n_spectator->games[i];
+        for (size_t s = 0u; s < 3u; ++s)
+        {
+            Snapshot *snapshot = &watched->snapshots[s];
+            snapshot->state = watched->start;
+            snapshot->alive = &n_spectator->alive[((i * 3u) + s) * n_spectator->alive_words];
+            memcpy(snapshot->alive, n_spectator->start_alive, n_spectator->alive_words * sizeof(uint64_t));
+        }
+    }
+
+    // as close to square as fits the games, with each world scaled to fit its tile less the gap
+    n_spectator->columns = 1;
+    while (((size_t)n_spectator->columns * (size_t)n_spectator->columns) < games)
+    {
+        ++n_spectator->columns;
+    }
+    const int32_t rows = ((int32_t)games + n_spectator->columns - 1) / n_spectator->columns;
+    const int32_t tile_width = WINDOW_WIDTH / n_spectator->columns;
+    const int32_t tile_height = WINDOW_HEIGHT / rows;
+    n_spectator->tile_size = (tile_width < tile_height) ? tile_width : tile_height;
+
+    const Scalar extent = (first->width > first->height) ? first->width : first->height;
+    n_spectator->scale = scalar_div(scalar_from_int(n_spectator->tile_size - TILE_GAP), extent);
+
+    for (size_t i = 0u; i < n_spectator->thread_count; ++i)
+    {
+        SpectatorThread *thread = &n_spectator->threads[i];
+        thread->started = pthread_create(&thread->thread, NULL, run_games, thread) == 0;
+        if (!thread->started)
+        {
+            res = FAILED;
+            destroy_spectator(n_spectator);
+            return res;
+        }
+    }
+
+    // assign the spectator to the user supplied pointer
+    *spectator = n_spectator;
+    return res;
+}
+
+void destroy_spectator(Spectator *spectator)
+{
+    if (spectator == NULL)
+    {
+        return;
+    }
+
+    atomic_store_explicit(&spectator->quit, true, memory_order_relaxed);
+    for (size_t i = 0u; (spectator->threads != NULL) && (i < spectator->thread_count); ++i)
+    {
+        if (spectator->threads[i].started)
+        {
+            pthread_join(spectator->threads[i].thread, NULL);
+        }
+    }
+
+    for (size_t i = 0u; i < spectator->game_count; ++i)
+    {
+        destroy_game(spectator->games[i].game);
+    }
+
+    free_tracked(spectator->games);
+    free_tracked(spectator->threads);
+    free_tracked(spectator->start_alive);
+    free_tracked(spectator->alive);
+    free_tracked(spectator->rects);
+    free_tracked(spectator);
+}
+
+Result draw_spectator(Spectator *spectator, Window *window)
+{
+    assert(spectator != NULL);
+    assert(window != NULL);
+
+    TRACE_ZONE("draw_spectator");
+
+    size_t count = 0u;
+    for (size_t i = 0u; i < spectator->game_count; ++i)
+    {
+        WatchedGame *watched = &spectator->games[i];
+
+        // release the snapshot drawn last frame, acquire the newest
+        if ((atomic_load_explicit(&watched->middle, memory_order_relaxed) & SNAPSHOT_FRESH) != 0u)
+        {
+            watched->front =
+                atomic_exchange_explicit(&watched->middle, watched->front, memory_order_acq_rel) & SNAPSHOT_INDEX;
+        }
+
+        count += add_tile(spectator, watched->game, &watched->snapshots[watched->front], i, &spectator->rects[count]);
+    }
+
+    const Camera camera = create_camera(scalar_from_int(WINDOW_WIDTH), scalar_from_int(WINDOW_HEIGHT));
+    set_camera_window(window, &camera);
+
+    return draw_rects_window(window, spectator->rects, count);
+}
+
+size_t get_spectator_rect_capacity(const Spectator *spectator)
+{
+    assert(spectator != NULL);
+
+    return spectator->rect_capacity;
+}
+
+void get_spectator_stats(const Spectator *spectator, SpectatorStats *stats)
+{
+    assert(spectator != NULL);
+    assert(stats != NULL);
+
+    *stats = (SpectatorStats){0};
+    for (size_t i = 0u; i < spectator->thread_count; ++i)
+    {
+        const SpectatorThread *thread = &spectator->threads[i];
+        stats->steps += atomic_load_explicit(&thread->steps, memory_order_relaxed);
+        stats->finished += atomic_load_explicit(&thread->finished, memory_order_relaxed);
+    }
+}
@@ -0,0 +1,112 @@
+#ifndef _SPECTATE_H_
+#define _SPECTATE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "result.h"
+#include "window.h"
+
+/**
+ * Spectate plays a batch of games of the built in level on background threads, as fast as they go, and draws the
+ * latest state of every one as a tile in one window so a soak run can be watched.
+ *
+ * Each game hands its states to the window through three snapshots: the simulation thread fills one, the window draws
+ * another and the third is swapped between them with a single atomic exchange, so neither side ever waits for the
+ * other. A snapshot is only taken once the window has picked up the one before, so the games spend no more time
+ * copying than the window can show. Every tile goes into one batch of rectangles drawn with a single submission.
+ */
+
+/**
+ * Most games watched at once, an 8 x 8 grid of tiles.
+ */
+#define SPECTATE_MAX_GAMES 64u
+
+/**
+ * Spectator internal data.
+ */
+typedef struct Spectator Spectator;
+
+/**
+ * Counters for the games being watched.
+ */
+typedef struct SpectatorStats
+{
+    // steps played by all the games together
+    uint64_t steps;
+
+    // games played to the end and started again
+    uint64_t finished;
+} SpectatorStats;
+
+/**
+ * Create the games and start the threads playing them with the autopilot. A game that ends starts again with a new
+ * power-up seed.
+ *
+ * @param spectator
+ *   Created spectator.
+ *
+ * @param games
+ *   Number of games, 1 to SPECTATE_MAX_GAMES.
+ *
+ * @param threads
+ *   Threads to play them on, each takes an equal share of the games.
+ *
+ * @param max_steps
+ *   Steps after which a game starts again even if it isn't over, 0 for no limit.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result create_spectator(Spectator **spectator, size_t games, size_t threads, uint64_t max_steps);
+
+/**
+ * Stop the threads and destroy the games.
+ *
+ * @param spectator
+ *   Spectator to destroy.
+ */
+void destroy_spectator(Spectator *spectator);
+
+/**
+ * Draw every game as a tile, each scaled to fit, from the latest snapshot it has handed over.
+ *
+ * This *must* be called after window_pre_render and before window_post_render for any given frame. It sets the camera
+ * to the whole window.
+ *
+ * @param spectator
+ *   Spectator to draw.
+ *
+ * @param window
+ *   Window to draw to.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result draw_spectator(Spectator *spectator, Window *window);
+
+/**
+ * Get the most rectangles draw_spectator can draw in a frame, for reserving window geometry up front.
+ *
+ * @param spectator
+ *   Spectator to query.
+ *
+ * @returns
+ *   Number of rectangles.
+ */
+size_t get_spectator_rect_capacity(const Spectator *spectator);
+
+/**
+ * Get the counters for the games, summed over the threads playing them.
+ *
+ * @param spectator
+ *   Spectator to read.
+ *
+ * @param stats
+ *   Out parameter for the counters.
+ */
+void get_spectator_stats(const Spectator *spectator, SpectatorStats *stats);
+
+#endif
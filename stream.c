@@ -0,0 +1,855 @@
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "alloc.h"
+#include "queue.h"
+#include "stream.h"
+#include "trace.h"
+
+/**
+ * Magic number at the start of a level file ("BRKL").
+ */
+#define LEVEL_MAGIC 0x42524b4cu
+
+/**
+ * Bumped whenever the file layout changes.
+ */
+#define LEVEL_VERSION 1u
+
+/**
+ * Width of a chunk in the world.
+ */
+#define CHUNK_SIZE (GAME_CELL_SIZE * GAME_CHUNK_CELLS)
+
+/**
+ * Distance around each ball kept in memory, a chunk across so the next chunk is read long before a ball reaches it.
+ */
+#define PREFETCH_DISTANCE CHUNK_SIZE
+
+/**
+ * Fewest slots a stream works with, enough for the chunks around every ball.
+ */
+#define MIN_SLOTS (16u * GAME_MAX_BALLS)
+
+/**
+ * Marks a slot with no chunk.
+ */
+#define NO_CHUNK UINT32_MAX
+
+/**
+ * Level file header. The header is followed by a ChunkEntry for every chunk and then the chunks themselves, all in the
+ * byte order of the machine that wrote them.
+ */
+typedef struct LevelHeader
+{
+    uint32_t magic;
+    uint32_t version;
+
+    // width and height of the world in pixels
+    int32_t size;
+
+    int32_t chunk_columns;
+    int32_t chunk_rows;
+
+    // bricks in the largest chunk
+    uint32_t max_chunk_bricks;
+} LevelHeader;
+
+/**
+ * Where a chunk is in a level file. A chunk is GAME_CHUNK_CELL_COUNT + 1 cell starts followed by its bricks.
+ */
+typedef struct ChunkEntry
+{
+    uint64_t offset;
+    uint32_t brick_count;
+    uint32_t unused;
+} ChunkEntry;
+
+/**
+ * A brick as stored in a level file, in whole pixels so the same file works with float and fixed point builds.
+ */
+typedef struct StoredBrick
+{
+    int32_t x;
+    int32_t y;
+    uint16_t width;
+    uint16_t height;
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t unused;
+} StoredBrick;
+
+/**
+ * Memory for one chunk. The reader thread owns a slot while it is free or being read, the game thread from when it is
+ * handed over until it gives it back.
+ */
+typedef struct Slot
+{
+    BrickChunk bricks;
+    uint32_t chunk;
+    bool failed;
+} Slot;
+
+/**
+ * Where each chunk is, as far as the game thread knows.
+ */
+typedef enum ChunkState
+{
+    CHUNK_ABSENT,
+    CHUNK_LOADING,
+    CHUNK_RESIDENT
+} ChunkState;
+
+typedef struct LevelStream
+{
+    int fd;
+    LevelHeader header;
+    ChunkEntry *entries;
+    uint32_t *firsts;
+    size_t chunk_count;
+
+    // every slot's indices and bricks are cut from the same two arrays
+    Slot *slots;
+    size_t slot_count;
+    uint32_t *indices;
+    Entity *bricks;
+
+    // the game thread asks for chunks and gives slots back, the reader thread hands over slots it has read
+    Queue requests;
+    Queue released;
+    Queue loaded;
+
+    // the reader sleeps until the game thread queues a request
+    pthread_t thread;
+    bool started;
+    sem_t wake;
+    bool wake_created;
+    atomic_bool quit;
+
+    // only touched by the reader thread
+    uint32_t *free_slots;
+    size_t free_count;
+    uint8_t *buffer;
+
+    // only touched by the game thread. wanted[c] is the last update chunk c was wanted in, slot_chunks[s] the chunk
+    // in slot s while the game has it
+    uint8_t *states;
+    uint32_t *wanted;
+    uint32_t *slot_chunks;
+    uint32_t update;
+    size_t resident;
+    size_t loading;
+    uint64_t loads;
+    uint64_t evictions;
+} LevelStream;
+
+/**
+ * Helper function to write one chunk of a generated level.
+ *
+ * @param file
+ *   File to write to, positioned where the chunk goes.
+ *
+ * @param size
+ *   Width and height of the world.
+ *
+ * @param column
+ *   Chunk column.
+ *
+ * @param row
+ *   Chunk row.
+ *
+ * @param bricks
+ *   Scratch buffer for the chunk's bricks, grown as needed.
+ *
+ * @param stored
+ *   Scratch buffer for the bricks as written, grown with bricks.
+ *
+ * @param capacity
+ *   Size of both scratch buffers.
+ *
+ * @param entry
+ *   Out parameter for the chunk's size, its offset must already be set.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result write_chunk(
+    FILE *file,
+    Scalar size,
+    int32_t column,
+    int32_t row,
+    Entity **bricks,
+    StoredBrick **stored,
+    size_t *capacity,
+    ChunkEntry *entry)
+{
+    const Block area = create_block_xy(
+        scalar_mul(scalar_from_int(column), CHUNK_SIZE), scalar_mul(scalar_from_int(row), CHUNK_SIZE), CHUNK_SIZE, CHUNK_SIZE);
+
+    size_t count = get_field_bricks(size, &area, *bricks, *capacity);
+    if (count > *capacity)
+    {
+        Entity *n_bricks = (Entity *)TRACKED_REALLOC(*bricks, count * sizeof(Entity));
+        if (n_bricks != NULL)
+        {
+            *bricks = n_bricks;
+        }
+
+        StoredBrick *n_stored = (StoredBrick *)TRACKED_REALLOC(*stored, count * sizeof(StoredBrick));
+        if (n_stored != NULL)
+        {
+            *stored = n_stored;
+        }
+
+        if ((n_bricks == NULL) || (n_stored == NULL))
+        {
+            return FAILED;
+        }
+
+        *capacity = count;
+        count = get_field_bricks(size, &area, *bricks, *capacity);
+    }
+
+    // counting sort by cell, which keeps bricks in level order within a cell like the brick grid
+    uint32_t cell_start[GAME_CHUNK_CELL_COUNT + 1] = {0};
+    uint32_t cursor[GAME_CHUNK_CELL_COUNT];
+    uint16_t *homes = (uint16_t *)TRACKED_CALLOC((count == 0u) ? 1u : count, sizeof(uint16_t));
+    if (homes == NULL)
+    {
+        return FAILED;
+    }
+
+    for (size_t i = 0u; i < count; ++i)
+    {
+        const Block *block = &(*bricks)[i].block;
+        const int32_t cell_column = (int32_t)(block->position.x / GAME_CELL_SIZE) - (column * GAME_CHUNK_CELLS);
+        const int32_t cell_row = (int32_t)(block->position.y / GAME_CELL_SIZE) - (row * GAME_CHUNK_CELLS);
+        assert((cell_column >= 0) && (cell_column < GAME_CHUNK_CELLS));
+        assert((cell_row >= 0) && (cell_row < GAME_CHUNK_CELLS));
+
+        homes[i] = (uint16_t)((cell_row * GAME_CHUNK_CELLS) + cell_column);
+        ++cell_start[homes[i] + 1u];
+    }
+
+    for (size_t i = 0u; i < GAME_CHUNK_CELL_COUNT; ++i)
+    {
+        cell_start[i + 1u] += cell_start[i];
+        cursor[i] = cell_start[i];
+    }
+
+    for (size_t i = 0u; i < count; ++i)
+    {
+        const Entity *brick = &(*bricks)[i];
+        (*stored)[cursor[homes[i]]++] = (StoredBrick){
+            .x = scalar_to_int(brick->block.position.x),
+            .y = scalar_to_int(brick->block.position.y),
+            .width = (uint16_t)scalar_to_int(brick->block.width),
+            .height = (uint16_t)scalar_to_int(brick->block.height),
+            .r = brick->r,
+            .g = brick->g,
+            .b = brick->b};
+    }
+
+    free_tracked(homes);
+
+    entry->brick_count = (uint32_t)count;
+    if ((fwrite(cell_start, sizeof(cell_start), 1u, file) != 1u) ||
+        ((count > 0u) && (fwrite(*stored, sizeof(StoredBrick), count, file) != count)))
+    {
+        return FAILED;
+    }
+
+    return SUCCESS;
+}
+
+Result write_streamed_level(const char *path, Scalar size)
+{
+    assert(path != NULL);
+    assert(size >= SCALAR(800.0f));
+
+    Result res = SUCCESS;
+
+    LevelHeader header = {.magic = LEVEL_MAGIC, .version = LEVEL_VERSION, .size = scalar_to_int(size)};
+    get_chunk_layout(size, &header.chunk_columns, &header.chunk_rows);
+    const size_t chunk_count = (size_t)header.chunk_columns * (size_t)header.chunk_rows;
+
+    FILE *file = fopen(path, "wb");
+    ChunkEntry *entries = (ChunkEntry *)TRACKED_CALLOC(chunk_count, sizeof(ChunkEntry));
+    if ((file == NULL) || (entries == NULL))
+    {
+        res = FAILED;
+    }
+
+    // chunks go after the table, which is filled in last
+    uint64_t offset = sizeof(LevelHeader) + (chunk_count * sizeof(ChunkEntry));
+    if ((res == SUCCESS) && (fseek(file, (long)offset, SEEK_SET) != 0))
+    {
+        res = FAILED;
+    }
+
+    Entity *bricks = NULL;
+    StoredBrick *stored = NULL;
+    size_t capacity = 0u;
+
+    for (size_t i = 0u; (res == SUCCESS) && (i < chunk_count); ++i)
+    {
+        ChunkEntry *entry = &entries[i];
+        entry->offset = offset;
+
+        res = write_chunk(
+            file,
+            size,
+            (int32_t)(i % (size_t)header.chunk_columns),
+            (int32_t)(i / (size_t)header.chunk_columns),
+            &bricks,
+            &stored,
+            &capacity,
+            entry);
+
+        offset += ((GAME_CHUNK_CELL_COUNT + 1u) * sizeof(uint32_t)) + (entry->brick_count * sizeof(StoredBrick));
+        header.max_chunk_bricks =
+            (entry->brick_count > header.max_chunk_bricks) ? entry->brick_count : header.max_chunk_bricks;
+    }
+
+    if ((res == SUCCESS) &&
+        ((fseek(file, 0, SEEK_SET) != 0) || (fwrite(&header, sizeof(header), 1u, file) != 1u) ||
+         (fwrite(entries, sizeof(ChunkEntry), chunk_count, file) != chunk_count)))
+    {
+        res = FAILED;
+    }
+
+    if ((file != NULL) && (fclose(file) != 0))
+    {
+        res = FAILED;
+    }
+
+    free_tracked(bricks);
+    free_tracked(stored);
+    free_tracked(entries);
+
+    return res;
+}
+
+/**
+ * Helper function to read a chunk into a slot, called on the reader thread.
+ *
+ * @param stream
+ *   Stream to read from.
+ *
+ * @param slot
+ *   Slot to read into, marked as failed if the chunk could not be read.
+ *
+ * @param chunk
+ *   Chunk to read.
+ */
+static void read_chunk(LevelStream *stream, Slot *slot, uint32_t chunk)
+{
+    TRACE_ZONE("read_chunk");
+
+    const ChunkEntry *entry = &stream->entries[chunk];
+    const size_t starts_size = (GAME_CHUNK_CELL_COUNT + 1u) * sizeof(uint32_t);
+    const size_t size = starts_size + (entry->brick_count * sizeof(StoredBrick));
+
+    slot->chunk = chunk;
+    slot->bricks.first_brick = stream->firsts[chunk];
+    slot->bricks.brick_count = entry->brick_count;
+    slot->failed = pread(stream->fd, stream->buffer, size, (off_t)entry->offset) != (ssize_t)size;
+    if (slot->failed)
+    {
+        return;
+    }
+
+    // cells must cover the chunk's bricks in order, a bad file is caught here rather than read out of bounds later
+    memcpy(slot->bricks.cell_start, stream->buffer, starts_size);
+    for (size_t i = 0u; i < GAME_CHUNK_CELL_COUNT; ++i)
+    {
+        slot->failed |= slot->bricks.cell_start[i] > slot->bricks.cell_start[i + 1u];
+    }
+    slot->failed |= (slot->bricks.cell_start[0] != 0u) ||
+                    (slot->bricks.cell_start[GAME_CHUNK_CELL_COUNT] != entry->brick_count);
+    if (slot->failed)
+    {
+        return;
+    }
+
+    const StoredBrick *stored = (const StoredBrick *)&stream->buffer[starts_size];
+    for (uint32_t i = 0u; i < entry->brick_count; ++i)
+    {
+        slot->bricks.indices[i] = slot->bricks.first_brick + i;
+        slot->bricks.bricks[i] = (Entity){
+            .block = create_block_xy(
+                scalar_from_int(stored[i].x),
+                scalar_from_int(stored[i].y),
+                scalar_from_int(stored[i].width),
+                scalar_from_int(stored[i].height)),
+            .r = stored[i].r,
+            .g = stored[i].g,
+            .b = stored[i].b};
+    }
+}
+
+/**
+ * Reader thread entry point, reads the chunks the game thread asks for until the stream is destroyed.
+ *
+ * @param arg
+ *   Stream to read for.
+ *
+ * @returns
+ *   NULL.
+ */
+static void *run_reader(void *arg)
+{
+    LevelStream *stream = (LevelStream *)arg;
+
+    TRACE_THREAD("level reader");
+
+    for (;;)
+    {
+        while ((sem_wait(&stream->wake) != 0) && (errno == EINTR))
+        {
+        }
+
+        if (atomic_load_explicit(&stream->quit, memory_order_acquire))
+        {
+            break;
+        }
+
+        uint32_t chunk = 0u;
+        while (pop_queue(&stream->requests, &chunk))
+        {
+            // the game thread only asks for a chunk when it has given back enough slots, and gives them back first
+            uint32_t slot = 0u;
+            while (pop_queue(&stream->released, &slot))
+            {
+                stream->free_slots[stream->free_count++] = slot;
+            }
+            assert(stream->free_count > 0u);
+
+            slot = stream->free_slots[--stream->free_count];
+            read_chunk(stream, &stream->slots[slot], chunk);
+
+            // one entry per slot, so this can't be full
+            push_queue(&stream->loaded, slot);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Helper function to read and check the header and chunk table of a level file.
+ *
+ * @param stream
+ *   Stream with the file open.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the file could not be read or is not a level file
+ */
+static Result read_level_index(LevelStream *stream)
+{
+    LevelHeader *header = &stream->header;
+    if ((pread(stream->fd, header, sizeof(LevelHeader), 0) != (ssize_t)sizeof(LevelHeader)) ||
+        (header->magic != LEVEL_MAGIC) || (header->version != LEVEL_VERSION) || (header->size < 800))
+    {
+        return FAILED;
+    }
+
+    int32_t columns = 0;
+    int32_t rows = 0;
+    get_chunk_layout(scalar_from_int(header->size), &columns, &rows);
+    if ((columns != header->chunk_columns) || (rows != header->chunk_rows))
+    {
+        return FAILED;
+    }
+
+    stream->chunk_count = (size_t)columns * (size_t)rows;
+    stream->entries = (ChunkEntry *)TRACKED_CALLOC(stream->chunk_count, sizeof(ChunkEntry));
+    stream->firsts = (uint32_t *)TRACKED_CALLOC(stream->chunk_count, sizeof(uint32_t));
+    const size_t table_size = stream->chunk_count * sizeof(ChunkEntry);
+    if ((stream->entries == NULL) || (stream->firsts == NULL) ||
+        (pread(stream->fd, stream->entries, table_size, sizeof(LevelHeader)) != (ssize_t)table_size))
+    {
+        return FAILED;
+    }
+
+    uint64_t count = 0u;
+    for (size_t i = 0u; i < stream->chunk_count; ++i)
+    {
+        if (stream->entries[i].brick_count > header->max_chunk_bricks)
+        {
+            return FAILED;
+        }
+
+        stream->firsts[i] = (uint32_t)count;
+        count += stream->entries[i].brick_count;
+    }
+
+    return (count <= UINT32_MAX) ? SUCCESS : FAILED;
+}
+
+/**
+ * Helper function to allocate the slots and the bookkeeping for them.
+ *
+ * @param stream
+ *   Stream with its index read.
+ *
+ * @param budget
+ *   Bytes to allocate for chunks.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure, or if the budget is too small
+ */
+static Result create_slots(LevelStream *stream, size_t budget)
+{
+    const size_t max_bricks = stream->header.max_chunk_bricks;
+    const size_t slot_size = sizeof(Slot) + (max_bricks * (sizeof(uint32_t) + sizeof(Entity))) + (3u * sizeof(uint32_t));
+
+    // no point in more slots than chunks, or in failing a small level whose every chunk fits
+    size_t count = budget / slot_size;
+    count = (count > stream->chunk_count) ? stream->chunk_count : count;
+    if (count < ((stream->chunk_count < MIN_SLOTS) ? stream->chunk_count : MIN_SLOTS))
+    {
+        return FAILED;
+    }
+
+    stream->slot_count = count;
+    stream->slots = (Slot *)TRACKED_CALLOC(count, sizeof(Slot));
+    stream->indices = (uint32_t *)TRACKED_CALLOC((count * max_bricks) + 1u, sizeof(uint32_t));
+    stream->bricks = (Entity *)TRACKED_CALLOC((count * max_bricks) + 1u, sizeof(Entity));
+    stream->free_slots = (uint32_t *)TRACKED_CALLOC(count, sizeof(uint32_t));
+    stream->slot_chunks = (uint32_t *)TRACKED_CALLOC(count, sizeof(uint32_t));
+    stream->buffer = (uint8_t *)TRACKED_CALLOC(
+        ((GAME_CHUNK_CELL_COUNT + 1u) * sizeof(uint32_t)) + (max_bricks * sizeof(StoredBrick)), sizeof(uint8_t));
+    stream->states = (uint8_t *)TRACKED_CALLOC(stream->chunk_count, sizeof(uint8_t));
+    stream->wanted = (uint32_t *)TRACKED_CALLOC(stream->chunk_count, sizeof(uint32_t));
+    if ((stream->slots == NULL) || (stream->indices == NULL) || (stream->bricks == NULL) ||
+        (stream->free_slots == NULL) || (stream->slot_chunks == NULL) || (stream->buffer == NULL) ||
+        (stream->states == NULL) || (stream->wanted == NULL) || (create_queue(&stream->requests, count) != SUCCESS) ||
+        (create_queue(&stream->released, count) != SUCCESS) || (create_queue(&stream->loaded, count) != SUCCESS))
+    {
+        return FAILED;
+    }
+
+    for (size_t i = 0u; i < count; ++i)
+    {
+        stream->slots[i].bricks.indices = &stream->indices[i * max_bricks];
+        stream->slots[i].bricks.bricks = &stream->bricks[i * max_bricks];
+        stream->slots[i].chunk = NO_CHUNK;
+        stream->free_slots[i] = (uint32_t)(count - 1u - i);
+        stream->slot_chunks[i] = NO_CHUNK;
+    }
+    stream->free_count = count;
+
+    return SUCCESS;
+}
+
+Result create_level_stream(LevelStream **stream, Game **game, const char *path, size_t budget)
+{
+    assert(stream != NULL);
+    assert(game != NULL);
+    assert(path != NULL);
+
+    Result res = SUCCESS;
+
+    LevelStream *n_stream = (LevelStream *)TRACKED_ALIGNED_CALLOC(CACHE_LINE, sizeof(LevelStream));
+    if (n_stream == NULL)
+    {
+        res = FAILED;
+        return res;
+    }
+
+    *n_stream = (LevelStream){.fd = open(path, O_RDONLY)};
+    atomic_init(&n_stream->quit, false);
+    if ((n_stream->fd < 0) || (read_level_index(n_stream) != SUCCESS) || (create_slots(n_stream, budget) != SUCCESS))
+    {
+        res = FAILED;
+        destroy_level_stream(n_stream);
+        return res;
+    }
+
+    uint32_t *chunk_bricks = (uint32_t *)TRACKED_CALLOC(n_stream->chunk_count, sizeof(uint32_t));
+    if (chunk_bricks == NULL)
+    {
+        res = FAILED;
+        destroy_level_stream(n_stream);
+        return res;
+    }
+
+    for (size_t i = 0u; i < n_stream->chunk_count; ++i)
+    {
+        chunk_bricks[i] = n_stream->entries[i].brick_count;
+    }
+
+    Game *n_game = NULL;
+    res = create_streamed_game(&n_game, scalar_from_int(n_stream->header.size), chunk_bricks);
+    free_tracked(chunk_bricks);
+    if (res != SUCCESS)
+    {
+        destroy_level_stream(n_stream);
+        return res;
+    }
+
+    n_stream->wake_created = sem_init(&n_stream->wake, 0, 0u) == 0;
+    n_stream->started =
+        n_stream->wake_created && (pthread_create(&n_stream->thread, NULL, run_reader, n_stream) == 0);
+    if (!n_stream->started)
+    {
+        res = FAILED;
+        destroy_game(n_game);
+        destroy_level_stream(n_stream);
+        return res;
+    }
+
+    // assign the stream and game to the user supplied pointers
+    *stream = n_stream;
+    *game = n_game;
+    return res;
+}
+
+void destroy_level_stream(LevelStream *stream)
+{
+    if (stream == NULL)
+    {
+        return;
+    }
+
+    if (stream->started)
+    {
+        atomic_store_explicit(&stream->quit, true, memory_order_release);
+        sem_post(&stream->wake);
+        pthread_join(stream->thread, NULL);
+    }
+
+    if (stream->wake_created)
+    {
+        sem_destroy(&stream->wake);
+    }
+
+    if (stream->fd >= 0)
+    {
+        close(stream->fd);
+    }
+
+    free_tracked(stream->entries);
+    free_tracked(stream->firsts);
+    free_tracked(stream->slots);
+    free_tracked(stream->indices);
+    free_tracked(stream->bricks);
+    free_tracked(stream->free_slots);
+    free_tracked(stream->slot_chunks);
+    free_tracked(stream->buffer);
+    free_tracked(stream->states);
+    free_tracked(stream->wanted);
+    destroy_queue(&stream->requests);
+    destroy_queue(&stream->released);
+    destroy_queue(&stream->loaded);
+    free_tracked(stream);
+}
+
+/**
+ * Helper function to get the range of chunks an area touches.
+ *
+ * @param game
+ *   Streamed game.
+ *
+ * @param area
+ *   Area to cover.
+ *
+ * @param range
+ *   Out parameter for the range, in chunks rather than cells.
+ */
+static void get_area_chunks(const Game *game, const Block *area, GridRange *range)
+{
+    get_brick_range(game, area, range);
+    range->first_column /= GAME_CHUNK_CELLS;
+    range->first_row /= GAME_CHUNK_CELLS;
+    range->last_column /= GAME_CHUNK_CELLS;
+    range->last_row /= GAME_CHUNK_CELLS;
+}
+
+/**
+ * Helper function to give back the slot of the chunk furthest from the ball that is not wanted.
+ *
+ * @param stream
+ *   Stream to make room in.
+ *
+ * @param game
+ *   Game to take the chunk out of.
+ *
+ * @returns
+ *   True if a slot was given back, false if every chunk in memory is wanted.
+ */
+static bool evict_chunk(LevelStream *stream, Game *game)
+{
+    GridRange ball;
+    get_area_chunks(game, &game->state.ball.block, &ball);
+
+    size_t best = SIZE_MAX;
+    int32_t best_distance = -1;
+    for (size_t i = 0u; i < stream->slot_count; ++i)
+    {
+        const uint32_t chunk = stream->slot_chunks[i];
+        if ((chunk == NO_CHUNK) || (stream->wanted[chunk] == stream->update))
+        {
+            continue;
+        }
+
+        const int32_t dx = abs((int32_t)(chunk % (uint32_t)game->chunk_columns) - ball.last_column);
+        const int32_t dy = abs((int32_t)(chunk / (uint32_t)game->chunk_columns) - ball.last_row);
+        const int32_t distance = (dx > dy) ? dx : dy;
+        if (distance > best_distance)
+        {
+            best = i;
+            best_distance = distance;
+        }
+    }
+
+    if (best == SIZE_MAX)
+    {
+        return false;
+    }
+
+    const uint32_t chunk = stream->slot_chunks[best];
+    set_brick_chunk(game, chunk, NULL);
+    stream->states[chunk] = CHUNK_ABSENT;
+    stream->slot_chunks[best] = NO_CHUNK;
+    --stream->resident;
+    ++stream->evictions;
+
+    // holds every slot, so this can't be full
+    push_queue(&stream->released, (uint32_t)best);
+    return true;
+}
+
+Result update_level_stream(LevelStream *stream, Game *game, const Block *view)
+{
+    assert(stream != NULL);
+    assert(game != NULL);
+
+    uint32_t slot_index = 0u;
+    while (pop_queue(&stream->loaded, &slot_index))
+    {
+        const Slot *slot = &stream->slots[slot_index];
+        --stream->loading;
+        if (slot->failed)
+        {
+            return FAILED;
+        }
+
+        stream->states[slot->chunk] = CHUNK_RESIDENT;
+        stream->slot_chunks[slot_index] = slot->chunk;
+        ++stream->resident;
+        ++stream->loads;
+        set_brick_chunk(game, slot->chunk, &slot->bricks);
+    }
+
+    // around the main ball first so it is read first, then the view and the other balls
+    const PowerupState *powerups = &game->state.powerups;
+    const Block *balls[GAME_MAX_BALLS] = {&game->state.ball.block};
+    size_t ball_count = 1u;
+    for (uint32_t i = 0u; i < (GAME_MAX_BALLS - 1u); ++i)
+    {
+        if (((powerups->extras_used >> i) & 1u) != 0u)
+        {
+            balls[ball_count++] = &powerups->extra_balls[i].block;
+        }
+    }
+
+    Block areas[GAME_MAX_BALLS + 1u];
+    size_t area_count = 0u;
+    for (size_t i = 0u; i < ball_count; ++i)
+    {
+        areas[area_count++] = create_block_xy(
+            balls[i]->position.x - PREFETCH_DISTANCE,
+            balls[i]->position.y - PREFETCH_DISTANCE,
+            balls[i]->width + (2 * PREFETCH_DISTANCE),
+            balls[i]->height + (2 * PREFETCH_DISTANCE));
+        if ((i == 0u) && (view != NULL))
+        {
+            areas[area_count++] = *view;
+        }
+    }
+
+    // mark everything wanted before asking for anything, so nothing wanted is dropped to make room
+    ++stream->update;
+    GridRange ranges[GAME_MAX_BALLS + 1u];
+    for (size_t i = 0u; i < area_count; ++i)
+    {
+        get_area_chunks(game, &areas[i], &ranges[i]);
+        for (int32_t row = ranges[i].first_row; row <= ranges[i].last_row; ++row)
+        {
+            for (int32_t column = ranges[i].first_column; column <= ranges[i].last_column; ++column)
+            {
+                stream->wanted[((size_t)row * (size_t)game->chunk_columns) + (size_t)column] = stream->update;
+            }
+        }
+    }
+
+    bool queued = false;
+    bool room = true;
+    for (size_t i = 0u; room && (i < area_count); ++i)
+    {
+        for (int32_t row = ranges[i].first_row; room && (row <= ranges[i].last_row); ++row)
+        {
+            for (int32_t column = ranges[i].first_column; room && (column <= ranges[i].last_column); ++column)
+            {
+                const size_t chunk = ((size_t)row * (size_t)game->chunk_columns) + (size_t)column;
+                if (stream->states[chunk] != CHUNK_ABSENT)
+                {
+                    continue;
+                }
+
+                // anything left over is asked for again next update
+                room = ((stream->resident + stream->loading) < stream->slot_count) || evict_chunk(stream, game);
+                room = room && push_queue(&stream->requests, (uint32_t)chunk);
+                if (room)
+                {
+                    stream->states[chunk] = CHUNK_LOADING;
+                    ++stream->loading;
+                    queued = true;
+                }
+            }
+        }
+    }
+
+    if (queued)
+    {
+        sem_post(&stream->wake);
+    }
+
+    return SUCCESS;
+}
+
+size_t get_stream_brick_capacity(const LevelStream *stream)
+{
+    assert(stream != NULL);
+
+    return stream->slot_count * stream->header.max_chunk_bricks;
+}
+
+void get_level_stream_stats(const LevelStream *stream, LevelStreamStats *stats)
+{
+    assert(stream != NULL);
+    assert(stats != NULL);
+
+    const size_t max_bricks = stream->header.max_chunk_bricks;
+    *stats = (LevelStreamStats){
+        .loads = stream->loads,
+        .evictions = stream->evictions,
+        .resident = stream->resident,
+        .slots = stream->slot_count,
+        .bytes = stream->slot_count * (sizeof(Slot) + (max_bricks * (sizeof(uint32_t) + sizeof(Entity))))};
+}
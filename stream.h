@@ -0,0 +1,138 @@
+#ifndef _STREAM_H_
+#define _STREAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "block.h"
+#include "game.h"
+#include "result.h"
+
+/**
+ * Stream plays levels too large to keep in memory from a file split into chunks of GAME_CHUNK_CELLS by
+ * GAME_CHUNK_CELLS grid cells.
+ *
+ * A background thread reads the chunks near the balls and the view ahead of time and hands them to the game thread,
+ * which puts them into the game. Chunks go back and forth between the threads through lock-free queues, so the game
+ * thread never waits on the disk or a lock. A chunk that is needed but not read yet holds up the simulation (see
+ * can_step_game) rather than the frame.
+ *
+ * Chunks are read into a fixed number of slots sized from a memory budget, allocated up front. When every slot is in
+ * use the chunk furthest from the ball that is not needed is dropped to make room, so memory stays within the budget
+ * however large the level is. Only the alive bit of each brick is kept for the whole level.
+ */
+
+/**
+ * Memory for chunks when no budget is given, in bytes.
+ */
+#define STREAM_DEFAULT_BUDGET (16u * 1024u * 1024u)
+
+/**
+ * Level stream internal data.
+ */
+typedef struct LevelStream LevelStream;
+
+/**
+ * Counters for how a stream is doing.
+ */
+typedef struct LevelStreamStats
+{
+    // chunks read and dropped since the stream was created
+    uint64_t loads;
+    uint64_t evictions;
+
+    // chunks in memory now, and the most there is room for
+    size_t resident;
+    size_t slots;
+
+    // bytes allocated for chunks
+    size_t bytes;
+} LevelStreamStats;
+
+/**
+ * Write a level file holding the same bricks as create_large_game, a chunk at a time so the level never has to fit in
+ * memory.
+ *
+ * @param path
+ *   File to write.
+ *
+ * @param size
+ *   Width and height of the world, at least 800.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result write_streamed_level(const char *path, Scalar size);
+
+/**
+ * Open a level file and start streaming it into a new game.
+ *
+ * @param stream
+ *   Created stream.
+ *
+ * @param game
+ *   Created game, with no chunks in memory yet. Must be destroyed before the stream.
+ *
+ * @param path
+ *   Level file written by write_streamed_level.
+ *
+ * @param budget
+ *   Bytes to allocate for chunks, enough for at least the chunks around every ball.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure, including a budget too small for the level
+ */
+Result create_level_stream(LevelStream **stream, Game **game, const char *path, size_t budget);
+
+/**
+ * Stop the background thread and destroy a level stream.
+ *
+ * @param stream
+ *   Stream to destroy.
+ */
+void destroy_level_stream(LevelStream *stream);
+
+/**
+ * Put the chunks read since the last update into the game, and ask for the chunks around the balls and the view.
+ * Never waits, call once a frame before stepping.
+ *
+ * @param stream
+ *   Stream to update.
+ *
+ * @param game
+ *   Game created with the stream.
+ *
+ * @param view
+ *   Area being drawn, may be NULL.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if a chunk could not be read
+ */
+Result update_level_stream(LevelStream *stream, Game *game, const Block *view);
+
+/**
+ * Get the most bricks that can be in memory at once, for sizing anything that holds the bricks in view.
+ *
+ * @param stream
+ *   Stream to query.
+ *
+ * @returns
+ *   Number of bricks.
+ */
+size_t get_stream_brick_capacity(const LevelStream *stream);
+
+/**
+ * Get counters for a stream.
+ *
+ * @param stream
+ *   Stream to query.
+ *
+ * @param stats
+ *   Out parameter for the counters.
+ */
+void get_level_stream_stats(const LevelStream *stream, LevelStreamStats *stats);
+
+#endif
@@ -0,0 +1,213 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "telemetry.h"
+
+/**
+ * Magic number at the start of the page ("BRKT").
+ */
+#define TELEMETRY_MAGIC 0x42524b54u
+
+/**
+ * Layout of the shared memory page.
+ */
+typedef struct TelemetryPage
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+
+    // odd while the writer is updating stats
+    _Atomic uint32_t sequence;
+
+    TelemetryStats stats;
+} TelemetryPage;
+
+typedef struct Telemetry
+{
+    TelemetryPage *page;
+    char *name;
+    bool writer;
+} Telemetry;
+
+/**
+ * Helper function to map a telemetry page.
+ *
+ * @param telemetry
+ *   Created telemetry object.
+ *
+ * @param name
+ *   Shared memory object name.
+ *
+ * @param writer
+ *   True to create the object read/write, false to open an existing one read only.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result map_telemetry(Telemetry **telemetry, const char *name, bool writer)
+{
+    assert(telemetry != NULL);
+    assert(name != NULL);
+
+    Result res = SUCCESS;
+
+    Telemetry *n_telemetry = (Telemetry *)calloc(1u, sizeof(Telemetry));
+    if (n_telemetry == NULL)
+    {
+        res = FAILED;
+        return res;
+    }
+
+    n_telemetry->writer = writer;
+    n_telemetry->name = strdup(name);
+    if (n_telemetry->name == NULL)
+    {
+        res = FAILED;
+        destroy_telemetry(n_telemetry);
+        return res;
+    }
+
+    // two writers on one page would corrupt each other's sequence, so a writer never takes over an existing page
+    const int fd = writer ? shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644) : shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        res = FAILED;
+        n_telemetry->writer = false;
+        destroy_telemetry(n_telemetry);
+        return res;
+    }
+
+    if (writer && (ftruncate(fd, sizeof(TelemetryPage)) != 0))
+    {
+        res = FAILED;
+        close(fd);
+        destroy_telemetry(n_telemetry);
+        return res;
+    }
+
+    void *address =
+        mmap(NULL, sizeof(TelemetryPage), writer ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+
+    // the mapping keeps the object alive
+    close(fd);
+
+    if (address == MAP_FAILED)
+    {
+        res = FAILED;
+        destroy_telemetry(n_telemetry);
+        return res;
+    }
+    n_telemetry->page = (TelemetryPage *)address;
+
+    if (writer)
+    {
+        memset(n_telemetry->page, 0, sizeof(TelemetryPage));
+        n_telemetry->page->version = TELEMETRY_VERSION;
+        n_telemetry->page->size = sizeof(TelemetryStats);
+        atomic_thread_fence(memory_order_release);
+        n_telemetry->page->magic = TELEMETRY_MAGIC;
+    }
+    else if (
+        (n_telemetry->page->magic != TELEMETRY_MAGIC) || (n_telemetry->page->version != TELEMETRY_VERSION) ||
+        (n_telemetry->page->size != sizeof(TelemetryStats)))
+    {
+        res = FAILED;
+        destroy_telemetry(n_telemetry);
+        return res;
+    }
+
+    // assign the telemetry to the user supplied pointer
+    *telemetry = n_telemetry;
+    return res;
+}
+
+Result create_telemetry(Telemetry **telemetry, const char *name)
+{
+    return map_telemetry(telemetry, name, true);
+}
+
+Result open_telemetry(Telemetry **telemetry, const char *name)
+{
+    return map_telemetry(telemetry, name, false);
+}
+
+void destroy_telemetry(Telemetry *telemetry)
+{
+    if (telemetry == NULL)
+    {
+        return;
+    }
+
+    if (telemetry->page != NULL)
+    {
+        munmap(telemetry->page, sizeof(TelemetryPage));
+    }
+
+    if (telemetry->writer && (telemetry->name != NULL))
+    {
+        shm_unlink(telemetry->name);
+    }
+
+    free(telemetry->name);
+    free(telemetry);
+}
+
+void publish_telemetry(Telemetry *telemetry, const TelemetryStats *stats)
+{
+    assert(telemetry != NULL);
+    assert(telemetry->writer);
+    assert(stats != NULL);
+
+    TelemetryPage *page = telemetry->page;
+    const uint32_t sequence = atomic_load_explicit(&page->sequence, memory_order_relaxed);
+
+    // odd sequence tells readers an update is in progress
+    atomic_store_explicit(&page->sequence, sequence + 1u, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    memcpy(&page->stats, stats, sizeof(TelemetryStats));
+
+    atomic_store_explicit(&page->sequence, sequence + 2u, memory_order_release);
+}
+
+Result read_telemetry(const Telemetry *telemetry, TelemetryStats *stats)
+{
+    assert(telemetry != NULL);
+    assert(stats != NULL);
+
+    TelemetryPage *page = telemetry->page;
+
+    for (uint32_t i = 0u; i < TELEMETRY_READ_RETRIES; ++i)
+    {
+        const uint32_t before = atomic_load_explicit(&page->sequence, memory_order_acquire);
+        if (before == 0u)
+        {
+            return NO_EVENT;
+        }
+
+        if ((before & 1u) != 0u)
+        {
+            continue;
+        }
+
+        memcpy(stats, &page->stats, sizeof(TelemetryStats));
+        atomic_thread_fence(memory_order_acquire);
+
+        const uint32_t after = atomic_load_explicit(&page->sequence, memory_order_relaxed);
+        if (before == after)
+        {
+            return SUCCESS;
+        }
+    }
+
+    return FAILED;
+}
@@ -0,0 +1,118 @@
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+#include <stdint.h>
+
+#include "result.h"
+
+/**
+ * Telemetry publishes live game statistics into a shared memory page so external processes can monitor the game.
+ *
+ * The page is protected by a seqlock: the game (the only writer) never waits, readers retry until they get a
+ * consistent copy. A page is only ever created by one game, so every run publishing at once needs its own name.
+ */
+
+/**
+ * Times a reader retries a page that is being updated before giving up on it, a writer that died mid update leaves
+ * the page that way for good.
+ */
+#define TELEMETRY_READ_RETRIES 100000u
+
+/**
+ * Version of TelemetryStats, bumped whenever the layout changes.
+ */
+#define TELEMETRY_VERSION 2u
+
+/**
+ * Statistics published every frame.
+ */
+typedef struct TelemetryStats
+{
+    uint64_t frame;
+    uint64_t step;
+    float frame_ms;
+    float physics_ms;
+    float steps_per_second;
+    float collisions_per_second;
+    uint32_t entity_count;
+    uint32_t particle_count;
+    uint32_t score;
+    uint32_t lives;
+
+    // tracked heap allocations made during the frame, and heap use now and at its peak
+    uint32_t frame_allocations;
+    uint64_t heap_bytes;
+    uint64_t peak_heap_bytes;
+} TelemetryStats;
+
+/**
+ * Telemetry internal data.
+ */
+typedef struct Telemetry Telemetry;
+
+/**
+ * Create the shared memory page and become its writer.
+ *
+ * @param telemetry
+ *   Created telemetry object.
+ *
+ * @param name
+ *   Shared memory object name, must start with '/' and must not exist yet.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure (including a name another game, or one that crashed, already has)
+ */
+Result create_telemetry(Telemetry **telemetry, const char *name);
+
+/**
+ * Open an existing shared memory page read only.
+ *
+ * @param telemetry
+ *   Opened telemetry object.
+ *
+ * @param name
+ *   Shared memory object name, must start with '/'.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure (including a page with a different version)
+ */
+Result open_telemetry(Telemetry **telemetry, const char *name);
+
+/**
+ * Destroy a telemetry object, the writer also removes the shared memory object.
+ *
+ * @param telemetry
+ *   Telemetry to destroy.
+ */
+void destroy_telemetry(Telemetry *telemetry);
+
+/**
+ * Publish new statistics, never blocks.
+ *
+ * @param telemetry
+ *   Telemetry created with create_telemetry.
+ *
+ * @param stats
+ *   Statistics to publish.
+ */
+void publish_telemetry(Telemetry *telemetry, const TelemetryStats *stats);
+
+/**
+ * Read a consistent copy of the latest statistics.
+ *
+ * @param telemetry
+ *   Telemetry opened with open_telemetry.
+ *
+ * @param stats
+ *   Out parameter for statistics.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   NO_EVENT if nothing has been published yet
+ *   FAILED if the page stayed mid update for TELEMETRY_READ_RETRIES tries
+ */
+Result read_telemetry(const Telemetry *telemetry, TelemetryStats *stats);
+
+#endif
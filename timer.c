@@ -0,0 +1,12 @@
+#include <stdint.h>
+#include <time.h>
+
+#include "timer.h"
+
+uint64_t get_time_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t)now.tv_sec * 1000000000u) + (uint64_t)now.tv_nsec;
+}
@@ -0,0 +1,14 @@
+#ifndef _TIMER_H_
+#define _TIMER_H_
+
+#include <stdint.h>
+
+/**
+ * Get the current time from a monotonic clock.
+ *
+ * @returns
+ *   Nanoseconds since an arbitrary fixed point, only useful for measuring intervals.
+ */
+uint64_t get_time_ns(void);
+
+#endif
@@ -0,0 +1,260 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "timer_wheel.h"
+
+/**
+ * Marks an empty slot or the end of a slot list.
+ */
+#define NONE UINT8_MAX
+
+/**
+ * Steps covered by one slot of a level.
+ */
+#define LEVEL_SPAN(LEVEL) ((uint64_t)1u << (TIMER_WHEEL_BITS * (LEVEL)))
+
+/**
+ * Timer ids are the timer's index in the low byte and its generation above that.
+ */
+#define ID_INDEX(ID) ((ID) & 0xffu)
+#define ID_GENERATION(ID) ((ID) >> 8u)
+#define GENERATION_MASK 0xffffffu
+
+_Static_assert(TIMER_WHEEL_CAPACITY <= 32u, "pending timers must fit in a 32 bit mask");
+_Static_assert((TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS) <= 256u, "slot numbers must fit in a byte");
+
+/**
+ * Helper function to find the slot a timer belongs in from the current step.
+ *
+ * @param wheel
+ *   Wheel the timer is on.
+ *
+ * @param expires
+ *   Step the timer fires on, no earlier than the current step.
+ *
+ * @returns
+ *   Slot number across all levels.
+ */
+static uint8_t find_slot(const TimerWheel *wheel, uint64_t expires)
+{
+    const uint64_t delta = expires - wheel->now;
+
+    size_t level = 0u;
+    while ((level < (TIMER_WHEEL_LEVELS - 1u)) && (delta >= LEVEL_SPAN(level + 1u)))
+    {
+        ++level;
+    }
+
+    // beyond the top level, park it in the furthest slot and place it again when that slot comes round
+    uint64_t at = expires;
+    if (delta >= LEVEL_SPAN(TIMER_WHEEL_LEVELS))
+    {
+        at = wheel->now + LEVEL_SPAN(TIMER_WHEEL_LEVELS) - 1u;
+    }
+
+    return (uint8_t)((level * TIMER_WHEEL_SLOTS) + ((at >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1u)));
+}
+
+/**
+ * Helper function to add a timer to the end of a slot.
+ *
+ * @param wheel
+ *   Wheel the timer is on.
+ *
+ * @param index
+ *   Timer to add.
+ *
+ * @param slot
+ *   Slot to add it to.
+ */
+static void link_timer(TimerWheel *wheel, uint8_t index, uint8_t slot)
+{
+    Timer *timer = &wheel->timers[index];
+    timer->slot = slot;
+    timer->next = NONE;
+    timer->prev = wheel->tails[slot];
+
+    if (wheel->tails[slot] == NONE)
+    {
+        wheel->heads[slot] = index;
+    }
+    else
+    {
+        wheel->timers[wheel->tails[slot]].next = index;
+    }
+    wheel->tails[slot] = index;
+}
+
+/**
+ * Helper function to remove a timer from its slot.
+ *
+ * @param wheel
+ *   Wheel the timer is on.
+ *
+ * @param index
+ *   Timer to remove.
+ */
+static void unlink_timer(TimerWheel *wheel, uint8_t index)
+{
+    const Timer *timer = &wheel->timers[index];
+
+    if (timer->prev == NONE)
+    {
+        wheel->heads[timer->slot] = timer->next;
+    }
+    else
+    {
+        wheel->timers[timer->prev].next = timer->next;
+    }
+
+    if (timer->next == NONE)
+    {
+        wheel->tails[timer->slot] = timer->prev;
+    }
+    else
+    {
+        wheel->timers[timer->next].prev = timer->prev;
+    }
+}
+
+/**
+ * Helper function to move every timer in a higher level slot down to where it belongs now, keeping their order.
+ *
+ * @param wheel
+ *   Wheel to update.
+ *
+ * @param slot
+ *   Slot to empty.
+ */
+static void cascade_slot(TimerWheel *wheel, uint8_t slot)
+{
+    uint8_t index = wheel->heads[slot];
+    wheel->heads[slot] = NONE;
+    wheel->tails[slot] = NONE;
+
+    while (index != NONE)
+    {
+        const uint8_t next = wheel->timers[index].next;
+        link_timer(wheel, index, find_slot(wheel, wheel->timers[index].expires));
+        index = next;
+    }
+}
+
+void init_timer_wheel(TimerWheel *wheel, uint64_t now)
+{
+    assert(wheel != NULL);
+
+    memset(wheel, 0, sizeof(TimerWheel));
+    memset(wheel->heads, NONE, sizeof(wheel->heads));
+    memset(wheel->tails, NONE, sizeof(wheel->tails));
+    wheel->now = now;
+}
+
+Result schedule_timer(TimerWheel *wheel, uint64_t delay, uint32_t kind, uint32_t data, uint32_t *id)
+{
+    assert(wheel != NULL);
+
+    Result result = SUCCESS;
+
+    if (wheel->count == TIMER_WHEEL_CAPACITY)
+    {
+        result = FAILED;
+        return result;
+    }
+
+    // lowest free timer, so the same schedule calls always use the same timers
+    const uint8_t index = (uint8_t)__builtin_ctz(~wheel->used);
+    Timer *timer = &wheel->timers[index];
+
+    timer->generation = (timer->generation + 1u) & GENERATION_MASK;
+    timer->generation = (timer->generation == 0u) ? 1u : timer->generation;
+    timer->expires = wheel->now + ((delay == 0u) ? 1u : delay);
+    timer->kind = kind;
+    timer->data = data;
+
+    wheel->used |= (uint32_t)1u << index;
+    ++wheel->count;
+    link_timer(wheel, index, find_slot(wheel, timer->expires));
+
+    if (id != NULL)
+    {
+        *id = (timer->generation << 8u) | index;
+    }
+
+    return result;
+}
+
+bool is_timer_pending(const TimerWheel *wheel, uint32_t id)
+{
+    assert(wheel != NULL);
+
+    const uint32_t index = ID_INDEX(id);
+    return (index < TIMER_WHEEL_CAPACITY) && (((wheel->used >> index) & 1u) != 0u) &&
+           (wheel->timers[index].generation == ID_GENERATION(id));
+}
+
+Result cancel_timer(TimerWheel *wheel, uint32_t id)
+{
+    assert(wheel != NULL);
+
+    if (!is_timer_pending(wheel, id))
+    {
+        return NO_EVENT;
+    }
+
+    const uint8_t index = (uint8_t)ID_INDEX(id);
+    unlink_timer(wheel, index);
+    wheel->used &= ~((uint32_t)1u << index);
+    --wheel->count;
+
+    return SUCCESS;
+}
+
+void advance_timer_wheel(TimerWheel *wheel, uint64_t now, TimerCallback callback, void *context)
+{
+    assert(wheel != NULL);
+    assert(now >= wheel->now);
+    assert(callback != NULL);
+
+    while (wheel->now < now)
+    {
+        // nothing pending, nothing to move or fire on the way
+        if (wheel->count == 0u)
+        {
+            wheel->now = now;
+            break;
+        }
+
+        const uint64_t step = ++wheel->now;
+
+        // when a level wraps, bring down the next slot of the level above, top first so timers moved out of one level
+        // are moved again if they land in a slot that is due now
+        for (size_t level = TIMER_WHEEL_LEVELS - 1u; level > 0u; --level)
+        {
+            if ((step & (LEVEL_SPAN(level) - 1u)) == 0u)
+            {
+                cascade_slot(
+                    wheel,
+                    (uint8_t)((level * TIMER_WHEEL_SLOTS) +
+                              ((step >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1u))));
+            }
+        }
+
+        // take timers off one at a time, a callback may cancel the ones after it
+        const uint8_t slot = (uint8_t)(step & (TIMER_WHEEL_SLOTS - 1u));
+        while (wheel->heads[slot] != NONE)
+        {
+            const uint8_t index = wheel->heads[slot];
+            const Timer *timer = &wheel->timers[index];
+            assert(timer->expires == step);
+
+            unlink_timer(wheel, index);
+            wheel->used &= ~((uint32_t)1u << index);
+            --wheel->count;
+
+            callback(context, timer->kind, timer->data);
+        }
+    }
+}
@@ -0,0 +1,178 @@
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "result.h"
+
+/**
+ * TimerWheel schedules timers against a step counter.
+ *
+ * Timers are kept in a hierarchical wheel: level 0 has a slot for each of the next TIMER_WHEEL_SLOTS steps, each
+ * level above covers TIMER_WHEEL_SLOTS times as many steps per slot. Scheduling and cancelling are O(1). Advancing
+ * only looks at the slot for each step, plus one slot of a higher level whenever a lower level wraps, whose timers
+ * are moved down.
+ *
+ * The wheel is plain data with no pointers, so it can live inside a game state and be copied, compared and rolled
+ * back with it. Timers that expire on the same step fire in the order they reached their slot, which only depends on
+ * the order timers were scheduled, so two wheels driven the same way always fire the same way.
+ */
+
+/**
+ * Slots per level, a power of two.
+ */
+#define TIMER_WHEEL_BITS 6u
+#define TIMER_WHEEL_SLOTS (1u << TIMER_WHEEL_BITS)
+
+/**
+ * Number of levels. Three levels of 64 slots reach 262144 steps ahead, timers further out are parked in the top level
+ * until they come into range.
+ */
+#define TIMER_WHEEL_LEVELS 3u
+
+/**
+ * Most timers pending at once.
+ */
+#define TIMER_WHEEL_CAPACITY 16u
+
+/**
+ * Never a valid timer id, for marking a timer that isn't scheduled.
+ */
+#define NO_TIMER 0u
+
+/**
+ * A pending timer.
+ */
+typedef struct Timer
+{
+    uint64_t expires;
+    uint32_t kind;
+    uint32_t data;
+
+    // bumped every time the timer is reused so stale ids can be told apart
+    uint32_t generation;
+
+    // neighbours in the slot list, UINT8_MAX when there is none, and the slot the timer is in
+    uint8_t next;
+    uint8_t prev;
+    uint8_t slot;
+    uint8_t unused;
+} Timer;
+
+/**
+ * Hierarchical timer wheel, see above.
+ */
+typedef struct TimerWheel
+{
+    // last step advanced to
+    uint64_t now;
+
+    Timer timers[TIMER_WHEEL_CAPACITY];
+
+    // first and last timer in each slot of each level
+    uint8_t heads[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];
+    uint8_t tails[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];
+
+    // bit i is set while timers[i] is pending
+    uint32_t used;
+    uint32_t count;
+} TimerWheel;
+
+/**
+ * Called for each timer that fires.
+ *
+ * @param context
+ *   Context given to advance_timer_wheel.
+ *
+ * @param kind
+ *   Kind given when the timer was scheduled.
+ *
+ * @param data
+ *   Data given when the timer was scheduled.
+ */
+typedef void (*TimerCallback)(void *context, uint32_t kind, uint32_t data);
+
+/**
+ * Empty a timer wheel.
+ *
+ * @param wheel
+ *   Wheel to initialise.
+ *
+ * @param now
+ *   Current step.
+ */
+void init_timer_wheel(TimerWheel *wheel, uint64_t now);
+
+/**
+ * Schedule a timer.
+ *
+ * @param wheel
+ *   Wheel to schedule on.
+ *
+ * @param delay
+ *   Steps from now until the timer fires, at least 1.
+ *
+ * @param kind
+ *   Passed to the callback.
+ *
+ * @param data
+ *   Passed to the callback.
+ *
+ * @param id
+ *   Out parameter for the timer's id, may be NULL.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED if the wheel is full
+ */
+Result schedule_timer(TimerWheel *wheel, uint64_t delay, uint32_t kind, uint32_t data, uint32_t *id);
+
+/**
+ * Cancel a pending timer.
+ *
+ * @param wheel
+ *   Wheel the timer was scheduled on.
+ *
+ * @param id
+ *   Timer to cancel.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   NO_EVENT if the timer already fired or was cancelled
+ */
+Result cancel_timer(TimerWheel *wheel, uint32_t id);
+
+/**
+ * Check if a timer is still pending.
+ *
+ * @param wheel
+ *   Wheel the timer was scheduled on.
+ *
+ * @param id
+ *   Timer to check.
+ *
+ * @returns
+ *   True if the timer has not fired or been cancelled.
+ */
+bool is_timer_pending(const TimerWheel *wheel, uint32_t id);
+
+/**
+ * Advance to a step, firing every timer that expires on the way in order of expiry. Callbacks may schedule and cancel
+ * timers, a timer scheduled by a callback fires once its own step is reached.
+ *
+ * @param wheel
+ *   Wheel to advance.
+ *
+ * @param now
+ *   Step to advance to, no earlier than the last one.
+ *
+ * @param callback
+ *   Called for each timer that fires.
+ *
+ * @param context
+ *   Passed to the callback.
+ */
+void advance_timer_wheel(TimerWheel *wheel, uint64_t now, TimerCallback callback, void *context);
+
+#endif
@@ -0,0 +1,285 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "alloc.h"
+#include "timer.h"
+#include "trace.h"
+
+#ifdef BREAKOUT_TRACE
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * A finished zone. Fields are atomic because dump_trace can read them while the owning thread overwrites them.
+ */
+typedef struct TraceEvent
+{
+    _Atomic(const char *) name;
+    _Atomic uint64_t start;
+    _Atomic uint64_t duration;
+} TraceEvent;
+
+/**
+ * Zones recorded by one thread, events[i % TRACE_BUFFER_EVENTS] holds zone i.
+ */
+typedef struct TraceBuffer
+{
+    // zones written so far, only the owner writes it
+    _Alignas(64) _Atomic uint64_t head;
+    _Atomic(const char *) thread_name;
+
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+} TraceBuffer;
+
+/**
+ * A zone copied out of a buffer for dumping.
+ */
+typedef struct TraceRecord
+{
+    const char *name;
+    uint64_t start;
+    uint64_t duration;
+} TraceRecord;
+
+_Static_assert((TRACE_BUFFER_EVENTS & (TRACE_BUFFER_EVENTS - 1u)) == 0u, "TRACE_BUFFER_EVENTS must be a power of two");
+
+/**
+ * Buffers for every thread, NULL while not tracing.
+ */
+static TraceBuffer *_Atomic trace_buffers;
+
+/**
+ * Buffers handed out to threads so far.
+ */
+static _Atomic uint32_t trace_threads;
+
+/**
+ * Bumped by each start_trace, so threads know a buffer they claimed earlier is gone.
+ */
+static _Atomic uint32_t trace_generation;
+
+/**
+ * Clock readings when tracing started, to convert ticks to time.
+ */
+static uint64_t start_ticks;
+static uint64_t start_ns;
+
+/**
+ * Copy of one buffer taken while dumping, so the owner can keep writing.
+ */
+static TraceRecord *dump_records;
+
+/**
+ * The calling thread's buffer and the generation it was claimed in.
+ */
+static _Thread_local TraceBuffer *thread_buffer;
+static _Thread_local uint32_t thread_generation;
+
+/**
+ * Helper function to read the clock zones are timed with.
+ *
+ * @returns
+ *   Clock ticks.
+ */
+static inline uint64_t read_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return get_time_ns();
+#endif
+}
+
+/**
+ * Helper function to get the calling thread's buffer, claiming one the first time.
+ *
+ * @returns
+ *   The buffer, or NULL if not tracing or every buffer is taken.
+ */
+static TraceBuffer *get_thread_buffer(void)
+{
+    TraceBuffer *buffers = atomic_load_explicit(&trace_buffers, memory_order_acquire);
+    if (buffers == NULL)
+    {
+        return NULL;
+    }
+
+    const uint32_t generation = atomic_load_explicit(&trace_generation, memory_order_relaxed);
+    if ((thread_buffer == NULL) || (thread_generation != generation))
+    {
+        const uint32_t index = atomic_fetch_add_explicit(&trace_threads, 1u, memory_order_relaxed);
+        thread_buffer = (index < TRACE_MAX_THREADS) ? &buffers[index] : NULL;
+        thread_generation = generation;
+    }
+
+    return thread_buffer;
+}
+
+TraceZone begin_trace_zone(const char *name)
+{
+    return (TraceZone){.name = name, .start = read_ticks()};
+}
+
+void end_trace_zone(const TraceZone *zone)
+{
+    const uint64_t end = read_ticks();
+    TraceBuffer *buffer = get_thread_buffer();
+    if (buffer == NULL)
+    {
+        return;
+    }
+
+    const uint64_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    TraceEvent *event = &buffer->events[head & (TRACE_BUFFER_EVENTS - 1u)];
+
+    // a dump that reads any of the new values is sure to see the head from before them, see dump_trace
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&event->name, zone->name, memory_order_relaxed);
+    atomic_store_explicit(&event->start, zone->start, memory_order_relaxed);
+    atomic_store_explicit(&event->duration, end - zone->start, memory_order_relaxed);
+    atomic_store_explicit(&buffer->head, head + 1u, memory_order_release);
+}
+
+void name_trace_thread(const char *name)
+{
+    TraceBuffer *buffer = get_thread_buffer();
+    if (buffer != NULL)
+    {
+        atomic_store_explicit(&buffer->thread_name, name, memory_order_relaxed);
+    }
+}
+
+Result start_trace(void)
+{
+    if (atomic_load_explicit(&trace_buffers, memory_order_relaxed) != NULL)
+    {
+        return SUCCESS;
+    }
+
+    TraceBuffer *buffers = (TraceBuffer *)TRACKED_CALLOC(TRACE_MAX_THREADS, sizeof(TraceBuffer));
+    dump_records = (TraceRecord *)TRACKED_CALLOC(TRACE_BUFFER_EVENTS, sizeof(TraceRecord));
+    if ((buffers == NULL) || (dump_records == NULL))
+    {
+        free_tracked(buffers);
+        free_tracked(dump_records);
+        dump_records = NULL;
+        return FAILED;
+    }
+
+    start_ns = get_time_ns();
+    start_ticks = read_ticks();
+
+    atomic_store_explicit(&trace_threads, 0u, memory_order_relaxed);
+    atomic_fetch_add_explicit(&trace_generation, 1u, memory_order_relaxed);
+    atomic_store_explicit(&trace_buffers, buffers, memory_order_release);
+    return SUCCESS;
+}
+
+void stop_trace(void)
+{
+    TraceBuffer *buffers = atomic_exchange_explicit(&trace_buffers, NULL, memory_order_acq_rel);
+    free_tracked(buffers);
+    free_tracked(dump_records);
+    dump_records = NULL;
+}
+
+Result dump_trace(const char *path)
+{
+    TraceBuffer *buffers = atomic_load_explicit(&trace_buffers, memory_order_acquire);
+    if (buffers == NULL)
+    {
+        return FAILED;
+    }
+
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+    {
+        return FAILED;
+    }
+
+    // ticks to microseconds, measured over the whole trace so far
+    const uint64_t ticks = read_ticks() - start_ticks;
+    const uint64_t ns = get_time_ns() - start_ns;
+    const double us_per_tick = (ticks > 0u) ? (((double)ns / 1000.0) / (double)ticks) : 0.0;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(file, "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"breakout\"}}");
+
+    uint32_t threads = atomic_load_explicit(&trace_threads, memory_order_relaxed);
+    threads = (threads < TRACE_MAX_THREADS) ? threads : TRACE_MAX_THREADS;
+    for (uint32_t thread = 0u; thread < threads; ++thread)
+    {
+        TraceBuffer *buffer = &buffers[thread];
+
+        const char *thread_name = atomic_load_explicit(&buffer->thread_name, memory_order_relaxed);
+        if (thread_name != NULL)
+        {
+            fprintf(
+                file,
+                ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}",
+                thread,
+                thread_name);
+        }
+
+        // copy what is there, then drop anything the owner may have overwritten while it was being copied
+        const uint64_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+        const uint64_t first = (head > TRACE_BUFFER_EVENTS) ? (head - TRACE_BUFFER_EVENTS) : 0u;
+        for (uint64_t i = first; i < head; ++i)
+        {
+            const TraceEvent *event = &buffer->events[i & (TRACE_BUFFER_EVENTS - 1u)];
+            dump_records[i & (TRACE_BUFFER_EVENTS - 1u)] = (TraceRecord){
+                .name = atomic_load_explicit(&event->name, memory_order_relaxed),
+                .start = atomic_load_explicit(&event->start, memory_order_relaxed),
+                .duration = atomic_load_explicit(&event->duration, memory_order_relaxed)};
+        }
+        atomic_thread_fence(memory_order_acquire);
+        const uint64_t later_head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+        const uint64_t valid =
+            ((later_head + 1u) > TRACE_BUFFER_EVENTS) ? (later_head + 1u - TRACE_BUFFER_EVENTS) : 0u;
+
+        for (uint64_t i = (first > valid) ? first : valid; i < head; ++i)
+        {
+            const TraceRecord *record = &dump_records[i & (TRACE_BUFFER_EVENTS - 1u)];
+
+            // zones begun before tracing started
+            if (record->start < start_ticks)
+            {
+                continue;
+            }
+
+            fprintf(
+                file,
+                ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"name\":\"%s\",\"ts\":%.3f,\"dur\":%.3f}",
+                thread,
+                record->name,
+                (double)(record->start - start_ticks) * us_per_tick,
+                (double)record->duration * us_per_tick);
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    return (fclose(file) == 0) ? SUCCESS : FAILED;
+}
+
+#else
+
+Result start_trace(void)
+{
+    return FAILED;
+}
+
+void stop_trace(void)
+{
+}
+
+Result dump_trace(const char *path)
+{
+    (void)path;
+    return FAILED;
+}
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdint.h>
+
+#include "result.h"
+
+/**
+ * Trace records how long scoped zones of code take on every thread and writes them out as a Chrome trace, which opens
+ * in Perfetto (ui.perfetto.dev) or chrome://tracing.
+ *
+ * A zone is timed from the TRACE_ZONE line to the end of the enclosing block:
+ *
+ *     {
+ *         TRACE_ZONE("render");
+ *         ...
+ *     }
+ *
+ * Each thread writes finished zones to its own ring buffer with no locks, keeping the most recent TRACE_BUFFER_EVENTS,
+ * so a dump shows the last moments before it was asked for. Zones are timed with the TSC where there is one and the
+ * monotonic clock otherwise.
+ *
+ * Zones are only compiled in when built with BREAKOUT_TRACE, otherwise the macros expand to nothing and start_trace
+ * fails.
+ */
+
+/**
+ * Zones kept per thread, a power of two.
+ */
+#define TRACE_BUFFER_EVENTS 32768u
+
+/**
+ * Most threads that can record zones, later threads are not traced.
+ */
+#define TRACE_MAX_THREADS 16u
+
+#ifdef BREAKOUT_TRACE
+
+/**
+ * A zone being timed, ended when it goes out of scope.
+ */
+typedef struct TraceZone
+{
+    const char *name;
+    uint64_t start;
+} TraceZone;
+
+/**
+ * Start timing a zone, use TRACE_ZONE rather than calling this.
+ *
+ * @param name
+ *   Name of the zone, must be a string literal or live as long as the trace.
+ *
+ * @returns
+ *   Zone being timed.
+ */
+TraceZone begin_trace_zone(const char *name);
+
+/**
+ * Finish timing a zone, called when a TRACE_ZONE goes out of scope.
+ *
+ * @param zone
+ *   Zone to finish.
+ */
+void end_trace_zone(const TraceZone *zone);
+
+/**
+ * Name the calling thread in the trace, use TRACE_THREAD rather than calling this.
+ *
+ * @param name
+ *   Name of the thread, must be a string literal or live as long as the trace.
+ */
+void name_trace_thread(const char *name);
+
+#define TRACE_JOIN_(A, B) A##B
+#define TRACE_JOIN(A, B) TRACE_JOIN_(A, B)
+
+/**
+ * Time from here to the end of the enclosing block as a zone called NAME.
+ */
+#define TRACE_ZONE(NAME)                                                                                             \
+    const TraceZone TRACE_JOIN(trace_zone_, __LINE__) __attribute__((cleanup(end_trace_zone), unused)) =              \
+        begin_trace_zone(NAME)
+
+/**
+ * Name the calling thread.
+ */
+#define TRACE_THREAD(NAME) name_trace_thread(NAME)
+
+#else
+
+#define TRACE_ZONE(NAME) ((void)0)
+#define TRACE_THREAD(NAME) ((void)0)
+
+#endif
+
+/**
+ * Start recording zones. Allocates every thread's buffer up front, so recording never allocates.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure, or if zones are not compiled in
+ */
+Result start_trace(void);
+
+/**
+ * Stop recording zones and free the buffers. Every thread recording zones must have finished.
+ */
+void stop_trace(void);
+
+/**
+ * Write the zones recorded so far as a Chrome trace. Can be called while other threads are recording, zones they
+ * overwrite while the dump is being taken are left out. Only one thread may dump at a time.
+ *
+ * @param path
+ *   File to write.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result dump_trace(const char *path);
+
+#endif
@@ -5,10 +5,10 @@
 
 Vector2D create_vec()
 {
-    return create_vec_xy(0.0f, 0.0f);
+    return create_vec_xy(SCALAR(0.0f), SCALAR(0.0f));
 }
 
-Vector2D create_vec_xy(float x, float y)
+Vector2D create_vec_xy(Scalar x, Scalar y)
 {
     Vector2D vec = {.x = x, .y = y};
     return vec;
@@ -23,7 +23,7 @@ void add_vec(Vector2D *vec1, const Vector2D *vec2)
     vec1->y += vec2->y;
 }
 
-void add_vec_xy(Vector2D *vec, float x, float y)
+void add_vec_xy(Vector2D *vec, Scalar x, Scalar y)
 {
     assert(vec != NULL);
 
@@ -35,5 +35,5 @@ void print_vec(const Vector2D *vec)
 {
     assert(vec != NULL);
 
-    printf("{ x: %f, y: %f }\n", vec->x, vec->y);
+    printf("{ x: %f, y: %f }\n", scalar_to_float(vec->x), scalar_to_float(vec->y));
 }
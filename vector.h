@@ -1,5 +1,10 @@
 #ifndef _VECTOR_H_
 #define _VECTOR_H_
+
+#include <stddef.h>
+
+#include "scalar.h"
+
 /**
  * 2-dim vector (x,y)/
 
@@ -8,8 +13,8 @@
  */
 typedef struct Vector2D
 {
-    float x;
-    float y;
+    Scalar x;
+    Scalar y;
 } Vector2D;
 
 /**
@@ -32,7 +37,7 @@ Vector2D create_vec();
  * @returns
  *   Vector2D with x and y set to supplied values.
  */
-Vector2D create_vec_xy(float x, float y);
+Vector2D create_vec_xy(Scalar x, Scalar y);
 
 /**
  * Add one vector to another.
@@ -57,7 +62,7 @@ void add_vec(Vector2D *vec1, const Vector2D *vec2);
  * @param y
  *   Value to add to y component.
  */
-void add_vec_xy(Vector2D *vec, float x, float y);
+void add_vec_xy(Vector2D *vec, Scalar x, Scalar y);
 
 /**
  * Print vector to stdout.
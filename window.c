@@ -3,17 +3,140 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "alloc.h"
+#include "trace.h"
 #include "window.h"
 
 #include <SDL2/SDL.h>
 
+/**
+ * Width and height of a glyph in font pixels.
+ */
+#define GLYPH_WIDTH 3
+#define GLYPH_HEIGHT 5
+
+/**
+ * Glyph cells in the atlas are padded by one pixel so neighbouring glyphs never bleed into each other.
+ */
+#define CELL_WIDTH (GLYPH_WIDTH + 1)
+#define CELL_HEIGHT (GLYPH_HEIGHT + 1)
+
+/**
+ * The atlas holds the 64 characters from ' ' to '_' in a 16x4 grid, plus a fifth row with a solid cell used for
+ * untextured HUD quads so everything can be drawn in one batch.
+ */
+#define ATLAS_COLUMNS 16
+#define ATLAS_WIDTH (ATLAS_COLUMNS * CELL_WIDTH)
+#define ATLAS_HEIGHT (5 * CELL_HEIGHT)
+#define GLYPH_COUNT 64
+
+/**
+ * Maximum number of quads the HUD can draw in a frame.
+ */
+#define HUD_MAX_QUADS 1024u
+
+/**
+ * Build a glyph from five rows of three bits, most significant bit on the left.
+ */
+#define GLYPH(R0, R1, R2, R3, R4) (uint16_t)(((R0) << 12) | ((R1) << 9) | ((R2) << 6) | ((R3) << 3) | (R4))
+
+/**
+ * 3x5 font for ' ' to '_', characters not listed are blank.
+ */
+static const uint16_t font_glyphs[GLYPH_COUNT] = {
+    ['%' - ' '] = GLYPH(5, 1, 2, 4, 5),
+    ['-' - ' '] = GLYPH(0, 0, 7, 0, 0),
+    ['.' - ' '] = GLYPH(0, 0, 0, 0, 2),
+    ['/' - ' '] = GLYPH(1, 1, 2, 4, 4),
+    ['0' - ' '] = GLYPH(7, 5, 5, 5, 7),
+    ['1' - ' '] = GLYPH(2, 6, 2, 2, 7),
+    ['2' - ' '] = GLYPH(7, 1, 7, 4, 7),
+    ['3' - ' '] = GLYPH(7, 1, 7, 1, 7),
+    ['4' - ' '] = GLYPH(5, 5, 7, 1, 1),
+    ['5' - ' '] = GLYPH(7, 4, 7, 1, 7),
+    ['6' - ' '] = GLYPH(7, 4, 7, 5, 7),
+    ['7' - ' '] = GLYPH(7, 1, 1, 1, 1),
+    ['8' - ' '] = GLYPH(7, 5, 7, 5, 7),
+    ['9' - ' '] = GLYPH(7, 5, 7, 1, 7),
+    [':' - ' '] = GLYPH(0, 2, 0, 2, 0),
+    ['A' - ' '] = GLYPH(2, 5, 7, 5, 5),
+    ['B' - ' '] = GLYPH(6, 5, 6, 5, 6),
+    ['C' - ' '] = GLYPH(3, 4, 4, 4, 3),
+    ['D' - ' '] = GLYPH(6, 5, 5, 5, 6),
+    ['E' - ' '] = GLYPH(7, 4, 6, 4, 7),
+    ['F' - ' '] = GLYPH(7, 4, 6, 4, 4),
+    ['G' - ' '] = GLYPH(3, 4, 5, 5, 3),
+    ['H' - ' '] = GLYPH(5, 5, 7, 5, 5),
+    ['I' - ' '] = GLYPH(7, 2, 2, 2, 7),
+    ['J' - ' '] = GLYPH(1, 1, 1, 5, 2),
+    ['K' - ' '] = GLYPH(5, 5, 6, 5, 5),
+    ['L' - ' '] = GLYPH(4, 4, 4, 4, 7),
+    ['M' - ' '] = GLYPH(5, 7, 7, 5, 5),
+    ['N' - ' '] = GLYPH(6, 5, 5, 5, 5),
+    ['O' - ' '] = GLYPH(2, 5, 5, 5, 2),
+    ['P' - ' '] = GLYPH(6, 5, 6, 4, 4),
+    ['Q' - ' '] = GLYPH(2, 5, 5, 6, 3),
+    ['R' - ' '] = GLYPH(6, 5, 6, 5, 5),
+    ['S' - ' '] = GLYPH(3, 4, 2, 1, 6),
+    ['T' - ' '] = GLYPH(7, 2, 2, 2, 2),
+    ['U' - ' '] = GLYPH(5, 5, 5, 5, 7),
+    ['V' - ' '] = GLYPH(5, 5, 5, 5, 2),
+    ['W' - ' '] = GLYPH(5, 5, 7, 7, 5),
+    ['X' - ' '] = GLYPH(5, 5, 2, 5, 5),
+    ['Y' - ' '] = GLYPH(5, 5, 2, 2, 2),
+    ['Z' - ' '] = GLYPH(7, 1, 2, 4, 7),
+};
+
+/**
+ * Cached geometry for one HUD string.
+ */
+typedef struct TextSlot
+{
+    char text[HUD_TEXT_LENGTH + 1u];
+    float x;
+    float y;
+    float scale;
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+
+    // geometry has been built for the values above
+    bool valid;
+    // drawn this frame
+    bool used;
+
+    size_t quads;
+    SDL_Vertex vertices[HUD_TEXT_LENGTH * 4u];
+} TextSlot;
+
 typedef struct Window
 {
     SDL_Window *window;
     SDL_Renderer *renderer;
+
+    // texture rendered to instead of the screen by an offscreen window, otherwise NULL
+    SDL_Texture *target;
+
+    // world position of the upper left corner of the screen
+    Scalar camera_x;
+    Scalar camera_y;
+
+    // scratch geometry for batched draws, sized in quads (4 vertices and 6 indices each)
+    SDL_Vertex *vertices;
+    int *indices;
+    size_t quad_capacity;
+
+    // HUD state, flushed in one batch by post_render_window
+    SDL_Texture *font_atlas;
+    TextSlot text_slots[HUD_TEXT_SLOTS];
+    SDL_Vertex *hud_vertices;
+    size_t hud_quads;
 } Window;
 
+static Result reserve_quads(Window *window, size_t quads);
+
 static Result map_sdl_key(Key *key, SDL_Keycode sdl_code)
 {
     switch (sdl_code)
@@ -27,18 +150,147 @@ static Result map_sdl_key(Key *key, SDL_Keycode sdl_code)
     case SDLK_RIGHT:
         *key = RIGHT_K;
         return SUCCESS;
-    fault:
+    case SDLK_r:
+        *key = REWIND_K;
+        return SUCCESS;
+    case SDLK_t:
+        *key = TRACE_K;
+        return SUCCESS;
+    default:
         return NO_EVENT;
     }
 }
 
-Result create_window(Window **window)
+/**
+ * SDL memory functions, every allocation SDL makes is counted under one "SDL" call site.
+ */
+static void *sdl_malloc(size_t size)
+{
+    return calloc_tracked(1u, size, "SDL", 0);
+}
+
+static void *sdl_calloc(size_t count, size_t size)
+{
+    return calloc_tracked(count, size, "SDL", 0);
+}
+
+static void *sdl_realloc(void *ptr, size_t size)
+{
+    return realloc_tracked(ptr, size, "SDL", 0);
+}
+
+/**
+ * Helper function to build the font atlas texture.
+ *
+ * @param renderer
+ *   Renderer to create texture with.
+ *
+ * @returns
+ *   Atlas texture or NULL on failure.
+ */
+static SDL_Texture *create_font_atlas(SDL_Renderer *renderer)
+{
+    // RGBA32 is byte ordered, so every pixel is white and only alpha changes
+    static uint8_t pixels[ATLAS_HEIGHT][ATLAS_WIDTH][4];
+    memset(pixels, 0xff, sizeof(pixels));
+
+    for (int glyph = 0; glyph < GLYPH_COUNT; ++glyph)
+    {
+        const int cell_x = (glyph % ATLAS_COLUMNS) * CELL_WIDTH;
+        const int cell_y = (glyph / ATLAS_COLUMNS) * CELL_HEIGHT;
+
+        for (int y = 0; y < CELL_HEIGHT; ++y)
+        {
+            for (int x = 0; x < CELL_WIDTH; ++x)
+            {
+                const int bit = ((GLYPH_HEIGHT - 1 - y) * GLYPH_WIDTH) + (GLYPH_WIDTH - 1 - x);
+                const bool set = (x < GLYPH_WIDTH) && (y < GLYPH_HEIGHT) && ((font_glyphs[glyph] >> bit) & 1u);
+                pixels[cell_y + y][cell_x + x][3] = set ? 0xff : 0x00;
+            }
+        }
+    }
+
+    SDL_Texture *atlas =
+        SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, ATLAS_WIDTH, ATLAS_HEIGHT);
+    if (atlas == NULL)
+    {
+        return NULL;
+    }
+
+    if ((SDL_UpdateTexture(atlas, NULL, pixels, ATLAS_WIDTH * 4) != 0) ||
+        (SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND) != 0))
+    {
+        SDL_DestroyTexture(atlas);
+        return NULL;
+    }
+
+    return atlas;
+}
+
+/**
+ * Helper function to write a textured quad.
+ *
+ * @param vertices
+ *   Four vertices to write.
+ *
+ * @param x
+ *   X coordinate of quad (upper left corner).
+ *
+ * @param y
+ *   Y coordinate of quad (upper left corner).
+ *
+ * @param width
+ *   Quad width.
+ *
+ * @param height
+ *   Quad height.
+ *
+ * @param u
+ *   Atlas x coordinate in pixels.
+ *
+ * @param v
+ *   Atlas y coordinate in pixels.
+ *
+ * @param colour
+ *   Colour of quad.
+ */
+static void write_hud_quad(
+    SDL_Vertex *vertices, float x, float y, float width, float height, int u, int v, SDL_Color colour)
+{
+    const float u0 = (float)u / ATLAS_WIDTH;
+    const float v0 = (float)v / ATLAS_HEIGHT;
+    const float u1 = (float)(u + GLYPH_WIDTH) / ATLAS_WIDTH;
+    const float v1 = (float)(v + GLYPH_HEIGHT) / ATLAS_HEIGHT;
+
+    vertices[0] = (SDL_Vertex){.position = {x, y}, .color = colour, .tex_coord = {u0, v0}};
+    vertices[1] = (SDL_Vertex){.position = {x + width, y}, .color = colour, .tex_coord = {u1, v0}};
+    vertices[2] = (SDL_Vertex){.position = {x + width, y + height}, .color = colour, .tex_coord = {u1, v1}};
+    vertices[3] = (SDL_Vertex){.position = {x, y + height}, .color = colour, .tex_coord = {u0, v1}};
+}
+
+/**
+ * Helper function to create a window, shown on screen or rendering offscreen.
+ *
+ * @param window
+ *   Created window.
+ *
+ * @param offscreen
+ *   True to hide the window and render to a texture.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result open_window(Window **window, bool offscreen)
 {
     Result res = SUCCESS;
 
+    // route SDL's own allocations through the tracker before it allocates anything
+    SDL_SetMemoryFunctions(sdl_malloc, sdl_calloc, sdl_realloc, free_tracked);
+
     // Initalize SDL
     // allocate space for the window object
-    Window *n_window = (Window *)calloc(1u, sizeof(Window));
+    Window *n_window = (Window *)TRACKED_CALLOC(1u, sizeof(Window));
     if ((SDL_Init(SDL_INIT_VIDEO) != 0) || (n_window == NULL))
     {
         res = FAILED;
@@ -47,7 +299,7 @@ Result create_window(Window **window)
     }
 
     // create an SDL window
-    n_window->window = SDL_CreateWindow("Breakout", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 800, 800, SDL_WINDOW_SHOWN);
+    n_window->window = SDL_CreateWindow("Breakout", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, WINDOW_WIDTH, WINDOW_HEIGHT, offscreen ? SDL_WINDOW_HIDDEN : SDL_WINDOW_SHOWN);
     if (n_window->window == NULL)
     {
         res = FAILED;
@@ -56,7 +308,7 @@ Result create_window(Window **window)
     }
 
     // create an SDL renderer
-    n_window->renderer = SDL_CreateRenderer(n_window->window, -1, 0);
+    n_window->renderer = SDL_CreateRenderer(n_window->window, -1, offscreen ? SDL_RENDERER_TARGETTEXTURE : 0);
     if (n_window->renderer == NULL)
     {
         res = FAILED;
@@ -64,11 +316,45 @@ Result create_window(Window **window)
         return res;
     }
 
+    // everything drawn from here on goes to the texture
+    if (offscreen)
+    {
+        n_window->target = SDL_CreateTexture(
+            n_window->renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, WINDOW_WIDTH, WINDOW_HEIGHT);
+        if ((n_window->target == NULL) || (SDL_SetRenderTarget(n_window->renderer, n_window->target) != 0))
+        {
+            res = FAILED;
+            destroy_window(n_window);
+            return res;
+        }
+    }
+
+    // create the HUD font atlas and geometry up front so drawing the HUD never allocates
+    n_window->font_atlas = create_font_atlas(n_window->renderer);
+    n_window->hud_vertices = (SDL_Vertex *)TRACKED_CALLOC(HUD_MAX_QUADS * 4u, sizeof(SDL_Vertex));
+    if ((n_window->font_atlas == NULL) || (n_window->hud_vertices == NULL) ||
+        (reserve_quads(n_window, HUD_MAX_QUADS) != SUCCESS))
+    {
+        res = FAILED;
+        destroy_window(n_window);
+        return res;
+    }
+
     // assign the window to the user supplied pointer
     *window = n_window;
     return res;
 }
 
+Result create_window(Window **window)
+{
+    return open_window(window, false);
+}
+
+Result create_offscreen_window(Window **window)
+{
+    return open_window(window, true);
+}
+
 void destroy_window(Window *window)
 {
     if (window == NULL)
@@ -76,12 +362,25 @@ void destroy_window(Window *window)
         return;
     }
 
+    if (window->font_atlas != NULL)
+    {
+        SDL_DestroyTexture(window->font_atlas);
+    }
+
+    if (window->target != NULL)
+    {
+        SDL_DestroyTexture(window->target);
+    }
+
     if (window->window != NULL)
     {
         SDL_DestroyWindow(window->window);
     }
 
-    free(window);
+    free_tracked(window->hud_vertices);
+    free_tracked(window->vertices);
+    free_tracked(window->indices);
+    free_tracked(window);
 
     SDL_Quit();
 }
@@ -123,6 +422,8 @@ Result get_window_event(const Window *window, KeyEvent *event)
 
 Result pre_render_window(const Window *window)
 {
+    TRACE_ZONE("pre_render_window");
+
     Result result = SUCCESS;
 
     // clear the window to black
@@ -144,18 +445,76 @@ Result pre_render_window(const Window *window)
     return result;
 }
 
-void post_render_window(const Window *window)
+void post_render_window(Window *window)
 {
-    return SDL_RenderPresent(window->renderer);
+    assert(window != NULL);
+
+    TRACE_ZONE("post_render_window");
+
+    // gather the cached text geometry after any graphs so text is drawn on top
+    for (size_t i = 0u; i < HUD_TEXT_SLOTS; ++i)
+    {
+        TextSlot *slot = &window->text_slots[i];
+        if (slot->used && ((window->hud_quads + slot->quads) <= HUD_MAX_QUADS))
+        {
+            memcpy(
+                &window->hud_vertices[window->hud_quads * 4u], slot->vertices, slot->quads * 4u * sizeof(SDL_Vertex));
+            window->hud_quads += slot->quads;
+        }
+        slot->used = false;
+    }
+
+    // the whole HUD is a single submission
+    if ((window->hud_quads > 0u) && (SDL_RenderGeometry(
+                                         window->renderer,
+                                         window->font_atlas,
+                                         window->hud_vertices,
+                                         (int)(window->hud_quads * 4u),
+                                         window->indices,
+                                         (int)(window->hud_quads * 6u)) != 0))
+    {
+        printf("failed to render hud: %s\n", SDL_GetError());
+    }
+    window->hud_quads = 0u;
+
+    // nothing is shown offscreen, reading a pixel back instead waits for the frame to finish drawing like presenting
+    // would
+    if (window->target != NULL)
+    {
+        uint32_t pixel = 0u;
+        const SDL_Rect corner = {.x = 0, .y = 0, .w = 1, .h = 1};
+        TRACE_ZONE("read back");
+        if (SDL_RenderReadPixels(window->renderer, &corner, SDL_PIXELFORMAT_RGBA32, &pixel, 4) != 0)
+        {
+            printf("failed to read back frame: %s\n", SDL_GetError());
+        }
+        return;
+    }
+
+    // includes waiting for vsync, if the renderer does
+    TRACE_ZONE("present");
+    SDL_RenderPresent(window->renderer);
+}
+
+void set_camera_window(Window *window, const Camera *camera)
+{
+    assert(window != NULL);
+    assert(camera != NULL);
+
+    window->camera_x = camera->view.position.x;
+    window->camera_y = camera->view.position.y;
 }
 
 Result draw_block_window(const Window *window, const Block *block, uint8_t r, uint8_t g, uint8_t b)
 {
     Result result = SUCCESS;
 
-    // convert our internal rect to an SDL rect
+    // convert our internal rect to an SDL rect in screen space
     SDL_Rect sdl_block = {
-        .x = block->position.x, .y = block->position.y, .w = block->width, .h = block->height};
+        .x = scalar_to_int(block->position.x - window->camera_x),
+        .y = scalar_to_int(block->position.y - window->camera_y),
+        .w = scalar_to_int(block->width),
+        .h = scalar_to_int(block->height)};
 
     // set the draw color
     if (SDL_SetRenderDrawColor(window->renderer, r, g, b, 0xff) != 0)
@@ -173,3 +532,284 @@ Result draw_block_window(const Window *window, const Block *block, uint8_t r, ui
 
     return result;
 }
+
+/**
+ * Helper function to make sure the scratch geometry can hold a number of quads.
+ *
+ * @param window
+ *   Window owning the geometry.
+ *
+ * @param quads
+ *   Number of quads required.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+static Result reserve_quads(Window *window, size_t quads)
+{
+    if (quads <= window->quad_capacity)
+    {
+        return SUCCESS;
+    }
+
+    size_t capacity = (window->quad_capacity == 0u) ? 1024u : window->quad_capacity;
+    while (capacity < quads)
+    {
+        capacity *= 2u;
+    }
+
+    SDL_Vertex *vertices = (SDL_Vertex *)TRACKED_REALLOC(window->vertices, capacity * 4u * sizeof(SDL_Vertex));
+    if (vertices == NULL)
+    {
+        return FAILED;
+    }
+    window->vertices = vertices;
+
+    int *indices = (int *)TRACKED_REALLOC(window->indices, capacity * 6u * sizeof(int));
+    if (indices == NULL)
+    {
+        return FAILED;
+    }
+    window->indices = indices;
+
+    // the index pattern never changes so only fill in the new quads
+    for (size_t i = window->quad_capacity; i < capacity; ++i)
+    {
+        const int base = (int)(i * 4u);
+        int *quad = &indices[i * 6u];
+        quad[0] = base;
+        quad[1] = base + 1;
+        quad[2] = base + 2;
+        quad[3] = base + 2;
+        quad[4] = base + 3;
+        quad[5] = base;
+    }
+
+    window->quad_capacity = capacity;
+    return SUCCESS;
+}
+
+Result reserve_window_quads(Window *window, size_t quads)
+{
+    assert(window != NULL);
+
+    return reserve_quads(window, quads);
+}
+
+Result draw_particles_window(
+    Window *window, const float *x, const float *y, const uint32_t *colour, size_t count, float size)
+{
+    assert(window != NULL);
+
+    TRACE_ZONE("draw_particles_window");
+
+    Result result = SUCCESS;
+
+    if (count == 0u)
+    {
+        return result;
+    }
+
+    const float camera_x = scalar_to_float(window->camera_x);
+    const float camera_y = scalar_to_float(window->camera_y);
+
+    // never grow the geometry mid frame, anything past what was reserved goes in another submission
+    for (size_t first = 0u; first < count; first += window->quad_capacity)
+    {
+        const size_t batch = ((count - first) < window->quad_capacity) ? (count - first) : window->quad_capacity;
+
+        SDL_Vertex *vertex = window->vertices;
+        for (size_t i = first; i < (first + batch); ++i)
+        {
+            const SDL_Color sdl_colour = {
+                .r = (Uint8)(colour[i] >> 24u),
+                .g = (Uint8)(colour[i] >> 16u),
+                .b = (Uint8)(colour[i] >> 8u),
+                .a = (Uint8)colour[i]};
+
+            const float left = x[i] - camera_x;
+            const float top = y[i] - camera_y;
+
+            vertex[0] = (SDL_Vertex){.position = {left, top}, .color = sdl_colour};
+            vertex[1] = (SDL_Vertex){.position = {left + size, top}, .color = sdl_colour};
+            vertex[2] = (SDL_Vertex){.position = {left + size, top + size}, .color = sdl_colour};
+            vertex[3] = (SDL_Vertex){.position = {left, top + size}, .color = sdl_colour};
+            vertex += 4;
+        }
+
+        if (SDL_RenderGeometry(
+                window->renderer, NULL, window->vertices, (int)(batch * 4u), window->indices, (int)(batch * 6u)) != 0)
+        {
+            result = FAILED;
+            return result;
+        }
+    }
+
+    return result;
+}
+
+Result draw_rects_window(Window *window, const DrawRect *rects, size_t count)
+{
+    assert(window != NULL);
+    assert((rects != NULL) || (count == 0u));
+
+    TRACE_ZONE("draw_rects_window");
+
+    Result result = SUCCESS;
+
+    if (count == 0u)
+    {
+        return result;
+    }
+
+    // never grow the geometry mid frame, anything past what was reserved goes in another submission
+    for (size_t first = 0u; first < count; first += window->quad_capacity)
+    {
+        const size_t batch = ((count - first) < window->quad_capacity) ? (count - first) : window->quad_capacity;
+
+        SDL_Vertex *vertex = window->vertices;
+        for (size_t i = first; i < (first + batch); ++i)
+        {
+            const SDL_Color sdl_colour = {
+                .r = (Uint8)(rects[i].colour >> 24u),
+                .g = (Uint8)(rects[i].colour >> 16u),
+                .b = (Uint8)(rects[i].colour >> 8u),
+                .a = (Uint8)rects[i].colour};
+
+            // snap to whole pixels like draw_block_window does
+            const Block *block = &rects[i].block;
+            const float left = (float)scalar_to_int(block->position.x - window->camera_x);
+            const float top = (float)scalar_to_int(block->position.y - window->camera_y);
+            const float right = left + (float)scalar_to_int(block->width);
+            const float bottom = top + (float)scalar_to_int(block->height);
+
+            vertex[0] = (SDL_Vertex){.position = {left, top}, .color = sdl_colour};
+            vertex[1] = (SDL_Vertex){.position = {right, top}, .color = sdl_colour};
+            vertex[2] = (SDL_Vertex){.position = {right, bottom}, .color = sdl_colour};
+            vertex[3] = (SDL_Vertex){.position = {left, bottom}, .color = sdl_colour};
+            vertex += 4;
+        }
+
+        if (SDL_RenderGeometry(
+                window->renderer, NULL, window->vertices, (int)(batch * 4u), window->indices, (int)(batch * 6u)) != 0)
+        {
+            result = FAILED;
+            return result;
+        }
+    }
+
+    return result;
+}
+
+Result draw_text_window(
+    Window *window, size_t slot, float x, float y, float scale, const char *text, uint8_t r, uint8_t g, uint8_t b)
+{
+    assert(window != NULL);
+    assert(slot < HUD_TEXT_SLOTS);
+    assert(text != NULL);
+
+    Result result = SUCCESS;
+    TextSlot *cached = &window->text_slots[slot];
+
+    const bool unchanged = cached->valid && (cached->x == x) && (cached->y == y) && (cached->scale == scale) &&
+                           (cached->r == r) && (cached->g == g) && (cached->b == b) &&
+                           (strncmp(cached->text, text, HUD_TEXT_LENGTH) == 0);
+
+    if (!unchanged)
+    {
+        const SDL_Color colour = {.r = r, .g = g, .b = b, .a = 0xff};
+        float pen_x = x;
+        size_t quads = 0u;
+
+        for (size_t i = 0u; (i < HUD_TEXT_LENGTH) && (text[i] != '\0'); ++i)
+        {
+            int c = (unsigned char)text[i];
+            c = ((c >= 'a') && (c <= 'z')) ? (c - 'a' + 'A') : c;
+
+            // skip blanks entirely, they only move the pen
+            if ((c > ' ') && (c < (' ' + GLYPH_COUNT)) && (font_glyphs[c - ' '] != 0u))
+            {
+                const int glyph = c - ' ';
+                write_hud_quad(
+                    &cached->vertices[quads * 4u],
+                    pen_x,
+                    y,
+                    GLYPH_WIDTH * scale,
+                    GLYPH_HEIGHT * scale,
+                    (glyph % ATLAS_COLUMNS) * CELL_WIDTH,
+                    (glyph / ATLAS_COLUMNS) * CELL_HEIGHT,
+                    colour);
+                ++quads;
+            }
+
+            pen_x += CELL_WIDTH * scale;
+        }
+
+        strncpy(cached->text, text, HUD_TEXT_LENGTH);
+        cached->text[HUD_TEXT_LENGTH] = '\0';
+        cached->x = x;
+        cached->y = y;
+        cached->scale = scale;
+        cached->r = r;
+        cached->g = g;
+        cached->b = b;
+        cached->quads = quads;
+        cached->valid = true;
+    }
+
+    cached->used = true;
+    return result;
+}
+
+Result draw_graph_window(
+    Window *window,
+    float x,
+    float y,
+    float width,
+    float height,
+    const float *samples,
+    size_t count,
+    size_t first,
+    float max_value,
+    uint8_t r,
+    uint8_t g,
+    uint8_t b)
+{
+    assert(window != NULL);
+    assert(samples != NULL);
+
+    Result result = SUCCESS;
+
+    if ((count == 0u) || ((window->hud_quads + count) > HUD_MAX_QUADS))
+    {
+        result = FAILED;
+        return result;
+    }
+
+    const SDL_Color colour = {.r = r, .g = g, .b = b, .a = 0xc0};
+    const float bar_width = width / (float)count;
+
+    for (size_t i = 0u; i < count; ++i)
+    {
+        float value = samples[(first + i) % count] / max_value;
+        value = (value > 1.0f) ? 1.0f : value;
+        value = (value < 0.0f) ? 0.0f : value;
+
+        const float bar_height = value * height;
+
+        // the solid cell is in the fifth atlas row
+        write_hud_quad(
+            &window->hud_vertices[window->hud_quads * 4u],
+            x + (bar_width * (float)i),
+            y + height - bar_height,
+            bar_width,
+            bar_height,
+            0,
+            4 * CELL_HEIGHT,
+            colour);
+        ++window->hud_quads;
+    }
+
+    return result;
+}
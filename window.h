@@ -1,16 +1,24 @@
 #ifndef _WINDOW_H_
 #define _WINDOW_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "key_event.h"
 #include "block.h"
+#include "camera.h"
 #include "result.h"
 
 /**
  * Window is responsible fro creating and destroying a window as well as rendering to it and getting event.
  */
 
+/**
+ * Size of the window in pixels.
+ */
+#define WINDOW_WIDTH 800
+#define WINDOW_HEIGHT 800
+
 /**
  * Window internal events handler.
  */
@@ -31,6 +39,38 @@ typedef struct Window Window;
  */
 Result create_window(Window **window);
 
+/**
+ * Create a hidden window that draws into a texture instead of the screen, for measuring rendering without depending on
+ * the display. Each frame is read back by post_render_window, so drawing it has finished when that returns. Where there
+ * is no display at all, set SDL_VIDEODRIVER=offscreen.
+ *
+ * The same single window limit as create_window applies.
+ *
+ * @param window
+ *  created window object.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result create_offscreen_window(Window **window);
+
+/**
+ * Make room for batches of up to a number of rectangles or particles, so drawing never has to allocate. Call this at
+ * setup with the largest batch the caller will draw, draws bigger than that are split into several submissions.
+ *
+ * @param window
+ *   The window to reserve geometry in.
+ *
+ * @param quads
+ *   Number of rectangles or particles to make room for.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED on failure
+ */
+Result reserve_window_quads(Window *window, size_t quads);
+
 /**
  * Destroy a window.
  *
@@ -69,10 +109,36 @@ Result pre_render_window(const Window *window);
 /**
  * Perform an post-render tasks.
  *
+ * This draws the HUD batched up by draw_text_window and draw_graph_window on top of everything else.
+ *
  * @param window
  *   Window to render to.
  */
-void post_render_window(const Window *window);
+void post_render_window(Window *window);
+
+/**
+ * Set the part of the world shown for the rest of the frame.
+ *
+ * Blocks and particles are given in world coordinates and moved by the camera, HUD text and graphs are not.
+ *
+ * @param window
+ *   The window to render to.
+ *
+ * @param camera
+ *   Camera to draw with.
+ */
+void set_camera_window(Window *window, const Camera *camera);
+
+/**
+ * A rectangle queued for drawing in a batch.
+ */
+typedef struct DrawRect
+{
+    Block block;
+
+    // packed as 0xRRGGBBAA
+    uint32_t colour;
+} DrawRect;
 
 /**
  * Draw a rectangle to the screen.
@@ -100,4 +166,166 @@ void post_render_window(const Window *window);
  */
 Result draw_block_window(const Window *window, const Block *block, uint8_t r, uint8_t g, uint8_t b);
 
+/**
+ * Draw a batch of small squares, in one geometry submission if reserve_window_quads made room for it.
+ *
+ * This *must* be called after window_pre_render and before window_post_render for any given frame.
+ *
+ * @param window
+ *   The window to render to.
+ *
+ * @param x
+ *   X coordinate of each square (upper left corner).
+ *
+ * @param y
+ *   Y coordinate of each square (upper left corner).
+ *
+ * @param colour
+ *   Colour of each square packed as 0xRRGGBBAA.
+ *
+ * @param count
+ *   Number of squares.
+ *
+ * @param size
+ *   Width and height of every square.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED in failure
+ */
+Result draw_particles_window(
+    Window *window, const float *x, const float *y, const uint32_t *colour, size_t count, float size);
+
+/**
+ * Draw a batch of rectangles to the screen, in order, in one submission if reserve_window_quads made room for it.
+ *
+ * This *must* be called after window_pre_render and before window_post_render for any given frame. It shares the
+ * particle vertex buffer.
+ *
+ * @param window
+ *   The window to render to.
+ *
+ * @param rects
+ *   Rectangles to draw.
+ *
+ * @param count
+ *   Number of rectangles.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED in failure
+ */
+Result draw_rects_window(Window *window, const DrawRect *rects, size_t count);
+
+/**
+ * Number of HUD text slots, each slot caches the geometry of the last string drawn in it.
+ */
+#define HUD_TEXT_SLOTS 8u
+
+/**
+ * Maximum number of characters in a HUD string, longer strings are truncated.
+ */
+#define HUD_TEXT_LENGTH 48u
+
+/**
+ * Queue text to be drawn on the HUD this frame.
+ *
+ * Text is drawn from a font atlas texture built when the window is created. The glyph geometry is only rebuilt when
+ * the text, position, scale or colour in a slot changes. Lower case letters are drawn as upper case.
+ *
+ * This *must* be called after window_pre_render and before window_post_render for any given frame.
+ *
+ * @param window
+ *   The window to render to.
+ *
+ * @param slot
+ *   Cache slot for this string, must be less than HUD_TEXT_SLOTS.
+ *
+ * @param x
+ *   X coordinate of text (upper left corner).
+ *
+ * @param y
+ *   Y coordinate of text (upper left corner).
+ *
+ * @param scale
+ *   Size of each font pixel in screen pixels.
+ *
+ * @param text
+ *   Text to draw.
+ *
+ * @param r
+ *   Red channel value.
+ *
+ * @param g
+ *   Green channel value.
+ *
+ * @param b
+ *   Blue channel value.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED in failure
+ */
+Result draw_text_window(
+    Window *window, size_t slot, float x, float y, float scale, const char *text, uint8_t r, uint8_t g, uint8_t b);
+
+/**
+ * Queue a bar graph to be drawn on the HUD this frame.
+ *
+ * This *must* be called after window_pre_render and before window_post_render for any given frame.
+ *
+ * @param window
+ *   The window to render to.
+ *
+ * @param x
+ *   X coordinate of graph (upper left corner).
+ *
+ * @param y
+ *   Y coordinate of graph (upper left corner).
+ *
+ * @param width
+ *   Graph width.
+ *
+ * @param height
+ *   Graph height, a sample of max_value fills the whole height.
+ *
+ * @param samples
+ *   Ring buffer of samples.
+ *
+ * @param count
+ *   Number of samples in the ring buffer.
+ *
+ * @param first
+ *   Index of the oldest sample, which is drawn on the left.
+ *
+ * @param max_value
+ *   Value at the top of the graph, larger samples are clipped.
+ *
+ * @param r
+ *   Red channel value.
+ *
+ * @param g
+ *   Green channel value.
+ *
+ * @param b
+ *   Blue channel value.
+ *
+ * @returns
+ *   SUCCESS on success
+ *   FAILED in failure
+ */
+Result draw_graph_window(
+    Window *window,
+    float x,
+    float y,
+    float width,
+    float height,
+    const float *samples,
+    size_t count,
+    size_t first,
+    float max_value,
+    uint8_t r,
+    uint8_t g,
+    uint8_t b);
+
 #endif
\ No newline at end of file